@@ -2,11 +2,15 @@
 #pragma once
 
 #include "Common/JitSymbols.h"
+#include "Interface/Core/BlockSamplingData.h"
+#include "Interface/Core/CompileWorkerPool.h"
 #include "Interface/Core/CPUID.h"
 #include "Interface/Core/Frontend.h"
 #include "Interface/Core/X86HelperGen.h"
 #include "Interface/Core/ObjectCache/ObjectCacheService.h"
 #include "Interface/Core/Dispatcher/Dispatcher.h"
+#include "Interface/Core/PatternDbt/rule-cache.h"
+#include "Interface/Core/PatternDbt/rule-stats.h"
 #include "Interface/IR/AOTIR.h"
 #include <FEXCore/Config/Config.h>
 #include <FEXCore/Core/Context.h>
@@ -21,6 +25,7 @@
 #include <FEXCore/fextl/set.h>
 #include <FEXCore/fextl/string.h>
 #include <FEXCore/fextl/unordered_map.h>
+#include <FEXCore/fextl/unordered_set.h>
 #include <FEXCore/fextl/vector.h>
 #include <FEXHeaderUtils/Syscalls.h>
 #include <stdint.h>
@@ -35,9 +40,12 @@
 #include <stddef.h>
 #include <queue>
 
+struct RuleSet;
+
 namespace FEXCore {
 class CodeLoader;
 class ThunkHandler;
+class SharedLookupCache;
 
 namespace CodeSerialize {
   class CodeObjectSerializeService;
@@ -74,7 +82,52 @@ namespace FEXCore::Context {
     uint64_t GuestRIP;
   };
 
-  using BlockDelinkerFunc = void(*)(FEXCore::Core::CpuStateFrame *Frame, FEXCore::Context::ExitFunctionLinkData *Record);
+  /**
+   * @brief Inline cache of an indirect branch, placed behind the call to the linker that fills it
+   *
+   * Each entry is published by its GuestRIP. Delinking empties an entry and the linker may fill it again for
+   * another target, so an exit reads the GuestRIP again after the HostBranch and only takes it if that still matches.
+   */
+  struct IndirectBranchCacheData {
+    static constexpr size_t ENTRIES = 4;
+    // Non-canonical with the low bit set, no block can start there.
+    // The exits find it with an arithmetic shift by 47, which only gives -2 for this pattern of the top bits.
+    static constexpr uint64_t EMPTY = 0xFFFF'0000'0000'0001ULL;
+
+    ExitFunctionLinkData Entries[ENTRIES];
+  };
+
+  using BlockDelinkerFunc = void(*)(uint64_t ExitFunctionLinker, FEXCore::Context::ExitFunctionLinkData *Record);
+
+  // std::mutex that remembers the thread holding it, so that the lock order around it can be asserted
+  class OwnerTrackingMutex final {
+  public:
+    void lock() {
+      Mutex.lock();
+      Owner.store(FHU::Syscalls::gettid(), std::memory_order_relaxed);
+    }
+
+    bool try_lock() {
+      if (!Mutex.try_lock()) {
+        return false;
+      }
+      Owner.store(FHU::Syscalls::gettid(), std::memory_order_relaxed);
+      return true;
+    }
+
+    void unlock() {
+      Owner.store(0, std::memory_order_relaxed);
+      Mutex.unlock();
+    }
+
+    bool IsOwnedByCurrentThread() const {
+      return Owner.load(std::memory_order_relaxed) == FHU::Syscalls::gettid();
+    }
+
+  private:
+    std::mutex Mutex;
+    std::atomic<pid_t> Owner{};
+  };
 
   class ContextImpl final : public FEXCore::Context::Context {
     public:
@@ -184,7 +237,12 @@ namespace FEXCore::Context {
       void WriteFilesWithCode(AOTIRCodeFileWriterFn Writer) override {
         IRCaptureCache.WriteFilesWithCode(Writer);
       }
+      void LoadTranslationRules(uint64_t PID) override;
+      void FinalizeRuleCache() override;
+      void RequestRuleStatsDump() override;
       void InvalidateGuestCodeRange(FEXCore::Core::InternalThreadState *Thread, uint64_t Start, uint64_t Length) override;
+      void AddNamedRegion(FEXCore::Core::InternalThreadState *Thread, uintptr_t Base, uintptr_t Size, uintptr_t Offset, const fextl::string &Filename) override;
+      void RemoveNamedRegion(FEXCore::Core::InternalThreadState *Thread, uintptr_t Base, uintptr_t Size) override;
       void InvalidateGuestCodeRange(FEXCore::Core::InternalThreadState *Thread, uint64_t Start, uint64_t Length, CodeRangeInvalidationFn callback) override;
       void MarkMemoryShared(FEXCore::Core::InternalThreadState *Thread) override;
 
@@ -222,9 +280,16 @@ namespace FEXCore::Context {
       FEX_CONFIG_OPT(AOTIRCapture, AOTIRCAPTURE);
       FEX_CONFIG_OPT(AOTIRGenerate, AOTIRGENERATE);
       FEX_CONFIG_OPT(AOTIRLoad, AOTIRLOAD);
+      FEX_CONFIG_OPT(TranslationRules, TRANSLATIONRULES);
+      FEX_CONFIG_OPT(RuleCache, RULECACHE);
+      FEX_CONFIG_OPT(RuleMining, RULEMINING);
+      FEX_CONFIG_OPT(RuleTrace, RULETRACE);
+      FEX_CONFIG_OPT(RuleStats, RULESTATS);
       FEX_CONFIG_OPT(SMCChecks, SMCCHECKS);
       FEX_CONFIG_OPT(Core, CORE);
       FEX_CONFIG_OPT(MaxInstPerBlock, MAXINST);
+      FEX_CONFIG_OPT(TierUpThreshold, TIERUPTHRESHOLD);
+      FEX_CONFIG_OPT(CompileWorkers, COMPILEWORKERS);
       FEX_CONFIG_OPT(RootFSPath, ROOTFS);
       FEX_CONFIG_OPT(ThunkHostLibsPath, THUNKHOSTLIBS);
       FEX_CONFIG_OPT(ThunkHostLibsPath32, THUNKHOSTLIBS32);
@@ -254,6 +319,23 @@ namespace FEXCore::Context {
 
     FEXCore::ForkableSharedMutex CodeInvalidationMutex;
 
+    // Blocks of every thread, and the code buffer they live in
+    fextl::unique_ptr<FEXCore::SharedLookupCache> BlockCache;
+    // Every thread emits into the shared code buffer and publishes the block, one at a time.
+    // Lock order is CodeInvalidationMutex, ThreadCreationMutex, CodeBufferWriteMutex, then the LookupCache locks.
+    // Dropping a block from every thread takes ThreadCreationMutex, so that never happens with this held.
+    OwnerTrackingMutex CodeBufferWriteMutex;
+    // Baseline blocks that ran TierUpThreshold times, they get the full pipeline until their code is invalidated.
+    // Written with CodeInvalidationMutex unique_locked, read with it shared.
+    fextl::unordered_set<uint64_t> TieredUpBlocks;
+    // Executions left for the baseline blocks, counted down by the blocks themselves.
+    // Kept out of the code buffer so the JIT code never writes to itself.
+    // Entries are never dropped, the blocks have the counter addresses baked in.
+    std::mutex TierUpCountersMutex;
+    fextl::unordered_map<uint64_t, uint32_t> TierUpCounters;
+    // Recompiles hot blocks off the guest threads, only with CompileWorkers set
+    fextl::unique_ptr<FEXCore::CPU::CompileWorkerPool> CompileWorkers;
+
     FEXCore::HostFeatures HostFeatures;
     // CPUID depends on HostFeatures so needs to be initialized after that.
     FEXCore::CPUIDEmu CPUID;
@@ -265,9 +347,8 @@ namespace FEXCore::Context {
     CustomCPUFactoryType CustomCPUFactory;
     FEXCore::Context::ExitHandler CustomExitHandler;
 
-#ifdef BLOCKSTATS
+    // Execution counts of the guest blocks, only with BLOCKSTATS or RuleMining
     fextl::unique_ptr<FEXCore::BlockSamplingData> BlockData;
-#endif
 
     SignalDelegator *SignalDelegation{};
     X86GeneratedCode X86CodeGen;
@@ -276,12 +357,17 @@ namespace FEXCore::Context {
     ~ContextImpl();
 
     bool IsPaused() const { return !Running; }
+    // Identifies the loaded translation rules, 0 without rules
+    uint64_t GetRuleSetId() const;
     void WaitForThreadsToRun() override;
     void Stop(bool IgnoreCurrentThread);
     void WaitForIdle() override;
     void SignalThread(FEXCore::Core::InternalThreadState *Thread, FEXCore::Core::SignalEvent Event);
 
     static void ThreadRemoveCodeEntry(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestRIP);
+    static void ThreadTierUpBlock(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestRIP);
+    // Sets the tier up counter of GuestRIP to Count, safe to call from any JIT thread
+    uint32_t *ArmTierUpCounter(uint64_t GuestRIP, uint32_t Count);
     static void ThreadAddBlockLink(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestDestination, FEXCore::Context::ExitFunctionLinkData *HostLink, const BlockDelinkerFunc &delinker);
 
     template<auto Fn>
@@ -292,6 +378,14 @@ namespace FEXCore::Context {
       return Fn(Frame, Record);
     }
 
+    template<auto Fn>
+    static uint64_t ThreadIndirectBranchLink(FEXCore::Core::CpuStateFrame *Frame, IndirectBranchCacheData *Record) {
+      auto Thread = Frame->Thread;
+      auto lk = GuardSignalDeferringSection<std::shared_lock>(static_cast<ContextImpl*>(Thread->CTX)->CodeInvalidationMutex, Thread);
+
+      return Fn(Frame, Record);
+    }
+
     // Wrapper which takes CpuStateFrame instead of InternalThreadState and unique_locks CodeInvalidationMutex
     // Must be called from owning thread
     static void ThreadRemoveCodeEntryFromJit(FEXCore::Core::CpuStateFrame *Frame, uint64_t GuestRIP) {
@@ -303,18 +397,48 @@ namespace FEXCore::Context {
       ThreadRemoveCodeEntry(Thread, GuestRIP);
     }
 
+    // Wrapper which takes CpuStateFrame instead of InternalThreadState and unique_locks CodeInvalidationMutex
+    // Hands the block to the compile workers instead if there are any
+    // Must be called from owning thread
+    static void ThreadTierUpBlockFromJit(FEXCore::Core::CpuStateFrame *Frame, uint64_t GuestRIP) {
+      auto Thread = Frame->Thread;
+      auto CTX = static_cast<ContextImpl*>(Thread->CTX);
+
+      LogMan::Throw::AFmt(Thread->ThreadManager.GetTID() == FHU::Syscalls::gettid(), "Must be called from owning thread {}, not {}", Thread->ThreadManager.GetTID(), FHU::Syscalls::gettid());
+      if (CTX->CompileWorkers && CTX->CompileWorkers->QueueTierUp(GuestRIP)) {
+        return;
+      }
+
+      auto lk = GuardSignalDeferringSection(CTX->CodeInvalidationMutex, Thread);
+
+      ThreadTierUpBlock(Thread, GuestRIP);
+    }
+
     void RemoveCustomIREntrypoint(uintptr_t Entrypoint);
 
     struct GenerateIRResult {
       FEXCore::IR::IRListView* IRList;
       bool IsRuleTrans;
+      bool HasRuleOps;
       FEXCore::IR::RegisterAllocationData::UniquePtr RAData;
       uint64_t TotalInstructions;
       uint64_t TotalInstructionsLength;
       uint64_t StartAddr;
       uint64_t Length;
+      // Followed hot branches out of the entry's symbol range
+      bool IsTrace;
     };
-    [[nodiscard]] GenerateIRResult GenerateIR(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestRIP, bool ExtendedDebugInfo, uint64_t MaxInst);
+    enum class CompileTier {
+      // Tiering is disabled, compiled as configured
+      Default,
+      // First compile of a block, single blocks without the IR optimization passes
+      Baseline,
+      // Recompile of a block that got hot, multiblock with every pass.
+      // Hot branches out of the symbol range are followed too, forming a trace.
+      Optimized,
+    };
+
+    [[nodiscard]] GenerateIRResult GenerateIR(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestRIP, bool ExtendedDebugInfo, uint64_t MaxInst, CompileTier Tier = CompileTier::Default);
 
     struct CompileCodeResult {
       void* CompiledCode;
@@ -325,9 +449,18 @@ namespace FEXCore::Context {
       uint64_t StartAddr;
       uint64_t Length;
     };
-    [[nodiscard]] CompileCodeResult CompileCode(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestRIP, uint64_t MaxInst = 0);
+    // Emitting takes BufferLock, it is still held on return if there is code
+    [[nodiscard]] CompileCodeResult CompileCode(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestRIP, uint64_t MaxInst, CompileTier Tier, std::unique_lock<OwnerTrackingMutex> &BufferLock);
     uintptr_t CompileBlock(FEXCore::Core::CpuStateFrame *Frame, uint64_t GuestRIP, uint64_t MaxInst = 0);
 
+    /**
+     * @brief Replaces the baseline block at GuestRIP with an optimized compile of it
+     *
+     * Called by the compile workers, the guest threads pick the new block up on their next lookup.
+     * Does nothing if the block got invalidated or tiered up in the meantime.
+     */
+    void PromoteBlock(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestRIP);
+
     // Used for thread creation from syscalls
     /**
      * @brief Initializes TID, PID and TLS data for a thread
@@ -422,10 +555,21 @@ namespace FEXCore::Context {
 
     void AddBlockMapping(FEXCore::Core::InternalThreadState *Thread, uint64_t Address, void *Ptr);
 
+    // Compiles the block and adds it to the lookup caches, unless another thread was faster
+    uintptr_t CompileAndAddBlock(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestRIP, uint64_t MaxInst, CompileTier Tier);
+    // Publishes the compiled block, CodeBufferWriteMutex must be held
+    uintptr_t AddCompiledBlock(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestRIP, CompileCodeResult &&Result);
+    // Drops a compiled block that lost the race to publish
+    static void DiscardCompiledCode(CompileCodeResult &Result);
+
     // Entry Cache
     std::mutex ExitMutex;
 
     IR::AOTIRCaptureCache IRCaptureCache;
+    CPU::RuleMatchCache RuleCache;
+    // Set once by LoadTranslationRules before guest code runs, read by every JIT thread
+    fextl::unique_ptr<RuleSet> TranslationRules;
+    CPU::RuleStatsRegistry RuleStats;
     fextl::unique_ptr<FEXCore::CodeSerialize::CodeObjectSerializeService> CodeObjectCacheService;
 
     bool StartPaused = false;
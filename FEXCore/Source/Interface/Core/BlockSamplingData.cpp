@@ -32,6 +32,7 @@ namespace FEXCore {
   }
 
   BlockSamplingData::BlockData *BlockSamplingData::GetBlockData(uint64_t RIP) {
+    std::lock_guard lk(SamplingMapMutex);
     auto it = SamplingMap.find(RIP);
     if (it != SamplingMap.end()) {
       return it->second;
@@ -44,7 +45,9 @@ namespace FEXCore {
   }
 
   BlockSamplingData::~BlockSamplingData() {
-    DumpBlockData();
+    if (DumpOnExit) {
+      DumpBlockData();
+    }
     for (auto it : SamplingMap) {
       delete it.second;
     }
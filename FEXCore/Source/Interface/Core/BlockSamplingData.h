@@ -2,6 +2,7 @@
 #pragma once
 
 #include <cstdint>
+#include <mutex>
 #include <unordered_map>
 
 namespace FEXCore {
@@ -11,15 +12,23 @@ public:
     uint64_t Start, End;
     uint64_t Min, Max;
     uint64_t TotalTime;
+    // Incremented by the JIT at every block entry
     uint64_t TotalCalls;
   };
 
-  BlockData *GetBlockData(uint64_t RIP);
+  // DumpOnExit writes the samples to output.csv when destroyed
+  explicit BlockSamplingData(bool DumpOnExit)
+    : DumpOnExit {DumpOnExit} {}
   ~BlockSamplingData();
 
+  // Safe to call from any JIT thread, the returned data lives as long as this object
+  BlockData *GetBlockData(uint64_t RIP);
+
   void DumpBlockData();
 
 private:
+  std::mutex SamplingMapMutex;
   std::unordered_map<uint64_t, BlockData*> SamplingMap;
+  bool DumpOnExit;
 };
 }
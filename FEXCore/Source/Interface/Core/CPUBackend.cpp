@@ -3,6 +3,7 @@
 #include "FEXCore/Utils/AllocatorHooks.h"
 #include "Interface/Context/Context.h"
 #include "Interface/Core/Dispatcher/Dispatcher.h"
+#include "Interface/Core/LookupCache.h"
 #include <FEXCore/Core/CPUBackend.h>
 
 #ifndef _WIN32
@@ -307,52 +308,46 @@ CPUBackend::CPUBackend(FEXCore::Core::InternalThreadState *ThreadState, size_t I
 #endif
 }
 
-CPUBackend::~CPUBackend() {
-  for (auto CodeBuffer : CodeBuffers) {
-    FreeCodeBuffer(CodeBuffer);
-  }
-  CodeBuffers.clear();
-}
+CPUBackend::~CPUBackend() = default;
 
 auto CPUBackend::GetEmptyCodeBuffer() -> CodeBuffer * {
-  if (ThreadState->CurrentFrame->SignalHandlerRefCounter == 0) {
-    if (CodeBuffers.empty()) {
-      auto NewCodeBuffer = AllocateNewCodeBuffer(InitialCodeSize);
-      EmplaceNewCodeBuffer(NewCodeBuffer);
-    } else {
-      if (CodeBuffers.size() > 1) {
-        // If we have more than one code buffer we are tracking then walk them and delete
-        // This is a cleanup step
-        for (size_t i = 1; i < CodeBuffers.size(); i++) {
-          FreeCodeBuffer(CodeBuffers[i]);
-        }
-        CodeBuffers.resize(1);
+  auto &Shared = *static_cast<Context::ContextImpl*>(ThreadState->CTX)->BlockCache;
+
+  {
+    std::lock_guard<std::recursive_mutex> lk(Shared.Lock);
+
+    // The old buffer is freed once the last thread running code from it has caught up and released it
+    auto Current = Shared.GetCodeBuffer();
+    if (!Current || Current == CurrentCodeBuffer) {
+      size_t NewSize = InitialCodeSize;
+      if (Current) {
+        // Grow the code buffer on every clear until it reaches the max
+        NewSize = std::min<size_t>(Current->Size * 1.5, MaxCodeSize);
       }
-      // Set the current code buffer to the initial
-      CurrentCodeBuffer = &CodeBuffers[0];
-
-      if (CurrentCodeBuffer->Size != MaxCodeSize) {
-        FreeCodeBuffer(*CurrentCodeBuffer);
-
-        // Resize the code buffer and reallocate our code size
-        CurrentCodeBuffer->Size *= 1.5;
-        CurrentCodeBuffer->Size = std::min(CurrentCodeBuffer->Size, MaxCodeSize);
 
-        *CurrentCodeBuffer = AllocateNewCodeBuffer(CurrentCodeBuffer->Size);
-      }
+      Shared.ClearCache(AllocateNewCodeBuffer(NewSize));
     }
-  } else {
-    // We have signal handlers that have generated code
-    // This means that we can not safely clear the code at this point in time
-    // Allocate some new code buffers that we can switch over to instead
-    auto NewCodeBuffer = AllocateNewCodeBuffer(InitialCodeSize);
-    EmplaceNewCodeBuffer(NewCodeBuffer);
+
+    CurrentCodeBuffer = Shared.GetCodeBuffer();
   }
 
-  return CurrentCodeBuffer;
+  // The thread runs what it emits, IsAddressInCodeBuffer has to know about the buffer before that.
+  // The LookupCache lock is taken before the shared one, so only once that is dropped.
+  ThreadState->LookupCache->SyncCodeBuffer();
+  return CurrentCodeBuffer.get();
+}
+
+bool CPUBackend::IsCodeBufferStale() {
+  return static_cast<Context::ContextImpl*>(ThreadState->CTX)->BlockCache->GetCodeBuffer() != CurrentCodeBuffer;
 }
 
-auto CPUBackend::AllocateNewCodeBuffer(size_t Size) -> CodeBuffer {
+void CPUBackend::ReleaseStaleCodeBuffer() {
+  if (CurrentCodeBuffer && IsCodeBufferStale()) {
+    CurrentCodeBuffer.reset();
+  }
+}
+
+auto CPUBackend::AllocateNewCodeBuffer(size_t Size) -> std::shared_ptr<CodeBuffer> {
 #ifndef _WIN32
 // MDWE (Memory-Deny-Write-Execute) is a new Linux 6.3 feature.
 // It's equivalent to systemd's `MemoryDenyWriteExecute` but implemented entirely in the kernel.
@@ -378,33 +373,28 @@ auto CPUBackend::AllocateNewCodeBuffer(size_t Size) -> CodeBuffer {
   }
 #endif
 
-  CodeBuffer Buffer;
-  Buffer.Size = Size;
-  Buffer.Ptr = static_cast<uint8_t *>(
-      FEXCore::Allocator::VirtualAlloc(Buffer.Size, true));
-  LOGMAN_THROW_AA_FMT(!!Buffer.Ptr, "Couldn't allocate code buffer");
+  auto Buffer = fextl::make_unique<CodeBuffer>();
+  Buffer->Size = Size;
+  Buffer->Ptr = static_cast<uint8_t *>(
+      FEXCore::Allocator::VirtualAlloc(Buffer->Size, true));
+  Buffer->Offset = 0;
+  LOGMAN_THROW_AA_FMT(!!Buffer->Ptr, "Couldn't allocate code buffer");
 
   if (static_cast<Context::ContextImpl*>(ThreadState->CTX)->Config.GlobalJITNaming()) {
-    static_cast<Context::ContextImpl*>(ThreadState->CTX)->Symbols.RegisterJITSpace(Buffer.Ptr, Buffer.Size);
+    static_cast<Context::ContextImpl*>(ThreadState->CTX)->Symbols.RegisterJITSpace(Buffer->Ptr, Buffer->Size);
   }
-  return Buffer;
+  return std::shared_ptr<CodeBuffer>(Buffer.release(), FreeCodeBuffer, fextl::FEXAlloc<CodeBuffer>{});
 }
 
-void CPUBackend::FreeCodeBuffer(CodeBuffer Buffer) {
-  FEXCore::Allocator::VirtualFree(Buffer.Ptr, Buffer.Size);
+void CPUBackend::FreeCodeBuffer(CodeBuffer *Buffer) {
+  FEXCore::Allocator::VirtualFree(Buffer->Ptr, Buffer->Size);
+  fextl::default_delete<CodeBuffer>{}(Buffer);
 }
 
 bool CPUBackend::IsAddressInCodeBuffer(uintptr_t Address) const {
-  for (auto &Buffer: CodeBuffers) {
-    auto start = (uintptr_t)Buffer.Ptr;
-    auto end = start + Buffer.Size;
-
-    if (Address >= start && Address < end) {
-      return true;
-    }
-  }
-
-  return false;
+  // The thread may run code from older buffers and from ones it didn't emit into itself.
+  // This is called from signal handlers, CurrentCodeBuffer may be getting replaced underneath.
+  return ThreadState->LookupCache->IsAddressInCodeBuffer(Address);
 }
 
 }
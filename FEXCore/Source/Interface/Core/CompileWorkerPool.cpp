@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: MIT
+/*
+$info$
+tags: backend|shared
+desc: Background recompiles of hot blocks
+$end_info$
+*/
+
+#include "Interface/Context/Context.h"
+#include "Interface/Core/CompileWorkerPool.h"
+
+#include <FEXCore/Debug/InternalThreadState.h>
+#include <FEXCore/Utils/SignalScopeGuards.h>
+
+namespace FEXCore::CPU {
+  CompileWorkerPool::CompileWorkerPool(FEXCore::Context::ContextImpl *CTX, uint32_t WorkerCount)
+    : CTX {CTX}
+    , WorkerCount {WorkerCount} {
+  }
+
+  CompileWorkerPool::~CompileWorkerPool() {
+    {
+      std::lock_guard lk(QueueLock);
+      Stopping = true;
+    }
+    QueueWakeup.notify_all();
+
+    for (auto &Worker : Workers) {
+      if (Worker->joinable()) {
+        Worker->join(nullptr);
+      }
+    }
+  }
+
+  bool CompileWorkerPool::QueueTierUp(uint64_t GuestRIP) {
+    // The guest thread may take a signal whose handler tiers up another block
+    auto lk = FEXCore::MaskSignalsAndLockMutex(QueueLock);
+
+    if (Stopping || Queue.size() >= MAX_QUEUED) {
+      return false;
+    }
+
+    if (Workers.empty()) {
+      StartWorkers();
+    }
+
+    if (Pending.insert(GuestRIP).second) {
+      Queue.push_back(GuestRIP);
+      QueueWakeup.notify_one();
+    }
+    return true;
+  }
+
+  void CompileWorkerPool::StartWorkers() {
+    // Signals are masked here, the workers inherit that and never take one
+    for (uint32_t i = 0; i < WorkerCount; ++i) {
+      Workers.emplace_back(FEXCore::Threads::Thread::Create(WorkerThread, this));
+    }
+  }
+
+  void *CompileWorkerPool::WorkerThread(void *Arg) {
+    auto This = static_cast<CompileWorkerPool*>(Arg);
+    FEXCore::Threads::SetThreadName("CompileWorker\0");
+
+    // Like the AOT generator each worker compiles with a thread of its own, which never runs guest code
+    auto Thread = This->CTX->CreateThread(0, 0, FEXCore::Context::Context::ManagedBy::FRONTEND, nullptr, 0);
+
+    for (;;) {
+      uint64_t GuestRIP;
+      {
+        std::unique_lock lk(This->QueueLock);
+        This->QueueWakeup.wait(lk, [This] { return This->Stopping || !This->Queue.empty(); });
+        if (This->Stopping) {
+          break;
+        }
+        GuestRIP = This->Queue.front();
+        This->Queue.pop_front();
+      }
+
+      This->CTX->PromoteBlock(Thread, GuestRIP);
+
+      std::lock_guard lk(This->QueueLock);
+      This->Pending.erase(GuestRIP);
+    }
+
+    // The object cache may still serialize blocks of this worker
+    CodeSerialize::CodeObjectSerializeService::WaitForEmptyJobQueue(&Thread->ObjectCacheRefCounter);
+    This->CTX->DestroyThread(Thread, false);
+    return nullptr;
+  }
+}
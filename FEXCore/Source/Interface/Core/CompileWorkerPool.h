@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <FEXCore/Utils/Threads.h>
+#include <FEXCore/fextl/deque.h>
+#include <FEXCore/fextl/memory.h>
+#include <FEXCore/fextl/unordered_set.h>
+#include <FEXCore/fextl/vector.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace FEXCore::Context {
+  class ContextImpl;
+}
+
+namespace FEXCore::CPU {
+  /**
+   * @brief Recompiles hot blocks in the background while the guest keeps running their baseline code
+   *
+   * Every worker compiles with a compiler of its own and swaps the optimized block in for the baseline one
+   * once it is done. The workers are only started with the first request.
+   */
+  class CompileWorkerPool final {
+    public:
+      CompileWorkerPool(FEXCore::Context::ContextImpl *CTX, uint32_t WorkerCount);
+
+      /**
+       * @brief Stops the workers, the requests still queued are dropped
+       */
+      ~CompileWorkerPool();
+
+      /**
+       * @brief Queues an optimized recompile of the block at GuestRIP
+       *
+       * Safe to call from the JIT, signals are masked while the queue is locked.
+       *
+       * @return false if the queue is full, the caller has to recompile the block itself then
+       */
+      bool QueueTierUp(uint64_t GuestRIP);
+
+    private:
+      // Requests beyond this are left to the guest threads
+      static constexpr size_t MAX_QUEUED = 4096;
+
+      static void *WorkerThread(void *Arg);
+      void StartWorkers();
+
+      FEXCore::Context::ContextImpl *CTX;
+      uint32_t WorkerCount;
+
+      std::mutex QueueLock;
+      std::condition_variable QueueWakeup;
+      fextl::deque<uint64_t> Queue;
+      // Queued or being compiled, a block is only ever requested once at a time
+      fextl::unordered_set<uint64_t> Pending;
+      bool Stopping{};
+
+      fextl::vector<fextl::unique_ptr<FEXCore::Threads::Thread>> Workers;
+  };
+}
@@ -16,6 +16,9 @@ $end_info$
 #include "Interface/Core/Frontend.h"
 #include "Interface/Core/ObjectCache/ObjectCacheService.h"
 #include "Interface/Core/OpcodeDispatcher.h"
+#include "Interface/Core/PatternDbt/parse.h"
+#include "Interface/Core/PatternDbt/rule-miner.h"
+#include "Interface/Core/PatternDbt/rule-trace.h"
 #include "Interface/Core/JIT/JITCore.h"
 #include "Interface/Core/Dispatcher/Dispatcher.h"
 #include "Interface/Core/X86Tables/X86Tables.h"
@@ -49,6 +52,7 @@ $end_info$
 #include "FEXCore/Utils/SignalScopeGuards.h"
 #include <FEXCore/Utils/Threads.h>
 #include <FEXCore/Utils/Profiler.h>
+#include <FEXCore/Utils/Telemetry.h>
 #include <FEXCore/fextl/fmt.h>
 #include <FEXCore/fextl/memory.h>
 #include <FEXCore/fextl/set.h>
@@ -80,10 +84,18 @@ $end_info$
 namespace FEXCore::Context {
   ContextImpl::ContextImpl()
   : CPUID {this}
-  , IRCaptureCache {this} {
+  , IRCaptureCache {this}
+  , RuleCache {this} {
 #ifdef BLOCKSTATS
-    BlockData = std::make_unique<FEXCore::BlockSamplingData>();
+    BlockData = fextl::make_unique<FEXCore::BlockSamplingData>(true);
+#else
+    if (Config.RuleMining()) {
+      // Only the execution counts, the rule miner writes its own report
+      BlockData = fextl::make_unique<FEXCore::BlockSamplingData>(false);
+    }
 #endif
+    BlockCache = fextl::make_unique<FEXCore::SharedLookupCache>(this);
+
     if (Config.CacheObjectCodeCompilation() != FEXCore::Config::ConfigObjectCodeHandler::CONFIG_NONE) {
       CodeObjectCacheService = fextl::make_unique<FEXCore::CodeSerialize::CodeObjectSerializeService>(this);
     }
@@ -99,12 +111,19 @@ namespace FEXCore::Context {
       Symbols.InitFile();
     }
 
+    if (Config.CompileWorkers() && Config.TierUpThreshold()) {
+      CompileWorkers = fextl::make_unique<FEXCore::CPU::CompileWorkerPool>(this, Config.CompileWorkers());
+    }
+
     // Track atomic TSO emulation configuration.
     UpdateAtomicTSOEmulationConfig();
   }
 
   ContextImpl::~ContextImpl() {
     {
+      // Workers may still be compiling, and their threads are in Threads
+      CompileWorkers.reset();
+
       if (CodeObjectCacheService) {
         CodeObjectCacheService->Shutdown();
       }
@@ -120,6 +139,61 @@ namespace FEXCore::Context {
       }
       Threads.clear();
     }
+
+    rule_trace_stop();
+  }
+
+  void ContextImpl::LoadTranslationRules(uint64_t PID) {
+    if (!Config.TranslationRules()) {
+      return;
+    }
+
+    TranslationRules = ParseTranslationRules(PID);
+
+    if (TranslationRules) {
+      rule_trace_start(Config.RuleTrace().c_str());
+      RuleStats.SetRules(TranslationRules.get());
+      RuleStats.StartDumper(Config.RuleStats());
+    }
+  }
+
+  uint64_t ContextImpl::GetRuleSetId() const {
+    return TranslationRules ? TranslationRules->id : 0;
+  }
+
+  void ContextImpl::FinalizeRuleCache() {
+    RuleCache.FinalizeRuleCache();
+
+    if (Config.RuleMining()) {
+      rule_miner_report();
+    }
+
+    rule_trace_stop();
+
+    RuleStats.StopDumper();
+
+    const auto Total = RuleStats.Collect();
+    LogMan::Msg::DFmt("Rules: {} matched covering {} guest instructions, {} translated",
+                      Total.matched_rules, Total.matched_instrs, Total.translated_rules);
+
+    FEXCORE_TELEMETRY_INIT(BlocksAttempted, TYPE_RULE_BLOCKS_ATTEMPTED);
+    FEXCORE_TELEMETRY_INIT(BlocksTranslated, TYPE_RULE_BLOCKS_TRANSLATED);
+    FEXCORE_TELEMETRY_INIT(GuestInstrs, TYPE_RULE_GUEST_INSTRS);
+    FEXCORE_TELEMETRY_INIT(MatchTime, TYPE_RULE_MATCH_NS);
+    FEXCORE_TELEMETRY_INIT(HostBytes, TYPE_RULE_HOST_BYTES);
+    FEXCORE_TELEMETRY_INIT(IRGuestInstrs, TYPE_RULE_IR_GUEST_INSTRS);
+    FEXCORE_TELEMETRY_INIT(IRHostBytes, TYPE_RULE_IR_HOST_BYTES);
+    FEXCORE_TELEMETRY_SET(BlocksAttempted, Total.blocks_attempted);
+    FEXCORE_TELEMETRY_SET(BlocksTranslated, Total.blocks_rule_only + Total.blocks_mixed);
+    FEXCORE_TELEMETRY_SET(GuestInstrs, Total.matched_instrs);
+    FEXCORE_TELEMETRY_SET(MatchTime, Total.match_ns);
+    FEXCORE_TELEMETRY_SET(HostBytes, Total.rule_host_bytes);
+    FEXCORE_TELEMETRY_SET(IRGuestInstrs, Total.ir_guest_instrs);
+    FEXCORE_TELEMETRY_SET(IRHostBytes, Total.ir_host_bytes);
+  }
+
+  void ContextImpl::RequestRuleStatsDump() {
+    RuleStats.RequestDump();
   }
 
   uint64_t ContextImpl::RestoreRIPFromHostPC(FEXCore::Core::InternalThreadState *Thread, uint64_t HostPC) {
@@ -410,6 +484,7 @@ namespace FEXCore::Context {
       std::lock_guard<std::mutex> lk(ThreadCreationMutex);
       // Walk the threads and tell them to clear their caches
       // Useful when our block size is set to a large number and we need to step a single instruction
+      std::lock_guard lkBuffer(CodeBufferWriteMutex);
       for (auto &Thread : Threads) {
         ClearCodeCache(Thread);
       }
@@ -536,6 +611,8 @@ namespace FEXCore::Context {
 
     Thread->CurrentFrame->Pointers.Common.L1Pointer = Thread->LookupCache->GetL1Pointer();
     Thread->CurrentFrame->Pointers.Common.L2Pointer = Thread->LookupCache->GetPagePointer();
+    Thread->CurrentFrame->Pointers.Common.SharedGenerationPointer = BlockCache->GetGenerationPointer();
+    Thread->CurrentFrame->Pointers.Common.GenerationPointer = Thread->LookupCache->GetGenerationPointer();
 
     Dispatcher->InitThreadPointers(Thread);
 
@@ -690,6 +767,12 @@ namespace FEXCore::Context {
 
     // Clean up dead stacks
     FEXCore::Threads::Thread::CleanupAfterFork();
+
+    // The compile workers died with the fork and their queue lock might be held, leak them and start over
+    if (CompileWorkers) {
+      (void)CompileWorkers.release();
+      CompileWorkers = fextl::make_unique<FEXCore::CPU::CompileWorkerPool>(this, Config.CompileWorkers());
+    }
   }
 
   void ContextImpl::LockBeforeFork(FEXCore::Core::InternalThreadState *Thread) {
@@ -712,8 +795,10 @@ namespace FEXCore::Context {
     }
     std::lock_guard<std::recursive_mutex> lk(Thread->LookupCache->WriteLock);
 
-    Thread->LookupCache->ClearCache();
+    // The code buffer is shared, if this thread's is still the current one then every thread moves on to a new one.
+    // Otherwise another thread did that already and this one only catches up.
     Thread->CPUBackend->ClearCache();
+    Thread->LookupCache->SyncCodeBuffer();
     Thread->DebugStore.clear();
   }
 
@@ -749,7 +834,7 @@ namespace FEXCore::Context {
     }
   }
 
-  ContextImpl::GenerateIRResult ContextImpl::GenerateIR(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestRIP, bool ExtendedDebugInfo, uint64_t MaxInst) {
+  ContextImpl::GenerateIRResult ContextImpl::GenerateIR(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestRIP, bool ExtendedDebugInfo, uint64_t MaxInst, CompileTier Tier) {
     FEXCORE_PROFILE_SCOPED("GenerateIR");
 
     Thread->OpDispatcher->ReownOrClaimBuffer();
@@ -759,7 +844,9 @@ namespace FEXCore::Context {
     uint64_t TotalInstructionsLength {0};
 
     bool HasCustomIR{};
+    bool HasRuleMatch{false};
     bool IsRuleTrans{false};
+    bool IsTrace{false};
 
     if (HasCustomIRHandlers.load(std::memory_order_relaxed)) {
       std::shared_lock lk(CustomIRMutex);
@@ -778,6 +865,17 @@ namespace FEXCore::Context {
 
       bool HadDispatchError {false};
 
+      // Baseline blocks are decoded alone, hot ones are followed into multiblock regions
+      const bool Multiblock = Tier == CompileTier::Optimized || (Tier == CompileTier::Default && Config.Multiblock());
+      Thread->FrontendDecoder->SetMultiblock(Multiblock);
+      Thread->OpDispatcher->SetMultiblock(Multiblock);
+      // The tiered up blocks are the ones that ran often, their edges are the hot ones
+      Thread->FrontendDecoder->SetHotBlocks(Tier == CompileTier::Optimized ? &TieredUpBlocks : nullptr);
+
+      // Blocks are still decoded with a cached match, the executable ranges have to be tracked
+      auto CachedRules = Config.RuleCache() ? RuleCache.Fetch(Thread, GuestRIP) : nullptr;
+      Thread->FrontendDecoder->SetBuildShadowInstructions(!CachedRules || Config.RuleMining());
+
       Thread->FrontendDecoder->DecodeInstructionsAtEntry(Thread, GuestCode, GuestRIP, MaxInst, [Thread](uint64_t BlockEntry, uint64_t Start, uint64_t Length) {
         if (Thread->LookupCache->AddBlockExecutableRange(BlockEntry, Start, Length)) {
           static_cast<ContextImpl*>(Thread->CTX)->SyscallHandler->MarkGuestExecutableRange(Thread, Start, Length);
@@ -786,16 +884,53 @@ namespace FEXCore::Context {
 
       auto BlockInfo = Thread->FrontendDecoder->GetDecodedBlockInfo();
       auto CodeBlocks = &BlockInfo->Blocks;
+      IsTrace = Thread->FrontendDecoder->DecodedTrace();
 
-      if (CodeBlocks->size() <= 1)
-        IsRuleTrans = Thread->CPUBackend->MatchTranslationRule(static_cast<const void*>(&CodeBlocks->at(0)));
-      else
-        LogMan::Msg::EFmt("CodeBlocks Size > 1: {}", CodeBlocks->size());
+      // The rule cache only knows single block functions
+      const bool SingleBlock = CodeBlocks->size() == 1;
+
+      if (SingleBlock && CachedRules) {
+        HasRuleMatch = CachedRules->record_num &&
+          Thread->CPUBackend->RestoreTranslationRules(GuestRIP, CachedRules->data, CachedRules->data_size, CachedRules->record_num);
+      }
+      else {
+        HasRuleMatch = Thread->CPUBackend->MatchTranslationRule(static_cast<const void*>(BlockInfo));
+
+        if (SingleBlock && Config.RuleCache() && Thread->FrontendDecoder->DecodedMinAddress == GuestRIP) {
+          fextl::vector<uint8_t> Data;
+          const uint32_t RecordNum = HasRuleMatch ? Thread->CPUBackend->SaveTranslationRules(GuestRIP, &Data) : 0;
+          RuleCache.Store(Thread, GuestRIP, Thread->FrontendDecoder->DecodedMaxAddress - GuestRIP, RecordNum, Data);
+        }
+      }
+
+      // Record what the rules leave to the IR for the rule miner
+      if (Config.RuleMining()) {
+        const auto Calls = &BlockData->GetBlockData(GuestRIP)->TotalCalls;
+        for (auto const &Block : *CodeBlocks) {
+          fextl::vector<uint8_t> Covered(Block.NumInstructions);
+          for (size_t i = 0; i < Block.NumInstructions; ++i) {
+            Covered[i] = HasRuleMatch && Thread->CPUBackend->GetRuleCoverage(Block.DecodedInstructions[i].PC) != CPU::CPUBackend::RuleCoverage::NONE;
+          }
+          rule_miner_record(Block.Entry, Calls, Block.guest_instr, Block.NumInstructions, Covered.data());
+        }
+      }
+
+      // Blocks fully covered by rules skip the IR, the others mix rule and IR translated instructions.
+      // Functions with multiple blocks always go through the IR so their blocks can branch to each other.
+      if (HasRuleMatch && SingleBlock) {
+        auto const &Block = CodeBlocks->at(0);
+        IsRuleTrans = true;
+        for (size_t i = 0; i < Block.NumInstructions && IsRuleTrans; ++i) {
+          IsRuleTrans = Thread->CPUBackend->GetRuleCoverage(Block.DecodedInstructions[i].PC) != CPU::CPUBackend::RuleCoverage::NONE;
+        }
+      }
 
       if (IsRuleTrans) {
         // LogMan::Msg::IFmt("Use Translation Block, Skip IR Block.");
         IsRuleTrans = false;
-        return { nullptr, true, nullptr, 0, 0, 0, 0 };
+        // The rule records only reference the shadow x86 instructions, which stay owned until CompileCode is done.
+        Thread->FrontendDecoder->DelayedDisownBuffer();
+        return { nullptr, true, false, nullptr, 0, 0, 0, 0, false };
       }
 
       Thread->OpDispatcher->BeginFunction(GuestRIP, CodeBlocks, BlockInfo->TotalInstructionCount, BlockInfo->Is64BitMode);
@@ -814,6 +949,9 @@ namespace FEXCore::Context {
 
         uint64_t InstsInBlock = Block.NumInstructions;
 
+        // Blocks can overlap, a rule that started in another block is translated with the IR here
+        bool InRule {false};
+
         for (size_t i = 0; i < InstsInBlock; ++i) {
           FEXCore::X86Tables::X86InstInfo const* TableInfo {nullptr};
           FEXCore::X86Tables::DecodedInst const* DecodedInfo {nullptr};
@@ -847,7 +985,33 @@ namespace FEXCore::Context {
             Thread->OpDispatcher->SetCurrentCodeBlock(NextOpBlock);
           }
 
-          if (TableInfo && TableInfo->OpcodeDispatcher) {
+          auto Coverage = HasRuleMatch ? Thread->CPUBackend->GetRuleCoverage(DecodedInfo->PC) : CPU::CPUBackend::RuleCoverage::NONE;
+          if (Coverage == CPU::CPUBackend::RuleCoverage::BODY && !InRule) {
+            Coverage = CPU::CPUBackend::RuleCoverage::NONE;
+          }
+          InRule = Coverage != CPU::CPUBackend::RuleCoverage::NONE;
+
+          if (Coverage == CPU::CPUBackend::RuleCoverage::EXIT) {
+            // The rule covers the rest of the block and leaves it
+            Thread->OpDispatcher->RuleTranslation(Block.Entry + BlockInstructionsLength - GuestRIP, &Block.DecodedInstructions[InstsInBlock - 1]);
+            for (; i < InstsInBlock; ++i) {
+              BlockInstructionsLength += Block.DecodedInstructions[i].InstSize;
+              TotalInstructionsLength += Block.DecodedInstructions[i].InstSize;
+              ++TotalInstructions;
+            }
+            break;
+          }
+          else if (Coverage != CPU::CPUBackend::RuleCoverage::NONE) {
+            // Only the first instruction of a rule emits it
+            Thread->OpDispatcher->ResetDecodeFailure();
+            if (Coverage == CPU::CPUBackend::RuleCoverage::HEAD) {
+              Thread->OpDispatcher->RuleTranslation(Block.Entry + BlockInstructionsLength - GuestRIP);
+            }
+            BlockInstructionsLength += DecodedInfo->InstSize;
+            TotalInstructionsLength += DecodedInfo->InstSize;
+            ++TotalInstructions;
+          }
+          else if (TableInfo && TableInfo->OpcodeDispatcher) {
             auto Fn = TableInfo->OpcodeDispatcher;
             Thread->OpDispatcher->ResetHandledLock();
             Thread->OpDispatcher->ResetDecodeFailure();
@@ -881,7 +1045,7 @@ namespace FEXCore::Context {
           if (HadDispatchError && TotalInstructions == 0) {
             // Couldn't handle any instruction in op dispatcher
             Thread->OpDispatcher->ResetWorkingList();
-            return { nullptr, false, nullptr, 0, 0, 0, 0 };
+            return { nullptr, false, false, nullptr, 0, 0, 0, 0, false };
           }
 
           if (NeedsBlockEnd) {
@@ -917,7 +1081,7 @@ namespace FEXCore::Context {
     }
 
     // Run the passmanager over the IR from the dispatcher
-    Thread->PassManager->Run(IREmitter);
+    Thread->PassManager->Run(IREmitter, Tier == CompileTier::Baseline);
 
     // Debug
     {
@@ -934,15 +1098,17 @@ namespace FEXCore::Context {
     return {
       .IRList = IRList,
       .IsRuleTrans = false,
+      .HasRuleOps = HasRuleMatch,
       .RAData = std::move(RAData),
       .TotalInstructions = TotalInstructions,
       .TotalInstructionsLength = TotalInstructionsLength,
       .StartAddr = Thread->FrontendDecoder->DecodedMinAddress,
       .Length = Thread->FrontendDecoder->DecodedMaxAddress - Thread->FrontendDecoder->DecodedMinAddress,
+      .IsTrace = IsTrace,
     };
   }
 
-  ContextImpl::CompileCodeResult ContextImpl::CompileCode(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestRIP, uint64_t MaxInst) {
+  ContextImpl::CompileCodeResult ContextImpl::CompileCode(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestRIP, uint64_t MaxInst, CompileTier Tier, std::unique_lock<OwnerTrackingMutex> &BufferLock) {
     FEXCore::IR::IRListView *IRList {};
     bool GeneratedRule {};
     FEXCore::Core::DebugData *DebugData {};
@@ -955,6 +1121,13 @@ namespace FEXCore::Context {
     if (CodeObjectCacheService) {
       auto CodeCacheEntry = CodeObjectCacheService->FetchCodeObjectFromCache(GuestRIP);
       if (CodeCacheEntry) {
+        // The frontend doesn't decode the block, track its executable range here instead
+        const auto GuestCodeStart = GuestRIP + CodeCacheEntry->Data->GuestCodeOffset;
+        if (Thread->LookupCache->AddBlockExecutableRange(GuestRIP, GuestCodeStart, CodeCacheEntry->Data->GuestCodeLength)) {
+          SyscallHandler->MarkGuestExecutableRange(Thread, GuestCodeStart, CodeCacheEntry->Data->GuestCodeLength);
+        }
+
+        BufferLock.lock();
         auto CompiledCode = Thread->CPUBackend->RelocateJITObjectCode(GuestRIP, CodeCacheEntry);
         if (CompiledCode) {
           return {
@@ -967,6 +1140,7 @@ namespace FEXCore::Context {
               .Length = 0,          // Unused
           };
         }
+        BufferLock.unlock();
       }
     }
 
@@ -989,12 +1163,15 @@ namespace FEXCore::Context {
         StartAddr = _StartAddr;
         Length = _Length;
         GeneratedIR = _GeneratedIR;
+
+        // Cached IR went through every pass already
+        Tier = CompileTier::Default;
       }
     }
 
     if (IRList == nullptr) {
       // Generate IR + Meta Info
-      auto [IRCopy, _GeneratedRule, RACopy, TotalInstructions, TotalInstructionsLength, _StartAddr, _Length] = GenerateIR(Thread, GuestRIP, Config.GDBSymbols(), MaxInst);
+      auto [IRCopy, _GeneratedRule, HasRuleOps, RACopy, TotalInstructions, TotalInstructionsLength, _StartAddr, _Length, IsTrace] = GenerateIR(Thread, GuestRIP, Config.GDBSymbols(), MaxInst, Tier);
 
       // Setup pointers to internal structures
       IRList = IRCopy;
@@ -1005,22 +1182,40 @@ namespace FEXCore::Context {
       Length = _Length;
 
       // These blocks aren't already in the cache
-      if (GeneratedRule)
+      // IR with rule ops depends on the rule match of this compile, it can't be cached
+      // Baseline IR is replaced once the block is hot, only the optimized IR is worth caching
+      // Traces depend on which blocks got hot in this run
+      if (GeneratedRule || HasRuleOps || Tier == CompileTier::Baseline || IsTrace)
         GeneratedIR = false;
       else
         GeneratedIR = true;
+
+      // The guest range of a trace spans code of other functions and the gaps between them, nothing can hash it.
+      // No length keeps it out of the code object cache as well.
+      if (IsTrace) {
+        Length = 0;
+      }
     }
 
     if (IRList == nullptr && !GeneratedRule) {
+      Thread->FrontendDecoder->DelayedDisownShadowBuffer();
       return {};
     }
 
     // Attempt to get the CPU backend to compile this code
+    // Blocks from rules alone aren't compiled any better the second time
+    const uint32_t TierUpCount = Tier == CompileTier::Baseline && IRList ? Config.TierUpThreshold() : 0;
+    BufferLock.lock();
+    auto CompiledCode = Thread->CPUBackend->CompileCode(GuestRIP, IRList, DebugData, RAData.get(), TierUpCount);
+
+    // Rule translation reads the shadow x86 instructions while compiling.
+    Thread->FrontendDecoder->DelayedDisownShadowBuffer();
+
     return {
       // FEX currently throws away the CPUBackend::CompiledCode object other than the entrypoint
       // In the future with code caching getting wired up, we will pass the rest of the data forward.
       // TODO: Pass the data forward when code caching is wired up to this.
-      .CompiledCode = Thread->CPUBackend->CompileCode(GuestRIP, IRList, DebugData, RAData.get()).BlockEntry,
+      .CompiledCode = CompiledCode.BlockEntry,
       .IRData = IRList,
       .DebugData = DebugData,
       .RAData = std::move(RAData),
@@ -1037,12 +1232,113 @@ namespace FEXCore::Context {
     // Invalidate might take a unique lock on this, to guarantee that during invalidation no code gets compiled
     auto lk = GuardSignalDeferringSection<std::shared_lock>(CodeInvalidationMutex, Thread);
 
+    // The dispatcher also comes here when the shared cache moved on, even if L1 still has the block
+    Thread->LookupCache->SyncCodeBuffer();
+
+    // Coming from the dispatcher nothing runs from the older code buffers anymore, unless a signal handler interrupted it
+    if (Thread->CurrentFrame->SignalHandlerRefCounter == 0) {
+      if (Thread->LookupCache->ReleaseCodeBuffers()) {
+        // The return stack may still continue into them
+        Thread->CurrentFrame->ClearReturnStack();
+      }
+      Thread->CPUBackend->ReleaseStaleCodeBuffer();
+    }
+
     // Is the code in the cache?
     // The backends only check L1 and L2, not L3
     if (auto HostCode = Thread->LookupCache->FindBlock(GuestRIP)) {
       return HostCode;
     }
 
+    auto Tier = CompileTier::Default;
+    if (Config.TierUpThreshold()) {
+      Tier = TieredUpBlocks.contains(GuestRIP) ? CompileTier::Optimized : CompileTier::Baseline;
+    }
+
+    return CompileAndAddBlock(Thread, GuestRIP, MaxInst, Tier);
+  }
+
+  void ContextImpl::PromoteBlock(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestRIP) {
+    FEXCORE_PROFILE_SCOPED("PromoteBlock");
+
+    uintptr_t Baseline {};
+    uint64_t Generation {};
+    CompileCodeResult Result {};
+    {
+      // Invalidation waits for the compile like it does for CompileBlock.
+      // Compile workers never take signals, nothing to defer here.
+      std::shared_lock lk(CodeInvalidationMutex);
+
+      // Invalidated in the meantime, or a guest thread tiered it up itself
+      Baseline = BlockCache->FindBlock(GuestRIP);
+      if (!Baseline || TieredUpBlocks.contains(GuestRIP)) {
+        return;
+      }
+      Generation = BlockCache->GetGeneration();
+
+      // Workers never run code, they can always drop the older code buffers
+      Thread->LookupCache->ReleaseCodeBuffers();
+
+      // The guest threads keep running the baseline block until the optimized one is published
+      std::unique_lock lkBuffer(CodeBufferWriteMutex, std::defer_lock);
+      Result = CompileCode(Thread, GuestRIP, 0, CompileTier::Optimized, lkBuffer);
+    }
+
+    if (Result.CompiledCode == nullptr) {
+      return;
+    }
+
+    // Swapping the block needs the same exclusion as invalidating it, but only for the swap
+    std::unique_lock lk(CodeInvalidationMutex);
+
+    // Invalidated, moved on to a new code buffer, or tiered up by a guest thread while compiling
+    if (BlockCache->GetGeneration() != Generation || BlockCache->FindBlock(GuestRIP) != Baseline ||
+        !TieredUpBlocks.insert(GuestRIP).second) {
+      DiscardCompiledCode(Result);
+      return;
+    }
+
+    // Threads still inside the baseline block finish running it, their next lookup finds the optimized one.
+    // This takes ThreadCreationMutex, which must not be taken with CodeBufferWriteMutex held.
+    ThreadRemoveCodeEntry(Thread, GuestRIP);
+
+    // Step clears the caches without CodeInvalidationMutex
+    std::lock_guard lkBuffer(CodeBufferWriteMutex);
+    if (BlockCache->GetGeneration() != Generation) {
+      DiscardCompiledCode(Result);
+      return;
+    }
+
+    AddCompiledBlock(Thread, GuestRIP, std::move(Result));
+  }
+
+  uintptr_t ContextImpl::CompileAndAddBlock(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestRIP, uint64_t MaxInst, CompileTier Tier) {
+    // Decoding, the IR passes and register allocation run in parallel, only emitting and publishing the block is serialized
+    std::unique_lock lkBuffer(CodeBufferWriteMutex, std::defer_lock);
+    auto Result = CompileCode(Thread, GuestRIP, MaxInst, Tier, lkBuffer);
+
+    if (Result.CompiledCode == nullptr) {
+      return 0;
+    }
+
+    // Another thread may have published the block while this one compiled it, its copy wins
+    if (auto HostCode = Thread->LookupCache->FindBlock(GuestRIP)) {
+      DiscardCompiledCode(Result);
+      return HostCode;
+    }
+
+    return AddCompiledBlock(Thread, GuestRIP, std::move(Result));
+  }
+
+  void ContextImpl::DiscardCompiledCode(CompileCodeResult &Result) {
+    // The code stays behind in the code buffer, unreachable until the buffer is cleared
+    delete Result.DebugData;
+    if (Result.IRData && Result.IRData->IsCopy()) {
+      delete Result.IRData;
+    }
+  }
+
+  uintptr_t ContextImpl::AddCompiledBlock(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestRIP, CompileCodeResult &&Result) {
     void *CodePtr {};
     FEXCore::IR::IRListView *IRList {};
     FEXCore::Core::DebugData *DebugData {};
@@ -1050,7 +1346,7 @@ namespace FEXCore::Context {
     bool GeneratedIR {};
     uint64_t StartAddr {}, Length {};
 
-    auto [Code, IR, Data, RAData, Generated, _StartAddr, _Length] = CompileCode(Thread, GuestRIP, MaxInst);
+    auto [Code, IR, Data, RAData, Generated, _StartAddr, _Length] = std::move(Result);
     CodePtr = Code;
     IRList = IR;
     DebugData = Data;
@@ -1058,10 +1354,6 @@ namespace FEXCore::Context {
     StartAddr = _StartAddr;
     Length = _Length;
 
-    if (CodePtr == nullptr) {
-      return 0;
-    }
-
     // The core managed to compile the code.
     if (Config.BlockJITNaming()) {
       auto FragmentBasePtr = reinterpret_cast<uint8_t *>(CodePtr);
@@ -1089,16 +1381,19 @@ namespace FEXCore::Context {
     }
 
     // Tell the object cache service to serialize the code if enabled
+    // Hashes are filled in by the service
     if (CodeObjectCacheService &&
         Config.CacheObjectCodeCompilation == FEXCore::Config::ConfigObjectCodeHandler::CONFIG_READWRITE &&
-        DebugData) {
+        DebugData && DebugData->Relocatable && Length) {
       CodeObjectCacheService->AsyncAddSerializationJob(fextl::make_unique<CodeSerialize::AsyncJobHandler::SerializationJobData>(
         CodeSerialize::AsyncJobHandler::SerializationJobData {
           .GuestRIP = GuestRIP,
+          .GuestCodeStart = StartAddr,
           .GuestCodeLength = Length,
           .GuestCodeHash = 0,
-          .HostCodeBegin = CodePtr,
+          .HostCodeBegin = reinterpret_cast<uint8_t *>(CodePtr) - DebugData->HostEntryOffset,
           .HostCodeLength = DebugData->HostCodeSize,
+          .HostEntryOffset = DebugData->HostEntryOffset,
           .HostCodeHash = 0,
           .ThreadJobRefCount = &Thread->ObjectCacheRefCounter,
           .Relocations = std::move(*DebugData->Relocations),
@@ -1188,35 +1483,59 @@ namespace FEXCore::Context {
     }
   }
 
-  static void InvalidateGuestThreadCodeRange(FEXCore::Core::InternalThreadState *Thread, uint64_t Start, uint64_t Length) {
+  static void InvalidateGuestThreadCodeRange(FEXCore::Core::InternalThreadState *Thread, const fextl::vector<uint64_t> &Blocks) {
     std::lock_guard<std::recursive_mutex> lk(Thread->LookupCache->WriteLock);
 
-    auto lower = Thread->LookupCache->CodePages.lower_bound(Start >> 12);
-    auto upper = Thread->LookupCache->CodePages.upper_bound((Start + Length - 1) >> 12);
-
-    for (auto it = lower; it != upper; it++) {
-      for (auto Address: it->second) {
-        ContextImpl::ThreadRemoveCodeEntry(Thread, Address);
-      }
-      it->second.clear();
+    for (auto Address : Blocks) {
+      Thread->DebugStore.erase(Address);
     }
+    Thread->LookupCache->Erase(Blocks);
   }
 
   static void InvalidateGuestCodeRangeInternal(FEXCore::Core::InternalThreadState *CallingThread, ContextImpl *CTX, uint64_t Start, uint64_t Length) {
+    LOGMAN_THROW_AA_FMT(!CTX->CodeBufferWriteMutex.IsOwnedByCurrentThread(), "ThreadCreationMutex must be taken before CodeBufferWriteMutex");
     std::lock_guard lk(static_cast<ContextImpl*>(CTX)->ThreadCreationMutex);
 
+    // The blocks are shared, only the L1 and L2 of each thread are its own
+    const auto Blocks = CTX->BlockCache->EraseRange(Start, Length);
+
+    // Traces are decoded along hot blocks, their code may be unmapped or rewritten now.
+    // Both callers hold CodeInvalidationMutex unique_locked.
+    for (auto Address : Blocks) {
+      CTX->TieredUpBlocks.erase(Address);
+    }
+    std::erase_if(CTX->TieredUpBlocks, [Start, Length](uint64_t Address) {
+      return Address >= Start && Address - Start < Length;
+    });
+
     for (auto &Thread : static_cast<ContextImpl*>(CTX)->Threads) {
 
       // TODO: Skip calling thread.
       // Remove once frontend has thread ownership.
       if (CallingThread == Thread) continue;
-      InvalidateGuestThreadCodeRange(Thread, Start, Length);
+      InvalidateGuestThreadCodeRange(Thread, Blocks);
     }
 
     // Now invalidate calling thread's code.
     if (CallingThread) {
-      InvalidateGuestThreadCodeRange(CallingThread, Start, Length);
+      InvalidateGuestThreadCodeRange(CallingThread, Blocks);
+    }
+  }
+
+  void ContextImpl::AddNamedRegion(FEXCore::Core::InternalThreadState *Thread, uintptr_t Base, uintptr_t Size, uintptr_t Offset, const fextl::string &Filename) {
+    if (CodeObjectCacheService) {
+      CodeObjectCacheService->AsyncAddNamedRegionJob(Base, Size, Offset, Filename);
+    }
+  }
+
+  void ContextImpl::RemoveNamedRegion(FEXCore::Core::InternalThreadState *Thread, uintptr_t Base, uintptr_t Size) {
+    if (!CodeObjectCacheService) {
+      return;
     }
+
+    // A thread may be relocating code out of the region's object file, don't unmap it underneath
+    auto lk = GuardSignalDeferringSectionWithFallback(CodeInvalidationMutex, Thread);
+    CodeObjectCacheService->AsyncRemoveNamedRegionJob(Base, Size);
   }
 
   void ContextImpl::InvalidateGuestCodeRange(FEXCore::Core::InternalThreadState *Thread, uint64_t Start, uint64_t Length) {
@@ -1244,11 +1563,15 @@ namespace FEXCore::Context {
       UpdateAtomicTSOEmulationConfig();
 
       if (Config.TSOAutoMigration) {
+        // Other threads may be compiling into the shared cache, exclude them the same way ClearCodeCache's callers do
+        auto lk = GuardSignalDeferringSectionWithFallback(CodeInvalidationMutex, Thread);
         std::lock_guard<std::mutex> lkThreads(ThreadCreationMutex);
+        std::lock_guard lkBuffer(CodeBufferWriteMutex);
 
         // Only the lookup cache is cleared here, so that old code can keep running until next compilation
         std::lock_guard<std::recursive_mutex> lkLookupCache(Thread->LookupCache->WriteLock);
-        Thread->LookupCache->ClearCache();
+        BlockCache->ClearCache();
+        Thread->LookupCache->SyncCodeBuffer();
 
         // DebugStore also needs to be cleared
         Thread->DebugStore.clear();
@@ -1262,13 +1585,42 @@ namespace FEXCore::Context {
     Thread->LookupCache->AddBlockLink(GuestDestination, HostLink, delinker);
   }
 
+  void ContextImpl::ThreadTierUpBlock(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestRIP) {
+    LogMan::Throw::AFmt(static_cast<ContextImpl*>(Thread->CTX)->CodeInvalidationMutex.try_lock() == false, "CodeInvalidationMutex needs to be unique_locked here");
+
+    auto CTX = static_cast<ContextImpl*>(Thread->CTX);
+
+    // Threads racing through the baseline block can all reach the end of its count, only the first drops it.
+    // The next lookup misses and compiles the block again, optimized.
+    if (CTX->TieredUpBlocks.insert(GuestRIP).second) {
+      ThreadRemoveCodeEntry(Thread, GuestRIP);
+    }
+  }
+
+  uint32_t *ContextImpl::ArmTierUpCounter(uint64_t GuestRIP, uint32_t Count) {
+    // Map nodes don't move, a stale baseline block of the same RIP counts down the new one harmlessly
+    std::lock_guard lk(TierUpCountersMutex);
+    auto &Counter = TierUpCounters[GuestRIP];
+    Counter = Count;
+    return &Counter;
+  }
+
   void ContextImpl::ThreadRemoveCodeEntry(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestRIP) {
     LogMan::Throw::AFmt(static_cast<ContextImpl*>(Thread->CTX)->CodeInvalidationMutex.try_lock() == false, "CodeInvalidationMutex needs to be unique_locked here");
 
-    std::lock_guard<std::recursive_mutex> lk(Thread->LookupCache->WriteLock);
+    auto CTX = static_cast<ContextImpl*>(Thread->CTX);
+    LOGMAN_THROW_AA_FMT(!CTX->CodeBufferWriteMutex.IsOwnedByCurrentThread(), "ThreadCreationMutex must be taken before CodeBufferWriteMutex");
+    CTX->BlockCache->Erase(GuestRIP);
 
-    Thread->DebugStore.erase(GuestRIP);
-    Thread->LookupCache->Erase(Thread->CurrentFrame, GuestRIP);
+    // Other threads may still find the block in their L1 or L2
+    const fextl::vector<uint64_t> Blocks {GuestRIP};
+    std::lock_guard lkThreads(CTX->ThreadCreationMutex);
+    for (auto &OtherThread : CTX->Threads) {
+      if (OtherThread != Thread) {
+        InvalidateGuestThreadCodeRange(OtherThread, Blocks);
+      }
+    }
+    InvalidateGuestThreadCodeRange(Thread, Blocks);
   }
 
   CustomIRResult ContextImpl::AddCustomIREntrypoint(uintptr_t Entrypoint, CustomIREntrypointHandler Handler, void *Creator, void *Data) {
@@ -21,6 +21,7 @@
 #include <csignal>
 #include <cstring>
 #include <signal.h>
+#include <utility>
 
 namespace FEXCore::CPU {
 
@@ -108,6 +109,17 @@ void Dispatcher::EmitDispatcher() {
   auto RipReg = TMP3;
   ldr(RipReg, STATE_PTR(CpuStateFrame, State.rip));
 
+  ARMEmitter::ForwardLabel NoBlock;
+
+  // Once the shared block cache moved on, catch up with it through CompileBlock.
+  // That drops the code buffers this thread doesn't run code from anymore.
+  ldr(TMP1, STATE_PTR(CpuStateFrame, Pointers.Common.SharedGenerationPointer));
+  ldr(TMP2, STATE_PTR(CpuStateFrame, Pointers.Common.GenerationPointer));
+  ldr(TMP1, TMP1, 0);
+  ldr(TMP2, TMP2, 0);
+  cmp(ARMEmitter::Size::i64Bit, TMP1, TMP2);
+  b(ARMEmitter::Condition::CC_NE, &NoBlock);
+
   // L1 Cache
   ldr(TMP1, STATE_PTR(CpuStateFrame, Pointers.Common.L1Pointer));
 
@@ -136,8 +148,6 @@ void Dispatcher::EmitDispatcher() {
     and_(ARMEmitter::Size::i64Bit, TMP4, RipReg.R(), TMP4);
   }
 
-  ARMEmitter::ForwardLabel NoBlock;
-
   {
     // Offset the address and add to our page pointer
     lsr(ARMEmitter::Size::i64Bit, TMP2, TMP4, 12);
@@ -193,8 +203,11 @@ void Dispatcher::EmitDispatcher() {
     ret();
   }
 
-  {
-    ExitFunctionLinkerAddress = GetCursorAddress<uint64_t>();
+  // Both linkers find their record behind the return address, the indirect branch one its guest RIP in the state
+  for (auto [LinkerAddress, LinkFunction] : {
+        std::pair{&ExitFunctionLinkerAddress, offsetof(FEXCore::Core::CpuStateFrame, Pointers.Common.ExitFunctionLink)},
+        std::pair{&IndirectBranchLinkerAddress, offsetof(FEXCore::Core::CpuStateFrame, Pointers.Common.IndirectBranchLink)}}) {
+    *LinkerAddress = GetCursorAddress<uint64_t>();
     SpillStaticRegs(TMP1);
 
     ldr(ARMEmitter::XReg::x0, STATE, offsetof(FEXCore::Core::CPUState, DeferredSignalRefCount));
@@ -204,7 +217,7 @@ void Dispatcher::EmitDispatcher() {
     mov(ARMEmitter::XReg::x0, STATE);
     mov(ARMEmitter::XReg::x1, ARMEmitter::XReg::lr);
 
-    ldr(ARMEmitter::XReg::x2, STATE_PTR(CpuStateFrame, Pointers.Common.ExitFunctionLink));
+    ldr(ARMEmitter::XReg::x2, STATE, LinkFunction);
     if (!CTX->Config.DisableVixlIndirectCalls) [[unlikely]] {
       GenerateIndirectRuntimeCall<uintptr_t, void *, void *>(ARMEmitter::Reg::r2);
     }
@@ -497,6 +510,7 @@ void Dispatcher::InitThreadPointers(FEXCore::Core::InternalThreadState *Thread)
     Common.DispatcherLoopTop = AbsoluteLoopTopAddress;
     Common.DispatcherLoopTopFillSRA = AbsoluteLoopTopAddressFillSRA;
     Common.ExitFunctionLinker = ExitFunctionLinkerAddress;
+    Common.IndirectBranchLinker = IndirectBranchLinkerAddress;
     Common.ThreadStopHandlerSpillSRA = ThreadStopHandlerAddressSpillSRA;
     Common.ThreadPauseHandlerSpillSRA = ThreadPauseHandlerAddressSpillSRA;
     Common.GuestSignal_SIGILL = GuestSignal_SIGILL;
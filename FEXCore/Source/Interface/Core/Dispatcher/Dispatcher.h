@@ -51,6 +51,7 @@ public:
   uint64_t ThreadPauseHandlerAddress{};
   uint64_t ThreadPauseHandlerAddressSpillSRA{};
   uint64_t ExitFunctionLinkerAddress{};
+  uint64_t IndirectBranchLinkerAddress{};
   uint64_t SignalHandlerReturnAddress{};
   uint64_t SignalHandlerReturnAddressRT{};
   uint64_t GuestSignal_SIGILL{};
@@ -10,6 +10,7 @@ $end_info$
 #include "Interface/Core/Frontend.h"
 #include "Interface/Core/X86Tables/X86Tables.h"
 #include "Interface/Core/PatternDbt/rule-debug-log.h"
+#include "Interface/Core/PatternDbt/rule-index.h"
 
 #include <cstring>
 #include <iostream>
@@ -82,11 +83,14 @@ static uint32_t MapVEXToReg(uint8_t vvvv, bool HasXMM) {
 Decoder::Decoder(FEXCore::Context::ContextImpl *ctx)
   : CTX {ctx}
   , OSABI { ctx->SyscallHandler ? ctx->SyscallHandler->GetOSABI() : FEXCore::HLE::SyscallOSABI::OS_UNKNOWN }
-  , PoolObject {ctx->FrontendAllocator, sizeof(FEXCore::X86Tables::DecodedInst) * DefaultDecodedBufferSize} {
+  , PoolObject {ctx->FrontendAllocator, sizeof(FEXCore::X86Tables::DecodedInst) * DefaultDecodedBufferSize}
+  , ShadowPoolObject {ctx->FrontendAllocator, sizeof(X86Instruction) * DefaultDecodedBufferSize}
+  , Multiblock {ctx->Config.Multiblock()} {
 }
 
 Decoder::~Decoder() {
   PoolObject.UnclaimBuffer();
+  ShadowPoolObject.UnclaimBuffer();
 }
 
 uint8_t Decoder::ReadByte() {
@@ -589,8 +593,6 @@ bool Decoder::NormalOp(FEXCore::X86Tables::X86InstInfo const *Info, uint16_t Op,
 
   DecodeInst->InstSize = InstructionSize;
 
-  DecodeInstToX86Inst(DecodeInst, x86_instr, this->pid);
-
   LOGMAN_THROW_AA_FMT(Bytes == 0, "Inst at 0x{:x}: 0x{:04x} '{}' Had an instruction of size {} with {} remaining",
                      DecodeInst->PC, DecodeInst->OP, DecodeInst->TableInfo->Name ?: "UND", InstructionSize, Bytes);
 
@@ -775,35 +777,6 @@ bool Decoder::DecodeInstruction(uint64_t PC) {
   memset(DecodeInst, 0, sizeof(DecodedInst));
   DecodeInst->PC = PC;
 
-  /* create an X86 instruction and insert it to tb */
-  auto create_x86_instr = [&](uint64_t pc) -> X86Instruction* {
-      X86Instruction* instr = &instr_buffer[instr_buffer_index];
-      if (instr_buffer_index >= 1000)
-          LogMan::Msg::EFmt("Instruction buffer is not enough!");
-
-      instr->pc = pc;
-      instr->next = nullptr;
-
-      if (instr_block_start == instr_buffer_index) {
-          instr->prev = nullptr;
-      } else {
-          instr->prev = &instr_buffer[instr_buffer_index-1];
-          instr->prev->next = instr;
-      }
-
-      for (int i = 0; i < X86_MAX_OPERAND_NUM; i++)
-          instr->opd[i].type = X86_OPD_TYPE_NONE;
-      instr->opc = X86_OPC_INVALID;
-      for (int i = 0; i < X86_REG_NUM; i++)
-          instr->reg_liveness[i] = true;
-
-      instr_buffer_index++;
-
-      return instr;
-  };
-
-	/* creat an instruction to save disasm results */
-	x86_instr = create_x86_instr(PC);
 
   for(;;) {
     if (InstructionSize >= MAX_INST_SIZE)
@@ -1015,8 +988,71 @@ bool Decoder::DecodeInstruction(uint64_t PC) {
   return true;
 }
 
+bool Decoder::IsRuleCandidateBlock(FEXCore::X86Tables::DecodedInst const *Instructions, uint64_t NumInstructions) const {
+  const RuleSet *Rules = CTX->TranslationRules.get();
+  if (!Rules || NumInstructions < rule_index_min_len(Rules)) {
+    return false;
+  }
+
+  for (uint64_t i = 0; i < NumInstructions; ++i) {
+    auto TableInfo = Instructions[i].TableInfo;
+    if (!TableInfo) {
+      continue;
+    }
+
+    // An instruction that was never converted might start a rule, assume it does.
+    auto it = ShadowOpcodeCache.find(TableInfo);
+    if (it == ShadowOpcodeCache.end() || it->second.OP != Instructions[i].OP ||
+        rule_index_may_start(Rules, it->second.Opcode)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+X86Instruction *Decoder::BuildShadowInstructions(FEXCore::X86Tables::DecodedInst *Instructions, uint64_t NumInstructions) {
+  // Most blocks can't be matched by any rule, don't pay for the conversion on those.
+  // The rule miner records every block, including the ones no rule can match.
+  if (!CTX->Config.RuleMining() && !IsRuleCandidateBlock(Instructions, NumInstructions)) {
+    return nullptr;
+  }
+
+  // One shadow instruction per decoded instruction, bounded like DecodedBuffer
+  LOGMAN_THROW_AA_FMT(instr_buffer_index + NumInstructions <= DefaultDecodedBufferSize, "Instruction buffer is not enough!");
+  X86Instruction *Block = &instr_buffer[instr_buffer_index];
+  instr_buffer_index += NumInstructions;
+
+  for (uint64_t i = 0; i < NumInstructions; ++i) {
+    auto DecodeInst = &Instructions[i];
+    X86Instruction *instr = &Block[i];
+    memset(instr, 0, sizeof(X86Instruction));
+
+    instr->pc = DecodeInst->PC;
+    instr->prev = i ? &Block[i - 1] : nullptr;
+    instr->next = i + 1 < NumInstructions ? &Block[i + 1] : nullptr;
+
+    for (int r = 0; r < X86_REG_NUM; r++)
+      instr->reg_liveness[r] = true;
+
+    // Invalid instruction at the end of the block, leave it as X86_OPC_INVALID
+    if (!DecodeInst->TableInfo) {
+      continue;
+    }
+
+    DecodeInstToX86Inst(DecodeInst, instr, pid);
+
+    // The opcode only depends on the table entry, but segment and lock prefixes reject the instruction
+    if (!(DecodeInst->Flags & (DecodeFlags::FLAG_SEGMENTS | DecodeFlags::FLAG_LOCK))) {
+      ShadowOpcodeCache[DecodeInst->TableInfo] = {DecodeInst->OP, instr->opc};
+    }
+  }
+
+  return Block;
+}
+
 void Decoder::BranchTargetInMultiblockRange() {
-  if (!CTX->Config.Multiblock)
+  if (!Multiblock)
     return;
 
   // If the RIP setting is conditional AND within our symbol range then it can be considered for multiblock
@@ -1075,6 +1111,21 @@ void Decoder::BranchTargetInMultiblockRange() {
     if (!HasBlocks.contains(TargetRIP)) {
       BlocksToDecode.insert(TargetRIP);
     }
+  } else if (IsHotTraceTarget(TargetRIP)) {
+    // The branch leaves the symbol range along a hot edge, the trace follows it.
+    // Cold edges of the branch are left as side exits.
+    if (Conditional) {
+      uint64_t FallthroughRIP = DecodeInst->PC + DecodeInst->InstSize;
+      bool FallthroughInRange = FallthroughRIP >= SymbolMinAddress && FallthroughRIP < SymbolMaxAddress;
+      if (!HasBlocks.contains(FallthroughRIP) && (FallthroughInRange || IsHotTraceTarget(FallthroughRIP))) {
+        BlocksToDecode.insert(FallthroughRIP);
+      }
+    }
+
+    if (!HasBlocks.contains(TargetRIP)) {
+      BlocksToDecode.insert(TargetRIP);
+    }
+    ++TraceBlockCount;
   } else {
     if (ExternalBranches) {
       ExternalBranches->insert(TargetRIP);
@@ -1082,6 +1133,12 @@ void Decoder::BranchTargetInMultiblockRange() {
   }
 }
 
+bool Decoder::IsHotTraceTarget(uint64_t RIP) const {
+  // Hot blocks have run already, and invalidating their code drops them from the set.
+  // So their code is still mapped and safe to decode.
+  return HotBlocks && TraceBlockCount < MAX_TRACE_BLOCKS && HotBlocks->contains(RIP);
+}
+
 bool Decoder::BranchTargetCanContinue(bool FinalInstruction) const {
   if (FinalInstruction) {
     return false;
@@ -1140,19 +1197,11 @@ void Decoder::DecodeInstructionsAtEntry(FEXCore::Core::InternalThreadState *Thre
   DecodedSize = 0;
   MaxCondBranchForward = 0;
   MaxCondBranchBackwards = ~0ULL;
+  TraceBlockCount = 0;
   DecodedBuffer = PoolObject.ReownOrClaimBuffer();
-
-
-  auto x86_instr_buffer_init = [&]() {
-    instr_buffer = new X86Instruction[1000];
-    if (instr_buffer == nullptr)
-        LogMan::Msg::EFmt("Cannot allocate memory for instruction buffer!");
-
-    instr_buffer_index = 0;
-    instr_block_start = 0;
-  };
-
-  x86_instr_buffer_init();
+  instr_buffer = ShadowPoolObject.ReownOrClaimBuffer();
+  ShadowBufferOwned = true;
+  instr_buffer_index = 0;
 
   // Decode operating mode from thread's CS segment.
   const auto CSSegment = Thread->CurrentFrame->State.gdt[Thread->CurrentFrame->State.cs_idx >> 3];
@@ -1201,9 +1250,6 @@ void Decoder::DecodeInstructionsAtEntry(FEXCore::Core::InternalThreadState *Thre
     uint64_t BlockNumberOfInstructions{};
     uint64_t BlockStartOffset = DecodedSize;
 
-    CurrentBlockDecoding.guest_instr = &instr_buffer[instr_buffer_index];
-    instr_block_start = instr_buffer_index;
-
     // Do a bit of pointer math to figure out where we are in code
     InstStream = AdjustAddrForSpecialRegion(_InstStream, EntryPoint, RIPToDecode);
 
@@ -1298,12 +1344,10 @@ void Decoder::DecodeInstructionsAtEntry(FEXCore::Core::InternalThreadState *Thre
     // Copy over only the number of instructions we decoded
     CurrentBlockDecoding.NumInstructions = BlockNumberOfInstructions;
     CurrentBlockDecoding.DecodedInstructions = &DecodedBuffer[BlockStartOffset];
+    CurrentBlockDecoding.guest_instr = BuildShadow ? BuildShadowInstructions(CurrentBlockDecoding.DecodedInstructions, BlockNumberOfInstructions) : nullptr;
     BlockInfo.TotalInstructionCount += BlockNumberOfInstructions;
   }
 
-  delete[] instr_buffer;
-  instr_buffer = nullptr;
-
   for (auto CodePage : CodePages) {
     AddContainedCodePage(PC, CodePage, FHU::FEX_PAGE_SIZE);
   }
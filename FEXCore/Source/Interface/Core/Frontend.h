@@ -6,7 +6,9 @@
 
 #include <FEXCore/HLE/SyscallHandler.h>
 #include <FEXCore/Utils/Telemetry.h>
+#include <FEXCore/fextl/robin_map.h>
 #include <FEXCore/fextl/set.h>
+#include <FEXCore/fextl/unordered_set.h>
 #include <FEXCore/fextl/vector.h>
 
 #include <array>
@@ -48,11 +50,28 @@ public:
 
   void SetSectionMaxAddress(uint64_t v) { SectionMaxAddress = v; }
   void SetExternalBranches(fextl::set<uint64_t> *v) { ExternalBranches = v; }
+  // Rule matches restored from the rule cache don't need the shadow x86 instructions
+  void SetBuildShadowInstructions(bool v) { BuildShadow = v; }
+  // Baseline compiles decode single blocks, the tiered up recompile follows the branches again
+  void SetMultiblock(bool v) { Multiblock = v; }
+  // Tiered up compiles also follow branches out of the symbol range into blocks that got hot, forming a trace
+  void SetHotBlocks(fextl::unordered_set<uint64_t> const *v) { HotBlocks = v; }
+  // The last decode followed a hot branch out of the symbol range, its guest code isn't one contiguous range
+  bool DecodedTrace() const { return TraceBlockCount != 0; }
 
   void DelayedDisownBuffer() {
     PoolObject.DelayedDisownBuffer();
   }
 
+  // The rule translator reads the shadow x86 instructions until the backend has finished compiling,
+  // so they are disowned separately from the decoded instructions.
+  void DelayedDisownShadowBuffer() {
+    if (ShadowBufferOwned) {
+      ShadowPoolObject.DelayedDisownBuffer();
+      ShadowBufferOwned = false;
+    }
+  }
+
 private:
   // To pass any information from instruction prefixes
   // down into the actual instruction handling machinery.
@@ -67,7 +86,11 @@ private:
 
   bool DecodeInstruction(uint64_t PC);
 
+  bool IsRuleCandidateBlock(FEXCore::X86Tables::DecodedInst const *Instructions, uint64_t NumInstructions) const;
+  X86Instruction *BuildShadowInstructions(FEXCore::X86Tables::DecodedInst *Instructions, uint64_t NumInstructions);
+
   void BranchTargetInMultiblockRange();
+  bool IsHotTraceTarget(uint64_t RIP) const;
   bool BranchTargetCanContinue(bool FinalInstruction) const;
 
   uint8_t ReadByte();
@@ -83,6 +106,20 @@ private:
   Utils::FixedSizePooledAllocation<FEXCore::X86Tables::DecodedInst*, 5000, 500> PoolObject;
   size_t DecodedSize {};
 
+  // Translation rules x86 instrs, one for each instruction of a block that might match a rule
+  X86Instruction *instr_buffer{};
+  Utils::FixedSizePooledAllocation<X86Instruction*, 5000, 500> ShadowPoolObject;
+  bool ShadowBufferOwned{};
+  bool BuildShadow{true};
+  bool Multiblock{};
+
+  // X86 opcode of each table entry seen so far, used to skip blocks no rule can match
+  struct ShadowOpcode {
+    uint16_t OP;
+    X86Opcode Opcode;
+  };
+  fextl::robin_map<FEXCore::X86Tables::X86InstInfo const*, ShadowOpcode> ShadowOpcodeCache;
+
   uint8_t const *InstStream;
   uint8_t GetGPRSize() const { return BlockInfo.Is64BitMode ? 8 : 4; }
 
@@ -90,11 +127,7 @@ private:
   uint8_t InstructionSize;
   std::array<uint8_t, MAX_INST_SIZE> Instruction;
   FEXCore::X86Tables::DecodedInst *DecodeInst;
-  // Translation rules x86 instrs
-  X86Instruction *instr_buffer;
-  X86Instruction *x86_instr;
-  int instr_buffer_index;
-  int instr_block_start;
+  uint64_t instr_buffer_index;
   uint64_t pid;
 
   // This is for multiblock data tracking
@@ -111,6 +144,11 @@ private:
   fextl::set<uint64_t> HasBlocks;
   fextl::set<uint64_t> *ExternalBranches {nullptr};
 
+  // Bounds how much code of other functions a trace duplicates
+  static constexpr size_t MAX_TRACE_BLOCKS = 16;
+  fextl::unordered_set<uint64_t> const *HotBlocks {nullptr};
+  size_t TraceBlockCount {};
+
   // ModRM rm decoding
   using DecodeModRMPtr = void (FEXCore::Frontend::Decoder::*)(X86Tables::DecodedOperand *Operand, X86Tables::ModRMDecoded ModRM);
   void DecodeModRM_16(X86Tables::DecodedOperand *Operand, X86Tables::ModRMDecoded ModRM);
@@ -51,6 +51,15 @@ DEF_OP(EntrypointOffset) {
     Mask = 0xFFFF'FFFFULL;
   }
 
+  if (EmitRelocatable) {
+    // A truncated RIP doesn't relocate
+    if (OpSize == 4 && CTX->Config.Is64BitMode) {
+      CodeRelocatable = false;
+    }
+    InsertGuestRIPMove(Dst, Constant & Mask);
+    return;
+  }
+
   LoadConstant(ARMEmitter::Size::i64Bit, Dst, Constant & Mask);
 }
 
@@ -7,8 +7,11 @@ $end_info$
 */
 #include "Interface/Context/Context.h"
 #include "Interface/Core/JIT/Arm64/JITClass.h"
+#include "Interface/Core/ObjectCache/ObjectCacheService.h"
 #include "Interface/HLE/Thunks/Thunks.h"
 
+#include <FEXCore/Utils/MathUtils.h>
+
 namespace FEXCore::CPU {
 
 uint64_t Arm64JITCore::GetNamedSymbolLiteral(FEXCore::CPU::RelocNamedSymbolLiteral::NamedSymbol Op) {
@@ -79,6 +82,18 @@ void Arm64JITCore::InsertGuestRIPMove(ARMEmitter::Register Reg, uint64_t Constan
   Relocations.emplace_back(MoveABI);
 }
 
+void Arm64JITCore::InsertGuestRIPLiteral(uint64_t Constant) {
+  Relocation MoveABI{};
+  MoveABI.GuestRIPLiteral.Header.Type = FEXCore::CPU::RelocationTypes::RELOC_GUEST_RIP_LITERAL;
+  // Offset is the offset from the entrypoint of the block
+  auto CurrentCursor = GetCursorAddress<uint8_t *>();
+  MoveABI.GuestRIPLiteral.Offset = CurrentCursor - CodeData.BlockBegin;
+  MoveABI.GuestRIPLiteral.GuestRIP = Constant;
+
+  dc64(Constant);
+  Relocations.emplace_back(MoveABI);
+}
+
 bool Arm64JITCore::ApplyRelocations(uint64_t GuestEntry, uint64_t CodeEntry, uint64_t CursorEntry, size_t NumRelocations, const char* EntryRelocations) {
   size_t DataIndex{};
   for (size_t j = 0; j < NumRelocations; ++j) {
@@ -110,12 +125,8 @@ bool Arm64JITCore::ApplyRelocations(uint64_t GuestEntry, uint64_t CodeEntry, uin
         break;
       }
       case FEXCore::CPU::RelocationTypes::RELOC_GUEST_RIP_MOVE: {
-        // XXX: Reenable once the JIT Object Cache is upstream
-        // XXX: Should spin the relocation list, create a list of guest RIP moves, and ask for them all once, reduces lock contention.
-        uint64_t Pointer = ~0ULL; // EmitterCTX->JITObjectCache->FindRelocatedRIP(Reloc->GuestRIPMove.GuestRIP);
-        if (Pointer == ~0ULL) {
-          return false;
-        }
+        // Serialized guest RIPs are relative to the block entry
+        uint64_t Pointer = GuestEntry + Reloc->GuestRIPMove.GuestRIP;
 
         // Relocation occurs at the cursorEntry + offset relative to that cursor.
         SetCursorOffset(CursorEntry + Reloc->GuestRIPMove.Offset);
@@ -123,10 +134,54 @@ bool Arm64JITCore::ApplyRelocations(uint64_t GuestEntry, uint64_t CodeEntry, uin
         DataIndex += sizeof(Reloc->GuestRIPMove);
         break;
       }
+      case FEXCore::CPU::RelocationTypes::RELOC_GUEST_RIP_LITERAL: {
+        uint64_t Pointer = GuestEntry + Reloc->GuestRIPLiteral.GuestRIP;
+
+        // Relocation occurs at the cursorEntry + offset relative to that cursor.
+        SetCursorOffset(CursorEntry + Reloc->GuestRIPLiteral.Offset);
+        dc64(Pointer);
+        DataIndex += sizeof(Reloc->GuestRIPLiteral);
+        break;
+      }
+      default:
+        return false;
     }
   }
 
   return true;
 }
+
+void *Arm64JITCore::RelocateJITObjectCode(uint64_t Entry, CodeSerialize::CodeObjectFileSection const *SerializationData) {
+  const auto Data = SerializationData->Data;
+  SyncCodeBuffer();
+
+  if ((GetCursorOffset() + Data->HostCodeLength) > CurrentCodeBuffer->Size) {
+    CTX->ClearCodeCache(ThreadState);
+  }
+
+  // Same alignment as a freshly compiled block
+  SetCursorOffset(FEXCore::AlignUp(GetCursorOffset(), 16));
+
+  const auto CursorBegin = GetCursorOffset();
+  auto BlockBegin = GetCursorAddress<uint8_t *>();
+  memcpy(BlockBegin, SerializationData->HostCode, Data->HostCodeLength);
+
+  if (!ApplyRelocations(Entry, reinterpret_cast<uint64_t>(BlockBegin), CursorBegin, Data->NumRelocations, SerializationData->Relocations)) {
+    // Leave the copy to be overwritten by the next block
+    SetCursorOffset(CursorBegin);
+    return nullptr;
+  }
+
+  // The tail is data, its RIP isn't covered by the relocations
+  auto CodeHeader = reinterpret_cast<JITCodeHeader *>(BlockBegin);
+  auto CodeTail = reinterpret_cast<JITCodeTail *>(BlockBegin + CodeHeader->OffsetToBlockTail);
+  CodeTail->RIP = Entry;
+
+  SetCursorOffset(CursorBegin + Data->HostCodeLength);
+  CurrentCodeBuffer->Offset = GetCursorOffset();
+  ClearICache(BlockBegin, CodeHeader->OffsetToBlockTail);
+
+  return BlockBegin + Data->HostEntryOffset;
+}
 }
 
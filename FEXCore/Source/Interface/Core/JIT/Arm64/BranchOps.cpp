@@ -45,14 +45,8 @@ DEF_OP(CallbackReturn) {
   ret();
 }
 
-DEF_OP(ExitFunction) {
-  auto Op = IROp->C<IR::IROp_ExitFunction>();
-
-  ResetStack();
-
-  uint64_t NewRIP;
-
-  if (IsInlineConstant(Op->NewRIP, &NewRIP) || IsInlineEntrypointOffset(Op->NewRIP, &NewRIP)) {
+void Arm64JITCore::EmitDirectExit(uint64_t NewRIP, bool Relocatable, ARMEmitter::SingleUseForwardLabel *GuestRIPLiteral) {
+  if (!Relocatable) {
     ARMEmitter::SingleUseForwardLabel l_BranchHost;
 
     ldr(TMP1, &l_BranchHost);
@@ -60,28 +54,192 @@ DEF_OP(ExitFunction) {
 
     Bind(&l_BranchHost);
     dc64(ThreadState->CurrentFrame->Pointers.Common.ExitFunctionLinker);
+    if (GuestRIPLiteral) {
+      Bind(GuestRIPLiteral);
+    }
     dc64(NewRIP);
   } else {
+    // The linker finds both literals behind the return address, keep them together
+    auto Linker = InsertNamedSymbolLiteral(FEXCore::CPU::RelocNamedSymbolLiteral::NamedSymbol::SYMBOL_LITERAL_EXITFUNCTION_LINKER);
 
-    ARMEmitter::SingleUseForwardLabel FullLookup;
-    auto RipReg = GetReg(Op->NewRIP.ID());
+    ldr(TMP1, &Linker.Loc);
+    blr(TMP1);
 
-    // L1 Cache
-    ldr(TMP1, STATE, offsetof(FEXCore::Core::CpuStateFrame, Pointers.Common.L1Pointer));
+    PlaceNamedSymbolLiteral(Linker);
+    if (GuestRIPLiteral) {
+      Bind(GuestRIPLiteral);
+    }
+    InsertGuestRIPLiteral(NewRIP);
+  }
+}
+
+void Arm64JITCore::EmitReturnStackCall(uint64_t ReturnRIP, bool Relocatable) {
+  ARMEmitter::SingleUseForwardLabel l_ReturnRIP;
+  ARMEmitter::SingleUseForwardLabel l_Call;
+
+  // Push, TMP1 keeps pointing to the entry until the call fills in the host code
+  ldr(TMP1, STATE, offsetof(FEXCore::Core::CpuStateFrame, ReturnStackIndex));
+  and_(ARMEmitter::Size::i64Bit, TMP2, TMP1, FEXCore::Core::CpuStateFrame::RETURN_STACK_ENTRIES - 1);
+  add(ARMEmitter::Size::i64Bit, TMP1, TMP1, 1);
+  str(TMP1, STATE, offsetof(FEXCore::Core::CpuStateFrame, ReturnStackIndex));
+  add(ARMEmitter::Size::i64Bit, TMP1, STATE, offsetof(FEXCore::Core::CpuStateFrame, ReturnStack));
+  add(TMP1, TMP1, TMP2, ARMEmitter::ShiftType::LSL, 4);
+
+  // The guest return address is the literal of the exit below
+  ldr(TMP2, &l_ReturnRIP);
+  str(TMP2, TMP1, offsetof(FEXCore::Core::CpuStateFrame::ReturnStackEntry, GuestRIP));
+
+  // A real call, so that the RET returns through the host's return predictor
+  bl(&l_Call);
+
+  // Returning from another block, the RIP reconstruction needs this block's header back
+  ARMEmitter::BackwardLabel l_BlockHeader{CodeData.BlockBegin};
+  adr(TMP1, &l_BlockHeader);
+  str(TMP1, STATE, offsetof(FEXCore::Core::CPUState, InlineJITBlockHeader));
+  EmitDirectExit(ReturnRIP, Relocatable, &l_ReturnRIP);
+
+  Bind(&l_Call);
+  str(ARMEmitter::XReg::lr, TMP1, offsetof(FEXCore::Core::CpuStateFrame::ReturnStackEntry, HostCode));
+}
 
-    and_(ARMEmitter::Size::i64Bit, TMP4, RipReg, LookupCache::L1_ENTRIES_MASK);
-    add(TMP1, TMP1, TMP4, ARMEmitter::ShiftType::LSL, 4);
+void Arm64JITCore::EmitReturnStackReturn(ARMEmitter::Register RipReg) {
+  ARMEmitter::SingleUseForwardLabel l_Miss;
+
+  // Pop, a miss drops the entry as well
+  ldr(TMP1, STATE, offsetof(FEXCore::Core::CpuStateFrame, ReturnStackIndex));
+  sub(ARMEmitter::Size::i64Bit, TMP1, TMP1, 1);
+  str(TMP1, STATE, offsetof(FEXCore::Core::CpuStateFrame, ReturnStackIndex));
+  and_(ARMEmitter::Size::i64Bit, TMP1, TMP1, FEXCore::Core::CpuStateFrame::RETURN_STACK_ENTRIES - 1);
+  add(ARMEmitter::Size::i64Bit, TMP2, STATE, offsetof(FEXCore::Core::CpuStateFrame, ReturnStack));
+  add(TMP1, TMP2, TMP1, ARMEmitter::ShiftType::LSL, 4);
+
+  // Note: sub+cbnz used over cmp+br to preserve flags.
+  ldp<ARMEmitter::IndexType::OFFSET>(TMP2, TMP1, TMP1, 0);
+  sub(TMP2, TMP2, RipReg.X());
+  cbnz(ARMEmitter::Size::i64Bit, TMP2, &l_Miss);
+  ret(TMP1);
+
+  Bind(&l_Miss);
+}
+
+void Arm64JITCore::EmitIndirectExit(ARMEmitter::Register RipReg) {
+  using CacheData = FEXCore::Context::IndirectBranchCacheData;
+  ARMEmitter::ForwardLabel l_Cache;
+  ARMEmitter::ForwardLabel l_Fill;
+  ARMEmitter::ForwardLabel FullLookup;
+
+  // A guest jump to EMPTY itself would match an empty entry and take its stale HostBranch, leave that to the dispatcher.
+  // Same check as the fill below, it catches a range of non-canonical addresses around EMPTY.
+  asr(ARMEmitter::Size::i64Bit, TMP2, RipReg, 47);
+  add(ARMEmitter::Size::i64Bit, TMP2, TMP2, 2);
+  cbz(ARMEmitter::Size::i64Bit, TMP2, &FullLookup);
+
+  // Targets this exit has seen before
+  adr(TMP1, &l_Cache);
+  for (size_t i = 0; i < CacheData::ENTRIES; ++i) {
+    ARMEmitter::ForwardLabel l_Next;
+    if (i != 0) {
+      add(ARMEmitter::Size::i64Bit, TMP1, TMP1, sizeof(FEXCore::Context::ExitFunctionLinkData));
+    }
 
     // Note: sub+cbnz used over cmp+br to preserve flags.
-    ldp<ARMEmitter::IndexType::OFFSET>(TMP2, TMP1, TMP1, 0);
-    sub(TMP1, TMP1, RipReg.X());
-    cbnz(ARMEmitter::Size::i64Bit, TMP1, &FullLookup);
+    ldr(TMP2, TMP1, offsetof(FEXCore::Context::ExitFunctionLinkData, GuestRIP));
+    sub(TMP2, TMP2, RipReg.X());
+    cbnz(ARMEmitter::Size::i64Bit, TMP2, &l_Next);
+    // TMP2 is zero, the address dependency orders the load after the GuestRIP the linker published
+    ldr(TMP2, TMP1, TMP2, ARMEmitter::ExtendedType::LSL_64, 0);
+
+    // The entry may have been emptied and filled for another target in between, check it still holds this one.
+    // TMP4 is zero, this time the address dependency orders the load after the HostBranch.
+    eor(ARMEmitter::Size::i64Bit, TMP4, TMP2, TMP2);
+    add(TMP4, TMP1, TMP4);
+    ldr(TMP4, TMP4, offsetof(FEXCore::Context::ExitFunctionLinkData, GuestRIP));
+    sub(TMP4, TMP4, RipReg.X());
+    cbnz(ARMEmitter::Size::i64Bit, TMP4, &l_Next);
     br(TMP2);
+    Bind(&l_Next);
+  }
 
-    Bind(&FullLookup);
-    ldr(TMP1, STATE, offsetof(FEXCore::Core::CpuStateFrame, Pointers.Common.DispatcherLoopTop));
-    str(RipReg.X(), STATE, offsetof(FEXCore::Core::CpuStateFrame, State.rip));
-    br(TMP1);
+  // Fill while any entry is empty, a megamorphic exit settles on the L1 cache
+  adr(TMP1, &l_Cache);
+  for (size_t i = 0; i < CacheData::ENTRIES; ++i) {
+    ldr(TMP2, TMP1, i * sizeof(FEXCore::Context::ExitFunctionLinkData) + offsetof(FEXCore::Context::ExitFunctionLinkData, GuestRIP));
+    asr(ARMEmitter::Size::i64Bit, TMP2, TMP2, 47);
+    add(ARMEmitter::Size::i64Bit, TMP2, TMP2, 2);
+    cbz(ARMEmitter::Size::i64Bit, TMP2, &l_Fill);
+  }
+  static_assert(static_cast<int64_t>(CacheData::EMPTY) >> 47 == -2, "The fill check relies on the top bits of EMPTY");
+
+  // L1 Cache
+  ldr(TMP1, STATE, offsetof(FEXCore::Core::CpuStateFrame, Pointers.Common.L1Pointer));
+
+  and_(ARMEmitter::Size::i64Bit, TMP4, RipReg, LookupCache::L1_ENTRIES_MASK);
+  add(TMP1, TMP1, TMP4, ARMEmitter::ShiftType::LSL, 4);
+
+  // Note: sub+cbnz used over cmp+br to preserve flags.
+  ldp<ARMEmitter::IndexType::OFFSET>(TMP2, TMP1, TMP1, 0);
+  sub(TMP1, TMP1, RipReg.X());
+  cbnz(ARMEmitter::Size::i64Bit, TMP1, &FullLookup);
+  br(TMP2);
+
+  Bind(&FullLookup);
+  ldr(TMP1, STATE, offsetof(FEXCore::Core::CpuStateFrame, Pointers.Common.DispatcherLoopTop));
+  str(RipReg.X(), STATE, offsetof(FEXCore::Core::CpuStateFrame, State.rip));
+  br(TMP1);
+
+  // The linker finds the cache behind the return address, the linker publishes entries with plain stores so keep it aligned
+  Bind(&l_Fill);
+  str(RipReg.X(), STATE, offsetof(FEXCore::Core::CpuStateFrame, State.rip));
+  ldr(TMP1, STATE, offsetof(FEXCore::Core::CpuStateFrame, Pointers.Common.IndirectBranchLinker));
+  if ((GetCursorAddress<uint64_t>() + 4) & 7) {
+    nop();
+  }
+  blr(TMP1);
+
+  Bind(&l_Cache);
+  for (size_t i = 0; i < CacheData::ENTRIES; ++i) {
+    dc64(0);
+    dc64(CacheData::EMPTY);
+  }
+}
+
+DEF_OP(ExitFunction) {
+  auto Op = IROp->C<IR::IROp_ExitFunction>();
+
+  ResetStack();
+
+  uint64_t NewRIP;
+  const bool ConstantRIP = IsInlineConstant(Op->NewRIP, &NewRIP) || IsInlineEntrypointOffset(Op->NewRIP, &NewRIP);
+  const bool RelocatableRIP = ConstantRIP && !IsInlineConstant(Op->NewRIP) && EmitRelocatable;
+
+  // A truncated RIP doesn't relocate
+  if (RelocatableRIP && IR->GetOp<IR::IROp_Header>(Op->NewRIP)->Size == 4 && CTX->Config.Is64BitMode) {
+    CodeRelocatable = false;
+  }
+
+  auto RipReg = ConstantRIP ? ARMEmitter::Reg::zr : GetReg(Op->NewRIP.ID());
+
+  if (Op->Hint == IR::BranchHint::Call) {
+    uint64_t ReturnRIP = Entry + Op->CallReturnOffset;
+    if (!CTX->Config.Is64BitMode) {
+      ReturnRIP &= 0xFFFF'FFFFULL;
+    }
+
+    // The callee may live in LR, which the call overwrites
+    if (!ConstantRIP && RipReg == ARMEmitter::Reg::lr) {
+      mov(ARMEmitter::Size::i64Bit, TMP3, RipReg);
+      RipReg = TMP3;
+    }
+
+    EmitReturnStackCall(ReturnRIP, EmitRelocatable);
+  } else if (Op->Hint == IR::BranchHint::Return && !ConstantRIP) {
+    EmitReturnStackReturn(RipReg);
+  }
+
+  if (ConstantRIP) {
+    EmitDirectExit(NewRIP, RelocatableRIP);
+  } else {
+    EmitIndirectExit(RipReg);
   }
 }
 
@@ -329,8 +487,13 @@ DEF_OP(Thunk) {
 
   mov(ARMEmitter::Size::i64Bit, ARMEmitter::Reg::r0, GetReg(Op->ArgPtr.ID()));
 
-  auto thunkFn = static_cast<Context::ContextImpl*>(ThreadState->CTX)->ThunkHandler->LookupThunk(Op->ThunkNameHash);
-  LoadConstant(ARMEmitter::Size::i64Bit, ARMEmitter::Reg::r2, (uintptr_t)thunkFn);
+  if (EmitRelocatable) {
+    InsertNamedThunkRelocation(ARMEmitter::Reg::r2, Op->ThunkNameHash);
+  }
+  else {
+    auto thunkFn = static_cast<Context::ContextImpl*>(ThreadState->CTX)->ThunkHandler->LookupThunk(Op->ThunkNameHash);
+    LoadConstant(ARMEmitter::Size::i64Bit, ARMEmitter::Reg::r2, (uintptr_t)thunkFn);
+  }
   if (!CTX->Config.DisableVixlIndirectCalls) [[unlikely]] {
     GenerateIndirectRuntimeCall<void, void*, void*>(ARMEmitter::Reg::r2);
   }
@@ -350,7 +513,12 @@ DEF_OP(ValidateCode) {
   int idx = 0;
 
   LoadConstant(ARMEmitter::Size::i64Bit, GetReg(Node), 0);
-  LoadConstant(ARMEmitter::Size::i64Bit, TMP1, Entry + Op->Offset);
+  if (EmitRelocatable) {
+    InsertGuestRIPMove(TMP1, Entry + Op->Offset);
+  }
+  else {
+    LoadConstant(ARMEmitter::Size::i64Bit, TMP1, Entry + Op->Offset);
+  }
   LoadConstant(ARMEmitter::Size::i64Bit, TMP2, 1);
 
   const auto Dst = GetReg(Node);
@@ -402,7 +570,12 @@ DEF_OP(ThreadRemoveCodeEntry) {
   // X1: RIP
   mov(ARMEmitter::Size::i64Bit, ARMEmitter::Reg::r0, STATE.R());
 
-  LoadConstant(ARMEmitter::Size::i64Bit, ARMEmitter::Reg::r1, Entry);
+  if (EmitRelocatable) {
+    InsertGuestRIPMove(ARMEmitter::Reg::r1, Entry);
+  }
+  else {
+    LoadConstant(ARMEmitter::Size::i64Bit, ARMEmitter::Reg::r1, Entry);
+  }
 
   ldr(ARMEmitter::XReg::x2, STATE, offsetof(FEXCore::Core::CpuStateFrame, Pointers.Common.ThreadRemoveCodeEntryFromJIT));
   if (!CTX->Config.DisableVixlIndirectCalls) [[unlikely]] {
@@ -31,6 +31,7 @@ $end_info$
 #include <FEXCore/Utils/Allocator.h>
 #include <FEXCore/Utils/CompilerDefs.h>
 #include <FEXCore/Utils/EnumUtils.h>
+#include <FEXCore/Utils/MathUtils.h>
 #include <FEXCore/Utils/Profiler.h>
 #include <FEXCore/HLE/SyscallHandler.h>
 
@@ -46,6 +47,8 @@ $end_info$
 static constexpr size_t INITIAL_CODE_SIZE = 1024 * 1024 * 16;
 // We don't want to move above 128MB atm because that means we will have to encode longer jumps
 static constexpr size_t MAX_CODE_SIZE = 1024 * 1024 * 128;
+// Largest exit a block tail can emit, the indirect branch cache included
+static constexpr size_t MAX_EXIT_SIZE = 640;
 
 namespace {
 static uint64_t LUDIV(uint64_t SrcHigh, uint64_t SrcLow, uint64_t Divisor) {
@@ -504,8 +507,7 @@ void Arm64JITCore::Op_Unhandled(IR::IROp_Header const *IROp, IR::NodeID Node) {
 }
 
 
-static void DirectBlockDelinker(FEXCore::Core::CpuStateFrame *Frame, FEXCore::Context::ExitFunctionLinkData *Record) {
-  auto LinkerAddress = Frame->Pointers.Common.ExitFunctionLinker;
+static void DirectBlockDelinker(uint64_t LinkerAddress, FEXCore::Context::ExitFunctionLinkData *Record) {
   uintptr_t branch = (uintptr_t)(Record) - 8;
   FEXCore::ARMEmitter::Emitter emit((uint8_t*)(branch), 8);
   FEXCore::ARMEmitter::SingleUseForwardLabel l_BranchHost;
@@ -516,8 +518,7 @@ static void DirectBlockDelinker(FEXCore::Core::CpuStateFrame *Frame, FEXCore::Co
   FEXCore::ARMEmitter::Emitter::ClearICache((void*)branch, 8);
 }
 
-static void IndirectBlockDelinker(FEXCore::Core::CpuStateFrame *Frame, FEXCore::Context::ExitFunctionLinkData *Record) {
-  auto LinkerAddress = Frame->Pointers.Common.ExitFunctionLinker;
+static void IndirectBlockDelinker(uint64_t LinkerAddress, FEXCore::Context::ExitFunctionLinkData *Record) {
   Record->HostBranch = LinkerAddress;
 }
 
@@ -525,6 +526,9 @@ static uint64_t Arm64JITCore_ExitFunctionLink(FEXCore::Core::CpuStateFrame *Fram
   auto Thread = Frame->Thread;
   auto GuestRip = Record->GuestRIP;
 
+  // The code buffer mustn't move on between the lookup and the link
+  std::scoped_lock lk(Thread->LookupCache->WriteLock, Thread->LookupCache->GetSharedLock());
+
   auto HostCode = Thread->LookupCache->FindBlock(GuestRip);
 
   if (!HostCode) {
@@ -532,6 +536,10 @@ static uint64_t Arm64JITCore_ExitFunctionLink(FEXCore::Core::CpuStateFrame *Fram
     return Frame->Pointers.Common.DispatcherLoopTop;
   }
 
+  if (!Thread->LookupCache->CanLink(Record)) {
+    return HostCode;
+  }
+
   uintptr_t branch = (uintptr_t)(Record) - 8;
 
   auto offset = HostCode/4 - branch/4;
@@ -555,6 +563,49 @@ static uint64_t Arm64JITCore_ExitFunctionLink(FEXCore::Core::CpuStateFrame *Fram
   return HostCode;
 }
 
+static void IndirectBranchCacheDelinker(uint64_t LinkerAddress, FEXCore::Context::ExitFunctionLinkData *Record) {
+  // A racing exit either still takes the old block or misses, the HostBranch is left for it
+  __atomic_store_n(&Record->GuestRIP, FEXCore::Context::IndirectBranchCacheData::EMPTY, __ATOMIC_RELAXED);
+}
+
+static uint64_t Arm64JITCore_IndirectBranchLink(FEXCore::Core::CpuStateFrame *Frame, FEXCore::Context::IndirectBranchCacheData *Record) {
+  auto Thread = Frame->Thread;
+  auto GuestRip = Frame->State.rip;
+
+  // The code buffer mustn't move on between the lookup and the link
+  std::scoped_lock lk(Thread->LookupCache->WriteLock, Thread->LookupCache->GetSharedLock());
+
+  auto HostCode = Thread->LookupCache->FindBlock(GuestRip);
+
+  if (!HostCode) {
+    return Frame->Pointers.Common.DispatcherLoopTop;
+  }
+
+  for (auto &Entry : Record->Entries) {
+    if (__atomic_load_n(&Entry.GuestRIP, __ATOMIC_RELAXED) == GuestRip) {
+      // Another thread got here first
+      return HostCode;
+    }
+  }
+
+  // Entries emptied by the delinker get filled again.
+  // An exit that matched the entry's previous GuestRIP rechecks it after reading the new HostBranch, and misses.
+  for (auto &Entry : Record->Entries) {
+    if (__atomic_load_n(&Entry.GuestRIP, __ATOMIC_RELAXED) != FEXCore::Context::IndirectBranchCacheData::EMPTY) {
+      continue;
+    }
+
+    if (Thread->LookupCache->CanLink(&Entry)) {
+      __atomic_store_n(&Entry.HostBranch, HostCode, __ATOMIC_RELAXED);
+      __atomic_store_n(&Entry.GuestRIP, GuestRip, __ATOMIC_RELEASE);
+      Thread->LookupCache->AddBlockLink(GuestRip, &Entry, IndirectBranchCacheDelinker);
+    }
+    break;
+  }
+
+  return HostCode;
+}
+
 void Arm64JITCore::Op_NoOp(IR::IROp_Header const *IROp, IR::NodeID Node) {
 }
 
@@ -565,6 +616,7 @@ Arm64JITCore::Arm64JITCore(FEXCore::Context::ContextImpl *ctx, FEXCore::Core::In
   , HostSupportsSVE256{ctx->HostFeatures.SupportsAVX}
   , HostSupportsRPRES{ctx->HostFeatures.SupportsRPRES}
   , HostSupportsAFP{ctx->HostFeatures.SupportsAFP}
+  , EmitRelocatable{ctx->Config.CacheObjectCodeCompilation() != FEXCore::Config::ConfigObjectCodeHandler::CONFIG_NONE}
   , CTX {ctx} {
 
   RAPass = Thread->PassManager->GetPass<IR::RegisterAllocationPass>("RA");
@@ -592,6 +644,7 @@ Arm64JITCore::Arm64JITCore(FEXCore::Context::ContextImpl *ctx, FEXCore::Core::In
     Common.PrintValue = reinterpret_cast<uint64_t>(PrintValue);
     Common.PrintVectorValue = reinterpret_cast<uint64_t>(PrintVectorValue);
     Common.ThreadRemoveCodeEntryFromJIT = reinterpret_cast<uintptr_t>(&Context::ContextImpl::ThreadRemoveCodeEntryFromJit);
+    Common.ThreadTierUpBlockFromJIT = reinterpret_cast<uintptr_t>(&Context::ContextImpl::ThreadTierUpBlockFromJit);
     Common.CPUIDObj = reinterpret_cast<uint64_t>(&CTX->CPUID);
 
     {
@@ -610,6 +663,7 @@ Arm64JITCore::Arm64JITCore(FEXCore::Context::ContextImpl *ctx, FEXCore::Core::In
       Common.SyscallHandlerFunc = PMF.GetVTableEntry(CTX->SyscallHandler);
     }
     Common.ExitFunctionLink = reinterpret_cast<uintptr_t>(&Context::ContextImpl::ThreadExitFunctionLink<Arm64JITCore_ExitFunctionLink>);
+    Common.IndirectBranchLink = reinterpret_cast<uintptr_t>(&Context::ContextImpl::ThreadIndirectBranchLink<Arm64JITCore_IndirectBranchLink>);
 
     // Fill in the fallback handlers
     InterpreterOps::FillFallbackIndexPointers(Common.FallbackHandlerPointers);
@@ -624,7 +678,12 @@ Arm64JITCore::Arm64JITCore(FEXCore::Context::ContextImpl *ctx, FEXCore::Core::In
   }
 
   // Must be done after Dispatcher init
-  ClearCache();
+  {
+    std::lock_guard lk(CTX->CodeBufferWriteMutex);
+    ClearCache();
+  }
+
+  CTX->RuleStats.Register(&rule_stats);
 
   // Setup dynamic dispatch.
   if (ParanoidTSO()) {
@@ -648,11 +707,28 @@ void Arm64JITCore::ClearCache() {
 
   auto CodeBuffer = GetEmptyCodeBuffer();
   SetBuffer(CodeBuffer->Ptr, CodeBuffer->Size);
-  EmitDetectionString();
+
+  // Other threads may have emitted into it already
+  if (CodeBuffer->Offset) {
+    SetCursorOffset(CodeBuffer->Offset);
+  }
+  else {
+    EmitDetectionString();
+    CodeBuffer->Offset = GetCursorOffset();
+  }
 }
 
-Arm64JITCore::~Arm64JITCore() {
+void Arm64JITCore::SyncCodeBuffer() {
+  if (IsCodeBufferStale()) {
+    ClearCache();
+  }
+  else {
+    SetCursorOffset(CurrentCodeBuffer->Offset);
+  }
+}
 
+Arm64JITCore::~Arm64JITCore() {
+  CTX->RuleStats.Unregister(&rule_stats);
 }
 
 bool Arm64JITCore::IsInlineConstant(const IR::OrderedNodeWrapper& WNode, uint64_t* Value) const {
@@ -713,24 +789,40 @@ bool Arm64JITCore::IsGPRPair(IR::NodeID Node) const {
 CPUBackend::CompiledCode Arm64JITCore::CompileCode(uint64_t Entry,
                                 FEXCore::IR::IRListView const *IR,
                                 FEXCore::Core::DebugData *DebugData,
-                                FEXCore::IR::RegisterAllocationData *RAData) {
+                                FEXCore::IR::RegisterAllocationData *RAData,
+                                uint32_t TierUpCount) {
   FEXCORE_PROFILE_SCOPED("Arm64::CompileCode");
 
   JumpTargets.clear();
   JumpTargets2.clear();
+  RuleLocalTargets.clear();
   uint32_t SSACount = IR == nullptr ? 20 : IR->GetSSACount();
 
   this->Entry = Entry;
   this->RAData = RAData;
   this->DebugData = DebugData;
   this->IR = IR;
+  CodeRelocatable = EmitRelocatable;
+
+  // Other threads emit into the same code buffer
+  SyncCodeBuffer();
 
-  // Fairly excessive buffer range to make sure we don't overflow
-  uint32_t BufferRange = SSACount * 16;
+  // Fairly excessive buffer range to make sure we don't overflow, exits are far larger than the ops around them.
+  // The tier up of a baseline block leaves like one.
+  uint32_t ExitCount = (IR == nullptr ? SSACount : 0) + (TierUpCount ? 1 : 0);
+  if (IR) {
+    for ([[maybe_unused]] auto BlockNode : IR->GetBlocks()) {
+      ++ExitCount;
+    }
+  }
+  uint32_t BufferRange = SSACount * 16 + ExitCount * MAX_EXIT_SIZE;
   if ((GetCursorOffset() + BufferRange) > CurrentCodeBuffer->Size) {
     CTX->ClearCodeCache(ThreadState);
   }
 
+  // The indirect branch caches are aligned against the block start, which has to keep its alignment when relocated
+  SetCursorOffset(FEXCore::AlignUp(GetCursorOffset(), 16));
+
   CodeData.BlockBegin = GetCursorAddress<uint8_t*>();
 
   // Put the code header at the start of the data block.
@@ -770,6 +862,63 @@ CPUBackend::CompiledCode Arm64JITCore::CompileCode(uint64_t Entry,
   adr(TMP1, &JITCodeHeaderLabel);
   str(TMP1, STATE, offsetof(FEXCore::Core::CPUState, InlineJITBlockHeader));
 
+  if (TierUpCount) {
+    // Count down the executions of the baseline block, the last one drops it and leaves to the dispatcher, which compiles it again.
+    // Racing threads can lose decrements, that only delays the recompile.
+    // The counter lives with the context, the block only carries its address.
+    ARMEmitter::SingleUseForwardLabel l_Counter;
+    ARMEmitter::SingleUseForwardLabel l_Run;
+
+    // The block is replaced before long, keep it out of the code cache
+    CodeRelocatable = false;
+
+    // Note: sub+cbnz used over subs+b.ne to preserve flags.
+    ldr(TMP1, &l_Counter);
+    ldr(TMP2.W(), TMP1, 0);
+    sub(ARMEmitter::Size::i32Bit, TMP2, TMP2, 1);
+    str(TMP2.W(), TMP1, 0);
+    cbnz(ARMEmitter::Size::i32Bit, TMP2, &l_Run);
+
+    PushDynamicRegsAndLR(TMP4);
+    SpillStaticRegs(TMP4);
+
+    // Arguments are passed as follows:
+    // X0: Thread
+    // X1: RIP
+    mov(ARMEmitter::Size::i64Bit, ARMEmitter::Reg::r0, STATE.R());
+    LoadConstant(ARMEmitter::Size::i64Bit, ARMEmitter::Reg::r1, Entry);
+
+    ldr(ARMEmitter::XReg::x2, STATE, offsetof(FEXCore::Core::CpuStateFrame, Pointers.Common.ThreadTierUpBlockFromJIT));
+    if (!CTX->Config.DisableVixlIndirectCalls) [[unlikely]] {
+      GenerateIndirectRuntimeCall<void, void*, void*>(ARMEmitter::Reg::r2);
+    }
+    else {
+      blr(ARMEmitter::Reg::r2);
+    }
+    FillStaticRegs();
+    PopDynamicRegsAndLR();
+
+    ldr(TMP1, STATE, offsetof(FEXCore::Core::CpuStateFrame, Pointers.Common.DispatcherLoopTop));
+    LoadConstant(ARMEmitter::Size::i64Bit, TMP2, Entry);
+    str(TMP2, STATE, offsetof(FEXCore::Core::CpuStateFrame, State.rip));
+    br(TMP1);
+
+    Bind(&l_Counter);
+    dc64(reinterpret_cast<uint64_t>(CTX->ArmTierUpCounter(Entry, TierUpCount)));
+
+    Bind(&l_Run);
+  }
+
+  if (CTX->BlockData) {
+    // Count the executions of the block. Racing threads can lose increments, the counts only rank blocks.
+    auto Calls = &CTX->BlockData->GetBlockData(Entry)->TotalCalls;
+    CodeRelocatable = false;
+    LoadConstant(ARMEmitter::Size::i64Bit, TMP1, reinterpret_cast<uint64_t>(Calls));
+    ldr(TMP2, TMP1, 0);
+    add(ARMEmitter::Size::i64Bit, TMP2, TMP2, 1);
+    str(TMP2, TMP1, 0);
+  }
+
   if (CTX->Config.NeedsPendingInterruptFaultCheck) {
     // Trigger a fault if there are any pending interrupts
     // Used only for suspend on WIN32 at the moment
@@ -795,18 +944,29 @@ CPUBackend::CompiledCode Arm64JITCore::CompileCode(uint64_t Entry,
 
   PendingTargetLabel = nullptr;
 
+  // Where the body starts and what the rules emitted so far, to split the block's code between rules and IR
+  const auto BodyBegin = GetCursorOffset();
+  const auto RuleBytesBegin = rule_stats.rule_host_bytes.load(std::memory_order_relaxed);
+
   /*
     Perform translation rule match
   */
   bool debug = true;
   uint64_t cur_ins_pc = this->Entry;
-  uint32_t reg_liveness[100] = {0};
 
-  // See if we can use rules to do translation
-  if (cur_ins_pc && instr_is_match(cur_ins_pc)) {
+  // Without IR the rules cover the whole block, in guest order
+  if (IR == nullptr && cur_ins_pc && instr_is_match(cur_ins_pc)) {
       debug = false;
+      CodeRelocatable = false;
       auto RTBStartHostCode = GetCursorAddress<uint8_t *>();
-      do_rule_translation(get_translation_rule(cur_ins_pc), reg_liveness);
+      fextl::vector<RuleRecord *> Rules;
+      for (int i = 0; i < rule_record_buf_index; i++) {
+        if (auto Rule = get_translation_rule(rule_record_buf[i].pc)) {
+          Rules.push_back(Rule);
+        }
+      }
+      // Assembled as one stream so the seams between rules get optimized
+      do_rule_stream_translation(Rules.data(), Rules.size());
       if (DebugData) {
         DebugData->Subblocks.push_back({
           static_cast<uint32_t>(RTBStartHostCode - CodeData.BlockEntry),
@@ -875,6 +1035,20 @@ CPUBackend::CompiledCode Arm64JITCore::CompileCode(uint64_t Entry,
   // CodeSize not including the tail data.
   const uint64_t CodeOnlySize = GetCursorAddress<uint8_t *>() - CodeData.BlockBegin;
 
+  if (CTX->TranslationRules) {
+    if (IR == nullptr) {
+      rule_stats_add(rule_stats.blocks_rule_only, 1);
+    }
+    else if (rule_stats.rule_host_bytes.load(std::memory_order_relaxed) != RuleBytesBegin) {
+      rule_stats_add(rule_stats.blocks_mixed, 1);
+    }
+    else {
+      rule_stats_add(rule_stats.ir_blocks, 1);
+      rule_stats_add(rule_stats.ir_guest_instrs, IR->GetHeader()->NumHostInstructions);
+      rule_stats_add(rule_stats.ir_host_bytes, GetCursorOffset() - BodyBegin);
+    }
+  }
+
   // Add the JitCodeTail
   auto JITBlockTailLocation = GetCursorAddress<uint8_t *>();
   auto JITBlockTail = GetCursorAddress<JITCodeTail*>();
@@ -887,8 +1061,7 @@ CPUBackend::CompiledCode Arm64JITCore::CompileCode(uint64_t Entry,
 
   // Put the block's RIP entry in the tail.
   // This will be used for RIP reconstruction in the future.
-  // TODO: This needs to be a data RIP relocation once code caching works.
-  //   Current relocation code doesn't support this feature yet.
+  // Blocks from the code object cache rewrite it when they are relocated.
   JITBlockTail->RIP = Entry;
 
   {
@@ -912,6 +1085,7 @@ CPUBackend::CompiledCode Arm64JITCore::CompileCode(uint64_t Entry,
   CodeData.Size = GetCursorAddress<uint8_t *>() - CodeData.BlockBegin;
 
   JITBlockTail->Size = CodeData.Size;
+  CurrentCodeBuffer->Offset = GetCursorOffset();
 
   ClearICache(CodeData.BlockBegin, CodeOnlySize);
 
@@ -963,6 +1137,8 @@ CPUBackend::CompiledCode Arm64JITCore::CompileCode(uint64_t Entry,
 
   if (DebugData) {
     DebugData->HostCodeSize = CodeData.Size;
+    DebugData->HostEntryOffset = CodeData.BlockEntry - CodeData.BlockBegin;
+    DebugData->Relocatable = CodeRelocatable;
     DebugData->Relocations = &Relocations;
   }
 
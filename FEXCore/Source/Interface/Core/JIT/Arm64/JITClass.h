@@ -12,6 +12,8 @@ $end_info$
 #include "Interface/Core/Dispatcher/Dispatcher.h"
 #include "Interface/Core/Frontend.h"
 #include "Interface/Core/PatternDbt/arm-instr.h"
+#include "Interface/Core/PatternDbt/arm-opt.h"
+#include "Interface/Core/PatternDbt/rule-stats.h"
 #include "Interface/Core/PatternDbt/rule-translate.h"
 
 #include <aarch64/assembler-aarch64.h>
@@ -35,6 +37,9 @@ namespace FEXCore::Core {
   struct InternalThreadState;
 }
 
+// Emitter unit test driving the rule assembler without a guest block
+class RuleStreamTest;
+
 namespace FEXCore::CPU {
 class Arm64JITCore final : public CPUBackend, public Arm64Emitter  {
 public:
@@ -47,7 +52,8 @@ public:
   [[nodiscard]] CPUBackend::CompiledCode CompileCode(uint64_t Entry,
                                   FEXCore::IR::IRListView const *IR,
                                   FEXCore::Core::DebugData *DebugData,
-                                  FEXCore::IR::RegisterAllocationData *RAData) override;
+                                  FEXCore::IR::RegisterAllocationData *RAData,
+                                  uint32_t TierUpCount) override;
 
   [[nodiscard]] void *MapRegion(void* HostPtr, uint64_t, uint64_t) override { return HostPtr; }
 
@@ -58,14 +64,23 @@ public:
   void ClearRelocations() override { Relocations.clear(); }
 
   bool MatchTranslationRule(const void *tb) override;
+  RuleCoverage GetRuleCoverage(uint64_t PC) override;
+  uint32_t SaveTranslationRules(uint64_t Entry, fextl::vector<uint8_t> *Data) override;
+  bool RestoreTranslationRules(uint64_t Entry, uint8_t const *Data, uint32_t DataSize, uint32_t RecordNum) override;
+
+  [[nodiscard]] void *RelocateJITObjectCode(uint64_t Entry, CodeSerialize::CodeObjectFileSection const *SerializationData) override;
 
 private:
+  friend class ::RuleStreamTest;
+
   FEX_CONFIG_OPT(ParanoidTSO, PARANOIDTSO);
 
   const bool HostSupportsSVE128{};
   const bool HostSupportsSVE256{};
   const bool HostSupportsRPRES{};
   const bool HostSupportsAFP{};
+  // Guest RIPs and host pointers go through relocations so blocks can be cached
+  const bool EmitRelocatable{};
 
   ARMEmitter::BiDirectionalLabel *PendingTargetLabel;
   FEXCore::Context::ContextImpl *CTX;
@@ -75,6 +90,8 @@ private:
 
   fextl::map<IR::NodeID, ARMEmitter::BiDirectionalLabel> JumpTargets;
   fextl::map<uint64_t, ARMEmitter::BiDirectionalLabel> JumpTargets2;
+  // Guest RIPs the current rule exit can branch to inside this function
+  fextl::map<uint64_t, IR::NodeID> RuleLocalTargets;
 
   [[nodiscard]] FEXCore::ARMEmitter::Register GetReg(IR::NodeID Node) const {
     const auto Reg = GetPhys(Node);
@@ -162,11 +179,40 @@ private:
 
   // This is purely a debugging aid for developers to see if they are in JIT code space when inspecting raw memory
   void EmitDetectionString();
+  // Picks up the cursor of the shared code buffer, or moves to a new buffer if another thread replaced it
+  void SyncCodeBuffer();
   IR::RegisterAllocationPass *RAPass;
   IR::RegisterAllocationData *RAData;
   FEXCore::Core::DebugData *DebugData;
 
   void ResetStack();
+
+  /**
+   * @name Return stack
+   * @{ */
+    // Leaves the block to NewRIP through the linker, GuestRIPLiteral is bound to where NewRIP is stored
+    void EmitDirectExit(uint64_t NewRIP, bool Relocatable, ARMEmitter::SingleUseForwardLabel *GuestRIPLiteral = nullptr);
+
+    /**
+     * @brief Pushes ReturnRIP on the return stack and calls the exit that follows
+     *
+     * The guest RET to ReturnRIP returns behind the call, where the block leaves to ReturnRIP.
+     * Uses TMP1 and TMP2 and overwrites LR.
+     */
+    void EmitReturnStackCall(uint64_t ReturnRIP, bool Relocatable);
+
+    // Pops the return stack and returns to its host code if it was pushed for RipReg, falls through otherwise
+    void EmitReturnStackReturn(ARMEmitter::Register RipReg);
+
+    /**
+     * @brief Leaves the block to RipReg through a small cache of the targets this exit has seen
+     *
+     * Misses go through the L1 cache and the dispatcher, the linker fills the cache while it has room.
+     * Uses TMP1 through TMP4.
+     */
+    void EmitIndirectExit(ARMEmitter::Register RipReg);
+  /**  @} */
+
   /**
    * @name Relocations
    * @{ */
@@ -198,6 +244,16 @@ private:
      */
     void InsertGuestRIPMove(ARMEmitter::Register Reg, uint64_t Constant);
 
+    /**
+     * @brief Places a guest RIP as a literal in memory
+     *
+     * @param Constant - The guest RIP that will be relocated
+     */
+    void InsertGuestRIPLiteral(uint64_t Constant);
+
+    // Cleared by anything in the current block that relocations can't describe
+    bool CodeRelocatable{};
+
     /**
      * @brief Inserts a named symbol as a literal in memory
      *
@@ -262,7 +318,12 @@ private:
 
   GuestRegisterMapping g_reg_map_buf[1000];
   int g_reg_map_buf_index;
-  int reg_map_num;
+
+  // Bindings of the rule being matched, or of the rule being assembled
+  RuleBindings rule_bind;
+
+  // Rule statistics of this thread, registered with the context
+  RuleStats rule_stats {};
 
   RuleRecord rule_record_buf[800];
   int rule_record_buf_index;
@@ -270,33 +331,28 @@ private:
   uint64_t pc_matched_buf[800];
   int pc_matched_buf_index;
 
-  int imm_map_buf_index_pre;
-  int g_reg_map_buf_index_pre;
-  int label_map_buf_index_pre;
-
-  ImmMapping *imm_map;
-  GuestRegisterMapping *g_reg_map;
-  LabelMapping *l_map;
-
   uint64_t pc_para_matched_buf[800];
   int pc_para_matched_buf_index;
 
+  /* Stand-ins for the last guest instruction of rules restored from the rule cache */
+  fextl::vector<X86Instruction> restored_last_guest;
+
   ARMRegister RipReg;
   uint64_t TrueNewRip;
   uint64_t FalseNewRip;
+  /* Return address pushed by the rule's call */
+  uint64_t CallReturnRip;
 
   inline void reset_buffer(void);
-  inline void save_map_buf_index(void);
-  inline void recover_map_buf_index(void);
-  inline void init_map_ptr(void);
+  inline void reset_bindings(void);
 
   inline void add_rule_record(TranslationRule *rule, uint64_t pc, uint64_t t_pc,
                               X86Instruction *last_guest, bool update_cc, bool save_cc, int pa_opc[20]);
   inline void add_matched_pc(uint64_t pc);
   inline void add_matched_para_pc(uint64_t pc);
-  bool match_label(char *lab_str, uint64_t t, uint64_t f);
+  bool match_label(uint16_t sym, uint64_t t, uint64_t f);
   bool match_register(X86Register greg, X86Register rreg, uint32_t regsize = 0, bool HighBits = false);
-  bool match_imm(uint64_t val, char *sym);
+  bool match_imm(uint64_t val, uint16_t sym);
   bool match_scale(X86Imm *gscale, X86Imm *rscale);
   bool match_offset(X86Imm *goffset, X86Imm *roffset);
   bool match_opd_imm(X86ImmOperand *gopd, X86ImmOperand *ropd);
@@ -304,9 +360,11 @@ private:
   bool match_opd_mem(X86MemOperand *gopd, X86MemOperand *ropd);
   bool check_opd_size(X86Operand *ropd, uint32_t gsize, uint32_t rsize);
   bool match_operand(X86Instruction *ginstr, X86Instruction *rinstr, int opd_idx);
+  bool match_block_rules(FEXCore::Frontend::Decoder::DecodedBlocks const *tb);
+  bool rule_overlaps_match(X86Instruction *head, uint32_t len);
   bool match_rule_internal(X86Instruction *instr, TranslationRule *rule, FEXCore::Frontend::Decoder::DecodedBlocks const *tb);
-  void get_label_map(char *lab_str, uint64_t *t, uint64_t *f);
-  uint64_t get_imm_map(char *sym);
+  void get_label_map(ARMImm *imm, uint64_t *t, uint64_t *f);
+  uint64_t get_imm_map(ARMImm *imm);
   uint64_t GetImmMapWrapper(ARMImm *imm);
   ARMRegister GetGuestRegMap(ARMRegister& reg, uint32_t& regsize);
   ARMRegister GetGuestRegMap(ARMRegister& reg, uint32_t& regsize, bool&& HighBits);
@@ -316,11 +374,25 @@ private:
   bool tb_rule_matched(void);
   bool check_translation_rule(uint64_t pc);
   RuleRecord* get_translation_rule(uint64_t pc);
-  void do_rule_translation(RuleRecord *rule_r, uint32_t *reg_liveness);
+  RuleRecord* find_translation_rule(uint64_t pc);
+  bool assign_rule_temp_regs(RuleRecord *rule_r);
+  bool rule_temp_regs_fit(TranslationRule *rule, X86Instruction *last_guest);
+  void set_rule_context(RuleRecord *rule_r);
+  void resolve_rule_instr(ARMInstruction *instr, ARMOptInstr *c);
+  void do_rule_translation(RuleRecord *rule_r);
+  void do_rule_stream_translation(RuleRecord **rules, int num);
+  void rule_tail_translation(RuleRecord *rule_r);
+  // Host instructions of the rules being assembled, reused between blocks
+  fextl::vector<ARMOptInstr> rule_opt_buf;
+  // Host registers of the rule's scratch registers, set by assign_rule_temp_regs
+  ARMRegister rule_temp_reg[ARM_REG_TEMP_NUM];
 
   void FlipCF();
+  // Cleared while assembling a rule instruction whose carry is never read
+  bool rule_cf_live {true};
   void assemble_arm_instr(ARMInstruction *instr, RuleRecord *rrule);
-  void assemble_arm_exit(uint64_t target_pc);
+  void assemble_arm_exit(uint64_t target_pc, IR::BranchHint hint = IR::BranchHint::None);
+  void assemble_rule_branch(uint64_t target_pc);
 
 #define DEF_OPC(x) void Opc_##x(ARMInstruction *instr, RuleRecord *rrule)
 #define ARM_ASM_DEFS
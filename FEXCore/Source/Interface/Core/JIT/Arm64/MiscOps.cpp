@@ -25,6 +25,42 @@ DEF_OP(GuestOpcode) {
   DebugData->GuestOpcodes.push_back({Op->GuestEntryOffset, GetCursorAddress<uint8_t*>() - CodeData.BlockBegin});
 }
 
+DEF_OP(RuleTranslation) {
+  auto Op = IROp->C<IR::IROp_RuleTranslation>();
+
+  auto Rule = find_translation_rule(Entry + Op->GuestEntryOffset);
+  LOGMAN_THROW_A_FMT(Rule, "No translation rule at 0x{:x}", Entry + Op->GuestEntryOffset);
+
+  // Rule code has its guest addresses built in, it can't be relocated
+  CodeRelocatable = false;
+
+  // Rules only know the static registers, keep the RA's registers around them
+  PushDynamicRegsAndLR(TMP1);
+  do_rule_translation(Rule);
+  PopDynamicRegsAndLR();
+}
+
+DEF_OP(RuleExit) {
+  auto Op = IROp->C<IR::IROp_RuleExit>();
+
+  auto Rule = find_translation_rule(Entry + Op->GuestEntryOffset);
+  LOGMAN_THROW_A_FMT(Rule, "No translation rule at 0x{:x}", Entry + Op->GuestEntryOffset);
+
+  CodeRelocatable = false;
+
+  // The rule leaves the block, nothing of the IR is live anymore
+  do_rule_translation(Rule);
+
+  // Overlapping blocks emit the same exit again, its labels are bound by now
+  JumpTargets2.clear();
+  RuleLocalTargets.clear();
+}
+
+DEF_OP(RuleLocalTarget) {
+  auto Op = IROp->C<IR::IROp_RuleLocalTarget>();
+  RuleLocalTargets[Entry + Op->Offset] = Op->TargetBlock.ID();
+}
+
 DEF_OP(Fence) {
   auto Op = IROp->C<IR::IROp_Fence>();
   switch (Op->Fence) {
@@ -10,17 +10,82 @@ $end_info$
 #include <FEXCore/Utils/LogManager.h>
 
 #include "Interface/Context/Context.h"
+#include "Interface/Core/Dispatcher/Dispatcher.h"
 #include "Interface/Core/LookupCache.h"
 
 namespace FEXCore {
-LookupCache::LookupCache(FEXCore::Context::ContextImpl *CTX)
+SharedLookupCache::SharedLookupCache(FEXCore::Context::ContextImpl *CTX)
   : BlockLinks_mbr { fextl::pmr::get_default_resource() }
   , ctx {CTX} {
-
-  TotalCacheSize = ctx->Config.VirtualMemSize / 4096 * 8 + CODE_SIZE + L1_SIZE;
   BlockLinks_pma = fextl::make_unique<std::pmr::polymorphic_allocator<std::byte>>(&BlockLinks_mbr);
   // Setup our PMR map.
   BlockLinks = BlockLinks_pma->new_object<BlockLinksMapType>();
+}
+
+SharedLookupCache::~SharedLookupCache() {
+  // No need to free BlockLinks map.
+  // These will get freed when their memory allocators are deallocated.
+}
+
+void SharedLookupCache::Erase(uint64_t Address) {
+  std::lock_guard<std::recursive_mutex> lk(Lock);
+
+  // Sever any links to this block
+  const auto LinkerAddress = ctx->Dispatcher->ExitFunctionLinkerAddress;
+  auto lower = BlockLinks->lower_bound({Address, nullptr});
+  auto upper = BlockLinks->upper_bound({Address, reinterpret_cast<FEXCore::Context::ExitFunctionLinkData *>(UINTPTR_MAX)});
+  for (auto it = lower; it != upper; it = BlockLinks->erase(it)) {
+    it->second(LinkerAddress, it->first.HostLink);
+  }
+
+  // Remove from BlockList
+  BlockList.erase(Address);
+}
+
+fextl::vector<uint64_t> SharedLookupCache::EraseRange(uint64_t Start, uint64_t Length) {
+  std::lock_guard<std::recursive_mutex> lk(Lock);
+  fextl::vector<uint64_t> Erased;
+
+  auto lower = CodePages.lower_bound(Start >> 12);
+  auto upper = CodePages.upper_bound((Start + Length - 1) >> 12);
+
+  for (auto it = lower; it != upper; it++) {
+    for (auto Address: it->second) {
+      Erase(Address);
+      Erased.push_back(Address);
+    }
+    it->second.clear();
+  }
+
+  return Erased;
+}
+
+void SharedLookupCache::ClearCache(CodeBufferPtr NewCodeBuffer) {
+  std::lock_guard<std::recursive_mutex> lk(Lock);
+
+  // Threads that didn't catch up yet keep running the old blocks, they have to go through the dispatcher
+  // to get to anything else so they pick up the next generation on the way
+  const auto LinkerAddress = ctx->Dispatcher->ExitFunctionLinkerAddress;
+  for (auto &[Tag, Delinker] : *BlockLinks) {
+    Delinker(LinkerAddress, Tag.HostLink);
+  }
+
+  // Allocate a new pointer from the BlockLinks pma again.
+  BlockLinks = BlockLinks_pma->new_object<BlockLinksMapType>();
+  BlockList.clear();
+  CodePages.clear();
+
+  if (NewCodeBuffer) {
+    CodeBuffer = std::move(NewCodeBuffer);
+  }
+  ++Generation;
+}
+
+LookupCache::LookupCache(FEXCore::Context::ContextImpl *CTX)
+  : ctx {CTX}
+  , Shared {*CTX->BlockCache} {
+
+  TotalCacheSize = ctx->Config.VirtualMemSize / 4096 * 8 + CODE_SIZE + L1_SIZE;
 
   // Block cache ends up looking like this
   // PageMemoryMap[VirtualMemoryRegion >> 12]
@@ -54,9 +119,6 @@ LookupCache::LookupCache(FEXCore::Context::ContextImpl *CTX)
 LookupCache::~LookupCache() {
   const size_t TotalCacheSize = ctx->Config.VirtualMemSize / 4096 * 8 + CODE_SIZE + L1_SIZE;
   FEXCore::Allocator::VirtualFree(reinterpret_cast<void*>(PagePointer), TotalCacheSize);
-
-  // No need to free BlockLinks map.
-  // These will get freed when their memory allocators are deallocated.
 }
 
 void LookupCache::ClearL2Cache() {
@@ -72,10 +134,57 @@ void LookupCache::ClearCache() {
 
   // Clear L1 and L2 by clearing the full cache.
   FEXCore::Allocator::VirtualDontNeed(reinterpret_cast<void*>(PagePointer), TotalCacheSize);
-  // Allocate a new pointer from the BlockLinks pma again.
-  BlockLinks = BlockLinks_pma->new_object<BlockLinksMapType>();
-  // All code is gone, clear the block list
-  BlockList.clear();
+  AllocateOffset = 0;
+}
+
+void LookupCache::SyncCodeBuffer() {
+  std::lock_guard<std::recursive_mutex> lk(WriteLock);
+  std::lock_guard<std::recursive_mutex> lkShared(Shared.Lock);
+
+  if (Generation == Shared.GetGeneration()) {
+    return;
+  }
+
+  ClearCache();
+  Generation = Shared.GetGeneration();
+
+  // Generations without a new code buffer share the previous one
+  auto CodeBuffer = Shared.GetCodeBuffer();
+  if (CodeBuffer && (CodeBuffers.empty() || CodeBuffers.back() != CodeBuffer)) {
+    const auto NumRanges = NumCodeBufferRanges.load(std::memory_order_relaxed);
+    LOGMAN_THROW_A_FMT(NumRanges < MAX_CODE_BUFFERS, "Thread is holding on to too many code buffers");
+
+    CodeBufferRanges[NumRanges] = {
+      .Start = reinterpret_cast<uintptr_t>(CodeBuffer->Ptr),
+      .End = reinterpret_cast<uintptr_t>(CodeBuffer->Ptr) + CodeBuffer->Size,
+    };
+    NumCodeBufferRanges.store(NumRanges + 1, std::memory_order_release);
+
+    CodeBuffers.push_back(std::move(CodeBuffer));
+  }
+}
+
+bool LookupCache::ReleaseCodeBuffers() {
+  if (CodeBuffers.size() <= 1) {
+    return false;
+  }
+
+  // Stop reporting the older buffers before they can get freed
+  CodeBufferRanges[0] = CodeBufferRanges[CodeBuffers.size() - 1];
+  NumCodeBufferRanges.store(1, std::memory_order_release);
+
+  CodeBuffers.erase(CodeBuffers.begin(), CodeBuffers.end() - 1);
+  return true;
+}
+
+bool LookupCache::IsAddressInCodeBuffer(uintptr_t Address) const {
+  const auto NumRanges = NumCodeBufferRanges.load(std::memory_order_acquire);
+  for (size_t i = 0; i < NumRanges; ++i) {
+    if (Address >= CodeBufferRanges[i].Start && Address < CodeBufferRanges[i].End) {
+      return true;
+    }
+  }
+  return false;
 }
 
 }
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 #include "Interface/Context/Context.h"
+#include <FEXCore/Core/CPUBackend.h>
 #include <FEXCore/Utils/LogManager.h>
 #include <FEXCore/fextl/map.h>
 #include <FEXCore/fextl/memory_resource.h>
@@ -8,14 +9,138 @@
 #include <FEXCore/fextl/vector.h>
 #include <FEXCore/fextl/memory_resource.h>
 
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <stddef.h>
 #include <utility>
 #include <mutex>
 
 namespace FEXCore {
 
+// Guest to host block mapping shared by every thread, and the code buffer that every thread emits its blocks into.
+// Each thread looks blocks up in its own LookupCache first and only comes here on a miss.
+class SharedLookupCache {
+public:
+  using CodeBufferPtr = std::shared_ptr<FEXCore::CPU::CPUBackend::CodeBuffer>;
+
+  SharedLookupCache(FEXCore::Context::ContextImpl *CTX);
+  ~SharedLookupCache();
+
+  uintptr_t FindBlock(uint64_t Address) {
+    std::lock_guard<std::recursive_mutex> lk(Lock);
+
+    auto HostCode = BlockList.find(Address);
+    if (HostCode != BlockList.end()) {
+      return HostCode->second;
+    }
+    return 0;
+  }
+
+  fextl::map<uint64_t, fextl::vector<uint64_t>> CodePages;
+
+  // Appends Block {Address} to CodePages [Start, Start + Length)
+  // Returns true if new pages are marked as containing code
+  bool AddBlockExecutableRange(uint64_t Address, uint64_t Start, uint64_t Length) {
+    std::lock_guard<std::recursive_mutex> lk(Lock);
+
+    bool rv = false;
+
+    for (auto CurrentPage = Start >> 12, EndPage = (Start + Length -1) >> 12; CurrentPage <= EndPage; CurrentPage++) {
+      auto &CodePage = CodePages[CurrentPage];
+      rv |= CodePage.size() == 0;
+      CodePage.push_back(Address);
+    }
+
+    return rv;
+  }
+
+  // Adds to Guest -> Host code mapping
+  void AddBlockMapping(uint64_t Address, void *HostCode) {
+    std::lock_guard<std::recursive_mutex> lk(Lock);
+
+    [[maybe_unused]] auto Inserted = BlockList.emplace(Address, (uintptr_t)HostCode).second;
+    LOGMAN_THROW_AA_FMT(Inserted, "Duplicate block mapping added");
+  }
+
+  // Severs the links to the block and removes it, the threads drop it from their L1 and L2 with LookupCache::Erase
+  void Erase(uint64_t Address);
+
+  // Erases every block with code in [Start, Start + Length) and returns their addresses
+  fextl::vector<uint64_t> EraseRange(uint64_t Start, uint64_t Length);
+
+  void AddBlockLink(uint64_t GuestDestination, FEXCore::Context::ExitFunctionLinkData * HostLink, const FEXCore::Context::BlockDelinkerFunc &delinker) {
+    std::lock_guard<std::recursive_mutex> lk(Lock);
+
+    BlockLinks->insert({{GuestDestination, HostLink}, delinker});
+  }
+
+  /**
+   * @brief Drops every block and moves every thread on to the next generation
+   *
+   * @param NewCodeBuffer The code buffer the next generation emits into, nullptr keeps the current one
+   *
+   * The blocks aren't freed, threads keep running them until they catch up with LookupCache::SyncCodeBuffer.
+   * A replaced code buffer lives on until the last thread running code from it releases it.
+   */
+  void ClearCache(CodeBufferPtr NewCodeBuffer = {});
+
+  CodeBufferPtr GetCodeBuffer() {
+    std::lock_guard<std::recursive_mutex> lk(Lock);
+    return CodeBuffer;
+  }
+
+  uint64_t GetGeneration() const { return Generation; }
+  uintptr_t GetGenerationPointer() const { return reinterpret_cast<uintptr_t>(&Generation); }
+
+  bool IsAddressInCodeBuffer(uintptr_t Address) const {
+    return CodeBuffer && Address >= (uintptr_t)CodeBuffer->Ptr && Address < (uintptr_t)CodeBuffer->Ptr + CodeBuffer->Size;
+  }
+
+  // This needs to be taken before reads or writes to anything here.
+  // When taken together with the WriteLock of a thread's LookupCache, that one needs to be taken first.
+  std::recursive_mutex Lock;
+
+private:
+  struct BlockLinkTag {
+    uint64_t GuestDestination;
+    FEXCore::Context::ExitFunctionLinkData *HostLink;
+
+    bool operator <(const BlockLinkTag& other) const {
+      if (GuestDestination < other.GuestDestination)
+        return true;
+      else if (GuestDestination == other.GuestDestination)
+        return HostLink < other.HostLink;
+      else
+        return false;
+    }
+  };
+
+  // Use a monotonic buffer resource to allocate both the std::pmr::map and its members.
+  // This allows us to quickly clear the block link map by clearing the monotonic allocator.
+  // If we had allocated the block link map without the MBR, then clearing the map would require slowly
+  // walking each block member and destructing objects.
+  //
+  // This makes `BlockLinks` look like a raw pointer that could memory leak, but since it is backed by the MBR, it won't.
+  std::pmr::monotonic_buffer_resource BlockLinks_mbr;
+  using BlockLinksMapType = std::pmr::map<BlockLinkTag, FEXCore::Context::BlockDelinkerFunc>;
+  fextl::unique_ptr<std::pmr::polymorphic_allocator<std::byte>> BlockLinks_pma;
+  BlockLinksMapType *BlockLinks;
+
+  fextl::robin_map<uint64_t, uint64_t> BlockList;
+
+  // Every block in BlockList lives in here
+  CodeBufferPtr CodeBuffer;
+  // Bumped whenever the blocks are dropped, only changes with Lock held
+  std::atomic<uint64_t> Generation{};
+  static_assert(sizeof(Generation) == sizeof(uint64_t) && decltype(Generation)::is_always_lock_free, "The dispatcher loads this directly");
+
+  FEXCore::Context::ContextImpl *ctx;
+};
+
+// The L1 and L2 of a thread, in front of the SharedLookupCache
 class LookupCache {
 public:
   struct LookupCacheEntry {
@@ -56,42 +181,30 @@ public:
       }
     }
 
-    // Try L3
-    auto HostCode = BlockList.find(Address);
+    // Try L3, shared with the other threads
+    std::lock_guard<std::recursive_mutex> lkShared(Shared.Lock);
 
-    if (HostCode != BlockList.end()) {
-      CacheBlockMapping(Address, HostCode->second);
-      return HostCode->second;
+    // L1 and L2 can only hold blocks of one generation
+    SyncCodeBuffer();
+
+    if (auto HostCode = Shared.FindBlock(Address)) {
+      CacheBlockMapping(Address, HostCode);
+      return HostCode;
     }
 
     // Failed to find
     return 0;
   }
 
-  fextl::map<uint64_t, fextl::vector<uint64_t>> CodePages;
-
-  // Appends Block {Address} to CodePages [Start, Start + Length)
-  // Returns true if new pages are marked as containing code
   bool AddBlockExecutableRange(uint64_t Address, uint64_t Start, uint64_t Length) {
-    std::lock_guard<std::recursive_mutex> lk(WriteLock);
-
-    bool rv = false;
-
-    for (auto CurrentPage = Start >> 12, EndPage = (Start + Length -1) >> 12; CurrentPage <= EndPage; CurrentPage++) {
-      auto &CodePage = CodePages[CurrentPage];
-      rv |= CodePage.size() == 0;
-      CodePage.push_back(Address);
-    }
-
-    return rv;
+    return Shared.AddBlockExecutableRange(Address, Start, Length);
   }
 
   // Adds to Guest -> Host code mapping
   void AddBlockMapping(uint64_t Address, void *HostCode) {
     std::lock_guard<std::recursive_mutex> lk(WriteLock);
 
-    [[maybe_unused]] auto Inserted = BlockList.emplace(Address, (uintptr_t)HostCode).second;
-    LOGMAN_THROW_AA_FMT(Inserted, "Duplicate block mapping added");
+    Shared.AddBlockMapping(Address, HostCode);
 
     // There is no need to update L1 or L2, they will get updated on first lookup
     // However, adding to L1 here increases performance
@@ -100,20 +213,74 @@ public:
     L1Entry.HostCode = (uintptr_t)HostCode;
   }
 
-  void Erase(FEXCore::Core::CpuStateFrame *Frame, uint64_t Address) {
-
+  // Removes blocks erased from the SharedLookupCache from L1 and L2
+  void Erase(const fextl::vector<uint64_t> &Addresses) {
     std::lock_guard<std::recursive_mutex> lk(WriteLock);
 
-    // Sever any links to this block
-    auto lower = BlockLinks->lower_bound({Address, nullptr});
-    auto upper = BlockLinks->upper_bound({Address, reinterpret_cast<FEXCore::Context::ExitFunctionLinkData *>(UINTPTR_MAX)});
-    for (auto it = lower; it != upper; it = BlockLinks->erase(it)) {
-      it->second(Frame, it->first.HostLink);
+    // The erased blocks are only known for the current generation, the thread didn't catch up yet
+    if (Generation != Shared.GetGeneration()) {
+      ClearCache();
+      return;
+    }
+
+    for (auto Address : Addresses) {
+      Erase(Address);
     }
+  }
+
+  // Links are only tracked for the current code buffer, code of an older one exits through the dispatcher instead
+  bool CanLink(FEXCore::Context::ExitFunctionLinkData *HostLink) {
+    std::lock_guard<std::recursive_mutex> lk(Shared.Lock);
+    return Generation == Shared.GetGeneration() && Shared.IsAddressInCodeBuffer(reinterpret_cast<uintptr_t>(HostLink));
+  }
+
+  void AddBlockLink(uint64_t GuestDestination, FEXCore::Context::ExitFunctionLinkData * HostLink, const FEXCore::Context::BlockDelinkerFunc &delinker) {
+    Shared.AddBlockLink(GuestDestination, HostLink, delinker);
+  }
+
+  // Clears L1 and L2, safe to do from another thread with WriteLock held
+  void ClearCache();
+  void ClearL2Cache();
+
+  /**
+   * @brief Catches up with the generation of the SharedLookupCache, only from the owning thread
+   *
+   * Clears L1 and L2 if the blocks were dropped and keeps the current code buffer alive for this thread.
+   */
+  void SyncCodeBuffer();
+
+  /**
+   * @brief Drops the code buffers of the older generations
+   *
+   * Only safe while nothing of the owning thread is running code from them, no signal frame or block is on its stack.
+   * Returns true if any were dropped.
+   */
+  bool ReleaseCodeBuffers();
+
+  // Safe to call from a signal handler of the owning thread
+  bool IsAddressInCodeBuffer(uintptr_t Address) const;
 
-    // Remove from BlockList
-    BlockList.erase(Address);
+  std::recursive_mutex &GetSharedLock() { return Shared.Lock; }
 
+  uintptr_t GetL1Pointer() const { return L1Pointer; }
+  uintptr_t GetPagePointer() const { return PagePointer; }
+  uintptr_t GetVirtualMemorySize() const { return VirtualMemSize; }
+  uintptr_t GetGenerationPointer() const { return reinterpret_cast<uintptr_t>(&Generation); }
+
+  constexpr static size_t L1_ENTRIES = 1 * 1024 * 1024; // Must be a power of 2
+  constexpr static size_t L1_ENTRIES_MASK = L1_ENTRIES - 1;
+
+  // This needs to be taken before reads or writes to L2, Thread::DebugStore,
+  // and before writes to L1. Concurrent access from a thread that this LookupCache doesn't belong to
+  // may only happen during cross thread invalidation (::Erase and ::ClearCache).
+  // All other operations must be done from the owning thread.
+  // Some care is taken so that L1 lookups can be done without locks, and even tearing is unlikely to lead to a crash.
+  // This approach has not been fully vetted yet.
+  // Also note that L1 lookups might be inlined in the JIT Dispatcher and/or block ends.
+  std::recursive_mutex WriteLock;
+
+private:
+  void Erase(uint64_t Address) {
     // Do L1
     auto &L1Entry = reinterpret_cast<LookupCacheEntry*>(L1Pointer)[Address & L1_ENTRIES_MASK];
     if (L1Entry.GuestCode == Address) {
@@ -141,32 +308,6 @@ public:
     BlockPointers[PageOffset].HostCode = 0;
   }
 
-  void AddBlockLink(uint64_t GuestDestination, FEXCore::Context::ExitFunctionLinkData * HostLink, const FEXCore::Context::BlockDelinkerFunc &delinker) {
-    std::lock_guard<std::recursive_mutex> lk(WriteLock);
-
-    BlockLinks->insert({{GuestDestination, HostLink}, delinker});
-  }
-
-  void ClearCache();
-  void ClearL2Cache();
-
-  uintptr_t GetL1Pointer() const { return L1Pointer; }
-  uintptr_t GetPagePointer() const { return PagePointer; }
-  uintptr_t GetVirtualMemorySize() const { return VirtualMemSize; }
-
-  constexpr static size_t L1_ENTRIES = 1 * 1024 * 1024; // Must be a power of 2
-  constexpr static size_t L1_ENTRIES_MASK = L1_ENTRIES - 1;
-
-  // This needs to be taken before reads or writes to L2, L3, CodePages, Thread::DebugStore,
-  // and before writes to L1. Concurrent access from a thread that this LookupCache doesn't belong to
-  // may only happen during cross thread invalidation (::Erase).
-  // All other operations must be done from the owning thread.
-  // Some care is taken so that L1 lookups can be done without locks, and even tearing is unlikely to lead to a crash.
-  // This approach has not been fully vetted yet.
-  // Also note that L1 lookups might be inlined in the JIT Dispatcher and/or block ends.
-  std::recursive_mutex WriteLock;
-
-private:
   void CacheBlockMapping(uint64_t Address, uintptr_t HostCode) {
     // Do L1
     auto &L1Entry = reinterpret_cast<LookupCacheEntry*>(L1Pointer)[Address & L1_ENTRIES_MASK];
@@ -221,33 +362,6 @@ private:
   uintptr_t PageMemory;
   uintptr_t L1Pointer;
 
-  struct BlockLinkTag {
-    uint64_t GuestDestination;
-    FEXCore::Context::ExitFunctionLinkData *HostLink;
-
-    bool operator <(const BlockLinkTag& other) const {
-      if (GuestDestination < other.GuestDestination)
-        return true;
-      else if (GuestDestination == other.GuestDestination)
-        return HostLink < other.HostLink;
-      else
-        return false;
-    }
-  };
-
-  // Use a monotonic buffer resource to allocate both the std::pmr::map and its members.
-  // This allows us to quickly clear the block link map by clearing the monotonic allocator.
-  // If we had allocated the block link map without the MBR, then clearing the map would require slowly
-  // walking each block member and destructing objects.
-  //
-  // This makes `BlockLinks` look like a raw pointer that could memory leak, but since it is backed by the MBR, it won't.
-  std::pmr::monotonic_buffer_resource BlockLinks_mbr;
-  using BlockLinksMapType = std::pmr::map<BlockLinkTag, FEXCore::Context::BlockDelinkerFunc>;
-  fextl::unique_ptr<std::pmr::polymorphic_allocator<std::byte>> BlockLinks_pma;
-  BlockLinksMapType *BlockLinks;
-
-  fextl::robin_map<uint64_t, uint64_t> BlockList;
-
   size_t TotalCacheSize;
 
   constexpr static size_t CODE_SIZE = 128 * 1024 * 1024;
@@ -257,6 +371,23 @@ private:
   size_t AllocateOffset {};
 
   FEXCore::Context::ContextImpl *ctx;
+  SharedLookupCache &Shared;
   uint64_t VirtualMemSize{};
+
+  // Generation of the SharedLookupCache that L1 and L2 hold blocks of, the dispatcher compares the two
+  uint64_t Generation{~0ULL};
+
+  // Code buffers this thread may still be running code from, the last one is the current generation's
+  fextl::vector<SharedLookupCache::CodeBufferPtr> CodeBuffers;
+
+  // Copy of the CodeBuffers ranges for IsAddressInCodeBuffer, which can interrupt the owning thread while it changes them.
+  // Nothing here is ever allocated or freed, an entry is written before the count including it gets published.
+  struct CodeBufferRange {
+    uintptr_t Start;
+    uintptr_t End;
+  };
+  constexpr static size_t MAX_CODE_BUFFERS = 16;
+  std::array<CodeBufferRange, MAX_CODE_BUFFERS> CodeBufferRanges;
+  std::atomic<size_t> NumCodeBufferRanges{};
 };
 }
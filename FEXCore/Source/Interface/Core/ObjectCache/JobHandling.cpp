@@ -37,7 +37,8 @@ namespace FEXCore::CodeSerialize {
 
         auto &EntryMap = CodeObjectCacheService->GetEntryMap();
 
-        auto it = EntryMap.emplace(Base, std::move(Entry));
+        // try_emplace leaves Entry alone if the base is already in the map
+        auto it = EntryMap.try_emplace(Base, std::move(Entry));
         if (!it.second) {
           // This happens when an application overwrites a previous region without unmapping what was there
 
@@ -45,11 +46,16 @@ namespace FEXCore::CodeSerialize {
           // Once this passes then we know that this section has been loaded.
           it.first->second->NamedJobRefCountMutex.lock();
 
+          // Wait for the serialization jobs of this entry to be written
+          it.first->second->ObjectJobRefCountMutex.lock();
+
           // Finalize anything the region needs to do first.
           CodeObjectCacheService->DoCodeRegionClosure(it.first->second->Base, it.first->second.get());
 
           // munmap the file that was mapped
-          FEXCore::Allocator::munmap(it.first->second->CodeData, it.first->second->FileSize);
+          if (it.first->second->CodeData) {
+            FEXCore::Allocator::munmap(it.first->second->CodeData, it.first->second->FileSize);
+          }
 
           // Remove this entry from the unrelocated map as well
           {
@@ -57,6 +63,10 @@ namespace FEXCore::CodeSerialize {
             CodeObjectCacheService->GetUnrelocatedEntryMap().erase(it.first->second->EntryHeader.OriginalBase);
           }
 
+          // Nothing can be waiting on the old entry anymore, it is destroyed by the overwrite
+          it.first->second->ObjectJobRefCountMutex.unlock();
+          it.first->second->NamedJobRefCountMutex.unlock();
+
           // Now overwrite the entry in the map
           it = EntryMap.insert_or_assign(Base, std::move(Entry));
           EntryIterator = it.first;
@@ -95,11 +105,17 @@ namespace FEXCore::CodeSerialize {
         // Once this passes it will have been loaded
         it->second->NamedJobRefCountMutex.lock();
 
+        // Wait for the serialization jobs of this entry to be written, their iterators point in to the map
+        it->second->ObjectJobRefCountMutex.lock();
+
         // Take the pointer from the map
         EntryPointer = std::move(it->second);
 
         // We can now unmap the file data
-        FEXCore::Allocator::munmap(EntryPointer->CodeData, EntryPointer->FileSize);
+        if (EntryPointer->CodeData) {
+          FEXCore::Allocator::munmap(EntryPointer->CodeData, EntryPointer->FileSize);
+          EntryPointer->CodeData = nullptr;
+        }
 
         // Remove this from the entry map
         EntryMap.erase(it);
@@ -125,6 +141,45 @@ namespace FEXCore::CodeSerialize {
   }
 
   void AsyncJobHandler::AsyncAddSerializationJob(fextl::unique_ptr<SerializationJobData> Data) {
-    // XXX: Actually add serialization job
+#ifndef _WIN32
+    {
+      std::shared_lock lk {CodeObjectCacheService->GetEntryMapMutex()};
+
+      auto &EntryMap = CodeObjectCacheService->GetEntryMap();
+
+      // Find the named region the code lives in
+      // The canary is always above, so this is only begin() if nothing is mapped below GuestRIP
+      auto it = EntryMap.upper_bound(Data->GuestRIP);
+      if (it == EntryMap.begin()) {
+        return;
+      }
+      --it;
+
+      // Only code entirely inside of the named region can be loaded back from its file
+      const auto Entry = it->second.get();
+      if (Data->GuestCodeStart < Entry->Base ||
+          (Data->GuestCodeStart + Data->GuestCodeLength) > (Entry->Base + Entry->Size)) {
+        return;
+      }
+
+      // Held until the job is written, removing the region waits on it
+      Entry->ObjectJobRefCountMutex.lock_shared();
+      Data->ObjectJobRefCountMutexPtr = &Entry->ObjectJobRefCountMutex;
+      Data->CodeRegionIterator = it;
+    }
+
+    Data->ThreadJobRefCount->lock_shared();
+
+    // Block linking backpatches the code once it runs, so copy and hash it now
+    const auto HostCode = reinterpret_cast<const uint8_t *>(Data->HostCodeBegin);
+    Data->HostCode.assign(HostCode, HostCode + Data->HostCodeLength);
+    Data->HostCodeHash = XXH3_64bits(Data->HostCode.data(), Data->HostCode.size());
+    Data->GuestCodeHash = XXH3_64bits(reinterpret_cast<const void *>(Data->GuestCodeStart), Data->GuestCodeLength);
+
+    CodeObjectCacheService->AsyncAddSerializationWorkItem(std::move(Data));
+
+    // Tell the async thread that it has work to do
+    CodeObjectCacheService->NotifyWork();
+#endif
   }
 }
@@ -2,10 +2,21 @@
 #include "Interface/Context/Context.h"
 #include "Interface/Core/ObjectCache/ObjectCacheService.h"
 
-
+#include <FEXCore/Config/Config.h>
+#include <FEXCore/Utils/AllocatorHooks.h>
+#include <FEXCore/Utils/LogManager.h>
+#include <FEXCore/Utils/MathUtils.h>
+#include <FEXCore/fextl/fmt.h>
 #include <FEXCore/fextl/memory.h>
 #include <FEXCore/fextl/string.h>
 
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <xxhash.h>
+
 namespace FEXCore::CodeSerialize {
   NamedRegionObjectHandler::NamedRegionObjectHandler(FEXCore::Context::ContextImpl *ctx) {
     DefaultSerializationConfig.Cookie = CODE_COOKIE;
@@ -24,17 +35,109 @@ namespace FEXCore::CodeSerialize {
     DefaultSerializationConfig.x87ReducedPrecision = ctx->Config.x87ReducedPrecision;
   }
 
+  void NamedRegionObjectHandler::LoadObjectFile(CodeRegionEntry *Entry) {
+    int FD = open(Entry->ObjectEntrySourceFilename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (FD == -1) {
+      return;
+    }
+
+    // Don't map a record that another process is in the middle of appending
+    struct stat st{};
+    void *FilePtr = MAP_FAILED;
+    flock(FD, LOCK_SH);
+    if (fstat(FD, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(CodeObjectSerializationHeader)) {
+      FilePtr = FEXCore::Allocator::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, FD, 0);
+    }
+    flock(FD, LOCK_UN);
+    close(FD);
+
+    if (FilePtr == MAP_FAILED) {
+      return;
+    }
+
+    const size_t Size = st.st_size;
+    const auto Header = reinterpret_cast<CodeObjectSerializationHeader const *>(FilePtr);
+    if (!IsCompatibleHeader(*Header)) {
+      // The next serialized code object starts the file over
+      LogMan::Msg::IFmt("ObjectCache: Ignoring stale {}", Entry->ObjectEntrySourceFilename);
+      FEXCore::Allocator::munmap(FilePtr, Size);
+      return;
+    }
+
+    Entry->CodeData = reinterpret_cast<char *>(FilePtr);
+    Entry->FileSize = Size;
+    Entry->EntryHeader = *Header;
+
+    Entry->FileCodeSections.reserve(Header->NumCodeEntries);
+    size_t Offset = sizeof(CodeObjectSerializationHeader);
+    while (Offset + sizeof(CodeSerializationData) <= Size) {
+      const auto Data = reinterpret_cast<CodeSerializationData const *>(Entry->CodeData + Offset);
+      const size_t Remaining = Size - Offset - sizeof(CodeSerializationData);
+
+      // A record cut short by a crashing writer ends the file
+      if (Data->HostCodeLength > Remaining || Data->RelocationsSize > Remaining ||
+          FEXCore::AlignUp(Data->HostCodeLength, 8) + Data->RelocationsSize > Remaining) {
+        break;
+      }
+
+      const auto HostCode = Entry->CodeData + Offset + sizeof(CodeSerializationData);
+      const bool Invalid = Data->HostEntryOffset >= Data->HostCodeLength ||
+        XXH3_64bits(HostCode, Data->HostCodeLength) != Data->HostCodeHash;
+
+      Entry->FileCodeSections.push_back(CodeObjectFileSection {
+        .Serialized = true,
+        .Invalid = Invalid,
+        .Data = Data,
+        .HostCode = HostCode,
+        .NumRelocations = Data->NumRelocations,
+        .Relocations = HostCode + FEXCore::AlignUp(Data->HostCodeLength, 8),
+      });
+
+      Offset += sizeof(CodeSerializationData) + FEXCore::AlignUp(FEXCore::AlignUp(Data->HostCodeLength, 8) + Data->RelocationsSize, 8);
+    }
+
+    // Built once the sections are done moving around
+    Entry->SectionLookupMap.reserve(Entry->FileCodeSections.size());
+    for (auto &Section : Entry->FileCodeSections) {
+      if (!Section.Invalid) {
+        // Processes racing on a block write it more than once, they are all the same
+        Entry->SectionLookupMap.try_emplace(Section.Data->GuestOffset, &Section);
+      }
+    }
+
+    LogMan::Msg::DFmt("ObjectCache: {} has {} code objects", Entry->Filename, Entry->SectionLookupMap.size());
+  }
+
   void NamedRegionObjectHandler::AddNamedRegionObject(CodeRegionMapType::iterator Entry, const fextl::string &base_filename, const fextl::string &filename, bool Executable) {
-    // XXX: Add named region objects
+    auto Region = Entry->second.get();
+
+    // One object file per mapping of a file, for this configuration
+    // Offsets in the file are relative to the base of the mapping
+    Region->ObjectEntrySourceFilename = fextl::fmt::format("{}codecache/{}-{:x}-{:x}-{:x}-{}.fexobj",
+      FEXCore::Config::GetDataDirectory(),
+      base_filename,
+      XXH3_64bits(filename.c_str(), filename.size()),
+      Region->Offset,
+      CodeObjectSerializationConfig::GetHash(DefaultSerializationConfig),
+      CODE_VERSION);
 
-    // XXX: Until entry loading is complete just claim it is loaded
-    Entry->second->NamedJobRefCountMutex.unlock();
+    if (Executable) {
+      LoadObjectFile(Region);
+    }
+
+    // The region is loaded, let the JIT look it up
+    Region->NamedJobRefCountMutex.unlock();
   }
 
   void NamedRegionObjectHandler::RemoveNamedRegionObject(uintptr_t Base, uintptr_t Size, fextl::unique_ptr<CodeRegionEntry> Entry) {
-    // XXX: Remove named region objects
+    // Every serialization job of this region was written before the remove job was queued
+    if (Entry->CurrentSerializedFD != -1) {
+      close(Entry->CurrentSerializedFD);
+      Entry->CurrentSerializedFD = -1;
+    }
 
-    // XXX: Until entry loading is complete just claim it is loaded
+    // Locked by AsyncRemoveNamedRegionJob, must be unlocked before the entry is freed
+    Entry->ObjectJobRefCountMutex.unlock();
     Entry->NamedJobRefCountMutex.unlock();
   }
 
@@ -2,8 +2,18 @@
 #include "Interface/Core/ObjectCache/ObjectCacheService.h"
 
 #include <FEXCore/Config/Config.h>
+#include <FEXCore/Utils/LogManager.h>
+#include <FEXCore/Utils/MathUtils.h>
 #include <FEXCore/fextl/memory.h>
 #include <FEXCore/Utils/Threads.h>
+#include <FEXHeaderUtils/Filesystem.h>
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <xxhash.h>
 
 namespace {
   static void* ThreadHandler(void *Arg) {
@@ -52,12 +62,166 @@ namespace FEXCore::CodeSerialize {
       // Don't do closure on canary
       return;
     }
-    // XXX: Do code region closure
+
+    // Everything was written when the job was handled, only the FD is left
+    if (it->CurrentSerializedFD != -1) {
+      close(it->CurrentSerializedFD);
+      it->CurrentSerializedFD = -1;
+    }
   }
 
   CodeObjectFileSection const *CodeObjectSerializeService::FetchCodeObjectFromCache(uint64_t GuestRIP) {
-    // XXX: Actually fetch code objects from cache
-    return nullptr;
+    std::shared_lock lk {EntryMapMutex};
+
+    // The canary is always above, so this is only begin() if nothing is mapped below GuestRIP
+    auto it = AddressToEntryMap.upper_bound(GuestRIP);
+    if (it == AddressToEntryMap.begin()) {
+      return nullptr;
+    }
+    --it;
+
+    const auto Entry = it->second.get();
+    if (GuestRIP >= (Entry->Base + Entry->Size)) {
+      return nullptr;
+    }
+
+    // Blocks until the async thread has loaded the region
+    std::shared_lock lk2 {Entry->NamedJobRefCountMutex};
+
+    auto Section = Entry->FindSection(GuestRIP);
+    if (!Section || Section->Invalid) {
+      return nullptr;
+    }
+
+    const auto Data = Section->Data;
+    const uint64_t GuestCodeStart = GuestRIP + Data->GuestCodeOffset;
+    if (GuestCodeStart < Entry->Base ||
+        Data->GuestCodeLength > (Entry->Base + Entry->Size - GuestCodeStart)) {
+      return nullptr;
+    }
+
+    // The file may have changed since the code was compiled
+    if (XXH3_64bits(reinterpret_cast<const void *>(GuestCodeStart), Data->GuestCodeLength) != Data->GuestCodeHash) {
+      return nullptr;
+    }
+
+    return Section;
+  }
+
+  void CodeObjectSerializeService::HandleSerializationJobs() {
+    // Walk through all of our jobs sequentially until the work queue is empty
+    while (SerializationWorkQueueJobs.load()) {
+      fextl::unique_ptr<AsyncJobHandler::SerializationJobData> Data;
+
+      {
+        std::unique_lock lk {SerializationWorkQueueMutex};
+        if (!SerializationWorkQueue.empty()) {
+          Data = std::move(SerializationWorkQueue.front());
+          SerializationWorkQueue.pop();
+        }
+
+        --SerializationWorkQueueJobs;
+      }
+
+      if (!Data) {
+        continue;
+      }
+
+      auto Entry = Data->CodeRegionIterator->second.get();
+      if (Entry->StillSerializing && !SerializeCodeObject(Data.get(), Entry)) {
+        // Don't keep failing on every block of this region
+        LogMan::Msg::IFmt("ObjectCache: Couldn't write {}", Entry->ObjectEntrySourceFilename);
+        Entry->StillSerializing = false;
+      }
+
+      // The region and the thread can go away now
+      Data->ObjectJobRefCountMutexPtr->unlock_shared();
+      Data->ThreadJobRefCount->unlock_shared();
+    }
+  }
+
+  bool CodeObjectSerializeService::SerializeCodeObject(AsyncJobHandler::SerializationJobData *Data, CodeRegionEntry *Entry) {
+    if (Entry->ObjectEntrySourceFilename.empty()) {
+      return false;
+    }
+
+    if (Entry->CurrentSerializedFD == -1) {
+      if (!FHU::Filesystem::CreateDirectories(FEXCore::Config::GetDataDirectory() + "codecache")) {
+        return false;
+      }
+
+      Entry->CurrentSerializedFD = open(Entry->ObjectEntrySourceFilename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+      if (Entry->CurrentSerializedFD == -1) {
+        return false;
+      }
+    }
+
+    // Lay the record out: header, host code, relocations, each 8 byte aligned
+    CodeSerializationData Header {
+      .GuestOffset = Data->GuestRIP - Entry->Base,
+      .GuestCodeOffset = static_cast<int64_t>(Data->GuestCodeStart - Data->GuestRIP),
+      .GuestCodeLength = Data->GuestCodeLength,
+      .GuestCodeHash = Data->GuestCodeHash,
+      .HostCodeLength = Data->HostCode.size(),
+      .HostCodeHash = Data->HostCodeHash,
+      .HostEntryOffset = Data->HostEntryOffset,
+      .NumRelocations = static_cast<uint32_t>(Data->Relocations.size()),
+      .RelocationsSize = 0,
+    };
+
+    fextl::vector<uint8_t> Record(sizeof(Header) + FEXCore::AlignUp(Header.HostCodeLength, 8));
+    memcpy(&Record[sizeof(Header)], Data->HostCode.data(), Header.HostCodeLength);
+
+    for (auto Reloc : Data->Relocations) {
+      // Guest RIPs get stored relative to the block, the file is valid at any load address
+      if (Reloc.Header.Type == FEXCore::CPU::RelocationTypes::RELOC_GUEST_RIP_MOVE) {
+        Reloc.GuestRIPMove.GuestRIP -= Data->GuestRIP;
+      }
+      else if (Reloc.Header.Type == FEXCore::CPU::RelocationTypes::RELOC_GUEST_RIP_LITERAL) {
+        Reloc.GuestRIPLiteral.GuestRIP -= Data->GuestRIP;
+      }
+
+      const auto RelocSize = FEXCore::CPU::GetRelocationSize(Reloc);
+      const auto Offset = Record.size();
+      Record.resize(Offset + RelocSize);
+      memcpy(&Record[Offset], &Reloc, RelocSize);
+      Header.RelocationsSize += RelocSize;
+    }
+
+    memcpy(&Record[0], &Header, sizeof(Header));
+    Record.resize(FEXCore::AlignUp(Record.size(), 8));
+
+    // Other processes append to the same file
+    const int FD = Entry->CurrentSerializedFD;
+    if (flock(FD, LOCK_EX) == -1) {
+      return false;
+    }
+
+    struct stat st{};
+    CodeObjectSerializationHeader FileHeader{};
+    bool Written = fstat(FD, &st) == 0;
+
+    if (Written && (static_cast<size_t>(st.st_size) < sizeof(FileHeader) ||
+                    pread(FD, &FileHeader, sizeof(FileHeader), 0) != sizeof(FileHeader) ||
+                    !NamedRegionHandler.IsCompatibleHeader(FileHeader))) {
+      // New file, or one from a different FEX version. Start over
+      FileHeader = NamedRegionHandler.DefaultCodeHeader(Entry->Base, Entry->Offset);
+      Written = ftruncate(FD, 0) == 0;
+      st.st_size = sizeof(FileHeader);
+    }
+
+    FileHeader.TotalCodeSize += Header.HostCodeLength;
+    ++FileHeader.NumCodeEntries;
+    FileHeader.TotalRelocationsCount += Header.NumRelocations;
+
+    // A writer that crashed may have left a partial record, keep the alignment
+    const off_t RecordOffset = FEXCore::AlignUp(st.st_size, 8);
+    Written = Written &&
+      pwrite(FD, Record.data(), Record.size(), RecordOffset) == static_cast<ssize_t>(Record.size()) &&
+      pwrite(FD, &FileHeader, sizeof(FileHeader), 0) == sizeof(FileHeader);
+
+    flock(FD, LOCK_UN);
+    return Written;
   }
 
   void CodeObjectSerializeService::ExecutionThread() {
@@ -70,9 +234,14 @@ namespace FEXCore::CodeSerialize {
       // Handle named region async jobs first. Highest priority
       NamedRegionHandler.HandleNamedRegionObjectJobs();
 
-      // XXX: Handle code serialization jobs second.
+      // Handle code serialization jobs second.
+      HandleSerializationJobs();
     }
 
+    // Write out whatever was queued before the shutdown
+    NamedRegionHandler.HandleNamedRegionObjectJobs();
+    HandleSerializationJobs();
+
     // Do final code region closures on thread shutdown
     for (auto &it : AddressToEntryMap) {
       DoCodeRegionClosure(it.first, it.second.get());
@@ -19,7 +19,27 @@
 namespace FEXCore::CodeSerialize {
   // XXX: Does this need to be signal safe?
   using CodeSerializationMutex = std::shared_mutex;
+
+  /**
+   * @brief The header of a code object in an object cache file
+   *
+   * Followed by the host code and the packed relocations, padded to 8 bytes
+   */
   struct CodeSerializationData {
+    // The block's entry, relative to the base of the named region
+    uint64_t GuestOffset;
+    // Start of the guest code the block was compiled from, relative to the block's entry
+    int64_t GuestCodeOffset;
+    uint64_t GuestCodeLength;
+    uint64_t GuestCodeHash;
+
+    uint64_t HostCodeLength;
+    uint64_t HostCodeHash;
+    // Offset of the entrypoint from the start of the host code
+    uint32_t HostEntryOffset;
+
+    uint32_t NumRelocations;
+    uint64_t RelocationsSize;
   };
 
   struct CodeObjectFileSection {
@@ -115,6 +135,16 @@ namespace FEXCore::CodeSerialize {
       fextl::robin_map<uint64_t, CodeObjectFileSection*> SectionLookupMap{};
     /**  @} */
 
+    /**
+     * @brief Looks up the code object of the block at GuestRIP
+     *
+     * NamedJobRefCountMutex must be held
+     */
+    CodeObjectFileSection *FindSection(uint64_t GuestRIP) const {
+      auto it = SectionLookupMap.find(GuestRIP - Base);
+      return it == SectionLookupMap.end() ? nullptr : it->second;
+    }
+
     // Default initialization
     CodeRegionEntry() = default;
 
@@ -146,14 +176,18 @@ namespace FEXCore::CodeSerialize {
        */
       struct SerializationJobData {
         uint64_t GuestRIP;        ///< The RIP for the guest
-        // XXX: Support multiblock
+        uint64_t GuestCodeStart;  ///< Lowest guest address of the code, below GuestRIP with multiblock
         uint64_t GuestCodeLength; ///< The Guest's code length
         uint64_t GuestCodeHash;   ///< Hash of the guest code
 
         void *HostCodeBegin;      ///< Host JIT code starting memory address
         size_t HostCodeLength;    ///< Host JIT code length
+        uint32_t HostEntryOffset; ///< Offset of the entrypoint from HostCodeBegin
         uint64_t HostCodeHash;    ///< Host JIT code hash before any backpatching
 
+        // Copy of the host code before any backpatching, taken when the job is added
+        fextl::vector<uint8_t> HostCode;
+
         // This is the thread specific ref counter for outstanding jobs.
         // This shared mutex is incremented when the job is added, then decremented when the job is complete.
         // If a thread is shutting down or clearing code cache then the thread will pull a unique lock on this mutex.
@@ -265,6 +299,12 @@ namespace FEXCore::CodeSerialize {
 
     protected:
       friend class AsyncJobHandler;
+      friend class CodeObjectSerializeService;
+
+      // Checks the header of an object cache file against our current process configuration
+      bool IsCompatibleHeader(CodeObjectSerializationHeader const &Header) const {
+        return Header.Config == DefaultSerializationConfig;
+      }
 
       // Return a default code header based off the default serialization config
       CodeObjectSerializationHeader DefaultCodeHeader(uint64_t Base, uint64_t Offset) const {
@@ -306,7 +346,7 @@ namespace FEXCore::CodeSerialize {
 
     private:
       // Code version. If the code emission changes then this needs to increment
-      constexpr static uint32_t CODE_VERSION = 0x0;
+      constexpr static uint32_t CODE_VERSION = 0x1;
 
       // Default cookie header for the file header
       constexpr static uint64_t CODE_COOKIE = FEXCore::IR::COOKIE_VERSION("FEXC", CODE_VERSION);
@@ -330,6 +370,11 @@ namespace FEXCore::CodeSerialize {
        * @{ */
         void AddNamedRegionObject(CodeRegionMapType::iterator Entry, const fextl::string &base_filename, const fextl::string &filename, bool Executable);
         void RemoveNamedRegionObject(uintptr_t Base, uintptr_t Size, fextl::unique_ptr<CodeRegionEntry> Entry);
+
+        /**
+         * @brief Maps the object cache file of Entry and indexes its code objects
+         */
+        void LoadObjectFile(CodeRegionEntry *Entry);
       /**  @} */
   };
 
@@ -441,6 +486,27 @@ namespace FEXCore::CodeSerialize {
        */
       void NotifyWork() { WorkAvailable.NotifyOne(); }
 
+      /**
+       * @brief Queues a code object for the async thread to write
+       */
+      void AsyncAddSerializationWorkItem(fextl::unique_ptr<AsyncJobHandler::SerializationJobData> Data) {
+        std::unique_lock lk {SerializationWorkQueueMutex};
+        SerializationWorkQueue.emplace(std::move(Data));
+        ++SerializationWorkQueueJobs;
+      }
+
+      /**
+       * @brief Writes every queued code object to its region's object cache file
+       */
+      void HandleSerializationJobs();
+
+      /**
+       * @brief Appends one code object to the object cache file of its region
+       *
+       * @return false if the file couldn't be written
+       */
+      bool SerializeCodeObject(AsyncJobHandler::SerializationJobData *Data, CodeRegionEntry *Entry);
+
     private:
       FEXCore::Context::ContextImpl *CTX;
 
@@ -457,5 +523,10 @@ namespace FEXCore::CodeSerialize {
       // Entry maps
       CodeRegionMapType AddressToEntryMap;
       CodeRegionPtrMapType UnrelocatedAddressToEntryMap;
+
+      // Code serialization jobs, consumed as a FIFO after the named region jobs
+      std::atomic<uint64_t> SerializationWorkQueueJobs{};
+      std::mutex SerializationWorkQueueMutex{};
+      fextl::queue<fextl::unique_ptr<AsyncJobHandler::SerializationJobData>> SerializationWorkQueue{};
   };
 }
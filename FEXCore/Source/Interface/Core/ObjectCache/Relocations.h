@@ -19,6 +19,10 @@ namespace FEXCore::CPU {
     // 64-bit mov on x86-64
     // Aligned to struct RelocGuestRIPMove
     RELOC_GUEST_RIP_MOVE,
+
+    // 8 byte literal in memory for a guest RIP
+    // Aligned to struct RelocGuestRIPLiteral
+    RELOC_GUEST_RIP_LITERAL,
   };
 
   struct RelocationTypeHeader final {
@@ -63,6 +67,18 @@ namespace FEXCore::CPU {
     uint64_t Offset{};
 
     // The unrelocated RIP that is being moved
+    // Relative to the block's entry once serialized
+    uint64_t GuestRIP;
+  };
+
+  struct RelocGuestRIPLiteral final {
+    RelocationTypeHeader Header{};
+
+    // Offset in to the code section to begin the relocation
+    uint64_t Offset{};
+
+    // The unrelocated RIP in the literal
+    // Relative to the block's entry once serialized
     uint64_t GuestRIP;
   };
 
@@ -75,5 +91,22 @@ namespace FEXCore::CPU {
     RelocNamedThunkMove NamedThunkMove;
 
     RelocGuestRIPMove GuestRIPMove;
+
+    RelocGuestRIPLiteral GuestRIPLiteral;
   };
+
+  /**
+   * @brief Size of a relocation in a serialized relocation list
+   *
+   * Serialized relocations are packed by the size of their type, not the size of the union
+   */
+  static inline size_t GetRelocationSize(const Relocation &Reloc) {
+    switch (Reloc.Header.Type) {
+      case RelocationTypes::RELOC_NAMED_SYMBOL_LITERAL: return sizeof(Reloc.NamedSymbolLiteral);
+      case RelocationTypes::RELOC_NAMED_THUNK_MOVE: return sizeof(Reloc.NamedThunkMove);
+      case RelocationTypes::RELOC_GUEST_RIP_MOVE: return sizeof(Reloc.GuestRIPMove);
+      case RelocationTypes::RELOC_GUEST_RIP_LITERAL: return sizeof(Reloc.GuestRIPLiteral);
+    }
+    return sizeof(Reloc);
+  }
 }
@@ -261,7 +261,7 @@ void OpDispatchBuilder::RETOp(OpcodeArgs) {
   CalculateDeferredFlags();
 
   // Store the new RIP
-  _ExitFunction(NewRIP);
+  _ExitFunction(NewRIP, IR::BranchHint::Return);
   BlockSetRIP = true;
 }
 
@@ -815,7 +815,7 @@ void OpDispatchBuilder::CALLOp(OpcodeArgs) {
   CalculateDeferredFlags();
   if (NextRIP != TargetRIP) {
     // Store the RIP
-    _ExitFunction(NewRIP); // If we get here then leave the function now
+    _ExitFunction(NewRIP, IR::BranchHint::Call, NextRIP - Entry); // If we get here then leave the function now
   }
   else {
     NeedsBlockEnd = true;
@@ -842,7 +842,7 @@ void OpDispatchBuilder::CALLAbsoluteOp(OpcodeArgs) {
 
   // Store the RIP
   CalculateDeferredFlags();
-  _ExitFunction(JMPPCOffset); // If we get here then leave the function now
+  _ExitFunction(JMPPCOffset, IR::BranchHint::Call, Op->PC + Op->InstSize - Entry); // If we get here then leave the function now
 }
 
 OrderedNode *OpDispatchBuilder::SelectBit(OrderedNode *Cmp, bool TrueIsNonzero, IR::OpSize ResultSize, OrderedNode *TrueValue, OrderedNode *FalseValue) {
@@ -4530,6 +4530,45 @@ void OpDispatchBuilder::Finalize() {
   }
 }
 
+void OpDispatchBuilder::RuleTranslation(uint32_t GuestEntryOffset, FEXCore::X86Tables::DecodedOp ExitOp) {
+  // Rules expect the flags in NZCV, the same as at the start of a block
+  CalculateDeferredFlags();
+
+  if (ExitOp) {
+    // Successors in this function are branched to directly, the rest leave through the dispatcher
+    auto AddLocalTarget = [this](uint64_t Target) {
+      auto it = JumpTargets.find(Target);
+      if (it != JumpTargets.end()) {
+        _RuleLocalTarget(it->second.BlockEntry, Target - Entry);
+      }
+    };
+
+    const uint64_t NextRIP = ExitOp->PC + ExitOp->InstSize;
+    AddLocalTarget(NextRIP);
+
+    if ((ExitOp->TableInfo->Flags & X86Tables::InstFlags::FLAGS_SETS_RIP) && ExitOp->Src[0].IsLiteral()) {
+      uint64_t Target = NextRIP + ExitOp->Src[0].Data.Literal.Value;
+      if (GetGPRSize() == 4) {
+        Target &= 0xFFFFFFFFU;
+      }
+
+      if (Target != NextRIP) {
+        AddLocalTarget(Target);
+      }
+    }
+
+    _RuleExit(GuestEntryOffset);
+    BlockSetRIP = true;
+    return;
+  }
+
+  _RuleTranslation(GuestEntryOffset);
+
+  // The rule may have changed any flag
+  CachedNZCV = nullptr;
+  PossiblySetNZCVBits = ~0U;
+}
+
 uint8_t OpDispatchBuilder::GetDstSize(X86Tables::DecodedOp Op) const {
   const uint32_t DstSizeFlag = X86Tables::DecodeFlags::GetSizeDstFlags(Op->Flags);
   LOGMAN_THROW_AA_FMT(DstSizeFlag != 0 && DstSizeFlag != X86Tables::DecodeFlags::SIZE_MASK, "Invalid destination size for op");
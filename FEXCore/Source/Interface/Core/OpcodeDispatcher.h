@@ -249,6 +249,10 @@ public:
   void BeginFunction(uint64_t RIP, fextl::vector<FEXCore::Frontend::Decoder::DecodedBlocks> const *Blocks, uint32_t NumInstructions, bool Is64BitMode);
   void Finalize();
 
+  // Hands the guest instructions of a matched translation rule over to the backend.
+  // ExitOp is the last instruction of the block when the rule covers the rest of it.
+  void RuleTranslation(uint32_t GuestEntryOffset, FEXCore::X86Tables::DecodedOp ExitOp = nullptr);
+
   // Dispatch builder functions
 #define OpcodeArgs [[maybe_unused]] FEXCore::X86Tables::DecodedOp Op
   void UnhandledOp(OpcodeArgs);
@@ -13,6 +13,7 @@
 #include "Interface/Core/PatternDbt/arm-instr.h"
 #include "Interface/Core/PatternDbt/rule-translate.h"
 #include "Interface/Core/PatternDbt/rule-debug-log.h"
+#include "Interface/Core/PatternDbt/rule-trace.h"
 
 using namespace FEXCore;
 
@@ -159,6 +160,14 @@ static ARMEmitter::VRegister GetVRegMap(ARMRegister& reg)
   return reg_invalid;
 }
 
+static ARMEmitter::SubRegSize GetSubRegSize(uint8_t ElementSize)
+{
+  LOGMAN_THROW_AA_FMT(ElementSize == 1 || ElementSize == 2 || ElementSize == 4 || ElementSize == 8, "Invalid element size");
+  return ElementSize == 1 ? ARMEmitter::SubRegSize::i8Bit :
+         ElementSize == 2 ? ARMEmitter::SubRegSize::i16Bit :
+         ElementSize == 4 ? ARMEmitter::SubRegSize::i32Bit : ARMEmitter::SubRegSize::i64Bit;
+}
+
 static ARMEmitter::ExtendedMemOperand  GenerateExtMemOperand(ARMEmitter::Register Base,
                                             ARMRegister Index,
                                             int32_t Imm,
@@ -488,6 +497,8 @@ DEF_OPC(MOV) {
           uxtb(EmitSize, Dst, Src);
         else if (Reg1Size == 2 && !HighBits)
           uxth(EmitSize, Dst, Src);
+        else if (Dst == Src && EmitSize == ARMEmitter::Size::i64Bit)
+          ;  // scratch register coalesced with its source, nothing to move
         else
           mov(EmitSize, Dst, Src);  // move (register)
                                     // move (to/from SP) not support
@@ -853,10 +864,10 @@ DEF_OPC(BIC) {
         }
 
       } else
-          LogMan::Msg::IFmt( "[arm] Unsupported reg for bic instruction.");
+          LogMan::Msg::EFmt( "[arm] Unsupported reg for bic instruction.");
 
     } else
-        LogMan::Msg::IFmt( "[arm] Unsupported operand type for bic instruction.");
+        LogMan::Msg::EFmt( "[arm] Unsupported operand type for bic instruction.");
 }
 
 
@@ -1056,6 +1067,9 @@ DEF_OPC(ADC) {
 
 // behind cmp, sub instr
 void FEXCore::CPU::Arm64JITCore::FlipCF() {
+    if (!rule_cf_live)
+        return;
+
     mrs((ARMEmitter::Reg::r20).X(), ARMEmitter::SystemRegister::NZCV);
     eor(ARMEmitter::Size::i32Bit, (ARMEmitter::Reg::r20).W(), (ARMEmitter::Reg::r20).W(), 0x20000000);
     msr(ARMEmitter::SystemRegister::NZCV, (ARMEmitter::Reg::r20).X());
@@ -1214,6 +1228,11 @@ DEF_OPC(MUL) {
 
     uint32_t Reg0Size, Reg1Size, Reg2Size;
     auto ARMReg = GetGuestRegMap(opd0->content.reg.num, Reg0Size);
+    // The vector forms of mul, smull and umull
+    if (ARMReg >= ARM_REG_V0 && ARMReg <= ARM_REG_V31) {
+      Opc_VALU(instr, rrule);
+      return;
+    }
     auto Dst = GetRegMap(ARMReg);
 
     const auto EmitSize =
@@ -1564,7 +1583,7 @@ DEF_OPC(B) {
 
     // get new rip
     uint64_t target, fallthrough;
-    get_label_map(opd->content.imm.content.sym, &target, &fallthrough);
+    get_label_map(&opd->content.imm, &target, &fallthrough);
     this->TrueNewRip = fallthrough + target;
     this->FalseNewRip = fallthrough;
 
@@ -1605,7 +1624,7 @@ DEF_OPC(CBNZ) {
 
     // get new rip
     uint64_t target, fallthrough;
-    get_label_map(opd->content.imm.content.sym, &target, &fallthrough);
+    get_label_map(&opd->content.imm, &target, &fallthrough);
     this->TrueNewRip = fallthrough + target;
     this->FalseNewRip = fallthrough;
 
@@ -1633,7 +1652,7 @@ DEF_OPC(SET_JUMP) {
     }
 
     if (opd->type == ARM_OPD_TYPE_IMM) {
-        get_label_map(opd->content.imm.content.sym, &target, &fallthrough);
+        get_label_map(&opd->content.imm, &target, &fallthrough);
 
         LoadConstant(ARMEmitter::Size::i64Bit, ARMEmitter::Reg::r20, fallthrough & Mask);
         LoadConstant(ARMEmitter::Size::i64Bit, ARMEmitter::Reg::r21, target);
@@ -1663,7 +1682,7 @@ DEF_OPC(SET_CALL) {
     auto MemSrc = ARMEmitter::ExtendedMemOperand((ARMEmitter::Reg::r8).X(), ARMEmitter::IndexType::PRE, -0x8);
 
     if (instr->opd_num && opd->type == ARM_OPD_TYPE_IMM) {
-        get_label_map(opd->content.imm.content.sym, &target, &fallthrough);
+        get_label_map(&opd->content.imm, &target, &fallthrough);
         LoadConstant(ARMEmitter::Size::i64Bit, (ARMEmitter::Reg::r20).X(), fallthrough & Mask);
 
         int64_t s = static_cast<int64_t>(target);
@@ -1676,11 +1695,13 @@ DEF_OPC(SET_CALL) {
           add(ARMEmitter::Size::i64Bit, (ARMEmitter::Reg::r21).X(), (ARMEmitter::Reg::r20).X(), (ARMEmitter::Reg::r21).X());
         }
         str((ARMEmitter::Reg::r20).X(), MemSrc);
+        CallReturnRip = fallthrough & Mask;
         // Set New RIP Reg
         RipReg = ARM_REG_R21;
     } else if (instr->opd_num && opd->type == ARM_OPD_TYPE_REG) {
         LoadConstant(ARMEmitter::Size::i64Bit, (ARMEmitter::Reg::r20).X(), rrule->target_pc & Mask);
         str((ARMEmitter::Reg::r20).X(), MemSrc);
+        CallReturnRip = rrule->target_pc & Mask;
         // Set New RIP Reg
         uint32_t Reg0Size;
         auto Src = GetGuestRegMap(opd->content.reg.num, Reg0Size);
@@ -1688,6 +1709,7 @@ DEF_OPC(SET_CALL) {
     } else if (!instr->opd_num) { // only push
         LoadConstant(ARMEmitter::Size::i64Bit, (ARMEmitter::Reg::r21).X(), rrule->target_pc & Mask);
         str((ARMEmitter::Reg::r21).X(), MemSrc);
+        CallReturnRip = rrule->target_pc & Mask;
         // Set New RIP Reg
         RipReg = ARM_REG_R20;
     }
@@ -1709,7 +1731,7 @@ DEF_OPC(PC_L) {
         ARMReg = GetGuestRegMap(opd1->content.reg.num, Reg1Size);
         auto RIPDst = GetRegMap(ARMReg);
 
-        get_label_map(opd2->content.imm.content.sym, &target, &fallthrough);
+        get_label_map(&opd2->content.imm, &target, &fallthrough);
         // 32bit this isn't RIP relative but instead absolute
         int64_t s = static_cast<int64_t>(static_cast<int32_t>(target));
         LoadConstant(ARMEmitter::Size::i64Bit, RIPDst.X(), (fallthrough + s) & Mask);
@@ -1725,7 +1747,7 @@ DEF_OPC(PC_L) {
           ldr(Dst.X(), MemSrc);
 
     } else if (opd1->type == ARM_OPD_TYPE_IMM) {
-        get_label_map(opd1->content.imm.content.sym, &target, &fallthrough);
+        get_label_map(&opd1->content.imm, &target, &fallthrough);
         // 32bit this isn't RIP relative but instead absolute
         int64_t s = static_cast<int64_t>(static_cast<int32_t>(target));
         LoadConstant(ARMEmitter::Size::i64Bit, Dst.X(), (fallthrough + s) & Mask);
@@ -1748,7 +1770,7 @@ DEF_OPC(PC_S) {
       ARMReg = GetGuestRegMap(opd1->content.reg.num, Reg1Size);
       auto RIPDst = GetRegMap(ARMReg);
 
-      get_label_map(opd2->content.imm.content.sym, &target, &fallthrough);
+      get_label_map(&opd2->content.imm, &target, &fallthrough);
       LoadConstant(ARMEmitter::Size::i64Bit, RIPDst.X(), (fallthrough + target) & Mask);
 
       auto MemSrc = ARMEmitter::ExtendedMemOperand(RIPDst.X(), ARMEmitter::IndexType::OFFSET, 0x0);
@@ -2082,7 +2104,7 @@ DEF_OPC(FMOV) {
     uint32_t Reg0Size, Reg1Size;
     auto ARMReg = GetGuestRegMap(opd0->content.reg.num, Reg0Size);
     if (ARMReg >= ARM_REG_R0 && ARMReg <= ARM_REG_R31) {
-        instr->opc = ARM_OPC_UMOV;
+        /* Rule instructions may live in a read-only rule database, don't rewrite the opcode */
         Opc_UMOV(instr, rrule);
         return;
     }
@@ -2347,10 +2369,356 @@ DEF_OPC(ZIP) {
 }
 
 
+/* The vector handlers below take the arrangement of the first operand: OpSize 8
+   is a 64-bit vector and an OpSize equal to the ElementSize a single element.
+   Widening and narrowing ops name the destination elements, like the emitter. */
+DEF_OPC(VALU) {
+    ARMOperand *opd0 = &instr->opd[0];
+    ARMOperand *opd1 = &instr->opd[1];
+    ARMOperand *opd2 = &instr->opd[2];
+    const auto OpSize = instr->OpSize;
+    const auto SubRegSize = GetSubRegSize(instr->ElementSize);
+
+    uint32_t Reg0Size, Reg1Size, Reg2Size;
+    auto ARMReg = GetGuestRegMap(opd0->content.reg.num, Reg0Size);
+    auto Dst = GetVRegMap(ARMReg);
+    ARMReg = GetGuestRegMap(opd1->content.reg.num, Reg1Size);
+    auto Vector1 = GetVRegMap(ARMReg);
+    ARMReg = GetGuestRegMap(opd2->content.reg.num, Reg2Size);
+    auto Vector2 = GetVRegMap(ARMReg);
+
+    auto Emit = [&](auto Dst, auto Vector1, auto Vector2) {
+      switch (instr->opc) {
+        case ARM_OPC_MUL:      mul(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_SQADD:    sqadd(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_UQADD:    uqadd(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_SQSUB:    sqsub(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_UQSUB:    uqsub(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_SMAX:     smax(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_SMIN:     smin(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_UMAX:     umax(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_UMIN:     umin(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_URHADD:   urhadd(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_UABD:     uabd(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_CMGE:     cmge(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_CMHI:     cmhi(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_CMHS:     cmhs(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_CMTST:    cmtst(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_SSHL:     sshl(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_USHL:     ushl(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_SQDMULH:  sqdmulh(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_SQRDMULH: sqrdmulh(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_TRN1:     trn1(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_TRN2:     trn2(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_UZP1:     uzp1(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_UZP2:     uzp2(SubRegSize, Dst, Vector1, Vector2); break;
+        default:
+          LogMan::Msg::EFmt("[arm] Unsupported vector instruction {}.", get_arm_instr_opc(instr->opc));
+      }
+    };
+
+    switch (instr->opc) {
+      // Widening multiplies of the lower and upper halves
+      case ARM_OPC_SMULL:  smull(SubRegSize, Dst.D(), Vector1.D(), Vector2.D()); break;
+      case ARM_OPC_SMULL2: smull2(SubRegSize, Dst.Q(), Vector1.Q(), Vector2.Q()); break;
+      case ARM_OPC_UMULL:  umull(SubRegSize, Dst.D(), Vector1.D(), Vector2.D()); break;
+      case ARM_OPC_UMULL2: umull2(SubRegSize, Dst.Q(), Vector1.Q(), Vector2.Q()); break;
+      default:
+        if (OpSize == 8)
+          Emit(Dst.D(), Vector1.D(), Vector2.D());
+        else
+          Emit(Dst.Q(), Vector1.Q(), Vector2.Q());
+    }
+}
+
+
+DEF_OPC(VMISC) {
+    ARMOperand *opd0 = &instr->opd[0];
+    ARMOperand *opd1 = &instr->opd[1];
+    const auto OpSize = instr->OpSize;
+    const auto SubRegSize = GetSubRegSize(instr->ElementSize);
+
+    uint32_t Reg0Size, Reg1Size;
+    auto ARMReg = GetGuestRegMap(opd0->content.reg.num, Reg0Size);
+    auto Dst = GetVRegMap(ARMReg);
+    ARMReg = GetGuestRegMap(opd1->content.reg.num, Reg1Size);
+    auto Vector = GetVRegMap(ARMReg);
+
+    auto Emit = [&](auto Dst, auto Vector) {
+      switch (instr->opc) {
+        case ARM_OPC_ABS:    abs(SubRegSize, Dst, Vector); break;
+        case ARM_OPC_NOT:    not_(ARMEmitter::SubRegSize::i8Bit, Dst, Vector); break;
+        case ARM_OPC_CNT:    cnt(SubRegSize, Dst, Vector); break;
+        case ARM_OPC_SADDLP: saddlp(SubRegSize, Dst, Vector); break;
+        case ARM_OPC_UADDLP: uaddlp(SubRegSize, Dst, Vector); break;
+        default:
+          LogMan::Msg::EFmt("[arm] Unsupported vector instruction {}.", get_arm_instr_opc(instr->opc));
+      }
+    };
+
+    switch (instr->opc) {
+      // Narrowing, the 2 forms write the upper half and keep the lower one
+      case ARM_OPC_XTN:    xtn(SubRegSize, Dst, Vector); break;
+      case ARM_OPC_XTN2:   xtn2(SubRegSize, Dst, Vector); break;
+      case ARM_OPC_SQXTN:  sqxtn(SubRegSize, Dst, Vector); break;
+      case ARM_OPC_SQXTN2: sqxtn2(SubRegSize, Dst, Vector); break;
+      case ARM_OPC_UQXTN:  uqxtn(SubRegSize, Dst, Vector); break;
+      case ARM_OPC_UQXTN2: uqxtn2(SubRegSize, Dst, Vector); break;
+      // Widening of the lower and upper halves
+      case ARM_OPC_SXTL:   sxtl(SubRegSize, Dst, Vector); break;
+      case ARM_OPC_SXTL2:  sxtl2(SubRegSize, Dst, Vector); break;
+      case ARM_OPC_UXTL:   uxtl(SubRegSize, Dst.D(), Vector.D()); break;
+      case ARM_OPC_UXTL2:  uxtl2(SubRegSize, Dst.Q(), Vector.Q()); break;
+      // Across lanes, always of a full 128-bit vector
+      case ARM_OPC_ADDV:   addv(SubRegSize, Dst.Q(), Vector.Q()); break;
+      case ARM_OPC_UADDLV: uaddlv(SubRegSize, Dst.Q(), Vector.Q()); break;
+      case ARM_OPC_UMAXV:  umaxv(SubRegSize, Dst.Q(), Vector.Q()); break;
+      case ARM_OPC_UMINV:  uminv(SubRegSize, Dst.Q(), Vector.Q()); break;
+      default:
+        if (OpSize == 8)
+          Emit(Dst.D(), Vector.D());
+        else
+          Emit(Dst.Q(), Vector.Q());
+    }
+}
+
+
+DEF_OPC(VSHIFT) {
+    ARMOperand *opd0 = &instr->opd[0];
+    ARMOperand *opd1 = &instr->opd[1];
+    ARMOperand *opd2 = &instr->opd[2];
+    const auto OpSize = instr->OpSize;
+    const auto SubRegSize = GetSubRegSize(instr->ElementSize);
+
+    uint32_t Reg0Size, Reg1Size;
+    auto ARMReg = GetGuestRegMap(opd0->content.reg.num, Reg0Size);
+    auto Dst = GetVRegMap(ARMReg);
+    ARMReg = GetGuestRegMap(opd1->content.reg.num, Reg1Size);
+    auto Vector = GetVRegMap(ARMReg);
+
+    if (opd2->type != ARM_OPD_TYPE_IMM) {
+      LogMan::Msg::EFmt("[arm] Unsupported operand type for {} instruction.", get_arm_instr_opc(instr->opc));
+      return;
+    }
+    uint32_t Shift = GetImmMapWrapper(&opd2->content.imm);
+
+    auto Emit = [&](auto Dst, auto Vector) {
+      switch (instr->opc) {
+        case ARM_OPC_SHL:  shl(SubRegSize, Dst, Vector, Shift); break;
+        case ARM_OPC_SSHR: sshr(SubRegSize, Dst, Vector, Shift); break;
+        case ARM_OPC_USHR: ushr(SubRegSize, Dst, Vector, Shift); break;
+        default:
+          LogMan::Msg::EFmt("[arm] Unsupported vector instruction {}.", get_arm_instr_opc(instr->opc));
+      }
+    };
+
+    if (instr->opc == ARM_OPC_SHRN)
+      shrn(SubRegSize, Dst.D(), Vector.D(), Shift);
+    else if (OpSize == 8)
+      Emit(Dst.D(), Vector.D());
+    else
+      Emit(Dst.Q(), Vector.Q());
+}
+
+
+DEF_OPC(VBITSEL) {
+    ARMOperand *opd0 = &instr->opd[0];
+    ARMOperand *opd1 = &instr->opd[1];
+    ARMOperand *opd2 = &instr->opd[2];
+    const auto OpSize = instr->OpSize;
+
+    uint32_t Reg0Size, Reg1Size, Reg2Size;
+    auto ARMReg = GetGuestRegMap(opd0->content.reg.num, Reg0Size);
+    auto Dst = GetVRegMap(ARMReg);
+    ARMReg = GetGuestRegMap(opd1->content.reg.num, Reg1Size);
+    auto Vector1 = GetVRegMap(ARMReg);
+    ARMReg = GetGuestRegMap(opd2->content.reg.num, Reg2Size);
+    auto Vector2 = GetVRegMap(ARMReg);
+
+    // All three read the destination, as the mask for bsl and as the data for bit and bif
+    auto Emit = [&](auto Dst, auto Vector1, auto Vector2) {
+      if (instr->opc == ARM_OPC_BSL)
+        bsl(Dst, Vector1, Vector2);
+      else if (instr->opc == ARM_OPC_BIT)
+        bit(Dst, Vector1, Vector2);
+      else
+        bif(Dst, Vector1, Vector2);
+    };
+
+    if (OpSize == 8)
+      Emit(Dst.D(), Vector1.D(), Vector2.D());
+    else
+      Emit(Dst.Q(), Vector1.Q(), Vector2.Q());
+}
+
+
+DEF_OPC(FALU) {
+    ARMOperand *opd0 = &instr->opd[0];
+    ARMOperand *opd1 = &instr->opd[1];
+    ARMOperand *opd2 = &instr->opd[2];
+    const auto OpSize = instr->OpSize;
+    const auto ElementSize = instr->ElementSize;
+
+    uint32_t Reg0Size, Reg1Size, Reg2Size;
+    auto ARMReg = GetGuestRegMap(opd0->content.reg.num, Reg0Size);
+    auto Dst = GetVRegMap(ARMReg);
+    ARMReg = GetGuestRegMap(opd1->content.reg.num, Reg1Size);
+    auto Vector1 = GetVRegMap(ARMReg);
+    ARMReg = GetGuestRegMap(opd2->content.reg.num, Reg2Size);
+    auto Vector2 = GetVRegMap(ARMReg);
+
+    LOGMAN_THROW_AA_FMT(ElementSize == 4 || ElementSize == 8, "{} Invalid size", get_arm_instr_opc(instr->opc));
+
+    if (OpSize == ElementSize) {
+      const auto ScalarSize = ElementSize == 4 ? ARMEmitter::ScalarRegSize::i32Bit : ARMEmitter::ScalarRegSize::i64Bit;
+      switch (instr->opc) {
+        case ARM_OPC_FADD: fadd(ScalarSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_FSUB: fsub(ScalarSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_FMUL: fmul(ScalarSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_FDIV: fdiv(ScalarSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_FMIN: fmin(ScalarSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_FMAX: fmax(ScalarSize, Dst, Vector1, Vector2); break;
+        default:
+          LogMan::Msg::EFmt("[arm] Unsupported scalar form of {}.", get_arm_instr_opc(instr->opc));
+      }
+      return;
+    }
+
+    const auto SubRegSize = GetSubRegSize(ElementSize);
+    auto Emit = [&](auto Dst, auto Vector1, auto Vector2) {
+      switch (instr->opc) {
+        case ARM_OPC_FADD:  fadd(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_FSUB:  fsub(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_FMUL:  fmul(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_FDIV:  fdiv(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_FMIN:  fmin(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_FMAX:  fmax(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_FCMEQ: fcmeq(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_FCMGE: fcmge(SubRegSize, Dst, Vector1, Vector2); break;
+        case ARM_OPC_FCMGT: fcmgt(SubRegSize, Dst, Vector1, Vector2); break;
+        default:
+          LogMan::Msg::EFmt("[arm] Unsupported vector instruction {}.", get_arm_instr_opc(instr->opc));
+      }
+    };
+
+    if (OpSize == 8)
+      Emit(Dst.D(), Vector1.D(), Vector2.D());
+    else
+      Emit(Dst.Q(), Vector1.Q(), Vector2.Q());
+}
+
+
+DEF_OPC(FMISC) {
+    ARMOperand *opd0 = &instr->opd[0];
+    ARMOperand *opd1 = &instr->opd[1];
+    const auto OpSize = instr->OpSize;
+    const auto ElementSize = instr->ElementSize;
+
+    uint32_t Reg0Size, Reg1Size;
+    auto ARMReg = GetGuestRegMap(opd0->content.reg.num, Reg0Size);
+    auto Dst = GetVRegMap(ARMReg);
+    ARMReg = GetGuestRegMap(opd1->content.reg.num, Reg1Size);
+    auto Vector = GetVRegMap(ARMReg);
+
+    LOGMAN_THROW_AA_FMT(ElementSize == 4 || ElementSize == 8, "{} Invalid size", get_arm_instr_opc(instr->opc));
+
+    if (OpSize == ElementSize) {
+      const auto ScalarSize = ElementSize == 4 ? ARMEmitter::ScalarRegSize::i32Bit : ARMEmitter::ScalarRegSize::i64Bit;
+      switch (instr->opc) {
+        case ARM_OPC_FABS:   fabs(ScalarSize, Dst, Vector); break;
+        case ARM_OPC_FNEG:   fneg(ScalarSize, Dst, Vector); break;
+        case ARM_OPC_FSQRT:  fsqrt(ScalarSize, Dst, Vector); break;
+        case ARM_OPC_SCVTF:  scvtf(ScalarSize, Dst, Vector); break;
+        case ARM_OPC_FCVTZS: fcvtzs(ScalarSize, Dst, Vector); break;
+        default:
+          LogMan::Msg::EFmt("[arm] Unsupported scalar form of {}.", get_arm_instr_opc(instr->opc));
+      }
+      return;
+    }
+
+    const auto SubRegSize = GetSubRegSize(ElementSize);
+    auto Emit = [&](auto Dst, auto Vector) {
+      switch (instr->opc) {
+        case ARM_OPC_FABS:   fabs(SubRegSize, Dst, Vector); break;
+        case ARM_OPC_FNEG:   fneg(SubRegSize, Dst, Vector); break;
+        case ARM_OPC_FSQRT:  fsqrt(SubRegSize, Dst, Vector); break;
+        case ARM_OPC_SCVTF:  scvtf(SubRegSize, Dst, Vector); break;
+        case ARM_OPC_FCVTZS: fcvtzs(SubRegSize, Dst, Vector); break;
+        default:
+          LogMan::Msg::EFmt("[arm] Unsupported vector instruction {}.", get_arm_instr_opc(instr->opc));
+      }
+    };
+
+    if (OpSize == 8)
+      Emit(Dst.D(), Vector.D());
+    else
+      Emit(Dst.Q(), Vector.Q());
+}
+
+
+DEF_OPC(FCMP) {
+    ARMOperand *opd0 = &instr->opd[0];
+    ARMOperand *opd1 = &instr->opd[1];
+    const auto ElementSize = instr->ElementSize;
+
+    uint32_t Reg0Size, Reg1Size;
+    auto ARMReg = GetGuestRegMap(opd0->content.reg.num, Reg0Size);
+    auto Vector1 = GetVRegMap(ARMReg);
+    ARMReg = GetGuestRegMap(opd1->content.reg.num, Reg1Size);
+    auto Vector2 = GetVRegMap(ARMReg);
+
+    LOGMAN_THROW_AA_FMT(ElementSize == 4 || ElementSize == 8, "fcmp Invalid size");
+    fcmp(ElementSize == 4 ? ARMEmitter::ScalarRegSize::i32Bit : ARMEmitter::ScalarRegSize::i64Bit, Vector1, Vector2);
+}
+
+
+DEF_OPC(MOVI) {
+    ARMOperand *opd0 = &instr->opd[0];
+    ARMOperand *opd1 = &instr->opd[1];
+    const auto OpSize = instr->OpSize;
+    const auto SubRegSize = GetSubRegSize(instr->ElementSize);
+
+    uint32_t Reg0Size;
+    auto ARMReg = GetGuestRegMap(opd0->content.reg.num, Reg0Size);
+    auto Dst = GetVRegMap(ARMReg);
+
+    if (opd1->type != ARM_OPD_TYPE_IMM) {
+      LogMan::Msg::EFmt("[arm] Unsupported operand type for movi instruction.");
+      return;
+    }
+    uint64_t Imm = GetImmMapWrapper(&opd1->content.imm);
+
+    if (OpSize == 8)
+      movi(SubRegSize, Dst.D(), Imm);
+    else
+      movi(SubRegSize, Dst.Q(), Imm);
+}
+
+
+DEF_OPC(TBL) {
+    ARMOperand *opd0 = &instr->opd[0];
+    ARMOperand *opd1 = &instr->opd[1];
+    ARMOperand *opd2 = &instr->opd[2];
+    const auto OpSize = instr->OpSize;
+
+    // tbl Vd, {Vn.16b}, Vm, a single 128-bit table register
+    uint32_t Reg0Size, Reg1Size, Reg2Size;
+    auto ARMReg = GetGuestRegMap(opd0->content.reg.num, Reg0Size);
+    auto Dst = GetVRegMap(ARMReg);
+    ARMReg = GetGuestRegMap(opd1->content.reg.num, Reg1Size);
+    auto Table = GetVRegMap(ARMReg);
+    ARMReg = GetGuestRegMap(opd2->content.reg.num, Reg2Size);
+    auto Index = GetVRegMap(ARMReg);
+
+    if (OpSize == 8)
+      tbl(Dst.D(), Table.Q(), Index.D());
+    else
+      tbl(Dst.Q(), Table.Q(), Index.Q());
+}
+
+
 void FEXCore::CPU::Arm64JITCore::assemble_arm_instr(ARMInstruction *instr, RuleRecord *rrule)
 {
-    LogMan::Msg::IFmt("ARM instr in the asm: {}.", get_arm_instr_opc(instr->opc));
-
     switch (instr->opc) {
         case ARM_OPC_LDRB:
         case ARM_OPC_LDRSB:
@@ -2500,45 +2868,133 @@ void FEXCore::CPU::Arm64JITCore::assemble_arm_instr(ARMInstruction *instr, RuleR
         case ARM_OPC_ZIP2:
             Opc_ZIP(instr, rrule);
             break;
+        case ARM_OPC_SQADD:
+        case ARM_OPC_UQADD:
+        case ARM_OPC_SQSUB:
+        case ARM_OPC_UQSUB:
+        case ARM_OPC_SMAX:
+        case ARM_OPC_SMIN:
+        case ARM_OPC_UMAX:
+        case ARM_OPC_UMIN:
+        case ARM_OPC_URHADD:
+        case ARM_OPC_UABD:
+        case ARM_OPC_CMGE:
+        case ARM_OPC_CMHI:
+        case ARM_OPC_CMHS:
+        case ARM_OPC_CMTST:
+        case ARM_OPC_SSHL:
+        case ARM_OPC_USHL:
+        case ARM_OPC_SQDMULH:
+        case ARM_OPC_SQRDMULH:
+        case ARM_OPC_SMULL2:
+        case ARM_OPC_UMULL2:
+        case ARM_OPC_TRN1:
+        case ARM_OPC_TRN2:
+        case ARM_OPC_UZP1:
+        case ARM_OPC_UZP2:
+            Opc_VALU(instr, rrule);
+            break;
+        case ARM_OPC_ABS:
+        case ARM_OPC_NOT:
+        case ARM_OPC_CNT:
+        case ARM_OPC_SADDLP:
+        case ARM_OPC_UADDLP:
+        case ARM_OPC_XTN:
+        case ARM_OPC_XTN2:
+        case ARM_OPC_SQXTN:
+        case ARM_OPC_SQXTN2:
+        case ARM_OPC_UQXTN:
+        case ARM_OPC_UQXTN2:
+        case ARM_OPC_SXTL:
+        case ARM_OPC_SXTL2:
+        case ARM_OPC_UXTL:
+        case ARM_OPC_UXTL2:
+        case ARM_OPC_ADDV:
+        case ARM_OPC_UADDLV:
+        case ARM_OPC_UMAXV:
+        case ARM_OPC_UMINV:
+            Opc_VMISC(instr, rrule);
+            break;
+        case ARM_OPC_SHL:
+        case ARM_OPC_SSHR:
+        case ARM_OPC_USHR:
+        case ARM_OPC_SHRN:
+            Opc_VSHIFT(instr, rrule);
+            break;
+        case ARM_OPC_BSL:
+        case ARM_OPC_BIT:
+        case ARM_OPC_BIF:
+            Opc_VBITSEL(instr, rrule);
+            break;
+        case ARM_OPC_FADD:
+        case ARM_OPC_FSUB:
+        case ARM_OPC_FMUL:
+        case ARM_OPC_FDIV:
+        case ARM_OPC_FMIN:
+        case ARM_OPC_FMAX:
+        case ARM_OPC_FCMEQ:
+        case ARM_OPC_FCMGE:
+        case ARM_OPC_FCMGT:
+            Opc_FALU(instr, rrule);
+            break;
+        case ARM_OPC_FABS:
+        case ARM_OPC_FNEG:
+        case ARM_OPC_FSQRT:
+        case ARM_OPC_SCVTF:
+        case ARM_OPC_FCVTZS:
+            Opc_FMISC(instr, rrule);
+            break;
+        case ARM_OPC_FCMP:
+            Opc_FCMP(instr, rrule);
+            break;
+        case ARM_OPC_MOVI:
+            Opc_MOVI(instr, rrule);
+            break;
+        case ARM_OPC_TBL:
+            Opc_TBL(instr, rrule);
+            break;
         default:
+            rule_trace(RULE_TRACE_UNSUPPORTED, rrule->pc, rrule->rule->index);
             LogMan::Msg::EFmt("Unsupported arm instruction in the assembler: {}, rule index: {}.",
                     get_arm_instr_opc(instr->opc), rrule->rule->index);
     }
 }
 
-void FEXCore::CPU::Arm64JITCore::assemble_arm_exit(uint64_t target_pc)
+void FEXCore::CPU::Arm64JITCore::assemble_arm_exit(uint64_t target_pc, IR::BranchHint hint)
 {
     ResetStack();
 
-    if (target_pc != 0) {
-      ARMEmitter::SingleUseForwardLabel l_BranchHost;
-      ldr(TMP1, &l_BranchHost);
-      blr(TMP1);
-
-      Bind(&l_BranchHost);
-      dc64(ThreadState->CurrentFrame->Pointers.Common.ExitFunctionLinker);
-      dc64(target_pc);
-    } else {
-      ARMEmitter::SingleUseForwardLabel FullLookup;
-      auto RipReg = GetRegMap(this->RipReg);
-
-      // L1 Cache
-      ldr(TMP1, STATE, offsetof(FEXCore::Core::CpuStateFrame, Pointers.Common.L1Pointer));
+    auto RipReg = target_pc != 0 ? ARMEmitter::Reg::zr : GetRegMap(this->RipReg);
 
-      and_(ARMEmitter::Size::i64Bit, TMP4, RipReg, LookupCache::L1_ENTRIES_MASK);
-      add(TMP1, TMP1, TMP4, ARMEmitter::ShiftType::LSL, 4);
+    /* Guest calls and returns go through the return stack, like the IR's */
+    if (hint == IR::BranchHint::Call) {
+      if (target_pc == 0 && RipReg == ARMEmitter::Reg::lr) {
+        mov(ARMEmitter::Size::i64Bit, TMP3, RipReg);
+        RipReg = TMP3;
+      }
+      EmitReturnStackCall(CallReturnRip, false);
+    } else if (hint == IR::BranchHint::Return && target_pc == 0) {
+      EmitReturnStackReturn(RipReg);
+    }
 
-      // Note: sub+cbnz used over cmp+br to preserve flags.
-      ldp<ARMEmitter::IndexType::OFFSET>(TMP2, TMP1, TMP1, 0);
-      sub(TMP1, TMP1, RipReg.X());
-      cbnz(ARMEmitter::Size::i64Bit, TMP1, &FullLookup);
-      br(TMP2);
+    if (target_pc != 0) {
+      EmitDirectExit(target_pc, false);
+    } else {
+      EmitIndirectExit(RipReg);
+    }
+}
 
-      Bind(&FullLookup);
-      ldr(TMP1, STATE, offsetof(FEXCore::Core::CpuStateFrame, Pointers.Common.DispatcherLoopTop));
-      str(RipReg.X(), STATE, offsetof(FEXCore::Core::CpuStateFrame, State.rip));
-      br(TMP1);
+/* Branch to target_pc, directly if it is a block of the function being compiled */
+void FEXCore::CPU::Arm64JITCore::assemble_rule_branch(uint64_t target_pc)
+{
+    auto it = RuleLocalTargets.find(target_pc);
+    if (it == RuleLocalTargets.end()) {
+        assemble_arm_exit(target_pc);
+        return;
     }
+
+    /* The block expects the same state as a block entry, the spill slots stay */
+    b(&JumpTargets.try_emplace(it->second).first->second);
 }
 
 #undef DEF_OP
@@ -5,6 +5,7 @@
 #include <stdlib.h>
 
 #include "arm-instr.h"
+#include "rule-sym.h"
 
 static const ARMRegister arm_reg_table[] = {
     ARM_REG_R0, ARM_REG_R1, ARM_REG_R2, ARM_REG_R3,
@@ -51,6 +52,7 @@ static const char *arm_reg_str[] = {
     "reg8", "reg9", "reg10", "reg11", "reg12", "reg13", "reg14", "reg15",
     "reg16", "reg17", "reg18", "reg19", "reg20", "reg21", "reg22", "reg23",
     "reg24", "reg25", "reg26", "reg27", "reg28", "reg29", "reg30", "reg31",
+    "rtmp0", "rtmp1", "rtmp2", "rtmp3",
 };
 
 static const char *arm_cc_str[] = {
@@ -135,18 +137,85 @@ static const char *arm_opc_str[] = {
     [ARM_OPC_PC_SW] = "pc_sw",
 
     // FP/NEON
+    [ARM_OPC_ABS]   = "abs",
     [ARM_OPC_ADDP]  = "addp",
+    [ARM_OPC_ADDV]  = "addv",
+    [ARM_OPC_BIF]   = "bif",
+    [ARM_OPC_BIT]   = "bit",
+    [ARM_OPC_BSL]   = "bsl",
     [ARM_OPC_CMEQ]  = "cmeq",
+    [ARM_OPC_CMGE]  = "cmge",
     [ARM_OPC_CMGT]  = "cmgt",
+    [ARM_OPC_CMHI]  = "cmhi",
+    [ARM_OPC_CMHS]  = "cmhs",
     [ARM_OPC_CMLT]  = "cmlt",
+    [ARM_OPC_CMTST] = "cmtst",
+    [ARM_OPC_CNT]   = "cnt",
     [ARM_OPC_DUP]   = "dup",
     [ARM_OPC_EXT]   = "ext",
+    [ARM_OPC_FABS]  = "fabs",
+    [ARM_OPC_FADD]  = "fadd",
+    [ARM_OPC_FCMEQ] = "fcmeq",
+    [ARM_OPC_FCMGE] = "fcmge",
+    [ARM_OPC_FCMGT] = "fcmgt",
+    [ARM_OPC_FCMP]  = "fcmp",
+    [ARM_OPC_FCVTZS] = "fcvtzs",
+    [ARM_OPC_FDIV]  = "fdiv",
+    [ARM_OPC_FMAX]  = "fmax",
+    [ARM_OPC_FMIN]  = "fmin",
     [ARM_OPC_FMOV]  = "fmov",
+    [ARM_OPC_FMUL]  = "fmul",
+    [ARM_OPC_FNEG]  = "fneg",
+    [ARM_OPC_FSQRT] = "fsqrt",
+    [ARM_OPC_FSUB]  = "fsub",
     [ARM_OPC_INS]   = "ins",
     [ARM_OPC_LD1]   = "ld1",
+    [ARM_OPC_MOVI]  = "movi",
+    [ARM_OPC_NOT]   = "not",
+    [ARM_OPC_SADDLP] = "saddlp",
+    [ARM_OPC_SCVTF] = "scvtf",
+    [ARM_OPC_SHL]   = "shl",
+    [ARM_OPC_SHRN]  = "shrn",
+    [ARM_OPC_SMAX]  = "smax",
+    [ARM_OPC_SMIN]  = "smin",
+    [ARM_OPC_SMULL2] = "smull2",
+    [ARM_OPC_SQADD] = "sqadd",
+    [ARM_OPC_SQDMULH] = "sqdmulh",
+    [ARM_OPC_SQRDMULH] = "sqrdmulh",
+    [ARM_OPC_SQSUB] = "sqsub",
+    [ARM_OPC_SQXTN] = "sqxtn",
+    [ARM_OPC_SQXTN2] = "sqxtn2",
     [ARM_OPC_SQXTUN] = "sqxtun",
     [ARM_OPC_SQXTUN2] = "sqxtun2",
+    [ARM_OPC_SSHL]  = "sshl",
+    [ARM_OPC_SSHR]  = "sshr",
+    [ARM_OPC_SXTL]  = "sxtl",
+    [ARM_OPC_SXTL2] = "sxtl2",
+    [ARM_OPC_TBL]   = "tbl",
+    [ARM_OPC_TRN1]  = "trn1",
+    [ARM_OPC_TRN2]  = "trn2",
+    [ARM_OPC_UABD]  = "uabd",
+    [ARM_OPC_UADDLP] = "uaddlp",
+    [ARM_OPC_UADDLV] = "uaddlv",
+    [ARM_OPC_UMAX]  = "umax",
+    [ARM_OPC_UMAXV] = "umaxv",
+    [ARM_OPC_UMIN]  = "umin",
+    [ARM_OPC_UMINV] = "uminv",
     [ARM_OPC_UMOV]  = "umov",
+    [ARM_OPC_UMULL2] = "umull2",
+    [ARM_OPC_UQADD] = "uqadd",
+    [ARM_OPC_UQSUB] = "uqsub",
+    [ARM_OPC_UQXTN] = "uqxtn",
+    [ARM_OPC_UQXTN2] = "uqxtn2",
+    [ARM_OPC_URHADD] = "urhadd",
+    [ARM_OPC_USHL]  = "ushl",
+    [ARM_OPC_USHR]  = "ushr",
+    [ARM_OPC_UXTL]  = "uxtl",
+    [ARM_OPC_UXTL2] = "uxtl2",
+    [ARM_OPC_UZP1]  = "uzp1",
+    [ARM_OPC_UZP2]  = "uzp2",
+    [ARM_OPC_XTN]   = "xtn",
+    [ARM_OPC_XTN2]  = "xtn2",
     [ARM_OPC_ZIP1]  = "zip1",
     [ARM_OPC_ZIP2]  = "zip2"
 };
@@ -436,6 +505,12 @@ void set_arm_instr_opd_reg_str(ARMInstruction *instr, int opd_index, char *reg_s
           instr->OpSize = 8;
           instr->ElementSize = 4;
         }
+        else if (reg_str[len-2] == '.' && strchr("bhsd", reg_str[len-1])) {
+          /* A single element, for the scalar FP and the across lanes ops */
+          instr->ElementSize = reg_str[len-1] == 'b' ? 1 : reg_str[len-1] == 'h' ? 2 :
+                               reg_str[len-1] == 's' ? 4 : 8;
+          instr->OpSize = instr->ElementSize;
+        }
     }
 
     if (len >= 5 && (instr->opc == ARM_OPC_UMOV || instr->opc == ARM_OPC_LD1 || instr->opc == ARM_OPC_INS)) {
@@ -479,6 +554,7 @@ void set_arm_instr_opd_scale_imm_str(ARMOperandScale *pscale, char *scale_str)
     if (strstr(scale_str, "imm")) { /* this is a symbol scale: imm_xxx */
         pscale->imm.type = ARM_IMM_TYPE_SYM;
         strcpy(pscale->imm.content.sym, scale_str);
+        pscale->imm.sym_id = rule_sym_intern(scale_str);
     } else { /* this is a value scale */
         pscale->imm.type = ARM_IMM_TYPE_VAL;
         pscale->imm.content.val = strtol(scale_str, NULL, 10);
@@ -567,6 +643,7 @@ void set_arm_opd_imm_sym_str(ARMOperand *opd, char *imm_str)
 
     iopd->type = ARM_IMM_TYPE_SYM;
     strcpy(iopd->content.sym, imm_str);
+    iopd->sym_id = rule_sym_intern(imm_str);
 }
 
 void set_arm_opd_mem_off_val(ARMOperand *opd, char *off_str)
@@ -583,6 +660,7 @@ void set_arm_opd_mem_off_str(ARMOperand *opd, char *off_str)
 
     mopd->offset.type = ARM_IMM_TYPE_SYM;
     strcpy(mopd->offset.content.sym, off_str);
+    mopd->offset.sym_id = rule_sym_intern(off_str);
 }
 
 void set_arm_opd_mem_index_reg(ARMOperand *opd, int regno)
@@ -7,6 +7,7 @@
 #define ARM_MAX_OPERAND_NUM 4
 
 #define ARM_REG_NUM 21 /* invalid, r0 - r15, CF, NF, VF, and ZF */
+#define ARM_REG_TEMP_NUM 4
 
 typedef enum {
     ARM_REG_INVALID = 0,
@@ -45,6 +46,9 @@ typedef enum {
     ARM_REG_REG24, ARM_REG_REG25, ARM_REG_REG26, ARM_REG_REG27,
     ARM_REG_REG28, ARM_REG_REG29, ARM_REG_REG30, ARM_REG_REG31,
 
+    /* Scratch registers for rule instructions, bound to a free host register per rule instance */
+    ARM_REG_TEMP0, ARM_REG_TEMP1, ARM_REG_TEMP2, ARM_REG_TEMP3,
+
     ARM_REG_END
 } ARMRegister;
 
@@ -139,18 +143,85 @@ typedef enum {
     ARM_OPC_PC_SW,
 
     // FP/NEON
+    ARM_OPC_ABS,
     ARM_OPC_ADDP,
+    ARM_OPC_ADDV,
+    ARM_OPC_BIF,
+    ARM_OPC_BIT,
+    ARM_OPC_BSL,
     ARM_OPC_CMEQ,
+    ARM_OPC_CMGE,
     ARM_OPC_CMGT,
+    ARM_OPC_CMHI,
+    ARM_OPC_CMHS,
     ARM_OPC_CMLT,
+    ARM_OPC_CMTST,
+    ARM_OPC_CNT,
     ARM_OPC_DUP,
     ARM_OPC_EXT,
+    ARM_OPC_FABS,
+    ARM_OPC_FADD,
+    ARM_OPC_FCMEQ,
+    ARM_OPC_FCMGE,
+    ARM_OPC_FCMGT,
+    ARM_OPC_FCMP,
+    ARM_OPC_FCVTZS,
+    ARM_OPC_FDIV,
+    ARM_OPC_FMAX,
+    ARM_OPC_FMIN,
     ARM_OPC_FMOV,
+    ARM_OPC_FMUL,
+    ARM_OPC_FNEG,
+    ARM_OPC_FSQRT,
+    ARM_OPC_FSUB,
     ARM_OPC_INS,
     ARM_OPC_LD1,
+    ARM_OPC_MOVI,
+    ARM_OPC_NOT,
+    ARM_OPC_SADDLP,
+    ARM_OPC_SCVTF,
+    ARM_OPC_SHL,
+    ARM_OPC_SHRN,
+    ARM_OPC_SMAX,
+    ARM_OPC_SMIN,
+    ARM_OPC_SMULL2,
+    ARM_OPC_SQADD,
+    ARM_OPC_SQDMULH,
+    ARM_OPC_SQRDMULH,
+    ARM_OPC_SQSUB,
+    ARM_OPC_SQXTN,
+    ARM_OPC_SQXTN2,
     ARM_OPC_SQXTUN,
     ARM_OPC_SQXTUN2,
+    ARM_OPC_SSHL,
+    ARM_OPC_SSHR,
+    ARM_OPC_SXTL,
+    ARM_OPC_SXTL2,
+    ARM_OPC_TBL,
+    ARM_OPC_TRN1,
+    ARM_OPC_TRN2,
+    ARM_OPC_UABD,
+    ARM_OPC_UADDLP,
+    ARM_OPC_UADDLV,
+    ARM_OPC_UMAX,
+    ARM_OPC_UMAXV,
+    ARM_OPC_UMIN,
+    ARM_OPC_UMINV,
     ARM_OPC_UMOV,
+    ARM_OPC_UMULL2,
+    ARM_OPC_UQADD,
+    ARM_OPC_UQSUB,
+    ARM_OPC_UQXTN,
+    ARM_OPC_UQXTN2,
+    ARM_OPC_URHADD,
+    ARM_OPC_USHL,
+    ARM_OPC_USHR,
+    ARM_OPC_UXTL,
+    ARM_OPC_UXTL2,
+    ARM_OPC_UZP1,
+    ARM_OPC_UZP2,
+    ARM_OPC_XTN,
+    ARM_OPC_XTN2,
     ARM_OPC_ZIP1,
     ARM_OPC_ZIP2,
 
@@ -202,6 +273,7 @@ typedef enum {
 
 typedef struct {
     ARMImmType type;
+    uint16_t sym_id;    /* interned content.sym, see rule-sym.h */
     union {
         int32_t val;    /* For disasmed instructions, this value is the scaled value */
         char sym[20];   /* For rule instructions, format: "imm_xxx" */
@@ -0,0 +1,496 @@
+#include <string.h>
+
+#include "arm-opt.h"
+
+#define ARM_OPT_MAX_FACTS 16
+
+typedef enum {
+    ARM_OPT_OTHER = 0,
+    ARM_OPT_ALU,        /* writes operand 0, reads the others */
+    ARM_OPT_COMPARE,    /* reads every operand, sets the flags */
+    ARM_OPT_LOAD,       /* writes the registers in front of the memory operand */
+    ARM_OPT_STORE,      /* reads the registers in front of the memory operand */
+} ARMOptClass;
+
+/* What is known to be in the registers at the current instruction */
+typedef struct {
+    int avail[ARM_OPT_MAX_FACTS];   /* instructions whose result is still in place */
+    int avail_num;
+    ARMRegister copy[ARM_OPT_MAX_FACTS][2]; /* registers holding the same value */
+    int copy_num;
+    int store;                      /* last store, its value is still in the source register */
+    bool zext[ARM_REG_END];         /* upper 32 bits known to be zero */
+} ARMOptFacts;
+
+/* The instruction handlers use these as scratch registers, r26 and r27 hold PF and AF */
+static const ARMRegister arm_opt_clobber[] = {
+    ARM_REG_R0, ARM_REG_R20, ARM_REG_R21, ARM_REG_R22, ARM_REG_R23, ARM_REG_R26, ARM_REG_R27,
+};
+
+bool arm_instr_define_cc(ARMInstruction *instr)
+{
+    switch (instr->opc) {
+        case ARM_OPC_ANDS:
+        case ARM_OPC_BICS:
+        case ARM_OPC_ADDS:
+        case ARM_OPC_ADCS:
+        case ARM_OPC_SUBS:
+        case ARM_OPC_SBCS:
+        case ARM_OPC_TST:
+        case ARM_OPC_CMP:
+        case ARM_OPC_CMPB:
+        case ARM_OPC_CMPW:
+        case ARM_OPC_CMN:
+        case ARM_OPC_FCMP:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool arm_instr_use_cc(ARMInstruction *instr)
+{
+    switch (instr->opc) {
+        case ARM_OPC_ADC:
+        case ARM_OPC_ADCS:
+        case ARM_OPC_SBC:
+        case ARM_OPC_SBCS:
+        case ARM_OPC_CSEL:
+        case ARM_OPC_CSET:
+            return true;
+        default:
+            return instr->cc != ARM_CC_INVALID && instr->cc != ARM_CC_AL;
+    }
+}
+
+ARMOpcode arm_flag_free_opc(ARMOpcode opc)
+{
+    switch (opc) {
+        case ARM_OPC_ANDS: return ARM_OPC_AND;
+        case ARM_OPC_BICS: return ARM_OPC_BIC;
+        case ARM_OPC_ADDS: return ARM_OPC_ADD;
+        case ARM_OPC_ADCS: return ARM_OPC_ADC;
+        case ARM_OPC_SUBS: return ARM_OPC_SUB;
+        case ARM_OPC_SBCS: return ARM_OPC_SBC;
+        default:           return ARM_OPC_INVALID;
+    }
+}
+
+static ARMOptClass arm_opt_class(ARMOpcode opc)
+{
+    switch (opc) {
+        case ARM_OPC_LDRB:
+        case ARM_OPC_LDRSB:
+        case ARM_OPC_LDRH:
+        case ARM_OPC_LDRSH:
+        case ARM_OPC_LDR:
+        case ARM_OPC_LDP:
+            return ARM_OPT_LOAD;
+        case ARM_OPC_STRB:
+        case ARM_OPC_STRH:
+        case ARM_OPC_STR:
+        case ARM_OPC_STP:
+            return ARM_OPT_STORE;
+        case ARM_OPC_TST:
+        case ARM_OPC_CMP:
+        case ARM_OPC_CMPB:
+        case ARM_OPC_CMPW:
+        case ARM_OPC_CMN:
+            return ARM_OPT_COMPARE;
+        case ARM_OPC_SXTW:
+        case ARM_OPC_MOV:
+        case ARM_OPC_MVN:
+        case ARM_OPC_CSEL:
+        case ARM_OPC_CSET:
+        case ARM_OPC_BFXIL:
+        case ARM_OPC_NEG:
+        case ARM_OPC_AND:
+        case ARM_OPC_ANDS:
+        case ARM_OPC_ORR:
+        case ARM_OPC_EOR:
+        case ARM_OPC_BIC:
+        case ARM_OPC_BICS:
+        case ARM_OPC_LSL:
+        case ARM_OPC_LSR:
+        case ARM_OPC_ASR:
+        case ARM_OPC_ADD:
+        case ARM_OPC_ADC:
+        case ARM_OPC_SUB:
+        case ARM_OPC_SBC:
+        case ARM_OPC_ADDS:
+        case ARM_OPC_ADCS:
+        case ARM_OPC_SUBS:
+        case ARM_OPC_SBCS:
+        case ARM_OPC_MUL:
+        case ARM_OPC_UMULL:
+        case ARM_OPC_SMULL:
+        case ARM_OPC_CLZ:
+            return ARM_OPT_ALU;
+        default:
+            return ARM_OPT_OTHER;
+    }
+}
+
+bool arm_opt_supported(ARMInstruction *instr)
+{
+    return arm_opt_class(instr->opc) != ARM_OPT_OTHER;
+}
+
+static ARMInstruction *opt_instr(ARMOptInstr *c)
+{
+    return c->replaced ? &c->replacement : c->instr;
+}
+
+/* Number of leading register operands the instruction writes */
+static int opt_def_num(ARMInstruction *instr)
+{
+    switch (arm_opt_class(instr->opc)) {
+        case ARM_OPT_ALU:  return 1;
+        case ARM_OPT_LOAD: return instr->opc == ARM_OPC_LDP ? 2 : 1;
+        default:           return 0;
+    }
+}
+
+static bool opt_is_clobbered(ARMRegister reg)
+{
+    for (auto r : arm_opt_clobber) {
+        if (r == reg)
+            return true;
+    }
+    return false;
+}
+
+static bool opt_mentions(ARMOptInstr *c, ARMRegister reg)
+{
+    ARMInstruction *instr = opt_instr(c);
+
+    for (size_t i = 0; i < instr->opd_num; i++) {
+        if (c->reg[i] == reg || c->index[i] == reg)
+            return true;
+    }
+    return false;
+}
+
+/* Does the instruction read one of the registers it writes */
+static bool opt_reads_own_def(ARMOptInstr *c)
+{
+    ARMInstruction *instr = opt_instr(c);
+    int def_num = opt_def_num(instr);
+
+    if (instr->opc == ARM_OPC_BFXIL)
+        return true;
+
+    for (int d = 0; d < def_num; d++) {
+        for (size_t i = def_num; i < instr->opd_num; i++) {
+            if (c->reg[i] == c->reg[d] || c->index[i] == c->reg[d])
+                return true;
+        }
+    }
+    return false;
+}
+
+/* Position of the memory operand, -1 if there is none */
+static int opt_mem_opd(ARMInstruction *instr)
+{
+    for (size_t i = 0; i < instr->opd_num; i++) {
+        if (instr->opd[i].type == ARM_OPD_TYPE_MEM)
+            return i;
+    }
+    return -1;
+}
+
+static bool opt_same_scale(ARMOperandScale *a, ARMOperandScale *b)
+{
+    if (a->type != b->type)
+        return false;
+    if (a->type == ARM_OPD_SCALE_TYPE_NONE)
+        return true;
+    return a->content.direct == b->content.direct && a->imm.type == b->imm.type &&
+           a->imm.content.val == b->imm.content.val;
+}
+
+static bool opt_same_instr(ARMOptInstr *a, ARMOptInstr *b)
+{
+    ARMInstruction *ia = opt_instr(a);
+    ARMInstruction *ib = opt_instr(b);
+
+    if (ia->opc != ib->opc || ia->cc != ib->cc || a->size != b->size || ia->opd_num != ib->opd_num)
+        return false;
+
+    for (size_t i = 0; i < ia->opd_num; i++) {
+        ARMOperand *oa = &ia->opd[i];
+        ARMOperand *ob = &ib->opd[i];
+
+        if (oa->type != ob->type || a->reg[i] != b->reg[i] || a->index[i] != b->index[i] || a->imm[i] != b->imm[i])
+            return false;
+        if (oa->type == ARM_OPD_TYPE_REG && !opt_same_scale(&oa->content.reg.scale, &ob->content.reg.scale))
+            return false;
+        if (oa->type == ARM_OPD_TYPE_MEM && (oa->content.mem.pre_post != ob->content.mem.pre_post ||
+                                            !opt_same_scale(&oa->content.mem.scale, &ob->content.mem.scale)))
+            return false;
+    }
+    return true;
+}
+
+static void opt_reset(ARMOptFacts *f)
+{
+    f->avail_num = 0;
+    f->copy_num = 0;
+    f->store = -1;
+    memset(f->zext, 0, sizeof(f->zext));
+}
+
+static void opt_kill_reg(ARMOptFacts *f, ARMOptInstr *code, ARMRegister reg)
+{
+    int i, n;
+
+    if (reg == ARM_REG_INVALID)
+        return;
+
+    for (i = n = 0; i < f->avail_num; i++) {
+        if (!opt_mentions(&code[f->avail[i]], reg))
+            f->avail[n++] = f->avail[i];
+    }
+    f->avail_num = n;
+
+    for (i = n = 0; i < f->copy_num; i++) {
+        if (f->copy[i][0] != reg && f->copy[i][1] != reg) {
+            f->copy[n][0] = f->copy[i][0];
+            f->copy[n][1] = f->copy[i][1];
+            n++;
+        }
+    }
+    f->copy_num = n;
+
+    if (f->store >= 0 && opt_mentions(&code[f->store], reg))
+        f->store = -1;
+
+    f->zext[reg] = false;
+}
+
+static void opt_kill_cc(ARMOptFacts *f, ARMOptInstr *code)
+{
+    int i, n;
+
+    for (i = n = 0; i < f->avail_num; i++) {
+        ARMInstruction *instr = opt_instr(&code[f->avail[i]]);
+        if (!arm_instr_define_cc(instr) && !arm_instr_use_cc(instr))
+            f->avail[n++] = f->avail[i];
+    }
+    f->avail_num = n;
+}
+
+static bool opt_has_copy(ARMOptFacts *f, ARMRegister a, ARMRegister b)
+{
+    for (int i = 0; i < f->copy_num; i++) {
+        if ((f->copy[i][0] == a && f->copy[i][1] == b) || (f->copy[i][0] == b && f->copy[i][1] == a))
+            return true;
+    }
+    return false;
+}
+
+static bool opt_is_reg_mov(ARMInstruction *instr)
+{
+    return instr->opc == ARM_OPC_MOV && instr->opd_num == 2 &&
+           instr->opd[0].type == ARM_OPD_TYPE_REG && instr->opd[1].type == ARM_OPD_TYPE_REG &&
+           instr->opd[1].content.reg.scale.type == ARM_OPD_SCALE_TYPE_NONE;
+}
+
+/* A plain str/ldr of 4 or 8 bytes at base + offset */
+static bool opt_is_simple_mem(ARMOptInstr *c, ARMOpcode opc)
+{
+    ARMInstruction *instr = c->instr;
+
+    return instr->opc == opc && instr->opd_num == 2 && (c->size == 4 || c->size == 8) &&
+           instr->opd[0].type == ARM_OPD_TYPE_REG && instr->opd[1].type == ARM_OPD_TYPE_MEM &&
+           c->index[1] == ARM_REG_INVALID && instr->opd[1].content.mem.pre_post == ARM_MEM_INDEX_TYPE_NONE &&
+           !opt_is_clobbered(c->reg[0]) && !opt_is_clobbered(c->reg[1]);
+}
+
+/* Turn a load into a move from the register that holds the loaded value */
+static void opt_replace_by_mov(ARMOptInstr *c, ARMRegister src)
+{
+    ARMInstruction *r = &c->replacement;
+
+    *r = *c->instr;
+    r->opc = ARM_OPC_MOV;
+    r->opd_num = 2;
+    r->OpSize = c->size;
+    /* A host register reads the same in the context of any rule */
+    memset(&r->opd[1], 0, sizeof(r->opd[1]));
+    r->opd[1].type = ARM_OPD_TYPE_REG;
+    r->opd[1].content.reg.num = src;
+    c->reg[1] = src;
+    c->index[1] = ARM_REG_INVALID;
+    c->imm[1] = 0;
+    c->replaced = true;
+}
+
+/* Is the instruction redundant with what the registers already hold */
+static bool opt_redundant(ARMOptFacts *f, ARMOptInstr *code, int i)
+{
+    ARMOptInstr *c = &code[i];
+    ARMInstruction *instr = opt_instr(c);
+    ARMOptClass cls = arm_opt_class(instr->opc);
+
+    if (opt_is_reg_mov(instr)) {
+        ARMRegister dst = c->reg[0];
+        ARMRegister src = c->reg[1];
+
+        if (c->size == 8)
+            return dst == src || opt_has_copy(f, dst, src);
+        if (c->size == 4)
+            return f->zext[src] && (dst == src || opt_has_copy(f, dst, src));
+        return false;
+    }
+
+    if (cls != ARM_OPT_ALU && cls != ARM_OPT_COMPARE)
+        return false;
+
+    for (int k = 0; k < f->avail_num; k++) {
+        if (opt_same_instr(&code[f->avail[k]], c))
+            return true;
+    }
+    return false;
+}
+
+static void opt_forward_store(ARMOptFacts *f, ARMOptInstr *code, int i)
+{
+    ARMOptInstr *c = &code[i];
+    ARMOptInstr *s;
+
+    if (f->store < 0 || !opt_is_simple_mem(c, ARM_OPC_LDR))
+        return;
+
+    s = &code[f->store];
+    if (s->size != c->size || s->reg[1] != c->reg[1] || s->imm[1] != c->imm[1])
+        return;
+
+    opt_replace_by_mov(c, s->reg[0]);
+}
+
+/* Record what the registers hold after the instruction */
+static void opt_update(ARMOptFacts *f, ARMOptInstr *code, int i)
+{
+    ARMOptInstr *c = &code[i];
+    ARMInstruction *instr = opt_instr(c);
+    ARMOptClass cls = arm_opt_class(instr->opc);
+    int def_num = opt_def_num(instr);
+    int mem = opt_mem_opd(instr);
+    bool src_zext = opt_is_reg_mov(instr) && f->zext[c->reg[1]];
+
+    if (arm_instr_define_cc(instr))
+        opt_kill_cc(f, code);
+    for (auto reg : arm_opt_clobber)
+        opt_kill_reg(f, code, reg);
+    for (int d = 0; d < def_num; d++)
+        opt_kill_reg(f, code, c->reg[d]);
+    if (mem >= 0 && instr->opd[mem].content.mem.pre_post != ARM_MEM_INDEX_TYPE_NONE)
+        opt_kill_reg(f, code, c->reg[mem]);
+
+    if (cls == ARM_OPT_STORE)
+        f->store = opt_is_simple_mem(c, ARM_OPC_STR) ? i : -1;
+
+    /* Upper halves cleared by 32 bit operations */
+    if (def_num == 1) {
+        bool zext;
+
+        if (opt_is_reg_mov(instr))
+            zext = c->size == 4 || src_zext;
+        else if (instr->opc == ARM_OPC_MOV)
+            zext = !(c->imm[1] >> 32);
+        else if (instr->opc == ARM_OPC_SXTW)
+            zext = false;
+        else
+            zext = c->size == 4 || instr->opc == ARM_OPC_CSET ||
+                   instr->opc == ARM_OPC_LDRB || instr->opc == ARM_OPC_LDRH;
+
+        f->zext[c->reg[0]] = zext;
+    }
+
+    if (opt_is_reg_mov(instr)) {
+        ARMRegister dst = c->reg[0];
+        ARMRegister src = c->reg[1];
+
+        if (dst != src && !opt_is_clobbered(dst) && !opt_is_clobbered(src) && f->copy_num < ARM_OPT_MAX_FACTS &&
+            (c->size == 8 || (c->size == 4 && src_zext))) {
+            f->copy[f->copy_num][0] = dst;
+            f->copy[f->copy_num][1] = src;
+            f->copy_num++;
+        }
+        return;
+    }
+
+    if (cls != ARM_OPT_ALU && cls != ARM_OPT_COMPARE)
+        return;
+    if (arm_instr_define_cc(instr) && arm_instr_use_cc(instr))
+        return;
+    if (opt_reads_own_def(c))
+        return;
+    for (size_t k = 0; k < instr->opd_num; k++) {
+        if (opt_is_clobbered(c->reg[k]) || opt_is_clobbered(c->index[k]))
+            return;
+    }
+
+    if (f->avail_num == ARM_OPT_MAX_FACTS) {
+        memmove(&f->avail[0], &f->avail[1], (ARM_OPT_MAX_FACTS - 1) * sizeof(f->avail[0]));
+        f->avail_num--;
+    }
+    f->avail[f->avail_num++] = i;
+}
+
+/* Which flags are read after each instruction, over the whole stream */
+static void opt_decide_cc_liveness(ARMOptInstr *code, int num)
+{
+    uint8_t live = (num && !code[num - 1].instr) ? 0 : (RULE_CC_LIVE | RULE_CF_LIVE);
+
+    for (int i = num - 1; i >= 0; i--) {
+        ARMOptInstr *c = &code[i];
+
+        if (!c->instr) {
+            live |= c->live_out;
+            continue;
+        }
+        if (c->removed)
+            continue;
+
+        ARMInstruction *instr = opt_instr(c);
+        c->cc_live = live;
+        if (arm_instr_define_cc(instr))
+            live = 0;
+        if (arm_instr_use_cc(instr))
+            live = RULE_CC_LIVE | RULE_CF_LIVE;
+    }
+}
+
+void arm_opt_rule_stream(ARMOptInstr *code, int num)
+{
+    ARMOptFacts facts;
+
+    opt_reset(&facts);
+
+    for (int i = 0; i < num; i++) {
+        ARMOptInstr *c = &code[i];
+
+        c->removed = false;
+        c->replaced = false;
+        c->cc_live = RULE_CC_LIVE | RULE_CF_LIVE;
+
+        /* Code after a rule leaving the block is entered from elsewhere */
+        if (!c->instr || c->opaque || !arm_opt_supported(c->instr)) {
+            opt_reset(&facts);
+            continue;
+        }
+
+        opt_forward_store(&facts, code, i);
+
+        if (opt_redundant(&facts, code, i)) {
+            c->removed = true;
+            continue;
+        }
+
+        opt_update(&facts, code, i);
+    }
+
+    opt_decide_cc_liveness(code, num);
+}
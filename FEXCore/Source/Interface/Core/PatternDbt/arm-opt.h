@@ -0,0 +1,51 @@
+#ifndef ARM_OPT_H
+#define ARM_OPT_H
+
+#include "arm-instr.h"
+
+/* Optimizer over the host instructions of consecutive rule instances.
+
+   Every rule is assembled on its own, so the seams between rules keep code
+   the next rule makes redundant: a guest register stored and loaded again, a
+   compare or cset repeated on unchanged operands, a copy or zero-extension of
+   a value that is already there, flags set and overwritten before anyone
+   reads them. The optimizer looks at the whole stream with the operands of
+   each rule resolved to host registers and immediate values, and marks what
+   can be removed or replaced. Instructions are still assembled in the context
+   of their own rule. */
+
+#define RULE_CC_LIVE 1  /* some flag set here is read later */
+#define RULE_CF_LIVE 2  /* the carry set here is read later */
+
+typedef struct {
+    ARMInstruction *instr;  /* rule instruction, NULL for the end of a rule that leaves the block */
+
+    /* Resolved operands, filled in by the caller */
+    ARMRegister reg[ARM_MAX_OPERAND_NUM];   /* host register, host base register of memory operands */
+    ARMRegister index[ARM_MAX_OPERAND_NUM]; /* host index register of memory operands */
+    uint64_t imm[ARM_MAX_OPERAND_NUM];      /* immediate value, offset of memory operands */
+    uint32_t size;          /* operation size in bytes */
+    bool opaque;            /* operands the optimizer can't reason about, e.g. parts of guest registers */
+    uint8_t live_out;       /* end of rule: flags read after it */
+
+    /* Decided by arm_opt_rule_stream */
+    uint8_t cc_live;        /* which of the flags set here are read later */
+    bool removed;
+    bool replaced;          /* assemble replacement instead of instr */
+    ARMInstruction replacement;
+} ARMOptInstr;
+
+/* Host instructions that set or read NZCV */
+bool arm_instr_define_cc(ARMInstruction *instr);
+bool arm_instr_use_cc(ARMInstruction *instr);
+
+/* The same operation without setting NZCV, ARM_OPC_INVALID if it only sets NZCV */
+ARMOpcode arm_flag_free_opc(ARMOpcode opc);
+
+/* If the optimizer knows which registers and memory the instruction touches.
+   Other instructions end every fact known so far. */
+bool arm_opt_supported(ARMInstruction *instr);
+
+void arm_opt_rule_stream(ARMOptInstr *code, int num);
+
+#endif
@@ -22,12 +22,19 @@ void rule_arm_instr_buf_init(void)
     rule_arm_instr_buf_index = 0;
 }
 
+ARMInstruction *get_rule_arm_instr_buf(int *num)
+{
+    *num = rule_arm_instr_buf_index;
+    return rule_arm_instr_buf;
+}
+
 static ARMInstruction *rule_arm_instr_alloc(uint64_t pc)
 {
     ARMInstruction *instr = &rule_arm_instr_buf[rule_arm_instr_buf_index++];
     if (rule_arm_instr_buf_index >= RULE_ARM_INSTR_BUF_LEN)
         LogMan::Msg::IFmt( "Error: rule_arm_instr_buf is not enought!\n");
 
+    memset(instr, 0, sizeof(ARMInstruction));
     instr->pc = pc;
     instr->next = NULL;
     return instr;
@@ -272,6 +279,7 @@ bool parse_rule_arm_code(FILE *fp, TranslationRule *rule)
             code_head = code_tail = cur;
         } else {
             code_tail->next = cur;
+            cur->prev = code_tail;
             code_tail = cur;
         }
         pc += 4; // fake value
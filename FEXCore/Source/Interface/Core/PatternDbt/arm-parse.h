@@ -5,5 +5,6 @@
 
 void rule_arm_instr_buf_init(void);
 bool parse_rule_arm_code(FILE *fp, TranslationRule *rule);
+ARMInstruction *get_rule_arm_instr_buf(int *num);
 
 #endif
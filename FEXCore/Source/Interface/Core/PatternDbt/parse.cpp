@@ -6,133 +6,41 @@
 #include <assert.h>
 #include <cstdlib>
 #include <iostream>
+#include <mutex>
 #include <fstream>
 #include <filesystem>
+#include <sys/stat.h>
+#include <xxhash.h>
 
 #include "rule-debug-log.h"
 #include "arm-parse.h"
 #include "x86-parse.h"
 #include "parse.h"
+#include "rule-index.h"
+#include "rule-db.h"
+#include "rule-profile.h"
+#include "rule-sym.h"
 
 #define RULE_BUF_LEN 10000
 
-static const int cache_index[] = {2483,
-896,
-2,
-7,
-121,
-252,
-2484,
-37,
-2482,
-138,
-446,
-101,
-2485,
-176,
-111,
-46,
-79,
-23,
-876,
-189,
-44,
-88,
-5,
-212,
-437,
-339,
-51,
-1873,
-218,
-58,
-299,
-39,
-675,
-1026,
-2349,
-59,
-753,
-2216,
-611,
-64,
-820,
-2492,
-300,
-317,
-1659,
-794,
-1237,
-440,
-206,
-720,
-1647,
-9,
-549,
-2079,
-1089,
-33,
-940,
-167,
-78,
-2488,
-328,
-2490,
-22,
-170,
-186,
-1950,
-11,
-585,
-24,
-1401,
-2295,
-12,
-191,
-1239,
-183,
-482,
-201,
-655,
-2486,
-2375,
-2491,
-226,
-2449,
-840,
-102,
-2487,
-844,
-1336,
-68,
-53,
-1875,
-462,
-2204};
-
-static TranslationRule *rule_buf;
-static int rule_buf_index;
-
-int cache_counter = 0;
-
-TranslationRule *rule_table[MAX_GUEST_LEN] = {NULL};
-TranslationRule *cache_rule_table[MAX_GUEST_LEN] = {NULL};
-
-static void rule_buf_init(void)
+/* The instruction buffers and the symbol table are shared by every parse */
+static std::mutex rule_load_lock;
+
+static void rule_buf_init(RuleSet *set)
 {
-    rule_buf = new TranslationRule[RULE_BUF_LEN];
-    if (rule_buf == NULL)
+    set->rules = new TranslationRule[RULE_BUF_LEN];
+    if (set->rules == NULL)
         LogMan::Msg::IFmt( "Cannot allocate memory for rule_buf!\n");
 
-    rule_buf_index = 0;
+    set->rule_num = 0;
 }
 
-static TranslationRule *rule_alloc(void)
+static TranslationRule *rule_alloc(RuleSet *set)
 {
-    TranslationRule *rule = &rule_buf[rule_buf_index++];
+    TranslationRule *rule = &set->rules[set->rule_num++];
     int i;
 
-    if (rule_buf_index >= RULE_BUF_LEN)
+    if (set->rule_num >= RULE_BUF_LEN)
         LogMan::Msg::IFmt( "Error: rule_buf is not enough!\n");
 
     rule->index = 0;
@@ -141,61 +49,33 @@ static TranslationRule *rule_alloc(void)
     rule->guest_instr_num = 0;
     rule->next = NULL;
     rule->prev = NULL;
-    #ifdef PROFILE_RULE_TRANSLATION
-    rule->hit_num = 0;
-    rule->print_flag = 0;
-    #endif
 
     for (i = 0; i < X86_CC_NUM; i++)
         rule->x86_cc_mapping[i] = 1;
 
-    rule->match_counter = 0;
-
     return rule;
 }
 
-static void init_buf(void)
+static void init_buf(RuleSet *set)
 {
     rule_arm_instr_buf_init();
     rule_x86_instr_buf_init();
 
-    rule_buf_init();
+    rule_buf_init(set);
+    rule_index_init(set);
+    rule_sym_init();
 }
 
-static void install_rule(TranslationRule *rule)
+static void install_rule(RuleSet *set, TranslationRule *rule)
 {
     int index = rule_hash_key(rule->x86_guest, rule->guest_instr_num);
 
     assert(index < MAX_GUEST_LEN);
 
-    int i;
-    for (i = 0; i < 93; i++){
-        if (cache_index[i] == rule->index){
-            ++cache_counter;
-            rule->next = cache_rule_table[index];
-            cache_rule_table[index] = rule;
-            return;
-        }
-    }
-
-    rule->next = rule_table[index];
-    if (rule_table[index])
-        rule_table[index]->prev = rule;
-    rule_table[index] = rule;
-
-}
-
-int ruleindex = 0;
-static void install_rule2(TranslationRule *rule)
-{
-    assert(ruleindex < MAX_GUEST_LEN);
-    if (ruleindex) {
-      rule->prev = rule_table[ruleindex-1];
-      rule_table[ruleindex-1]->next = rule;
-    }
-    rule_table[ruleindex] = rule;
-    rule->next = nullptr;
-    ruleindex++;
+    rule->next = set->table[index];
+    if (set->table[index])
+        set->table[index]->prev = rule;
+    set->table[index] = rule;
 }
 
 int rule_hash_key(X86Instruction *x86_insn, int num)
@@ -215,9 +95,13 @@ int rule_hash_key(X86Instruction *x86_insn, int num)
     return (sum/num);
 }
 
-TranslationRule *get_rule(void)
+/* Identify the loaded rules by the rule text they come from */
+static void set_rule_set_id(RuleSet *set, uint64_t src_size, int64_t src_mtime)
 {
-    return &rule_buf[0];
+    const uint64_t id[] = {src_size, (uint64_t)src_mtime, (uint64_t)set->rule_num,
+                           sizeof(TranslationRule), sizeof(X86Instruction), sizeof(ARMInstruction)};
+
+    set->id = XXH3_64bits(id, sizeof(id));
 }
 
 static void flush_file(uint64_t pid)
@@ -242,31 +126,93 @@ static void flush_file(uint64_t pid)
     file2.close();
 }
 
-void ParseTranslationRules(uint64_t pid)
+static void define_x86_sym(X86Imm *imm)
+{
+    if (imm->type == X86_IMM_TYPE_SYM)
+        rule_sym_define(imm->content.sym, imm->sym_id);
+}
+
+static void define_arm_sym(ARMImm *imm)
+{
+    if (imm->type == ARM_IMM_TYPE_SYM)
+        rule_sym_define(imm->content.sym, imm->sym_id);
+}
+
+/* The image keeps the symbol ids of the parse that wrote it, enter their
+   names again so host expressions over symbols can be evaluated */
+static void define_rule_syms(TranslationRule *rule)
+{
+    for (X86Instruction *x = rule->x86_guest; x; x = x->next) {
+        for (int i = 0; i < x->opd_num; i++) {
+            X86Operand *opd = &x->opd[i];
+            if (opd->type == X86_OPD_TYPE_IMM) {
+                define_x86_sym(&opd->content.imm);
+            } else if (opd->type == X86_OPD_TYPE_MEM) {
+                define_x86_sym(&opd->content.mem.scale);
+                define_x86_sym(&opd->content.mem.offset);
+            }
+        }
+    }
+
+    for (ARMInstruction *a = rule->arm_host; a; a = a->next) {
+        for (size_t i = 0; i < a->opd_num; i++) {
+            ARMOperand *opd = &a->opd[i];
+            if (opd->type == ARM_OPD_TYPE_IMM) {
+                define_arm_sym(&opd->content.imm);
+            } else if (opd->type == ARM_OPD_TYPE_REG) {
+                define_arm_sym(&opd->content.reg.scale.imm);
+            } else if (opd->type == ARM_OPD_TYPE_MEM) {
+                define_arm_sym(&opd->content.mem.offset);
+                define_arm_sym(&opd->content.mem.scale.imm);
+            }
+        }
+    }
+}
+
+static bool load_rule_db(RuleSet *set, const char *db_file, const char *rule_file)
+{
+    RuleDBImage img;
+    uint64_t i;
+
+    if (!rule_db_load(db_file, rule_file, &img))
+        return false;
+
+    /* The image is read-only, the rules are used in place */
+    set->rules = img.rules;
+    set->rule_num = img.rule_num;
+    set_rule_set_id(set, img.src_size, img.src_mtime);
+    memcpy(set->table, img.rule_table, sizeof(set->table));
+
+    rule_index_init(set);
+    rule_sym_init();
+    for (i = 0; i < img.rule_num; i++) {
+        rule_index_insert(set, &set->rules[i]);
+        define_rule_syms(&set->rules[i]);
+    }
+
+    LogMan::Msg::IFmt("== Ready: {} translation rules mapped from {}{}, {} index nodes.\n\n",
+                      img.rule_num, db_file, img.relocated ? " (relocated)" : "", rule_index_node_num(set));
+    return true;
+}
+
+bool ParseTranslationRuleFile(const char *rule_file, RuleSet *set)
 {
-    std::filesystem::path homeDir = std::filesystem::path(getenv("HOME"));
-    std::filesystem::path combinedPath = homeDir / "rules4all";
-    const char* rule_file = combinedPath.c_str();
     TranslationRule *rule = NULL;
     int counter = 0;
     int install_counter = 0;
-    int i;
     char line[500];
     char *substr;
     FILE *fp;
 
     /* 1. init environment */
-    init_buf();
-    #ifdef DEBUG_RULE_LOG
-      flush_file(pid);
-    #endif
+    init_buf(set);
 
     LogMan::Msg::IFmt("== Loading translation rules from {}...\n", rule_file);
     /* 2. open the rule file and parse it */
     fp = fopen(rule_file, "r");
     if (fp == NULL) {
         LogMan::Msg::IFmt("== No translation rule file found.\n");
-        return;
+        return false;
     }
 
     while(!feof(fp)) {
@@ -281,7 +227,7 @@ void ParseTranslationRules(uint64_t pid)
         if ((substr = strstr(line, ".Guest:\n")) != NULL) {
             char idx[20] = "\0";
 
-            rule = rule_alloc();
+            rule = rule_alloc(set);
             counter++;
 
             /* get the index of this rule */
@@ -293,8 +239,9 @@ void ParseTranslationRules(uint64_t pid)
         } else if (strstr(line, ".Host:\n")) {
             if (parse_rule_arm_code(fp, rule)) {
 
-                /* install this rule to the hash table*/
-                install_rule(rule);
+                /* install this rule to the hash table and the rule index */
+                install_rule(set, rule);
+                rule_index_insert(set, rule);
 
                 install_counter++;
             }
@@ -302,70 +249,35 @@ void ParseTranslationRules(uint64_t pid)
             LogMan::Msg::IFmt("Error in parsing rule file: {}.\n", line);
     }
 
-    LogMan::Msg::IFmt("== Ready: {} translation rules loaded, {} installed, {} cached.\n\n", counter, install_counter, cache_counter);
-    for (i = 0; i < MAX_GUEST_LEN;i++){
-        if (cache_rule_table[i]){
-            TranslationRule *temp = cache_rule_table[i];
-            while(temp->next) {
-                temp = temp->next;
-            }
-            temp->next = rule_table[i];
-        } else {
-            cache_rule_table[i] = rule_table[i];
-        }
+    LogMan::Msg::IFmt("== Ready: {} translation rules loaded, {} installed, {} index nodes.\n\n",
+                      counter, install_counter, rule_index_node_num(set));
 
-    }
+    fclose(fp);
+    return true;
 }
 
-#ifdef PROFILE_RULE_TRANSLATION
-void print_rule_hit_num(void );
-void print_rule_hit_num(void)
+fextl::unique_ptr<RuleSet> ParseTranslationRules(uint64_t pid)
 {
-    TranslationRule *cur_max;
-    int zero_counter = 0;
-    int counter[5] = {0};
-    int i;
+    std::filesystem::path homeDir = std::filesystem::path(getenv("HOME"));
+    std::filesystem::path rulePath = homeDir / "rules4all";
+    std::filesystem::path dbPath = homeDir / "rules4all.db";
+    auto set = fextl::make_unique<RuleSet>();
+    struct stat st;
 
-    for (i = 0; i < MAX_GUEST_LEN; i++) {
-        TranslationRule *cur_rule = rule_table[i];
-        while(cur_rule) {
-            if (cur_rule->hit_num == 0)
-                zero_counter++;
-            cur_rule = cur_rule->next;
-        }
-    }
+    std::lock_guard lk(rule_load_lock);
 
-    LogMan::Msg::IFmt("Rule hit information: {} rules has zero hit.", zero_counter);
-    LogMan::Msg::IFmt("Index  #Guest  #Hit");
-    while(1) {
-        cur_max = NULL;
-        for (i = 0; i < MAX_GUEST_LEN; i++) {
-            TranslationRule *cur_rule = rule_table[i];
-            while(cur_rule) {
-                if (cur_rule->print_flag == 0 &&
-                    ((cur_max != NULL && cur_rule->hit_num > cur_max->hit_num) ||
-                     (cur_max == NULL && cur_rule->hit_num > 0)))
-                    cur_max = cur_rule;
-                cur_rule = cur_rule->next;
-            }
-        }
-        if (cur_max) {
-            LogMan::Msg::IFmt( "  {}\t{}\t%llu",
-                    cur_max->index, cur_max->guest_instr_num, cur_max->hit_num);
-            cur_max->print_flag = 1;
-            if (cur_max->guest_instr_num > 4)
-                counter[4]++;
-            else
-                counter[cur_max->guest_instr_num-1]++;
-        }
-        else
-            break;
-    }
-    LogMan::Msg::IFmt("#Guest    #RuleCounter");
-    for (i = 0; i < 5; i++)
-        if (i == 4)
-            LogMan::Msg::IFmt( " >4           {}", counter[i]);
-        else
-            LogMan::Msg::IFmt( "  {}           {}", i+1, counter[i]);
+    #ifdef DEBUG_RULE_LOG
+      flush_file(pid);
+    #endif
+
+    /* Prefer the image compiled by RuleDBCompiler, fall back to the rule text */
+    if (!load_rule_db(set.get(), dbPath.c_str(), rulePath.c_str()) &&
+        ParseTranslationRuleFile(rulePath.c_str(), set.get()) && stat(rulePath.c_str(), &st) == 0)
+        set_rule_set_id(set.get(), st.st_size, st.st_mtime);
+
+    /* Start from the rule order earlier runs converged on */
+    rule_profile_init(set.get());
+    rule_profile_load();
+
+    return set;
 }
-#endif
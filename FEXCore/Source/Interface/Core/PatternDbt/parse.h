@@ -1,11 +1,12 @@
 #ifndef PARSE_H
 #define PARSE_H
 
+#include <FEXCore/fextl/memory.h>
+
 #include "arm-instr.h"
+#include "rule-index.h"
 #include "x86-instr.h"
 
-#define PROFILE_RULE_TRANSLATION
-
 #define X86_CC_NUM 4
 
 #define X86_OF 0
@@ -31,23 +32,28 @@ typedef struct TranslationRule {
                                  ARM_VF -> x86_OF, ARM_NF -> x86_SF, ARM_CF -> x86_CF, ARM_ZF -> x86_ZF
                               2: arm cc is emulated by the negation of the corresponding x86 cc
                                  ARM_CF -> !x86_CF */
-
-    #ifdef PROFILE_RULE_TRANSLATION
-    uint64_t hit_num;   /* number of hit to this rule (static) */
-    int print_flag;     /* flag used to print hit number */
-    #endif
-
-    int match_counter;  /* counter the match times for each rule
-                           used in rule ordering */
-
 } TranslationRule;
 
+/* The translation rules of a context.
+
+   Built once before any guest code is translated and only read afterwards,
+   every JIT thread of the context matches against the same set without
+   locking. Only the rule order in the index changes later, under its own
+   lock. Rules may be mapped read-only from the rule database, runtime
+   data about them is kept apart and indexed by position in rules. */
+typedef struct RuleSet {
+    TranslationRule *rules;     /* rules[0 .. rule_num - 1] */
+    int rule_num;
+    uint64_t id;                /* identifies the rule text the set comes from, 0 if unknown */
+    TranslationRule *table[MAX_GUEST_LEN];  /* hash chains, see rule_hash_key */
+    RuleIndex index;            /* trie the matcher looks the rules up in, see rule-index.h */
+} RuleSet;
+
 int rule_hash_key(X86Instruction *, int);
 
-TranslationRule *get_rule(void);
-void ParseTranslationRules(uint64_t pid);
+bool ParseTranslationRuleFile(const char *rule_file, RuleSet *set);
 
-extern TranslationRule *rule_table[];
-extern TranslationRule *cache_rule_table[];
+/* Load the rule database or the rule text of the user, safe to call from any thread */
+fextl::unique_ptr<RuleSet> ParseTranslationRules(uint64_t pid);
 
 #endif
@@ -0,0 +1,290 @@
+#include "Interface/Context/Context.h"
+#include "Interface/IR/AOTIR.h"
+
+#include <FEXCore/Config/Config.h>
+#include <FEXCore/HLE/SyscallHandler.h>
+#include <FEXCore/Utils/AllocatorHooks.h>
+#include <FEXCore/Utils/LogManager.h>
+#include <FEXCore/fextl/fmt.h>
+#include <FEXHeaderUtils/Filesystem.h>
+
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <xxhash.h>
+
+#include "parse.h"
+#include "rule-cache.h"
+#include "rule-profile.h"
+
+#define RULE_CACHE_VERSION 5
+#define RULE_CACHE_ALIGN 8
+
+static constexpr uint64_t RULE_CACHE_COOKIE = FEXCore::IR::COOKIE_VERSION("FEXR", RULE_CACHE_VERSION);
+
+static fextl::string rule_cache_path(fextl::string const &FileId)
+{
+    return FEXCore::Config::GetDataDirectory() + "rulecache/" + FileId + ".rulecache";
+}
+
+namespace FEXCore::CPU {
+  RuleMatchCache::~RuleMatchCache() {
+    for (auto &[FileId, File] : Files) {
+      if (File.FilePtr) {
+        FEXCore::Allocator::munmap(File.FilePtr, File.Size);
+      }
+    }
+  }
+
+  RuleMatchCache::CacheFile *RuleMatchCache::GetCacheFile(fextl::string const &FileId) {
+    auto [it, Inserted] = Files.try_emplace(FileId);
+    auto File = &it->second;
+
+    if (!Inserted) {
+      return File;
+    }
+
+    const auto Path = rule_cache_path(FileId);
+    int fd = open(Path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+      return File;
+    }
+
+    struct stat st;
+    void *FilePtr = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(RuleCacheHeader)) {
+      FilePtr = FEXCore::Allocator::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+
+    if (FilePtr == MAP_FAILED) {
+      return File;
+    }
+
+    auto Header = reinterpret_cast<RuleCacheHeader const *>(FilePtr);
+    const size_t Size = st.st_size;
+
+    // Matches refer to rules by position, they are useless with any other rule set
+    if (Header->cookie != RULE_CACHE_COOKIE || Header->rule_set_id != CTX->GetRuleSetId() ||
+        Header->index_off > Size || Header->count > (Size - Header->index_off) / sizeof(RuleCacheIndexEntry)) {
+      LogMan::Msg::IFmt("RuleCache: Ignoring stale {}", Path);
+      FEXCore::Allocator::munmap(FilePtr, Size);
+      return File;
+    }
+
+    File->FilePtr = FilePtr;
+    File->Size = Size;
+    File->Header = Header;
+
+    LogMan::Msg::DFmt("RuleCache: Module {} has {} blocks", FileId, Header->count);
+    return File;
+  }
+
+  RuleCacheEntry const *RuleMatchCache::FindLoaded(CacheFile const *File, uint64_t GuestStart) const {
+    if (!File->Header) {
+      return nullptr;
+    }
+
+    auto Base = reinterpret_cast<uint8_t const *>(File->FilePtr);
+    auto Index = reinterpret_cast<RuleCacheIndexEntry const *>(Base + File->Header->index_off);
+    ssize_t l = 0;
+    ssize_t r = File->Header->count - 1;
+
+    while (l <= r) {
+      size_t m = l + (r - l) / 2;
+
+      if (Index[m].guest_start == GuestStart) {
+        const auto Offset = Index[m].data_off;
+        if (Offset > File->Size - sizeof(RuleCacheEntry)) {
+          return nullptr;
+        }
+
+        auto Entry = reinterpret_cast<RuleCacheEntry const *>(Base + Offset);
+        if (Entry->data_size > File->Size - Offset - sizeof(RuleCacheEntry)) {
+          return nullptr;
+        }
+        return Entry;
+      }
+      else if (Index[m].guest_start < GuestStart) {
+        l = m + 1;
+      }
+      else {
+        r = m - 1;
+      }
+    }
+
+    return nullptr;
+  }
+
+  RuleCacheEntry const *RuleMatchCache::Fetch(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestRIP) {
+    if (!CTX->GetRuleSetId()) {
+      return nullptr;
+    }
+
+    auto AOTIRCacheEntry = CTX->SyscallHandler->LookupAOTIRCacheEntry(Thread, GuestRIP);
+    if (!AOTIRCacheEntry.Entry) {
+      return nullptr;
+    }
+
+    const auto GuestStart = GuestRIP - AOTIRCacheEntry.VAFileStart;
+    auto Find = [this, GuestStart](CacheFile const *File) -> RuleCacheEntry const * {
+      // Blocks matched during this run take precedence over the file
+      auto it = File->Captured.find(GuestStart);
+      if (it != File->Captured.end()) {
+        return reinterpret_cast<RuleCacheEntry const *>(it->second.data());
+      }
+      return FindLoaded(File, GuestStart);
+    };
+
+    RuleCacheEntry const *Entry{};
+    bool HaveFile{};
+    {
+      std::shared_lock lk(RuleCacheLock);
+      auto it = Files.find(AOTIRCacheEntry.Entry->FileId);
+      if (it != Files.end()) {
+        HaveFile = true;
+        Entry = Find(&it->second);
+      }
+    }
+
+    if (!HaveFile) {
+      std::unique_lock lk(RuleCacheLock);
+      Entry = Find(GetCacheFile(AOTIRCacheEntry.Entry->FileId));
+    }
+
+    if (!Entry) {
+      return nullptr;
+    }
+
+    // verify hash
+    auto hash = XXH3_64bits(reinterpret_cast<void const *>(GuestRIP), Entry->guest_len);
+    if (hash != Entry->guest_hash) {
+      LogMan::Msg::IFmt("RuleCache: hash check failed {:x}\n", GuestRIP);
+      return nullptr;
+    }
+
+    return Entry;
+  }
+
+  void RuleMatchCache::Store(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestRIP, uint64_t Length,
+                             uint32_t RecordNum, fextl::vector<uint8_t> const &Data) {
+    if (!CTX->GetRuleSetId() || !Length) {
+      return;
+    }
+
+    auto AOTIRCacheEntry = CTX->SyscallHandler->LookupAOTIRCacheEntry(Thread, GuestRIP);
+    if (!AOTIRCacheEntry.Entry) {
+      return;
+    }
+
+    RuleCacheEntry Header {
+      .guest_hash = XXH3_64bits(reinterpret_cast<void const *>(GuestRIP), Length),
+      .guest_len = Length,
+      .record_num = RecordNum,
+      .data_size = static_cast<uint32_t>(Data.size()),
+    };
+
+    fextl::vector<uint8_t> Entry(sizeof(Header) + Data.size());
+    memcpy(Entry.data(), &Header, sizeof(Header));
+    if (!Data.empty()) {
+      memcpy(Entry.data() + sizeof(Header), Data.data(), Data.size());
+    }
+
+    std::unique_lock lk(RuleCacheLock);
+    // An entry handed out by Fetch must stay valid, never replace one
+    GetCacheFile(AOTIRCacheEntry.Entry->FileId)->Captured.try_emplace(GuestRIP - AOTIRCacheEntry.VAFileStart, std::move(Entry));
+  }
+
+  bool RuleMatchCache::WriteCacheFile(fextl::string const &FileId, CacheFile const &File) const {
+    // Merge the blocks of the previous runs with the ones matched now
+    fextl::map<uint64_t, RuleCacheEntry const *> Entries;
+
+    if (File.Header) {
+      auto Index = reinterpret_cast<RuleCacheIndexEntry const *>(reinterpret_cast<uint8_t const *>(File.FilePtr) + File.Header->index_off);
+      for (uint64_t i = 0; i < File.Header->count; ++i) {
+        if (auto Entry = FindLoaded(&File, Index[i].guest_start)) {
+          Entries.emplace(Index[i].guest_start, Entry);
+        }
+      }
+    }
+
+    for (auto &[GuestStart, Data] : File.Captured) {
+      Entries.insert_or_assign(GuestStart, reinterpret_cast<RuleCacheEntry const *>(Data.data()));
+    }
+
+    fextl::vector<uint8_t> Image(sizeof(RuleCacheHeader));
+    fextl::vector<RuleCacheIndexEntry> Index;
+    Index.reserve(Entries.size());
+
+    for (auto &[GuestStart, Entry] : Entries) {
+      const size_t Offset = Image.size();
+      const size_t EntrySize = sizeof(RuleCacheEntry) + Entry->data_size;
+
+      Image.resize((Offset + EntrySize + RULE_CACHE_ALIGN - 1) & ~(RULE_CACHE_ALIGN - 1), 0);
+      memcpy(&Image[Offset], Entry, EntrySize);
+      Index.push_back({GuestStart, Offset});
+    }
+
+    RuleCacheHeader Header {
+      .cookie = RULE_CACHE_COOKIE,
+      .rule_set_id = CTX->GetRuleSetId(),
+      .count = Index.size(),
+      .index_off = Image.size(),
+    };
+    memcpy(&Image[0], &Header, sizeof(Header));
+
+    const auto IndexOffset = Image.size();
+    Image.resize(IndexOffset + Index.size() * sizeof(RuleCacheIndexEntry));
+    if (!Index.empty()) {
+      memcpy(&Image[IndexOffset], Index.data(), Index.size() * sizeof(RuleCacheIndexEntry));
+    }
+
+    // Forked children write the same files, give each its own temporary file
+    const auto Path = rule_cache_path(FileId);
+    const auto TmpPath = fextl::fmt::format("{}.{}.tmp", Path, ::getpid());
+
+    int fd = open(TmpPath.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+      LogMan::Msg::IFmt("RuleCache: Failed to store {}", FileId);
+      return false;
+    }
+
+    bool Written = write(fd, Image.data(), Image.size()) == static_cast<ssize_t>(Image.size());
+    close(fd);
+
+    // Rename the temporary file to atomically update the cache
+    if (!Written || FHU::Filesystem::RenameFile(TmpPath, Path)) {
+      LogMan::Msg::IFmt("RuleCache: Failed to store {}", FileId);
+      unlink(TmpPath.c_str());
+      return false;
+    }
+
+    return true;
+  }
+
+  void RuleMatchCache::FinalizeRuleCache() {
+    rule_profile_save();
+
+    std::unique_lock lk(RuleCacheLock);
+
+    bool HaveDirectory{};
+    for (auto &[FileId, File] : Files) {
+      if (File.Captured.empty()) {
+        continue;
+      }
+
+      if (!HaveDirectory) {
+        HaveDirectory = FHU::Filesystem::CreateDirectories(FEXCore::Config::GetDataDirectory() + "rulecache");
+        if (!HaveDirectory) {
+          LogMan::Msg::IFmt("RuleCache: Couldn't create rulecache folder");
+          return;
+        }
+      }
+
+      WriteCacheFile(FileId, File);
+    }
+  }
+}
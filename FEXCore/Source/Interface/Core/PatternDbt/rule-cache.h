@@ -0,0 +1,139 @@
+#ifndef RULE_CACHE_H
+#define RULE_CACHE_H
+
+#include <FEXCore/fextl/map.h>
+#include <FEXCore/fextl/string.h>
+#include <FEXCore/fextl/unordered_map.h>
+#include <FEXCore/fextl/vector.h>
+
+#include <cstdint>
+#include <shared_mutex>
+
+namespace FEXCore::Context {
+  class ContextImpl;
+}
+
+namespace FEXCore::Core {
+  struct InternalThreadState;
+}
+
+/* Per-binary cache of rule matches.
+
+   For every guest block of a mapped file it keeps what MatchTranslationRule
+   decided last time: either no rule, or the sequence of matched rules with the
+   register, immediate and label bindings of each. The guest bytes are hashed
+   so a block that changed on disk is matched again.
+
+   Addresses are stored relative to the block entry, the cache is valid for
+   any load address of the file. */
+
+typedef struct {
+    uint64_t cookie;
+    uint64_t rule_set_id;   /* RuleSet::id of the rules the matches refer to */
+    uint64_t count;
+    uint64_t index_off;     /* RuleCacheIndexEntry[count], sorted by guest_start */
+} RuleCacheHeader;
+
+typedef struct {
+    uint64_t guest_start;   /* block entry, relative to the start of the file mapping */
+    uint64_t data_off;
+} RuleCacheIndexEntry;
+
+typedef struct {
+    uint64_t guest_hash;
+    uint64_t guest_len;
+    uint32_t record_num;    /* 0 if no rule matched this block */
+    uint32_t data_size;
+    uint8_t data[0];        /* record_num RuleCacheRecord, each followed by its bindings and pc offsets */
+} RuleCacheEntry;
+
+typedef struct {
+    uint64_t pc_off;
+    uint64_t target_pc_off;
+    uint32_t rule_id;       /* position in the rule buffer */
+    uint16_t imm_num;
+    uint16_t reg_num;
+    uint16_t label_num;
+    uint16_t pc_num;        /* guest instructions covered by the rule */
+    uint8_t has_target_pc;
+    uint8_t update_cc;
+    uint8_t save_cc;
+
+    /* what do_rule_translation needs from the last guest instruction */
+    uint8_t last_opd_num;
+    uint8_t last_opd0_type;
+    uint8_t last_rip_literal;
+    uint8_t last_cc_live;   /* bit i: condition code X86_REG_OF + i is live after the rule */
+    uint32_t last_opc;
+} RuleCacheRecord;
+
+typedef struct {
+    uint32_t sym;           /* symbol id, see rule-sym.h */
+    uint32_t pad;
+    uint64_t val;
+} RuleCacheImm;
+
+typedef struct {
+    uint32_t sym;
+    uint32_t num;
+    uint32_t regsize;
+    uint32_t high_bits;
+} RuleCacheReg;
+
+typedef struct {
+    uint32_t sym;           /* symbol id, see rule-sym.h */
+    uint32_t pad;
+    uint64_t target;
+    uint64_t fallthrough_off;
+} RuleCacheLabel;
+
+namespace FEXCore::CPU {
+  class RuleMatchCache final {
+    public:
+      RuleMatchCache(FEXCore::Context::ContextImpl *ctx) : CTX {ctx} {}
+      ~RuleMatchCache();
+
+      /**
+       * @brief Looks up the rule matches of the block at GuestRIP
+       *
+       * @return The cached entry if the block's guest bytes are unchanged, nullptr otherwise
+       */
+      RuleCacheEntry const *Fetch(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestRIP);
+
+      /**
+       * @brief Records the rule matches of a block that Fetch didn't have
+       *
+       * @param Length - Number of guest bytes in the block
+       * @param RecordNum - Number of serialized records in Data, 0 if no rule matched
+       */
+      void Store(FEXCore::Core::InternalThreadState *Thread, uint64_t GuestRIP, uint64_t Length,
+                 uint32_t RecordNum, fextl::vector<uint8_t> const &Data);
+
+      /**
+       * @brief Writes every file with new matches back to the data directory
+       *
+       * The rule profile is written along, if RuleProfile is enabled
+       */
+      void FinalizeRuleCache();
+
+    private:
+      struct CacheFile {
+        void *FilePtr{};
+        size_t Size{};
+        RuleCacheHeader const *Header{};
+        // Serialized RuleCacheEntry of the blocks matched during this run
+        fextl::map<uint64_t, fextl::vector<uint8_t>> Captured;
+      };
+
+      CacheFile *GetCacheFile(fextl::string const &FileId);
+      RuleCacheEntry const *FindLoaded(CacheFile const *File, uint64_t GuestStart) const;
+      bool WriteCacheFile(fextl::string const &FileId, CacheFile const &File) const;
+
+      FEXCore::Context::ContextImpl *CTX;
+
+      std::shared_mutex RuleCacheLock;
+      fextl::unordered_map<fextl::string, CacheFile> Files;
+  };
+}
+
+#endif
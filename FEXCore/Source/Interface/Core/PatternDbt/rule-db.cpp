@@ -0,0 +1,315 @@
+#include <FEXCore/Utils/AllocatorHooks.h>
+#include <FEXCore/Utils/LogManager.h>
+#include <FEXCore/fextl/string.h>
+#include <FEXCore/fextl/vector.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "arm-parse.h"
+#include "x86-parse.h"
+#include "rule-db.h"
+
+#define RULE_DB_PAGE_SIZE 4096
+
+typedef struct {
+    const char *start;  /* section in the parse buffers */
+    uint64_t size;
+    uint64_t off;       /* section in the image */
+} RuleDBSection;
+
+#define RULE_DB_SECTION_NUM 3
+
+static RuleDBSection rule_db_sections[RULE_DB_SECTION_NUM];
+
+static uint64_t rule_db_align(uint64_t off, uint64_t align)
+{
+    return (off + align - 1) & ~(align - 1);
+}
+
+/* Translate a pointer into the parse buffers to its offset in the image */
+static bool rule_db_ptr_off(const void *ptr, uint64_t *off)
+{
+    const char *p = (const char *)ptr;
+    int i;
+
+    for (i = 0; i < RULE_DB_SECTION_NUM; i++) {
+        RuleDBSection *sec = &rule_db_sections[i];
+        if (p >= sec->start && p < sec->start + sec->size) {
+            *off = sec->off + (p - sec->start);
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Rewrite the pointer stored at slot as an address in the linked image */
+static bool rule_db_link_slot(fextl::vector<uint8_t> &img, fextl::vector<uint64_t> &relocs,
+                              uint64_t slot, uint64_t base)
+{
+    void *ptr;
+    uint64_t off, val;
+
+    memcpy(&ptr, &img[slot], sizeof(ptr));
+    if (!ptr)
+        return true;
+
+    if (!rule_db_ptr_off(ptr, &off)) {
+        LogMan::Msg::EFmt("[RuleDB] pointer at image offset {:#x} is outside of the rule buffers.", slot);
+        return false;
+    }
+
+    val = base + off;
+    memcpy(&img[slot], &val, sizeof(val));
+    relocs.push_back(slot);
+    return true;
+}
+
+static bool rule_db_write_file(const char *db_file, const fextl::vector<uint8_t> &img)
+{
+    fextl::string tmp_file = fextl::string(db_file) + ".tmp";
+    FILE *fp = fopen(tmp_file.c_str(), "wb");
+    bool ret;
+
+    if (!fp) {
+        LogMan::Msg::EFmt("[RuleDB] cannot open {}.", tmp_file);
+        return false;
+    }
+
+    ret = fwrite(img.data(), 1, img.size(), fp) == img.size();
+    ret = (fclose(fp) == 0) && ret;
+
+    /* Rename the temporary file to atomically replace the database */
+    if (ret)
+        ret = rename(tmp_file.c_str(), db_file) == 0;
+
+    if (!ret) {
+        LogMan::Msg::EFmt("[RuleDB] failed to write {}.", db_file);
+        unlink(tmp_file.c_str());
+    }
+    return ret;
+}
+
+bool rule_db_write(const RuleSet *set, const char *db_file, const char *src_file, uint64_t base)
+{
+    RuleDBHeader hdr;
+    struct stat st;
+    int x86_num, arm_num;
+    int rule_num = set->rule_num;
+    TranslationRule *rules = set->rules;
+    X86Instruction *x86 = get_rule_x86_instr_buf(&x86_num);
+    ARMInstruction *arm = get_rule_arm_instr_buf(&arm_num);
+    fextl::vector<uint8_t> img;
+    fextl::vector<uint64_t> relocs;
+    uint64_t off, slot;
+    int i;
+
+    if (base & (RULE_DB_PAGE_SIZE - 1)) {
+        LogMan::Msg::EFmt("[RuleDB] base {:#x} is not page aligned.", base);
+        return false;
+    }
+
+    if (stat(src_file, &st) < 0) {
+        LogMan::Msg::EFmt("[RuleDB] cannot stat {}.", src_file);
+        return false;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = RULE_DB_MAGIC;
+    hdr.version = RULE_DB_VERSION;
+    hdr.header_size = sizeof(RuleDBHeader);
+    hdr.rule_size = sizeof(TranslationRule);
+    hdr.x86_instr_size = sizeof(X86Instruction);
+    hdr.arm_instr_size = sizeof(ARMInstruction);
+    hdr.x86_opc_num = X86_OPC_END;
+    hdr.arm_opc_num = ARM_OPC_END;
+    hdr.table_len = MAX_GUEST_LEN;
+    hdr.base = base;
+    hdr.src_size = st.st_size;
+    hdr.src_mtime = st.st_mtime;
+
+    /* 1. lay out the sections */
+    off = rule_db_align(sizeof(RuleDBHeader), RULE_DB_ALIGN);
+    hdr.rule_off = off;
+    hdr.rule_num = rule_num;
+    off = rule_db_align(off + rule_num * sizeof(TranslationRule), RULE_DB_ALIGN);
+    hdr.x86_off = off;
+    hdr.x86_num = x86_num;
+    off = rule_db_align(off + x86_num * sizeof(X86Instruction), RULE_DB_ALIGN);
+    hdr.arm_off = off;
+    hdr.arm_num = arm_num;
+    off = rule_db_align(off + arm_num * sizeof(ARMInstruction), RULE_DB_ALIGN);
+    hdr.table_off = off;
+    off = rule_db_align(off + MAX_GUEST_LEN * sizeof(TranslationRule *), RULE_DB_ALIGN);
+
+    rule_db_sections[0] = {(const char *)rules, rule_num * sizeof(TranslationRule), hdr.rule_off};
+    rule_db_sections[1] = {(const char *)x86, x86_num * sizeof(X86Instruction), hdr.x86_off};
+    rule_db_sections[2] = {(const char *)arm, arm_num * sizeof(ARMInstruction), hdr.arm_off};
+
+    /* 2. copy the parsed rules */
+    img.resize(off, 0);
+    if (rule_num)
+        memcpy(&img[hdr.rule_off], rules, rule_num * sizeof(TranslationRule));
+    if (x86_num)
+        memcpy(&img[hdr.x86_off], x86, x86_num * sizeof(X86Instruction));
+    if (arm_num)
+        memcpy(&img[hdr.arm_off], arm, arm_num * sizeof(ARMInstruction));
+    memcpy(&img[hdr.table_off], set->table, MAX_GUEST_LEN * sizeof(TranslationRule *));
+
+    /* 3. link every pointer slot against base */
+    bool ok = true;
+    for (i = 0; i < rule_num; i++) {
+        slot = hdr.rule_off + i * sizeof(TranslationRule);
+        ok &= rule_db_link_slot(img, relocs, slot + offsetof(TranslationRule, arm_host), base);
+        ok &= rule_db_link_slot(img, relocs, slot + offsetof(TranslationRule, x86_guest), base);
+        ok &= rule_db_link_slot(img, relocs, slot + offsetof(TranslationRule, next), base);
+        ok &= rule_db_link_slot(img, relocs, slot + offsetof(TranslationRule, prev), base);
+    }
+    for (i = 0; i < x86_num; i++) {
+        slot = hdr.x86_off + i * sizeof(X86Instruction);
+        ok &= rule_db_link_slot(img, relocs, slot + offsetof(X86Instruction, prev), base);
+        ok &= rule_db_link_slot(img, relocs, slot + offsetof(X86Instruction, next), base);
+    }
+    for (i = 0; i < arm_num; i++) {
+        slot = hdr.arm_off + i * sizeof(ARMInstruction);
+        ok &= rule_db_link_slot(img, relocs, slot + offsetof(ARMInstruction, prev), base);
+        ok &= rule_db_link_slot(img, relocs, slot + offsetof(ARMInstruction, next), base);
+    }
+    for (i = 0; i < MAX_GUEST_LEN; i++)
+        ok &= rule_db_link_slot(img, relocs, hdr.table_off + i * sizeof(TranslationRule *), base);
+
+    if (!ok)
+        return false;
+
+    /* 4. append the relocation table and pad to a whole page */
+    hdr.reloc_off = img.size();
+    hdr.reloc_num = relocs.size();
+    img.resize(img.size() + relocs.size() * sizeof(uint64_t), 0);
+    if (!relocs.empty())
+        memcpy(&img[hdr.reloc_off], relocs.data(), relocs.size() * sizeof(uint64_t));
+
+    hdr.image_size = rule_db_align(img.size(), RULE_DB_PAGE_SIZE);
+    img.resize(hdr.image_size, 0);
+    memcpy(&img[0], &hdr, sizeof(hdr));
+
+    LogMan::Msg::IFmt("[RuleDB] {} rules, {} guest and {} host instructions, {} relocations, {} bytes.",
+                      rule_num, x86_num, arm_num, relocs.size(), hdr.image_size);
+
+    return rule_db_write_file(db_file, img);
+}
+
+static bool rule_db_check_header(const RuleDBHeader *hdr, uint64_t file_size, const char *src_file)
+{
+    struct stat st;
+
+    if (hdr->magic != RULE_DB_MAGIC || hdr->version != RULE_DB_VERSION ||
+        hdr->header_size != sizeof(RuleDBHeader)) {
+        LogMan::Msg::IFmt("[RuleDB] unknown database version.");
+        return false;
+    }
+
+    if (hdr->rule_size != sizeof(TranslationRule) || hdr->x86_instr_size != sizeof(X86Instruction) ||
+        hdr->arm_instr_size != sizeof(ARMInstruction) || hdr->x86_opc_num != X86_OPC_END ||
+        hdr->arm_opc_num != ARM_OPC_END || hdr->table_len != MAX_GUEST_LEN) {
+        LogMan::Msg::IFmt("[RuleDB] database was compiled by a different build.");
+        return false;
+    }
+
+    if (hdr->image_size > file_size ||
+        hdr->rule_off + hdr->rule_num * sizeof(TranslationRule) > hdr->image_size ||
+        hdr->x86_off + hdr->x86_num * sizeof(X86Instruction) > hdr->image_size ||
+        hdr->arm_off + hdr->arm_num * sizeof(ARMInstruction) > hdr->image_size ||
+        hdr->table_off + MAX_GUEST_LEN * sizeof(TranslationRule *) > hdr->image_size ||
+        hdr->reloc_off + hdr->reloc_num * sizeof(uint64_t) > hdr->image_size) {
+        LogMan::Msg::IFmt("[RuleDB] database is truncated.");
+        return false;
+    }
+
+    /* The text is optional, but if it is there it must be what the image was compiled from */
+    if (src_file && stat(src_file, &st) == 0 &&
+        ((uint64_t)st.st_size != hdr->src_size || st.st_mtime != hdr->src_mtime)) {
+        LogMan::Msg::IFmt("[RuleDB] database is out of date with {}.", src_file);
+        return false;
+    }
+
+    return true;
+}
+
+static bool rule_db_relocate(uint8_t *base, const RuleDBHeader *hdr)
+{
+    const uint64_t delta = (uint64_t)base - hdr->base;
+    const uint64_t *relocs = (const uint64_t *)(base + hdr->reloc_off);
+    uint64_t i;
+
+    for (i = 0; i < hdr->reloc_num; i++) {
+        uint64_t slot = relocs[i];
+        uint64_t val;
+
+        if (slot & (sizeof(uint64_t) - 1) || slot + sizeof(uint64_t) > hdr->reloc_off)
+            return false;
+
+        memcpy(&val, base + slot, sizeof(val));
+        val += delta;
+        memcpy(base + slot, &val, sizeof(val));
+    }
+
+    return true;
+}
+
+bool rule_db_load(const char *db_file, const char *src_file, RuleDBImage *img)
+{
+    RuleDBHeader hdr;
+    struct stat st;
+    uint8_t *map;
+    int fd;
+
+    fd = open(db_file, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    if (fstat(fd, &st) < 0 || pread(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) ||
+        !rule_db_check_header(&hdr, st.st_size, src_file)) {
+        close(fd);
+        return false;
+    }
+
+    /* Try the address the image is linked at first, the pages are then shared with every other process */
+    map = (uint8_t *)FEXCore::Allocator::mmap((void *)hdr.base, hdr.image_size, PROT_READ,
+                                              MAP_PRIVATE | MAP_FIXED_NOREPLACE, fd, 0);
+    if (map != MAP_FAILED && map != (uint8_t *)hdr.base) {
+        FEXCore::Allocator::munmap(map, hdr.image_size);
+        map = (uint8_t *)MAP_FAILED;
+    }
+
+    img->relocated = map == MAP_FAILED;
+    if (img->relocated) {
+        map = (uint8_t *)FEXCore::Allocator::mmap(nullptr, hdr.image_size, PROT_READ | PROT_WRITE,
+                                                  MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+
+        if (!rule_db_relocate(map, &hdr)) {
+            LogMan::Msg::IFmt("[RuleDB] bad relocation in {}.", db_file);
+            FEXCore::Allocator::munmap(map, hdr.image_size);
+            close(fd);
+            return false;
+        }
+        mprotect(map, hdr.image_size, PROT_READ);
+    }
+    close(fd);
+
+    img->rules = (TranslationRule *)(map + hdr.rule_off);
+    img->rule_num = hdr.rule_num;
+    img->rule_table = (TranslationRule **)(map + hdr.table_off);
+    img->src_size = hdr.src_size;
+    img->src_mtime = hdr.src_mtime;
+
+    return true;
+}
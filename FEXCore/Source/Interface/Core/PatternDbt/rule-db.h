@@ -0,0 +1,72 @@
+#ifndef RULE_DB_H
+#define RULE_DB_H
+
+#include <cstdint>
+
+#include "parse.h"
+
+/* Precompiled rule database.
+
+   The image is the rule_buf, the rule instruction buffers and the hash
+   table as laid out in memory after parsing the rule text, with every
+   pointer rewritten as if the image was mapped at `base`.
+
+   A loader that gets the mapping at `base` uses the file pages read-only as
+   they are, so every emulated process shares them through the page cache.
+   Otherwise the image is mapped privately and the pointer slots listed in
+   the relocation table are adjusted. */
+
+#define RULE_DB_MAGIC 0x4244454c55525846ULL /* "FXRULEDB" */
+#define RULE_DB_VERSION 4
+
+#define RULE_DB_DEFAULT_BASE 0x0000fe0000000000ULL
+#define RULE_DB_ALIGN 64
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t header_size;
+
+    /* The image is only valid for the build that wrote it */
+    uint32_t rule_size;
+    uint32_t x86_instr_size;
+    uint32_t arm_instr_size;
+    uint32_t x86_opc_num;
+    uint32_t arm_opc_num;
+    uint32_t table_len;
+
+    uint64_t base;          /* address the image is linked at */
+    uint64_t image_size;
+
+    uint64_t src_size;      /* size and mtime of the rule text it was compiled from */
+    int64_t src_mtime;
+
+    uint64_t rule_off;
+    uint64_t rule_num;
+    uint64_t x86_off;
+    uint64_t x86_num;
+    uint64_t arm_off;
+    uint64_t arm_num;
+    uint64_t table_off;     /* rule_table */
+    uint64_t reloc_off;     /* offsets of every non-null pointer slot */
+    uint64_t reloc_num;
+} RuleDBHeader;
+
+typedef struct {
+    TranslationRule *rules;
+    uint64_t rule_num;
+    TranslationRule **rule_table;
+    uint64_t src_size;      /* rule text the image was compiled from */
+    int64_t src_mtime;
+    bool relocated;         /* false if the file pages are shared as is */
+} RuleDBImage;
+
+/* Write the rules of set, just parsed from rule text, to db_file.
+   src_file is the text they were parsed from. */
+bool rule_db_write(const RuleSet *set, const char *db_file, const char *src_file, uint64_t base);
+
+/* Map db_file. Fails if the image is missing, was written by another
+   build, or is older than src_file. */
+bool rule_db_load(const char *db_file, const char *src_file, RuleDBImage *img);
+
+#endif
@@ -0,0 +1,201 @@
+#include <FEXCore/Utils/LogManager.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <shared_mutex>
+
+#include "parse.h"
+#include "rule-index.h"
+
+static RuleTrieNode *rule_trie_node_alloc(RuleIndex *index)
+{
+    index->node_num++;
+    return new RuleTrieNode;
+}
+
+static void rule_trie_node_free(RuleTrieNode *node)
+{
+    if (!node)
+        return;
+
+    for (auto &[key, child] : node->children)
+        rule_trie_node_free(child);
+
+    delete node;
+}
+
+RuleIndex::~RuleIndex()
+{
+    rule_trie_node_free(root);
+}
+
+uint32_t rule_shape_key(X86Instruction *instr)
+{
+    uint32_t key = RULE_SHAPE_ANY(instr->opc);
+    int i;
+
+    /* nop and parameterized instructions match any operands */
+    if (instr->opc == X86_OPC_NOP || instr->opd_num == 0)
+        return key;
+
+    key |= (uint32_t)instr->opd_num << 6;
+    for (i = 0; i < instr->opd_num && i < X86_MAX_OPERAND_NUM; i++)
+        key |= (uint32_t)instr->opd[i].type << (2 * (X86_MAX_OPERAND_NUM - 1 - i));
+
+    return key;
+}
+
+void rule_index_init(RuleSet *set)
+{
+    RuleIndex *index = &set->index;
+    std::unique_lock lk(index->lock);
+
+    rule_trie_node_free(index->root);
+    index->node_num = 0;
+    index->root = rule_trie_node_alloc(index);
+
+    std::fill(std::begin(index->start_opc), std::end(index->start_opc), false);
+    index->min_len = UINT32_MAX;
+    index->max_len = 0;
+}
+
+void rule_index_insert(RuleSet *set, TranslationRule *rule)
+{
+    RuleIndex *index = &set->index;
+    std::unique_lock lk(index->lock);
+    RuleTrieNode *node = index->root;
+    X86Instruction *instr = rule->x86_guest;
+    uint32_t len = 0;
+
+    if (!node || !instr)
+        return;
+
+    while (instr) {
+        /* A rule containing an unsupported instruction can never match */
+        if (instr->opc == X86_OPC_INVALID)
+            return;
+
+        uint32_t key = rule_shape_key(instr);
+        auto it = node->children.find(key);
+        if (it == node->children.end())
+            it = node->children.emplace(key, rule_trie_node_alloc(index)).first;
+
+        node = it->second;
+        instr = instr->next;
+        len++;
+    }
+
+    node->rules.push_back(rule);
+
+    index->start_opc[rule->x86_guest->opc] = true;
+    index->min_len = std::min(index->min_len, len);
+    index->max_len = std::max(index->max_len, len);
+}
+
+static void rule_index_walk(const RuleIndex *index, RuleTrieNode *node, X86Instruction *instr, uint32_t depth,
+                            RuleCandidate *cands, int *num, int max_cands)
+{
+    /* No rule is longer than max_len */
+    if (instr && instr->opc != X86_OPC_INVALID && depth < index->max_len) {
+        uint32_t key = rule_shape_key(instr);
+        uint32_t any = RULE_SHAPE_ANY(instr->opc);
+
+        /* Longer rules first, once cands is full only shorter ones get dropped */
+        auto it = node->children.find(key);
+        if (it != node->children.end())
+            rule_index_walk(index, it->second, instr->next, depth + 1, cands, num, max_cands);
+
+        if (any != key) {
+            it = node->children.find(any);
+            if (it != node->children.end())
+                rule_index_walk(index, it->second, instr->next, depth + 1, cands, num, max_cands);
+        }
+    }
+
+    for (auto rule : node->rules) {
+        if (*num >= max_cands)
+            return;
+        cands[(*num)++] = {rule, depth};
+    }
+}
+
+int rule_index_lookup(const RuleSet *set, X86Instruction *instr, RuleCandidate *cands, int max_cands)
+{
+    const RuleIndex *index = &set->index;
+    int num = 0;
+
+    if (!instr)
+        return 0;
+
+    {
+        std::shared_lock lk(index->lock);
+        if (index->root)
+            rule_index_walk(index, index->root, instr, 0, cands, &num, max_cands);
+    }
+
+    /* Try from the longest rule */
+    std::stable_sort(cands, cands + num, [](const RuleCandidate &a, const RuleCandidate &b) {
+        return a.len > b.len;
+    });
+
+    return num;
+}
+
+static void rule_index_sort_node(RuleTrieNode *node, bool (*before)(TranslationRule *, TranslationRule *))
+{
+    /* Stable, rules with the same score keep their relative order */
+    std::stable_sort(node->rules.begin(), node->rules.end(), before);
+
+    for (auto &[key, child] : node->children)
+        rule_index_sort_node(child, before);
+}
+
+void rule_index_sort(RuleSet *set, bool (*before)(TranslationRule *a, TranslationRule *b))
+{
+    RuleIndex *index = &set->index;
+    std::unique_lock lk(index->lock);
+
+    if (index->root)
+        rule_index_sort_node(index->root, before);
+}
+
+int rule_hash_lookup(const RuleSet *set, X86Instruction *instr, int len, RuleCandidate *cands, int max_cands)
+{
+    int hindex = rule_hash_key(instr, len);
+    int num = 0;
+
+    if (hindex >= MAX_GUEST_LEN)
+        return 0;
+
+    for (TranslationRule *cur_rule = set->table[hindex]; cur_rule; cur_rule = cur_rule->next) {
+        if (cur_rule->guest_instr_num != (uint32_t)len)
+            continue;
+        if (num >= max_cands)
+            break;
+        cands[num++] = {cur_rule, (uint32_t)len};
+    }
+
+    return num;
+}
+
+uint32_t rule_index_node_num(const RuleSet *set)
+{
+    return set->index.node_num;
+}
+
+bool rule_index_may_start(const RuleSet *set, X86Opcode opc)
+{
+    return opc < X86_OPC_END && set->index.start_opc[opc];
+}
+
+uint32_t rule_index_min_len(const RuleSet *set)
+{
+    return set->index.min_len;
+}
+
+uint32_t rule_index_max_len(const RuleSet *set)
+{
+    return set->index.max_len;
+}
@@ -0,0 +1,81 @@
+#ifndef RULE_INDEX_H
+#define RULE_INDEX_H
+
+#include <FEXCore/fextl/unordered_map.h>
+#include <FEXCore/fextl/vector.h>
+
+#include <cstdint>
+#include <shared_mutex>
+
+#include "x86-instr.h"
+
+struct RuleSet;
+struct TranslationRule;
+
+#define MAX_RULE_CANDIDATES 256
+
+/* Shape of an instruction used as an edge in the rule trie:
+   opcode, number of operands and the kind of each operand.
+   Rules with zero operands (parameterized instructions and nop)
+   accept any operand shape and are keyed on the opcode alone. */
+#define RULE_SHAPE_OPC_SHIFT 8
+#define RULE_SHAPE_ANY(opc) ((uint32_t)(opc) << RULE_SHAPE_OPC_SHIFT)
+
+typedef struct RuleTrieNode {
+    fextl::unordered_map<uint32_t, struct RuleTrieNode *> children;
+    fextl::vector<struct TranslationRule *> rules;    /* rules whose guest sequence ends at this node */
+} RuleTrieNode;
+
+/* Trie over the guest sequences of the rules of a RuleSet, together with
+   the pre-filter built while the rules are inserted. */
+typedef struct RuleIndex {
+    RuleTrieNode *root = nullptr;
+    uint32_t node_num = 0;
+    /* Lookups walk the trie while rule_index_sort reorders the nodes */
+    mutable std::shared_mutex lock;
+
+    /* Opcodes found in the first position of some rule */
+    bool start_opc[X86_OPC_END] = {};
+    uint32_t min_len = UINT32_MAX;
+    uint32_t max_len = 0;
+
+    ~RuleIndex();
+} RuleIndex;
+
+typedef struct {
+    struct TranslationRule *rule;
+    uint32_t len;           /* number of guest instructions covered by this rule */
+} RuleCandidate;
+
+uint32_t rule_shape_key(X86Instruction *instr);
+
+/* Drop the index of set and start an empty one */
+void rule_index_init(RuleSet *set);
+void rule_index_insert(RuleSet *set, struct TranslationRule *rule);
+
+/* Walk the trie of set along the guest instructions starting at instr and collect
+   every rule whose guest pattern shape matches a prefix of the sequence.
+   Candidates are returned longest first, and in the order of the trie node
+   within the same length. Past max_cands the rules of a node are dropped
+   before those of the nodes below it. Returns the number of candidates. */
+int rule_index_lookup(const RuleSet *set, X86Instruction *instr, RuleCandidate *cands, int max_cands);
+
+/* Reorder the rules of every trie node, rules for which before(a, b) holds
+   are returned first. The order starts as install order. Safe against
+   concurrent lookups. */
+void rule_index_sort(RuleSet *set, bool (*before)(struct TranslationRule *a, struct TranslationRule *b));
+
+/* Legacy lookup through the sum-of-opcodes hash chains,
+   kept to compare against the trie in the matcher benchmark. */
+int rule_hash_lookup(const RuleSet *set, X86Instruction *instr, int len, RuleCandidate *cands, int max_cands);
+
+uint32_t rule_index_node_num(const RuleSet *set);
+
+/* Pre-filter built while rules are inserted. A guest block can only be
+   matched if it contains an opcode that starts some rule and is at least
+   as long as the shortest rule. */
+bool rule_index_may_start(const RuleSet *set, X86Opcode opc);
+uint32_t rule_index_min_len(const RuleSet *set);
+uint32_t rule_index_max_len(const RuleSet *set);
+
+#endif
@@ -0,0 +1,296 @@
+#include <FEXCore/Config/Config.h>
+#include <FEXCore/Utils/LogManager.h>
+#include <FEXCore/fextl/fmt.h>
+#include <FEXCore/fextl/string.h>
+#include <FEXCore/fextl/unordered_map.h>
+#include <FEXCore/fextl/vector.h>
+#include <FEXHeaderUtils/Filesystem.h>
+
+#include <algorithm>
+#include <fcntl.h>
+#include <mutex>
+#include <unistd.h>
+
+#include "rule-miner.h"
+
+typedef struct {
+    fextl::string seq;      /* guest code in rule file syntax */
+    int len;                /* number of guest instructions */
+} MinerCandidate;
+
+typedef struct {
+    const uint64_t *calls;
+    uint32_t instr_num;
+    uint32_t covered_num;
+    uint32_t unknown_num;   /* instructions the rule language has no opcode for */
+    fextl::vector<uint32_t> candidates;     /* uncovered sequences, index into miner_candidates */
+    fextl::vector<uint16_t> uncovered_opc;  /* opcodes of the uncovered instructions */
+} MinerBlock;
+
+/* Symbols given to the registers and immediates of one sequence */
+typedef struct {
+    int reg_sym[X86_REG_XMM15 + 1];
+    int reg_num;
+    int imm_num;
+} MinerNames;
+
+static std::mutex miner_lock;
+static fextl::vector<MinerCandidate> miner_candidates;
+static fextl::unordered_map<fextl::string, uint32_t> miner_candidate_ids;
+static fextl::unordered_map<uint64_t, MinerBlock> miner_blocks;
+
+static const char *reg_size_suffix(uint32_t size)
+{
+    switch (size) {
+        case 1: return "b";
+        case 2: return "w";
+        case 3: return "d";
+        case 4: return "q";
+        default: return "";
+    }
+}
+
+static const char *mem_size_str(uint32_t size)
+{
+    switch (size) {
+        case 1: return "byte ";
+        case 2: return "word ";
+        case 3: return "dword ";
+        case 4: return "qword ";
+        case 5: return "xmmword ";
+        default: return "";
+    }
+}
+
+static void render_reg(fextl::string &out, MinerNames *names, X86Register reg, uint32_t size, bool high)
+{
+    static const char *high_str[] = {"ah", "ch", "dh", "bh"};
+    static const char *rsp_str[] = {"spl", "sp", "esp", "rsp"};
+
+    /* Rules name these physically */
+    if (high && reg >= X86_REG_RAX && reg <= X86_REG_RBX) {
+        out += high_str[reg - X86_REG_RAX];
+        return;
+    }
+    if (reg == X86_REG_RSP) {
+        out += size >= 1 && size <= 4 ? rsp_str[size - 1] : "rsp";
+        return;
+    }
+    if (reg < X86_REG_RAX || reg > X86_REG_XMM15) {
+        out += get_x86_reg_str(reg);
+        return;
+    }
+
+    if (names->reg_sym[reg] < 0)
+        names->reg_sym[reg] = names->reg_num++;
+
+    out += fextl::fmt::format("reg{}", names->reg_sym[reg]);
+    if (reg <= X86_REG_R15)
+        out += reg_size_suffix(size);
+}
+
+static void render_operand(fextl::string &out, MinerNames *names, X86Operand *opd, uint32_t size)
+{
+    switch (opd->type) {
+        case X86_OPD_TYPE_REG:
+            render_reg(out, names, opd->content.reg.num, size, opd->content.reg.HighBits);
+            break;
+        case X86_OPD_TYPE_IMM:
+            if (opd->content.imm.isRipLiteral)
+                out += fextl::fmt::format("{}[rip + imm_{}]", mem_size_str(size), names->imm_num++);
+            else
+                out += fextl::fmt::format("$imm_{}", names->imm_num++);
+            break;
+        case X86_OPD_TYPE_MEM: {
+            X86MemOperand *mem = &opd->content.mem;
+            bool has_offset = mem->offset.type == X86_IMM_TYPE_SYM ||
+                              (mem->offset.type == X86_IMM_TYPE_VAL && mem->offset.content.val);
+
+            out += mem_size_str(size);
+            out += '[';
+            if (mem->base != X86_REG_INVALID)
+                render_reg(out, names, mem->base, 0, false);
+            if (mem->index != X86_REG_INVALID) {
+                if (mem->base != X86_REG_INVALID)
+                    out += " + ";
+                render_reg(out, names, mem->index, 0, false);
+                out += fextl::fmt::format(" * imm_{}", names->imm_num++);
+            }
+            if (has_offset) {
+                if (mem->base != X86_REG_INVALID || mem->index != X86_REG_INVALID)
+                    out += " + ";
+                out += fextl::fmt::format("imm_{}", names->imm_num++);
+            }
+            out += ']';
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/* The sequence in rule syntax, registers and immediates named in order of appearance */
+static fextl::string render_sequence(X86Instruction *instrs, int len)
+{
+    MinerNames names;
+    fextl::string out;
+
+    std::fill(std::begin(names.reg_sym), std::end(names.reg_sym), -1);
+    names.reg_num = 0;
+    names.imm_num = 0;
+
+    for (int i = 0; i < len; i++) {
+        X86Instruction *instr = &instrs[i];
+
+        out += "    ";
+        out += get_x86_opc_str(instr->opc);
+        for (int j = 0; j < instr->opd_num; j++) {
+            out += j ? ", " : " ";
+            render_operand(out, &names, &instr->opd[j], j ? instr->SrcSize : instr->DestSize);
+        }
+        out += '\n';
+    }
+
+    return out;
+}
+
+void rule_miner_record(uint64_t entry, const uint64_t *calls, X86Instruction *instrs, int num, const uint8_t *covered)
+{
+    MinerBlock block {};
+    fextl::vector<std::pair<fextl::string, int>> seqs;
+
+    block.calls = calls;
+    block.instr_num = num;
+
+    for (int i = 0; i < num; i++) {
+        if (covered[i])
+            block.covered_num++;
+        else if (instrs[i].opc == X86_OPC_INVALID)
+            block.unknown_num++;
+        else
+            block.uncovered_opc.push_back(instrs[i].opc);
+
+        /* Sequences a rule could be written for, no rule can contain an unknown opcode */
+        for (int len = 1; len <= RULE_MINER_MAX_LEN && i + len <= num; len++) {
+            int last = i + len - 1;
+            if (covered[last] || instrs[last].opc == X86_OPC_INVALID)
+                break;
+            seqs.emplace_back(render_sequence(&instrs[i], len), len);
+        }
+    }
+
+    std::lock_guard lk(miner_lock);
+
+    for (auto &[seq, len] : seqs) {
+        auto [it, inserted] = miner_candidate_ids.try_emplace(seq, miner_candidates.size());
+        if (inserted)
+            miner_candidates.push_back({seq, len});
+        block.candidates.push_back(it->second);
+    }
+
+    /* A block translated again replaces its earlier record, the count is shared */
+    miner_blocks[entry] = std::move(block);
+}
+
+static bool rule_miner_write(const fextl::string &path, const fextl::string &text)
+{
+    int fd = open(path.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1)
+        return false;
+
+    bool written = write(fd, text.data(), text.size()) == (ssize_t)text.size();
+    close(fd);
+    return written;
+}
+
+static double percent(uint64_t part, uint64_t total)
+{
+    return total ? 100.0 * part / total : 0.0;
+}
+
+bool rule_miner_report(void)
+{
+    std::lock_guard lk(miner_lock);
+
+    if (miner_blocks.empty())
+        return false;
+
+    const auto Dir = FEXCore::Config::GetDataDirectory() + "rulemining/";
+    if (!FHU::Filesystem::CreateDirectories(Dir)) {
+        LogMan::Msg::IFmt("RuleMining: Couldn't create rulemining folder");
+        return false;
+    }
+
+    fextl::vector<uint64_t> weight(miner_candidates.size());
+    fextl::vector<uint32_t> block_num(miner_candidates.size());
+    fextl::vector<uint64_t> opc_count(X86_OPC_END);
+    uint64_t exec_blocks = 0, total = 0, covered = 0, unknown = 0;
+
+    for (auto &[entry, block] : miner_blocks) {
+        uint64_t calls = *block.calls;
+        if (!calls)
+            continue;
+
+        exec_blocks++;
+        total += calls * block.instr_num;
+        covered += calls * block.covered_num;
+        unknown += calls * block.unknown_num;
+
+        /* Executed guest instructions a rule for the sequence would cover */
+        for (uint32_t id : block.candidates) {
+            weight[id] += calls * miner_candidates[id].len;
+            block_num[id]++;
+        }
+        for (uint16_t opc : block.uncovered_opc)
+            opc_count[opc] += calls;
+    }
+
+    fextl::vector<uint32_t> order;
+    for (uint32_t id = 0; id < miner_candidates.size(); id++) {
+        if (weight[id])
+            order.push_back(id);
+    }
+    std::sort(order.begin(), order.end(), [&weight](uint32_t a, uint32_t b) { return weight[a] > weight[b]; });
+    if (order.size() > RULE_MINER_REPORT_MAX)
+        order.resize(RULE_MINER_REPORT_MAX);
+
+    fextl::string candidates = "# Guest sequences no rule covers, by executed guest instructions a rule for them would cover\n\n";
+    for (size_t i = 0; i < order.size(); i++) {
+        uint32_t id = order[i];
+        candidates += fextl::fmt::format("# Candidate {}: {} instructions ({:.2f}%), {} blocks\n{}.Guest:\n{}\n",
+                                         i + 1, weight[id], percent(weight[id], total), block_num[id], i + 1,
+                                         miner_candidates[id].seq);
+    }
+
+    fextl::string coverage = fextl::fmt::format(
+        "Executed blocks: {}\n"
+        "Executed guest instructions: {}\n"
+        "Covered by rules: {} ({:.2f}%)\n"
+        "Not covered: {} ({:.2f}%)\n"
+        "  without an opcode in the rule language: {} ({:.2f}%)\n\n"
+        "# Not covered instructions by opcode\n",
+        exec_blocks, total, covered, percent(covered, total), total - covered, percent(total - covered, total),
+        unknown, percent(unknown, total));
+
+    fextl::vector<uint16_t> opcs;
+    for (uint16_t opc = 0; opc < X86_OPC_END; opc++) {
+        if (opc_count[opc])
+            opcs.push_back(opc);
+    }
+    std::sort(opcs.begin(), opcs.end(), [&opc_count](uint16_t a, uint16_t b) { return opc_count[a] > opc_count[b]; });
+    for (uint16_t opc : opcs)
+        coverage += fextl::fmt::format("{} {} ({:.2f}%)\n", get_x86_opc_str((X86Opcode)opc), opc_count[opc],
+                                       percent(opc_count[opc], total));
+
+    // Every process of the guest writes its own reports
+    const auto CandidatesPath = fextl::fmt::format("{}candidates.{}.txt", Dir, ::getpid());
+    const auto CoveragePath = fextl::fmt::format("{}coverage.{}.txt", Dir, ::getpid());
+    if (!rule_miner_write(CandidatesPath, candidates) || !rule_miner_write(CoveragePath, coverage)) {
+        LogMan::Msg::IFmt("RuleMining: Failed to write the reports to {}", Dir);
+        return false;
+    }
+
+    LogMan::Msg::IFmt("RuleMining: {:.2f}% of {} executed guest instructions covered by rules, candidates in {}",
+                      percent(covered, total), total, CandidatesPath);
+    return true;
+}
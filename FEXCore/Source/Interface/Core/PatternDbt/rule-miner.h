@@ -0,0 +1,27 @@
+#ifndef RULE_MINER_H
+#define RULE_MINER_H
+
+#include "x86-instr.h"
+
+/* Mining of rule candidates from the running guest.
+
+   With RuleMining enabled every translated block is recorded with the guest
+   sequences of up to RULE_MINER_MAX_LEN instructions that no rule covers,
+   and the JIT counts how often each block runs. At exit the sequences are
+   ranked by the executed guest instructions a rule for them would cover.
+   They are written in the guest syntax of the rule file with registers and
+   immediates renamed to symbols, so sequences that only differ in registers
+   or constants add up, and a candidate only needs its host code to become a
+   rule. A coverage report next to it tells which share of the executed guest
+   instructions the rules covered. */
+
+#define RULE_MINER_MAX_LEN 4
+#define RULE_MINER_REPORT_MAX 1000
+
+/* covered[i] is set if a rule translates instrs[i], calls counts the executions of the block */
+void rule_miner_record(uint64_t entry, const uint64_t *calls, X86Instruction *instrs, int num, const uint8_t *covered);
+
+/* Write both reports to the rulemining folder of the data directory */
+bool rule_miner_report(void);
+
+#endif
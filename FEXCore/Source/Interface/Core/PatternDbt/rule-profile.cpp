@@ -0,0 +1,213 @@
+#include "Interface/IR/AOTIR.h"
+
+#include <FEXCore/Config/Config.h>
+#include <FEXCore/Utils/LogManager.h>
+#include <FEXCore/fextl/fmt.h>
+#include <FEXCore/fextl/vector.h>
+#include <FEXHeaderUtils/Filesystem.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fcntl.h>
+#include <mutex>
+#include <unistd.h>
+
+#include "rule-index.h"
+#include "rule-profile.h"
+
+#define RULE_PROFILE_VERSION 1
+
+static constexpr uint64_t RULE_PROFILE_COOKIE = FEXCore::IR::COOKIE_VERSION("FEXP", RULE_PROFILE_VERSION);
+
+typedef struct {
+    std::atomic<uint32_t> attempts;
+    std::atomic<uint32_t> matches;
+} RuleProfileCounter;
+
+/* File layout: the header followed by rule_num entries in rule_buf order */
+typedef struct {
+    uint64_t cookie;
+    uint64_t rule_set_id;   /* RuleSet::id of the rules the entries refer to */
+    uint64_t rule_num;
+} RuleProfileHeader;
+
+typedef struct {
+    uint32_t attempts;
+    uint32_t matches;
+} RuleProfileEntry;
+
+static RuleSet *profile_set;
+static TranslationRule *profile_rules;
+static uint64_t profile_rule_set_id;
+static fextl::vector<RuleProfileCounter> profile_counters;
+static std::atomic<uint64_t> profile_attempts;
+static std::atomic<uint64_t> profile_matches;
+
+/* Counts the rules are ordered by, only used while holding profile_reorder_lock */
+static std::mutex profile_reorder_lock;
+static fextl::vector<RuleProfileEntry> profile_snapshot;
+
+static fextl::string rule_profile_path(void)
+{
+    return FEXCore::Config::GetDataDirectory() + "rulecache/rules.profile";
+}
+
+static ssize_t rule_profile_index(TranslationRule *rule)
+{
+    if (!profile_rules || rule < profile_rules || rule >= profile_rules + profile_counters.size())
+        return -1;
+
+    return rule - profile_rules;
+}
+
+void rule_profile_init(RuleSet *set)
+{
+    profile_set = set;
+    profile_rules = set->rules;
+    profile_rule_set_id = set->id;
+    profile_counters = fextl::vector<RuleProfileCounter>(set->rules ? set->rule_num : 0);
+    profile_attempts = 0;
+    profile_matches = 0;
+}
+
+void rule_profile_attempt(TranslationRule *rule, bool matched)
+{
+    ssize_t idx = rule_profile_index(rule);
+
+    if (idx < 0)
+        return;
+
+    profile_counters[idx].attempts.fetch_add(1, std::memory_order_relaxed);
+    if (matched) {
+        profile_counters[idx].matches.fetch_add(1, std::memory_order_relaxed);
+        profile_matches.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if ((profile_attempts.fetch_add(1, std::memory_order_relaxed) + 1) % RULE_PROFILE_PERIOD == 0)
+        rule_profile_reorder();
+}
+
+/* Order by (matches + 1) / (attempts + 2), a rule never tried starts at one half */
+static bool rule_profile_before(TranslationRule *a, TranslationRule *b)
+{
+    ssize_t ia = rule_profile_index(a);
+    ssize_t ib = rule_profile_index(b);
+    RuleProfileEntry pa = ia < 0 ? RuleProfileEntry{} : profile_snapshot[ia];
+    RuleProfileEntry pb = ib < 0 ? RuleProfileEntry{} : profile_snapshot[ib];
+
+    return (uint64_t)(pa.matches + 1) * (pb.attempts + 2) > (uint64_t)(pb.matches + 1) * (pa.attempts + 2);
+}
+
+void rule_profile_reorder(void)
+{
+    std::unique_lock lk(profile_reorder_lock, std::try_to_lock);
+
+    /* Another thread is already reordering */
+    if (!lk.owns_lock())
+        return;
+
+    profile_snapshot.resize(profile_counters.size());
+    for (size_t i = 0; i < profile_counters.size(); i++) {
+        RuleProfileCounter *c = &profile_counters[i];
+        uint32_t attempts = c->attempts.load(std::memory_order_relaxed);
+        uint32_t matches = c->matches.load(std::memory_order_relaxed);
+
+        /* Increments racing with the halving are lost, the counts only steer the order */
+        if (attempts > RULE_PROFILE_AGE_LIMIT) {
+            attempts /= 2;
+            matches /= 2;
+            c->attempts.store(attempts, std::memory_order_relaxed);
+            c->matches.store(matches, std::memory_order_relaxed);
+        }
+
+        profile_snapshot[i] = {attempts, std::min(matches, attempts)};
+    }
+
+    rule_index_sort(profile_set, rule_profile_before);
+}
+
+bool rule_profile_load(void)
+{
+    FEX_CONFIG_OPT(RuleProfile, RULEPROFILE);
+    RuleProfileHeader hdr;
+
+    if (!RuleProfile() || profile_counters.empty())
+        return false;
+
+    const auto Path = rule_profile_path();
+    int fd = open(Path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return false;
+
+    fextl::vector<RuleProfileEntry> entries(profile_counters.size());
+    const ssize_t size = entries.size() * sizeof(RuleProfileEntry);
+    bool ok = read(fd, &hdr, sizeof(hdr)) == sizeof(hdr) && hdr.cookie == RULE_PROFILE_COOKIE &&
+              hdr.rule_set_id == profile_rule_set_id && hdr.rule_num == entries.size() &&
+              read(fd, entries.data(), size) == size;
+    close(fd);
+
+    /* Entries refer to rules by position, they are useless with any other rule set */
+    if (!ok) {
+        LogMan::Msg::IFmt("RuleProfile: Ignoring stale {}", Path);
+        return false;
+    }
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        profile_counters[i].attempts = entries[i].attempts;
+        profile_counters[i].matches = std::min(entries[i].matches, entries[i].attempts);
+    }
+
+    rule_profile_reorder();
+
+    LogMan::Msg::IFmt("RuleProfile: Rules ordered by the profile in {}", Path);
+    return true;
+}
+
+bool rule_profile_save(void)
+{
+    FEX_CONFIG_OPT(RuleProfile, RULEPROFILE);
+
+    if (!RuleProfile() || profile_counters.empty() || !profile_attempts)
+        return false;
+
+    if (!FHU::Filesystem::CreateDirectories(FEXCore::Config::GetDataDirectory() + "rulecache")) {
+        LogMan::Msg::IFmt("RuleProfile: Couldn't create rulecache folder");
+        return false;
+    }
+
+    RuleProfileHeader hdr {
+        .cookie = RULE_PROFILE_COOKIE,
+        .rule_set_id = profile_rule_set_id,
+        .rule_num = profile_counters.size(),
+    };
+
+    fextl::vector<RuleProfileEntry> entries(profile_counters.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        entries[i].attempts = profile_counters[i].attempts.load(std::memory_order_relaxed);
+        entries[i].matches = profile_counters[i].matches.load(std::memory_order_relaxed);
+    }
+
+    // Forked children write the same file, give each its own temporary file
+    const auto Path = rule_profile_path();
+    const auto TmpPath = fextl::fmt::format("{}.{}.tmp", Path, ::getpid());
+
+    int fd = open(TmpPath.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        LogMan::Msg::IFmt("RuleProfile: Failed to store {}", Path);
+        return false;
+    }
+
+    const ssize_t size = entries.size() * sizeof(RuleProfileEntry);
+    bool written = write(fd, &hdr, sizeof(hdr)) == sizeof(hdr) && write(fd, entries.data(), size) == size;
+    close(fd);
+
+    // Rename the temporary file to atomically update the profile
+    if (!written || FHU::Filesystem::RenameFile(TmpPath, Path)) {
+        LogMan::Msg::IFmt("RuleProfile: Failed to store {}", Path);
+        unlink(TmpPath.c_str());
+        return false;
+    }
+
+    LogMan::Msg::DFmt("RuleProfile: {} rule attempts for {} matches", profile_attempts.load(), profile_matches.load());
+    return true;
+}
@@ -0,0 +1,35 @@
+#ifndef RULE_PROFILE_H
+#define RULE_PROFILE_H
+
+#include "parse.h"
+
+/* Runtime profile of rule matching.
+
+   Each time the matcher tries a rule on a guest sequence, the attempt and
+   its outcome are counted for that rule. Every RULE_PROFILE_PERIOD attempts
+   the rules sharing a trie node are reordered by match rate, so the rules
+   that match the running code are tried first and fewer candidates fail
+   before one matches. Counts are halved once they grow past
+   RULE_PROFILE_AGE_LIMIT, recent matches weigh more than old ones.
+
+   With RuleProfile enabled the counts are kept in the data directory and
+   loaded by the next run of the same rule set, so every installation
+   converges on its own hot rules. */
+
+#define RULE_PROFILE_PERIOD 4096
+#define RULE_PROFILE_AGE_LIMIT (1 << 16)
+
+/* Counts for the rules of set, all zero. The set is reordered by the counts */
+void rule_profile_init(RuleSet *set);
+
+void rule_profile_attempt(TranslationRule *rule, bool matched);
+
+/* Reorder the candidates of every trie node by the counts so far */
+void rule_profile_reorder(void);
+
+/* Load the counts of an earlier run, or write the current ones.
+   Both do nothing unless RuleProfile is enabled. */
+bool rule_profile_load(void);
+bool rule_profile_save(void);
+
+#endif
@@ -0,0 +1,170 @@
+#include <FEXCore/Utils/File.h>
+#include <FEXCore/Utils/LogManager.h>
+#include <FEXCore/fextl/fmt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <unistd.h>
+
+#include "parse.h"
+#include "rule-stats.h"
+
+/* How often the dumper thread looks for a request, a signal handler can't wake it */
+#define RULE_STATS_POLL_PERIOD std::chrono::milliseconds(100)
+
+static void rule_stats_sum(RuleStatsTotal *total, RuleStats *stats)
+{
+    total->matched_instrs += stats->matched_instrs.load(std::memory_order_relaxed);
+    total->matched_rules += stats->matched_rules.load(std::memory_order_relaxed);
+    total->translated_rules += stats->translated_rules.load(std::memory_order_relaxed);
+    total->blocks_attempted += stats->blocks_attempted.load(std::memory_order_relaxed);
+    total->blocks_rule_only += stats->blocks_rule_only.load(std::memory_order_relaxed);
+    total->blocks_mixed += stats->blocks_mixed.load(std::memory_order_relaxed);
+    total->match_ns += stats->match_ns.load(std::memory_order_relaxed);
+    total->rule_host_bytes += stats->rule_host_bytes.load(std::memory_order_relaxed);
+    total->ir_blocks += stats->ir_blocks.load(std::memory_order_relaxed);
+    total->ir_guest_instrs += stats->ir_guest_instrs.load(std::memory_order_relaxed);
+    total->ir_host_bytes += stats->ir_host_bytes.load(std::memory_order_relaxed);
+}
+
+namespace FEXCore::CPU {
+  void RuleStatsRegistry::Register(RuleStats *Stats) {
+    std::lock_guard lk(Lock);
+    Live.push_back(Stats);
+  }
+
+  void RuleStatsRegistry::Unregister(RuleStats *Stats) {
+    std::lock_guard lk(Lock);
+    auto it = std::find(Live.begin(), Live.end(), Stats);
+    if (it == Live.end()) {
+      return;
+    }
+
+    rule_stats_sum(&Retired, Stats);
+    Live.erase(it);
+  }
+
+  RuleStatsTotal RuleStatsRegistry::Collect() {
+    std::lock_guard lk(Lock);
+    RuleStatsTotal Total = Retired;
+
+    for (auto Stats : Live) {
+      rule_stats_sum(&Total, Stats);
+    }
+    return Total;
+  }
+
+  void RuleStatsRegistry::SetRules(const RuleSet *Set) {
+    Rules = Set;
+    Counters = fextl::vector<RuleCounter>(Set && Set->rules ? Set->rule_num : 0);
+  }
+
+  ssize_t RuleStatsRegistry::RuleIndex(const TranslationRule *Rule) const {
+    if (Counters.empty() || Rule < Rules->rules || Rule >= Rules->rules + Rules->rule_num) {
+      return -1;
+    }
+    return Rule - Rules->rules;
+  }
+
+  bool RuleStatsRegistry::Dump(const fextl::string &Path) {
+    const auto Total = Collect();
+    const auto IRBytesPerInstr = Total.ir_guest_instrs ? double(Total.ir_host_bytes) / double(Total.ir_guest_instrs) : 0.0;
+
+    fextl::string Out = fextl::fmt::format(
+      "{{\n"
+      "  \"rule_set_id\": {},\n"
+      "  \"blocks_attempted\": {},\n"
+      "  \"blocks_rule_only\": {},\n"
+      "  \"blocks_mixed\": {},\n"
+      "  \"blocks_ir\": {},\n"
+      "  \"matched_rules\": {},\n"
+      "  \"matched_guest_instrs\": {},\n"
+      "  \"translated_rules\": {},\n"
+      "  \"match_ns\": {},\n"
+      "  \"rule_host_bytes\": {},\n"
+      "  \"ir_guest_instrs\": {},\n"
+      "  \"ir_host_bytes\": {},\n"
+      "  \"ir_bytes_per_guest_instr\": {:.2f},\n"
+      "  \"rules\": [",
+      Rules ? Rules->id : 0, Total.blocks_attempted, Total.blocks_rule_only, Total.blocks_mixed, Total.ir_blocks,
+      Total.matched_rules, Total.matched_instrs, Total.translated_rules, Total.match_ns, Total.rule_host_bytes,
+      Total.ir_guest_instrs, Total.ir_host_bytes, IRBytesPerInstr);
+
+    // Only the rules that were used, ir_bytes is what the IR would take for the same guest instructions
+    bool First = true;
+    for (size_t i = 0; i < Counters.size(); i++) {
+      const auto Hits = Counters[i].hits.load(std::memory_order_relaxed);
+      if (!Hits) {
+        continue;
+      }
+
+      const auto GuestInstrs = Hits * Rules->rules[i].guest_instr_num;
+      Out += fextl::fmt::format("{}\n    {{\"index\": {}, \"hits\": {}, \"guest_instrs\": {}, \"host_bytes\": {}, \"ir_bytes\": {:.0f}}}",
+                                First ? "" : ",", Rules->rules[i].index, Hits, GuestInstrs,
+                                Counters[i].host_bytes.load(std::memory_order_relaxed), double(GuestInstrs) * IRBytesPerInstr);
+      First = false;
+    }
+    Out += "\n  ]\n}\n";
+
+    // Every process of the guest writes its own dump
+    const auto FilePath = fextl::fmt::format("{}.{}", Path, ::getpid());
+    auto File = FEXCore::File::File(FilePath.c_str(),
+      FEXCore::File::FileModes::WRITE |
+      FEXCore::File::FileModes::CREATE |
+      FEXCore::File::FileModes::TRUNCATE);
+
+    if (!File.IsValid() || File.Write(Out.data(), Out.size()) != (ssize_t)Out.size()) {
+      LogMan::Msg::IFmt("RuleStats: Couldn't write {}", FilePath);
+      return false;
+    }
+    return true;
+  }
+
+  void *RuleStatsRegistry::DumperThread(void *Arg) {
+    auto This = static_cast<RuleStatsRegistry*>(Arg);
+    FEXCore::Threads::SetThreadName("RuleStats\0");
+
+    while (!This->DumperStopping.load()) {
+      This->DumperWakeup.WaitFor(RULE_STATS_POLL_PERIOD);
+      if (This->DumpRequested.exchange(false, std::memory_order_relaxed)) {
+        This->Dump(This->DumpPath);
+      }
+    }
+    return nullptr;
+  }
+
+  void RuleStatsRegistry::StartDumper(const fextl::string &Path) {
+    if (Path.empty() || Dumper) {
+      return;
+    }
+
+    DumpPath = Path;
+    DumperPid = ::getpid();
+
+    // The request comes from a signal handler, the dumper itself must not take signals
+    uint64_t OldMask = FEXCore::Threads::SetSignalMask(~0ULL);
+    Dumper = FEXCore::Threads::Thread::Create(DumperThread, this);
+    FEXCore::Threads::SetSignalMask(OldMask);
+  }
+
+  void RuleStatsRegistry::StopDumper() {
+    if (DumpPath.empty()) {
+      return;
+    }
+
+    // A forked child has the object but not the thread
+    if (Dumper && DumperPid != ::getpid()) {
+      (void)Dumper.release();
+    }
+    else if (Dumper) {
+      DumperStopping = true;
+      DumperWakeup.NotifyAll();
+      if (Dumper->joinable()) {
+        Dumper->join(nullptr);
+      }
+      Dumper.reset();
+    }
+
+    Dump(DumpPath);
+  }
+}
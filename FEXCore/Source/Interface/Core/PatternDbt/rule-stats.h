@@ -0,0 +1,149 @@
+#ifndef RULE_STATS_H
+#define RULE_STATS_H
+
+#include <FEXCore/Utils/Event.h>
+#include <FEXCore/Utils/Threads.h>
+#include <FEXCore/fextl/memory.h>
+#include <FEXCore/fextl/string.h>
+#include <FEXCore/fextl/vector.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <sys/types.h>
+
+struct RuleSet;
+struct TranslationRule;
+
+/* Rule matching statistics.
+
+   Every JIT thread counts into its own RuleStats, only the owning thread
+   writes them so counting needs no atomic read-modify-write. The context
+   keeps the stats of every live thread and the sum of the threads that are
+   gone, and adds them up when asked.
+
+   Compiled blocks are split three ways: assembled from rules alone, IR with
+   rule translated instructions, and IR alone. The bytes per guest
+   instruction of the IR alone blocks are what the rule translated
+   instructions are compared against, the same guest code is never compiled
+   both ways. */
+
+typedef struct RuleStats {
+    std::atomic<uint64_t> matched_instrs;   /* guest instructions covered by matched rules */
+    std::atomic<uint64_t> matched_rules;    /* rule instances matched */
+    std::atomic<uint64_t> translated_rules; /* rule instances assembled */
+
+    std::atomic<uint64_t> blocks_attempted; /* blocks matched against the rules, or restored from the rule cache */
+    std::atomic<uint64_t> blocks_rule_only; /* blocks assembled from rules without IR */
+    std::atomic<uint64_t> blocks_mixed;     /* IR blocks with rule translated instructions */
+    std::atomic<uint64_t> match_ns;         /* time spent matching */
+    std::atomic<uint64_t> rule_host_bytes;  /* host code assembled from rules */
+
+    std::atomic<uint64_t> ir_blocks;        /* blocks without any rule */
+    std::atomic<uint64_t> ir_guest_instrs;
+    std::atomic<uint64_t> ir_host_bytes;    /* host code of the block body, without the block header and tail */
+} RuleStats;
+
+typedef struct {
+    uint64_t matched_instrs;
+    uint64_t matched_rules;
+    uint64_t translated_rules;
+
+    uint64_t blocks_attempted;
+    uint64_t blocks_rule_only;
+    uint64_t blocks_mixed;
+    uint64_t match_ns;
+    uint64_t rule_host_bytes;
+
+    uint64_t ir_blocks;
+    uint64_t ir_guest_instrs;
+    uint64_t ir_host_bytes;
+} RuleStatsTotal;
+
+/* Counts of one rule, shared by the threads */
+typedef struct {
+    std::atomic<uint64_t> hits;             /* instances assembled */
+    std::atomic<uint64_t> host_bytes;
+} RuleCounter;
+
+/* Only for the thread owning c */
+static inline void rule_stats_add(std::atomic<uint64_t> &c, uint64_t n)
+{
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+namespace FEXCore::CPU {
+  class RuleStatsRegistry final {
+    public:
+      void Register(RuleStats *Stats);
+
+      /**
+       * @brief Stops collecting from Stats, its counts are kept in the total
+       */
+      void Unregister(RuleStats *Stats);
+
+      /**
+       * @brief Sum of every thread so far, live or gone
+       */
+      RuleStatsTotal Collect();
+
+      /**
+       * @brief Sets up the per rule counters of Rules, before any guest code is translated
+       */
+      void SetRules(const RuleSet *Rules);
+
+      /**
+       * @brief Counts an assembled instance of Rule and its host code
+       */
+      void CountRule(const TranslationRule *Rule, uint32_t HostBytes) {
+        const auto Index = RuleIndex(Rule);
+        if (Index < 0) {
+          return;
+        }
+        Counters[Index].hits.fetch_add(1, std::memory_order_relaxed);
+        Counters[Index].host_bytes.fetch_add(HostBytes, std::memory_order_relaxed);
+      }
+
+      /**
+       * @brief Writes the totals and the per rule counts to Path as JSON
+       */
+      bool Dump(const fextl::string &Path);
+
+      /**
+       * @brief Starts a thread that writes the dump to Path whenever one is requested
+       */
+      void StartDumper(const fextl::string &Path);
+
+      /**
+       * @brief Asks the dumper thread for a dump, safe to call from a signal handler
+       */
+      void RequestDump() {
+        DumpRequested.store(true, std::memory_order_relaxed);
+      }
+
+      /**
+       * @brief Stops the dumper thread and writes the final dump
+       */
+      void StopDumper();
+
+    private:
+      ssize_t RuleIndex(const TranslationRule *Rule) const;
+      static void *DumperThread(void *Arg);
+
+      std::mutex Lock;
+      fextl::vector<RuleStats *> Live;
+      RuleStatsTotal Retired{};
+
+      const RuleSet *Rules{};
+      fextl::vector<RuleCounter> Counters;
+
+      fextl::string DumpPath;
+      fextl::unique_ptr<FEXCore::Threads::Thread> Dumper;
+      pid_t DumperPid{};
+      std::atomic<bool> DumpRequested{};
+      std::atomic<bool> DumperStopping{};
+      Event DumperWakeup;
+  };
+}
+
+#endif
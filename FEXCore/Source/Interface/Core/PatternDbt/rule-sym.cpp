@@ -0,0 +1,48 @@
+#include <FEXCore/Utils/LogManager.h>
+#include <FEXCore/fextl/string.h>
+#include <FEXCore/fextl/unordered_map.h>
+
+#include <string_view>
+
+#include "rule-sym.h"
+
+static fextl::unordered_map<fextl::string, uint16_t> rule_syms;
+
+void rule_sym_init(void)
+{
+    rule_syms.clear();
+}
+
+uint16_t rule_sym_intern(const char *sym)
+{
+    auto it = rule_syms.find(sym);
+    if (it != rule_syms.end())
+        return it->second;
+
+    if (rule_syms.size() >= RULE_SYM_MAX) {
+        LogMan::Msg::EFmt("Too many rule symbols, rules using {} never match.", sym);
+        return RULE_SYM_NONE;
+    }
+
+    uint16_t id = rule_syms.size();
+    rule_syms.emplace(sym, id);
+    return id;
+}
+
+void rule_sym_define(const char *sym, uint16_t id)
+{
+    if (id < RULE_SYM_MAX)
+        rule_syms.emplace(sym, id);
+}
+
+uint16_t rule_sym_find(const char *sym, size_t len)
+{
+    auto it = rule_syms.find(fextl::string(std::string_view(sym, len)));
+
+    return it == rule_syms.end() ? RULE_SYM_NONE : it->second;
+}
+
+uint32_t rule_sym_num(void)
+{
+    return rule_syms.size();
+}
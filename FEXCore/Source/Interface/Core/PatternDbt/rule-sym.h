@@ -0,0 +1,32 @@
+#ifndef RULE_SYM_H
+#define RULE_SYM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Interned rule symbols.
+
+   Immediates and labels of rules are named by symbols such as imm_0 or L1.
+   Every distinct symbol text gets a small id when the rules are parsed, the
+   matcher binds and looks up symbols by id instead of comparing strings.
+   Host operands that are expressions over symbols get an id of their own
+   that is never bound, they are evaluated from their text. */
+
+#define RULE_SYM_MAX 256
+#define RULE_SYM_NONE 0xffff
+
+/* Forget every symbol, before parsing rule text */
+void rule_sym_init(void);
+
+/* Id of sym, RULE_SYM_NONE once the table is full */
+uint16_t rule_sym_intern(const char *sym);
+
+/* Enter the symbol of a rule that was interned by an earlier parse */
+void rule_sym_define(const char *sym, uint16_t id);
+
+/* Id of the first len characters of sym, RULE_SYM_NONE if unknown */
+uint16_t rule_sym_find(const char *sym, size_t len);
+
+uint32_t rule_sym_num(void);
+
+#endif
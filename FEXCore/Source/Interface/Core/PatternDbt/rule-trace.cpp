@@ -0,0 +1,180 @@
+#include <FEXCore/Utils/Event.h>
+#include <FEXCore/Utils/LogManager.h>
+#include <FEXCore/Utils/Threads.h>
+#include <FEXCore/fextl/fmt.h>
+#include <FEXCore/fextl/memory.h>
+#include <FEXCore/fextl/vector.h>
+#include <FEXHeaderUtils/Syscalls.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "rule-trace.h"
+
+#ifdef ENABLE_RULE_TRACE
+/* Drain at least this often, and as soon as half of the ring is written */
+#define RULE_TRACE_DRAIN_PERIOD std::chrono::milliseconds(50)
+
+/* A writer stores 2n + 1 to the sequence of its slot before it writes
+   record n and 2n + 2 after, so the drain thread can tell a record that is
+   complete from one being written or overrun by a later one */
+static RuleTraceRecord trace_ring[RULE_TRACE_LEN];
+static std::atomic<uint64_t> trace_seq[RULE_TRACE_LEN];
+static std::atomic<uint64_t> trace_head;
+
+/* Only the drain thread, or rule_trace_stop once it is gone */
+static uint64_t trace_tail;
+static uint64_t trace_drained;
+static uint64_t trace_lost;
+
+static int trace_fd = -1;
+static pid_t trace_pid;
+static fextl::unique_ptr<FEXCore::Threads::Thread> trace_thread;
+static std::atomic<bool> trace_stopping;
+static Event trace_wakeup;
+
+std::atomic<bool> rule_trace_on;
+
+void rule_trace_add(RuleTraceEvent event, uint64_t pc, uint32_t rule_index, uint32_t host_bytes)
+{
+    static thread_local uint32_t tid = FHU::Syscalls::gettid();
+
+    uint64_t n = trace_head.fetch_add(1, std::memory_order_relaxed);
+    uint32_t slot = n % RULE_TRACE_LEN;
+    RuleTraceRecord *r = &trace_ring[slot];
+
+    trace_seq[slot].store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    r->guest_pc = pc;
+    r->rule_index = rule_index;
+    r->host_bytes = host_bytes;
+    r->tid = tid;
+    r->event = event;
+    r->reserved = 0;
+
+    trace_seq[slot].store(2 * n + 2, std::memory_order_release);
+
+    if (slot % (RULE_TRACE_LEN / 2) == 0)
+        trace_wakeup.NotifyOne();
+}
+
+/* Write out the complete records. Unless final, stop at the first one still
+   being written, it is picked up by the next round */
+static void rule_trace_drain(bool final)
+{
+    fextl::vector<RuleTraceRecord> out;
+    uint64_t head = trace_head.load(std::memory_order_acquire);
+
+    if (head - trace_tail > RULE_TRACE_LEN) {
+        trace_lost += head - trace_tail - RULE_TRACE_LEN;
+        trace_tail = head - RULE_TRACE_LEN;
+    }
+
+    out.reserve(head - trace_tail);
+    for (; trace_tail < head; trace_tail++) {
+        uint32_t slot = trace_tail % RULE_TRACE_LEN;
+        uint64_t seq = trace_seq[slot].load(std::memory_order_acquire);
+
+        if (seq < 2 * trace_tail + 2 && !final)
+            break;
+        if (seq != 2 * trace_tail + 2) {
+            trace_lost++;
+            continue;
+        }
+
+        RuleTraceRecord r = trace_ring[slot];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (trace_seq[slot].load(std::memory_order_relaxed) != seq) {
+            trace_lost++;
+            continue;
+        }
+        out.push_back(r);
+    }
+
+    size_t size = out.size() * sizeof(RuleTraceRecord);
+    if (size && write(trace_fd, out.data(), size) != (ssize_t)size) {
+        trace_lost += out.size();
+        return;
+    }
+    trace_drained += out.size();
+}
+
+static void *rule_trace_thread(void *)
+{
+    FEXCore::Threads::SetThreadName("RuleTrace\0");
+
+    while (!trace_stopping.load()) {
+        trace_wakeup.WaitFor(RULE_TRACE_DRAIN_PERIOD);
+        rule_trace_drain(false);
+    }
+    return nullptr;
+}
+
+bool rule_trace_start(const char *path)
+{
+    if (!path || !*path || trace_fd != -1)
+        return false;
+
+    // Every process of the guest writes its own trace
+    const auto Path = fextl::fmt::format("{}.{}", path, ::getpid());
+    trace_fd = open(Path.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0644);
+    if (trace_fd == -1) {
+        LogMan::Msg::IFmt("RuleTrace: Couldn't open {}", Path);
+        return false;
+    }
+
+    RuleTraceHeader hdr {};
+    memcpy(hdr.magic, "FEXRTRC", 8);
+    hdr.version = RULE_TRACE_VERSION;
+    hdr.record_size = sizeof(RuleTraceRecord);
+    if (write(trace_fd, &hdr, sizeof(hdr)) != sizeof(hdr)) {
+        close(trace_fd);
+        trace_fd = -1;
+        return false;
+    }
+
+    trace_pid = ::getpid();
+    uint64_t OldMask = FEXCore::Threads::SetSignalMask(~0ULL);
+    trace_thread = FEXCore::Threads::Thread::Create(rule_trace_thread, nullptr);
+    FEXCore::Threads::SetSignalMask(OldMask);
+
+    rule_trace_on = true;
+    return true;
+}
+
+void rule_trace_stop(void)
+{
+    // A forked child has the file but not the thread, the parent closes it
+    if (trace_fd == -1 || trace_pid != ::getpid())
+        return;
+
+    rule_trace_on = false;
+
+    trace_stopping = true;
+    trace_wakeup.NotifyAll();
+    if (trace_thread->joinable())
+        trace_thread->join(nullptr);
+    trace_thread.reset();
+
+    rule_trace_drain(true);
+    close(trace_fd);
+    trace_fd = -1;
+
+    LogMan::Msg::IFmt("RuleTrace: {} records written, {} lost", trace_drained, trace_lost);
+}
+#else
+bool rule_trace_start(const char *path)
+{
+    if (path && *path)
+        LogMan::Msg::IFmt("RuleTrace: Not compiled in, build with ENABLE_RULE_TRACE");
+    return false;
+}
+
+void rule_trace_stop(void)
+{
+}
+#endif
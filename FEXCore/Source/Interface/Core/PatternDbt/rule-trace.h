@@ -0,0 +1,64 @@
+#ifndef RULE_TRACE_H
+#define RULE_TRACE_H
+
+#include <atomic>
+#include <cstdint>
+
+/* Binary trace of the rule matcher and assembler.
+
+   Instead of a log line per block, rule and host instruction, the JIT puts
+   a fixed size record into a ring buffer for every event, and a background
+   thread drains the ring into the file named by RuleTrace, with the pid
+   appended. A record that the writers overrun before it is drained is lost
+   and counted. The trace is compiled in with ENABLE_RULE_TRACE, and without
+   RuleTrace set every event costs a load and a branch that isn't taken.
+   Scripts/rule_trace.py prints a trace file. */
+
+#define RULE_TRACE_LEN (1 << 16)
+#define RULE_TRACE_VERSION 1
+
+typedef enum {
+    RULE_TRACE_BLOCK,       /* matching of a block starts */
+    RULE_TRACE_MISS,        /* a candidate rule failed to match */
+    RULE_TRACE_MATCH,       /* a rule matched */
+    RULE_TRACE_EMIT,        /* a rule was assembled into host_bytes of host code */
+    RULE_TRACE_UNSUPPORTED, /* the assembler has no encoding for a host instruction of the rule */
+} RuleTraceEvent;
+
+/* File layout: the header followed by records in the order they were drained */
+typedef struct {
+    char magic[8];          /* "FEXRTRC" */
+    uint32_t version;
+    uint32_t record_size;
+} RuleTraceHeader;
+
+typedef struct {
+    uint64_t guest_pc;
+    uint32_t rule_index;    /* TranslationRule::index, 0 for RULE_TRACE_BLOCK */
+    uint32_t host_bytes;
+    uint32_t tid;
+    uint16_t event;
+    uint16_t reserved;
+} RuleTraceRecord;
+
+#ifdef ENABLE_RULE_TRACE
+extern std::atomic<bool> rule_trace_on;
+
+void rule_trace_add(RuleTraceEvent event, uint64_t pc, uint32_t rule_index, uint32_t host_bytes);
+
+static inline void rule_trace(RuleTraceEvent event, uint64_t pc, uint32_t rule_index, uint32_t host_bytes = 0)
+{
+    if (rule_trace_on.load(std::memory_order_relaxed)) [[unlikely]]
+        rule_trace_add(event, pc, rule_index, host_bytes);
+}
+#else
+static inline void rule_trace(RuleTraceEvent, uint64_t, uint32_t, uint32_t = 0) {}
+#endif
+
+/* Open the trace file and start the drain thread, nothing if path is empty */
+bool rule_trace_start(const char *path);
+
+/* Drain what is left and close the file */
+void rule_trace_stop(void);
+
+#endif
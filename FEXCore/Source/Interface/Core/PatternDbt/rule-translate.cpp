@@ -1,13 +1,21 @@
+#include "Interface/Context/Context.h"
 #include "Interface/Core/JIT/Arm64/JITClass.h"
 
 #include <FEXCore/Debug/InternalThreadState.h>
 #include <FEXCore/Utils/LogManager.h>
+#include <FEXCore/Utils/Profiler.h>
 
+#include <chrono>
 #include <cstdio>
 #include <assert.h>
 #include <cstring>
 
 #include "rule-translate.h"
+#include "arm-opt.h"
+#include "rule-index.h"
+#include "rule-cache.h"
+#include "rule-profile.h"
+#include "rule-trace.h"
 #include "rule-debug-log.h"
 
 #define MAX_RULE_RECORD_BUF_LEN 800
@@ -15,11 +23,8 @@
 #define MAX_HOST_RULE_LEN 800
 
 #define MAX_MAP_BUF_LEN 1000
-#define MAX_HOST_RULE_INSTR_LEN 1000
 
-static int debug = 0;
-static int match_insts = 0;
-static int match_counter = 10;
+static constexpr bool debug = false;
 
 inline void FEXCore::CPU::Arm64JITCore::reset_buffer(void)
 {
@@ -33,34 +38,34 @@ inline void FEXCore::CPU::Arm64JITCore::reset_buffer(void)
     pc_para_matched_buf_index = 0;
 }
 
-inline void FEXCore::CPU::Arm64JITCore::save_map_buf_index(void)
+/* Drop every binding of the previous rule */
+inline void FEXCore::CPU::Arm64JITCore::reset_bindings(void)
 {
-    imm_map_buf_index_pre = imm_map_buf_index;
-    g_reg_map_buf_index_pre = g_reg_map_buf_index;
-    label_map_buf_index_pre = label_map_buf_index;
-}
+    RuleBindings *b = &rule_bind;
 
-inline void FEXCore::CPU::Arm64JITCore::recover_map_buf_index(void)
-{
-    imm_map_buf_index = imm_map_buf_index_pre;
-    g_reg_map_buf_index = g_reg_map_buf_index_pre;
-    label_map_buf_index = label_map_buf_index_pre;
-}
-
-inline void FEXCore::CPU::Arm64JITCore::init_map_ptr(void)
-{
-    imm_map = NULL;
-    g_reg_map = NULL;
-    l_map = NULL;
-    reg_map_num = 0;
+    if (++b->gen == 0) {
+        memset(b->imm_gen, 0, sizeof(b->imm_gen));
+        memset(b->label_gen, 0, sizeof(b->label_gen));
+        memset(b->reg_gen, 0, sizeof(b->reg_gen));
+        b->gen = 1;
+    }
+    b->imm_num = 0;
+    b->label_num = 0;
+    b->reg_num = 0;
 }
 
+/* Save the rule matched last with its bindings */
 inline void FEXCore::CPU::Arm64JITCore::add_rule_record(TranslationRule *rule, uint64_t pc, uint64_t t_pc,
                                    X86Instruction *last_guest, bool update_cc, bool save_cc, int pa_opc[20])
 {
     RuleRecord *p = &rule_record_buf[rule_record_buf_index++];
+    RuleBindings *b = &rule_bind;
+    uint32_t i;
 
     assert(rule_record_buf_index < MAX_RULE_RECORD_BUF_LEN);
+    assert(imm_map_buf_index + b->imm_num < MAX_MAP_BUF_LEN);
+    assert(label_map_buf_index + b->label_num < MAX_MAP_BUF_LEN);
+    assert(g_reg_map_buf_index + b->reg_num < MAX_MAP_BUF_LEN);
 
     p->pc = pc;
     p->target_pc = t_pc;
@@ -68,9 +73,22 @@ inline void FEXCore::CPU::Arm64JITCore::add_rule_record(TranslationRule *rule, u
     p->rule = rule;
     p->update_cc = update_cc;
     p->save_cc = save_cc;
-    p->imm_map = imm_map;
-    p->g_reg_map = g_reg_map;
-    p->l_map = l_map;
+
+    p->imm_map = &imm_map_buf[imm_map_buf_index];
+    p->imm_num = b->imm_num;
+    for (i = 0; i < b->imm_num; i++)
+        imm_map_buf[imm_map_buf_index++] = b->imm[b->imm_order[i]];
+
+    p->l_map = &label_map_buf[label_map_buf_index];
+    p->label_num = b->label_num;
+    for (i = 0; i < b->label_num; i++)
+        label_map_buf[label_map_buf_index++] = b->label[b->label_order[i]];
+
+    p->g_reg_map = &g_reg_map_buf[g_reg_map_buf_index];
+    p->reg_num = b->reg_num;
+    for (i = 0; i < b->reg_num; i++)
+        g_reg_map_buf[g_reg_map_buf_index++] = b->reg[b->reg_order[i]];
+
     for (int i = 0; i < 20; i++)
         p->para_opc[i] = pa_opc[i];
 }
@@ -91,35 +109,26 @@ inline void FEXCore::CPU::Arm64JITCore::add_matched_para_pc(uint64_t pc)
 }
 
 
-bool FEXCore::CPU::Arm64JITCore::match_label(char *lab_str, uint64_t t, uint64_t f)
+bool FEXCore::CPU::Arm64JITCore::match_label(uint16_t sym, uint64_t t, uint64_t f)
 {
-    LabelMapping *lmap = l_map;
+    RuleBindings *b = &rule_bind;
 
-    while(lmap) {
-        if (strcmp(lmap->lab_str, lab_str)) {
-            lmap = lmap->next;
-            continue;
-        }
-
-        return (lmap->target == t && lmap->fallthrough == f);
-    }
+    if (sym >= RULE_SYM_MAX)
+        return false;
 
-    /* append this map to label map buffer */
-    lmap = &label_map_buf[label_map_buf_index++];
-    assert(label_map_buf_index < MAX_MAP_BUF_LEN);
-    strcpy(lmap->lab_str, lab_str);
-    lmap->target = t;
-    lmap->fallthrough = f;
+    if (b->label_gen[sym] == b->gen)
+        return (b->label[sym].target == t && b->label[sym].fallthrough == f);
 
-    lmap->next = l_map;
-    l_map = lmap;
+    b->label_gen[sym] = b->gen;
+    b->label[sym] = {sym, t, f};
+    b->label_order[b->label_num++] = sym;
 
     return true;
 }
 
 bool FEXCore::CPU::Arm64JITCore::match_register(X86Register greg, X86Register rreg, uint32_t regsize, bool HighBits)
 {
-    GuestRegisterMapping *gmap = g_reg_map;
+    RuleBindings *b = &rule_bind;
 
     if (greg == X86_REG_INVALID && rreg == X86_REG_INVALID)
         return true;
@@ -141,61 +150,36 @@ bool FEXCore::CPU::Arm64JITCore::match_register(X86Register greg, X86Register rr
     }
 
     /* check if we already have this map */
-    while (gmap) {
-        if (gmap->sym != rreg) {
-            gmap = gmap->next;
-            continue;
-        }
-        if (debug && (gmap->num != greg))
-            fprintf(stderr, "Unmatch reg: map conflict: %d %d\n", gmap->num, greg);
-        return (gmap->num == greg);
+    uint32_t idx = rreg - X86_REG_REG0;
+    if (b->reg_gen[idx] == b->gen) {
+        if (debug && (b->reg[idx].num != greg))
+            LogMan::Msg::IFmt("Unmatch reg: map conflict: {} {}", b->reg[idx].num, greg);
+        return (b->reg[idx].num == greg);
     }
 
-    /* append this map to register map buffer */
-    gmap = &g_reg_map_buf[g_reg_map_buf_index++];
-    assert(g_reg_map_buf_index < MAX_MAP_BUF_LEN);
-    gmap->sym = rreg;
-    gmap->num = greg;
-
-    if (regsize)
-      gmap->regsize = regsize;
-    else
-      gmap->regsize = 0;
-
-    if (HighBits)
-      gmap->HighBits = true;
-    else
-      gmap->HighBits = false;
-    ++reg_map_num;
-
-    gmap->next = g_reg_map;
-    g_reg_map = gmap;
+    b->reg_gen[idx] = b->gen;
+    b->reg[idx] = {rreg, greg, regsize, HighBits};
+    b->reg_order[b->reg_num++] = idx;
 
     return true;
 }
 
-bool FEXCore::CPU::Arm64JITCore::match_imm(uint64_t val, char *sym)
+bool FEXCore::CPU::Arm64JITCore::match_imm(uint64_t val, uint16_t sym)
 {
-    ImmMapping *imap = imm_map;
+    RuleBindings *b = &rule_bind;
 
-    while(imap) {
-        if (!strcmp(sym, imap->imm_str)) {
-            if (debug && (val != imap->imm_val))
-                LogMan::Msg::IFmt( "Unmatch imm: symbol map conflict {} {}", imap->imm_val, val);
-            return (val == imap->imm_val);
-        }
+    if (sym >= RULE_SYM_MAX)
+        return false;
 
-        imap = imap->next;
+    if (b->imm_gen[sym] == b->gen) {
+        if (debug && (val != b->imm[sym].imm_val))
+            LogMan::Msg::IFmt( "Unmatch imm: symbol map conflict {} {}", b->imm[sym].imm_val, val);
+        return (val == b->imm[sym].imm_val);
     }
 
-    /* add this map to immediate map buffer */
-    imap = &imm_map_buf[imm_map_buf_index++];
-    assert(imm_map_buf_index < MAX_MAP_BUF_LEN);
-    strcpy(imap->imm_str, sym);
-    imap->imm_val = val;
-
-    imap->next = imm_map;
-    imm_map = imap;
+    b->imm_gen[sym] = b->gen;
+    b->imm[sym] = {sym, val};
+    b->imm_order[b->imm_num++] = sym;
 
     return true;
 }
@@ -212,19 +196,18 @@ bool FEXCore::CPU::Arm64JITCore::match_scale(X86Imm *gscale, X86Imm *rscale)
         return gscale->content.val == rscale->content.val;
     }
     else if (rscale->type == X86_IMM_TYPE_NONE)
-        return match_imm(0, rscale->content.sym);
+        return match_imm(0, rscale->sym_id);
     else
-        return match_imm(gscale->content.val, rscale->content.sym);
+        return match_imm(gscale->content.val, rscale->sym_id);
 }
 
 bool FEXCore::CPU::Arm64JITCore::match_offset(X86Imm *goffset, X86Imm *roffset)
 {
-    char *sym;
     int32_t off_val;
 
     if (roffset->type != X86_IMM_TYPE_NONE &&
         goffset->type == X86_IMM_TYPE_NONE)
-        return match_imm(0, roffset->content.sym);
+        return match_imm(0, roffset->sym_id);
 
     if (goffset->type == X86_IMM_TYPE_NONE &&
         roffset->type == X86_IMM_TYPE_NONE)
@@ -242,10 +225,9 @@ bool FEXCore::CPU::Arm64JITCore::match_offset(X86Imm *goffset, X86Imm *roffset)
         return false;
     }
 
-    sym = roffset->content.sym;
     off_val = goffset->content.val;
 
-    return match_imm(off_val, sym);
+    return match_imm(off_val, roffset->sym_id);
 }
 
 bool FEXCore::CPU::Arm64JITCore::match_opd_imm(X86ImmOperand *gopd, X86ImmOperand *ropd)
@@ -256,7 +238,7 @@ bool FEXCore::CPU::Arm64JITCore::match_opd_imm(X86ImmOperand *gopd, X86ImmOperan
     if (ropd->type == X86_IMM_TYPE_VAL)
         return (gopd->content.val == ropd->content.val);
     else if (ropd->type == X86_IMM_TYPE_SYM)
-        return match_imm(gopd->content.val, ropd->content.sym);
+        return match_imm(gopd->content.val, ropd->sym_id);
     else {
         if (debug)
             LogMan::Msg::IFmt("Unmatch imm: type error");
@@ -303,7 +285,8 @@ bool FEXCore::CPU::Arm64JITCore::match_operand(X86Instruction *ginstr, X86Instru
         #ifdef DEBUG_RULE_LOG
             writeToLogFile(std::to_string(ThreadState->ThreadManager.PID) + "fex-debug.log", "[INFO] Different operand type\n");
         #else
-            LogMan::Msg::IFmt("Different operand {} type", opd_idx);
+            if (debug)
+                LogMan::Msg::IFmt("Different operand {} type", opd_idx);
         #endif
         return false;
     }
@@ -331,7 +314,7 @@ bool FEXCore::CPU::Arm64JITCore::match_operand(X86Instruction *ginstr, X86Instru
             return false;
         if (x86_instr_test_branch(rinstr) || ropd->content.imm.isRipLiteral) {
             assert(ropd->content.imm.type == X86_IMM_TYPE_SYM);
-            return match_label(ropd->content.imm.content.sym, gopd->content.imm.content.val, ginstr->pc + ginstr->InstSize);
+            return match_label(ropd->content.imm.sym_id, gopd->content.imm.content.val, ginstr->pc + ginstr->InstSize);
         } else /* match imm operand */
             return match_opd_imm(&gopd->content.imm, &ropd->content.imm);
     } else if (ropd->type == X86_OPD_TYPE_REG) {
@@ -363,7 +346,7 @@ bool FEXCore::CPU::Arm64JITCore::match_rule_internal(X86Instruction *instr, Tran
 
     int j = 0;
     /* init for this rule */
-    init_map_ptr();
+    reset_bindings();
 
     while(p_rule_instr) {
 
@@ -440,45 +423,50 @@ bool FEXCore::CPU::Arm64JITCore::match_rule_internal(X86Instruction *instr, Tran
     return true;
 }
 
-void FEXCore::CPU::Arm64JITCore::get_label_map(char *lab_str, uint64_t *t, uint64_t *f)
+void FEXCore::CPU::Arm64JITCore::get_label_map(ARMImm *imm, uint64_t *t, uint64_t *f)
 {
-    LabelMapping *lmap = l_map;
+    RuleBindings *b = &rule_bind;
+    uint16_t sym = imm->sym_id;
 
-    while(lmap) {
-        if (!strcmp(lmap->lab_str, lab_str)) {
-            *t = lmap->target;
-            *f = lmap->fallthrough;
-            return;
-        }
-        lmap = lmap->next;
-    }
+    assert(sym < RULE_SYM_MAX && b->label_gen[sym] == b->gen);
 
-    assert (0);
+    *t = b->label[sym].target;
+    *f = b->label[sym].fallthrough;
 }
 
-
-uint64_t FEXCore::CPU::Arm64JITCore::get_imm_map(char *sym)
+uint64_t FEXCore::CPU::Arm64JITCore::get_imm_map(ARMImm *imm)
 {
-    ImmMapping *im = imm_map;
-    char t_str[50]; /* replaced string */
-    char t_buf[50]; /* buffer string */
+    RuleBindings *b = &rule_bind;
+    uint16_t sym = imm->sym_id;
+    const char *p = imm->content.sym;
+    char t_str[64]; /* replaced string */
+    size_t len = 0;
+
+    if (sym < RULE_SYM_MAX && b->imm_gen[sym] == b->gen)
+        return b->imm[sym].imm_val;
+
+    /* The host imm_str is an expression, replace every imm_xxx in it
+       with the corresponding guest value and parse the result */
+    while (*p && len < sizeof(t_str) - 21) {
+        if (!isalpha(*p)) {
+            t_str[len++] = *p++;
+            continue;
+        }
 
-    /* Due to the expression in host imm_str, We replace all imm_xxx in host imm_str
-       with the corresponding guest values, and parse it to get the value of the expression */
-    strcpy(t_str, sym);
+        const char *start = p;
+        while (isalnum(*p) || *p == '_')
+            p++;
 
-    while(im) {
-        char *p_str = strstr(t_str, im->imm_str);
-        while (p_str) {
-            size_t len = (size_t)(p_str - t_str);
-            strncpy(t_buf, t_str, len);
-            sprintf(t_buf + len, "%lu", im->imm_val);
-            strncat(t_buf, t_str + len + strlen(im->imm_str), strlen(t_str) - len - strlen(im->imm_str));
-            strcpy(t_str, t_buf);
-            p_str = strstr(t_str, im->imm_str);
+        uint16_t id = rule_sym_find(start, p - start);
+        if (id < RULE_SYM_MAX && b->imm_gen[id] == b->gen) {
+            len += sprintf(t_str + len, "%lu", b->imm[id].imm_val);
+        } else {
+            while (start < p && len < sizeof(t_str) - 1)
+                t_str[len++] = *start++;
         }
-        im = im->next;
     }
+    t_str[len] = '\0';
+
     if (debug)
         LogMan::Msg::IFmt("get imm val: {}", t_str);
     return std::stoull(t_str);
@@ -492,7 +480,7 @@ uint64_t FEXCore::CPU::Arm64JITCore::GetImmMapWrapper(ARMImm *imm)
     if (imm->type == ARM_IMM_TYPE_VAL)
         return imm->content.val;
 
-    return get_imm_map(imm->content.sym);
+    return get_imm_map(imm);
 }
 
 static ARMRegister guest_host_reg_map(X86Register& reg)
@@ -552,21 +540,26 @@ ARMRegister FEXCore::CPU::Arm64JITCore::GetGuestRegMap(ARMRegister& reg, uint32_
         return reg;
     }
 
-    GuestRegisterMapping *gmap = g_reg_map;
+    if (ARM_REG_TEMP0 <= reg && reg < ARM_REG_TEMP0 + ARM_REG_TEMP_NUM) {
+        regsize = 0;
+        HighBits = false;
+        return rule_temp_reg[reg - ARM_REG_TEMP0];
+    }
+
+    RuleBindings *b = &rule_bind;
+    uint32_t idx = reg - ARM_REG_REG0;
 
-    while (gmap) {
-        if (!strcmp(get_arm_reg_str(reg), get_x86_reg_str(gmap->sym))) {
-            regsize = gmap->regsize;
-            HighBits = gmap->HighBits;
-            ARMRegister armreg = guest_host_reg_map(gmap->num);
-            if (armreg == ARM_REG_INVALID) {
-                LogMan::Msg::EFmt("Unsupported reg num - arm: {}, x86: {}", get_arm_reg_str(reg), get_x86_reg_str(gmap->num));
-                exit(0);
-            }
-            return armreg;
-        }
+    if (ARM_REG_REG0 <= reg && reg <= ARM_REG_REG31 && b->reg_gen[idx] == b->gen) {
+        GuestRegisterMapping *gmap = &b->reg[idx];
 
-        gmap = gmap->next;
+        regsize = gmap->regsize;
+        HighBits = gmap->HighBits;
+        ARMRegister armreg = guest_host_reg_map(gmap->num);
+        if (armreg == ARM_REG_INVALID) {
+            LogMan::Msg::EFmt("Unsupported reg num - arm: {}, x86: {}", get_arm_reg_str(reg), get_x86_reg_str(gmap->num));
+            exit(0);
+        }
+        return armreg;
     }
 
     assert(0);
@@ -608,6 +601,16 @@ bool FEXCore::CPU::Arm64JITCore::check_translation_rule(uint64_t pc)
     return false;
 }
 
+FEXCore::CPU::CPUBackend::RuleCoverage FEXCore::CPU::Arm64JITCore::GetRuleCoverage(uint64_t PC)
+{
+    int i;
+    for (i = 0; i < rule_record_buf_index; i++) {
+        if (rule_record_buf[i].pc == PC)
+            return rule_record_buf[i].target_pc ? RuleCoverage::EXIT : RuleCoverage::HEAD;
+    }
+    return instr_is_match(PC) ? RuleCoverage::BODY : RuleCoverage::NONE;
+}
+
 RuleRecord* FEXCore::CPU::Arm64JITCore::get_translation_rule(uint64_t pc)
 {
     int i;
@@ -620,12 +623,17 @@ RuleRecord* FEXCore::CPU::Arm64JITCore::get_translation_rule(uint64_t pc)
     return NULL;
 }
 
+/* Overlapping blocks of a function emit the same rule more than once, keep it enabled */
+RuleRecord* FEXCore::CPU::Arm64JITCore::find_translation_rule(uint64_t pc)
+{
+    int i;
+    for (i = 0; i < rule_record_buf_index; i++) {
+        if (rule_record_buf[i].pc == pc)
+            return &rule_record_buf[i];
+    }
+    return NULL;
+}
 
-#ifdef PROFILE_RULE_TRANSLATION
-uint64_t rule_guest_pc = 0;
-uint32_t num_rules_hit = 0;
-uint32_t num_rules_replace = 0;
-#endif
 
 static bool is_save_cc(X86Instruction *pins, int icount)
 {
@@ -642,11 +650,21 @@ static bool is_save_cc(X86Instruction *pins, int icount)
 }
 
 
+/* Check whether any of the len instructions from head is covered by a rule already */
+bool FEXCore::CPU::Arm64JITCore::rule_overlaps_match(X86Instruction *head, uint32_t len)
+{
+    for (uint32_t k = 0; k < len && head; k++, head = head->next) {
+        if (instr_is_match(head->pc))
+            return true;
+    }
+    return false;
+}
+
 /* Try to match instructions in this tb with existing rules */
-bool FEXCore::CPU::Arm64JITCore::MatchTranslationRule(const void *tb)
+bool FEXCore::CPU::Arm64JITCore::match_block_rules(FEXCore::Frontend::Decoder::DecodedBlocks const *transblock)
 {
-    auto transblock = static_cast<const FEXCore::Frontend::Decoder::DecodedBlocks*>(tb);
-    if (match_counter <= 0)
+    /* The decoder skips blocks that can't match any rule */
+    if (!transblock->guest_instr)
         return false;
 
     X86Instruction *guest_instr = transblock->guest_instr;
@@ -660,15 +678,20 @@ bool FEXCore::CPU::Arm64JITCore::MatchTranslationRule(const void *tb)
       ofstream_rule_arm_instr2(guest_instr, ThreadState->ThreadManager.PID);
     #endif
 
-    LogMan::Msg::IFmt("=====Guest Instr Match Rule Start, Guest PC: 0x{:x}=====\n", guest_instr->pc);
-
-    reset_buffer();
+    rule_trace(RULE_TRACE_BLOCK, guest_instr->pc, 0);
 
     /* Try from the longest rule */
     while (cur_head) {
 
         bool opd_para = false;
 
+        /* Blocks of a function can overlap, the shared instructions keep the rules of the first block */
+        if (instr_is_match(cur_head->pc)) {
+            cur_head = cur_head->next;
+            guest_instr_num--;
+            continue;
+        }
+
         if (guest_instr_num <= 0) {
             X86Instruction *t_head = cur_head;
             guest_instr_num = 0;
@@ -678,92 +701,373 @@ bool FEXCore::CPU::Arm64JITCore::MatchTranslationRule(const void *tb)
             }
         }
 
-        for (i = guest_instr_num; i > 0; i--) {
-            /* calculate hash key */
-            int hindex = rule_hash_key(cur_head, i);
+        /* Candidates sharing the instruction shapes of cur_head, longest first */
+        RuleCandidate cands[MAX_RULE_CANDIDATES];
+        int cand_num = rule_index_lookup(CTX->TranslationRules.get(), cur_head, cands, MAX_RULE_CANDIDATES);
+        TranslationRule *cur_rule = NULL;
 
-            if (hindex >= MAX_GUEST_LEN)
+        i = 0;
+        for (j = 0; j < cand_num; j++) {
+            /* Instructions left out by the rules go through the IR */
+            if (cands[j].len > (uint32_t)guest_instr_num || rule_overlaps_match(cur_head, cands[j].len))
                 continue;
-            /* check rule with length i (number of guest instructions) */
-            TranslationRule *cur_rule = cache_rule_table[hindex];
-
-            save_map_buf_index();
-            uint32_t num_rules_match = 0;
-            while (cur_rule) {
 
-                if (cur_rule->guest_instr_num != i)
-                    goto next;
-
-                num_rules_match++;
-
-                if (match_rule_internal(cur_head, cur_rule, transblock)) {
-                    #if defined(PROFILE_RULE_TRANSLATION) && defined(DEBUG_RULE_LOG)
-                        writeToLogFile(std::to_string(ThreadState->ThreadManager.PID) + "fex-debug.log", "[INFO] #####  Rule index " +
-                            std::to_string(cur_rule->index) + ", match num:" +
-                            std::to_string(num_rules_match) + "#####\n\n");
-                    #endif
-                    break;
-                }
+            bool matched = match_rule_internal(cur_head, cands[j].rule, transblock);
 
-                next:
-                cur_rule = cur_rule->next;
-                recover_map_buf_index();
+            /* A rule whose scratch registers don't fit here leaves the instructions to the IR */
+            if (matched) {
+                X86Instruction *last = cur_head;
+                for (uint32_t k = 1; k < cands[j].len; k++)
+                    last = last->next;
+                matched = rule_temp_regs_fit(cands[j].rule, last);
             }
-            /* We find a matched rule, save it */
-            if (cur_rule) {
-                X86Instruction *temp = cur_head;
-                uint64_t target_pc = 0;
-
-                match_insts += i;
-
-                /* Check target_pc for this rule */
-                for (j = 1; j < i; j++)
-                    temp = temp->next;
-                if (!temp->next) // last instr
-                    target_pc = temp->pc + temp->InstSize;
-
-                int pa_opc[20];
-                if (!opd_para) {
-                    add_rule_record(cur_rule , cur_head->pc, target_pc, temp,
-                        true, is_save_cc(cur_head, i), pa_opc);
-                }
-
-                /* We get a matched rule, keep moving forward */
-                if (opd_para) {
-                  for (j = 0; j < i; j++) {
-                    add_matched_para_pc(cur_head->pc);
-                    cur_head = cur_head->next;
-                    guest_instr_num--;
-                  }
-                } else {
-                  for (j = 0; j < i; j++) {
-                    add_matched_pc(cur_head->pc);
-                    cur_head = cur_head->next;
-                    guest_instr_num--;
-                  }
-                }
+            rule_profile_attempt(cands[j].rule, matched);
+            rule_trace(matched ? RULE_TRACE_MATCH : RULE_TRACE_MISS, cur_head->pc, cands[j].rule->index);
 
-                ismatch = true;
+            if (matched) {
+                cur_rule = cands[j].rule;
+                i = cands[j].len;
                 break;
             }
+        }
+
+        /* No matched rule found, leave this instruction to the IR */
+        if (!cur_rule) {
+            cur_head = cur_head->next;
+            guest_instr_num--;
+            continue;
+        }
 
-            recover_map_buf_index();
+        /* We find a matched rule, save it */
+        X86Instruction *temp = cur_head;
+        uint64_t target_pc = 0;
 
-            if(1) goto final;
+        rule_stats_add(rule_stats.matched_instrs, i);
+        rule_stats_add(rule_stats.matched_rules, 1);
+
+        /* Check target_pc for this rule */
+        for (j = 1; j < i; j++)
+            temp = temp->next;
+        if (!temp->next) // last instr
+            target_pc = temp->pc + temp->InstSize;
+
+        int pa_opc[20];
+        if (!opd_para) {
+            add_rule_record(cur_rule , cur_head->pc, target_pc, temp,
+                true, is_save_cc(cur_head, i), pa_opc);
         }
 
-        /* No matched rule found, also keep moving forward */
-        if (i == 0) {
-            /* print unmatched instructions
-               if not continuous, record as a new block */
+        /* We get a matched rule, keep moving forward */
+        if (opd_para) {
+          for (j = 0; j < i; j++) {
+            add_matched_para_pc(cur_head->pc);
+            cur_head = cur_head->next;
+            guest_instr_num--;
+          }
+        } else {
+          for (j = 0; j < i; j++) {
+            add_matched_pc(cur_head->pc);
             cur_head = cur_head->next;
             guest_instr_num--;
+          }
         }
+
+        ismatch = true;
     }
-    final:
+
     return ismatch;
 }
 
+/* Find the block of the function starting at pc */
+static int find_block(FEXCore::Frontend::Decoder::DecodedBlockInformation const *BlockInfo, uint64_t pc)
+{
+    for (size_t b = 0; b < BlockInfo->Blocks.size(); b++) {
+        if (BlockInfo->Blocks[b].Entry == pc)
+            return b;
+    }
+    return -1;
+}
+
+/* Liveness at the end of a block: what its successors in this function read,
+   everything if the block can leave the function */
+static void block_live_out(FEXCore::Frontend::Decoder::DecodedBlockInformation const *BlockInfo,
+                           size_t b, fextl::vector<bool> const &live_in, bool *live_out)
+{
+    auto &Block = BlockInfo->Blocks[b];
+    X86Instruction *last = Block.guest_instr;
+    int succ[2] = {-1, -1};
+    int succ_num = 0;
+    bool known = true;
+    int i;
+
+    while (last && last->next)
+        last = last->next;
+
+    auto &LastOp = Block.DecodedInstructions[Block.NumInstructions - 1];
+    uint64_t next_pc = LastOp.PC + LastOp.InstSize;
+    uint64_t target = 0;
+    if (LastOp.Src[0].IsLiteral()) {
+        target = next_pc + LastOp.Src[0].Data.Literal.Value;
+        if (!BlockInfo->Is64BitMode)
+            target &= 0xFFFFFFFFU;
+    }
+
+    if (!last || last->opc == X86_OPC_INVALID || last->opc == X86_OPC_CALL || last->opc == X86_OPC_RET) {
+        known = false;
+    } else if (last->opc == X86_OPC_JMP) {
+        succ[succ_num++] = target ? find_block(BlockInfo, target) : -1;
+    } else if (x86_instr_test_branch(last)) {
+        succ[succ_num++] = find_block(BlockInfo, next_pc);
+        succ[succ_num++] = target ? find_block(BlockInfo, target) : -1;
+    } else {
+        succ[succ_num++] = find_block(BlockInfo, next_pc);
+    }
+
+    for (i = 0; i < succ_num; i++) {
+        if (succ[i] < 0)
+            known = false;
+    }
+
+    for (i = 0; i < X86_REG_NUM; i++) {
+        live_out[i] = !known;
+        for (int k = 0; known && k < succ_num; k++)
+            live_out[i] |= live_in[succ[k] * X86_REG_NUM + i];
+    }
+}
+
+/* Register and condition code liveness of every shadow instruction of the function.
+   Iterates to a fixed point so loops between the blocks are covered. */
+static void decide_function_liveness(FEXCore::Frontend::Decoder::DecodedBlockInformation const *BlockInfo)
+{
+    const size_t block_num = BlockInfo->Blocks.size();
+    fextl::vector<bool> live_in(block_num * X86_REG_NUM, false);
+    bool live[X86_REG_NUM];
+    bool changed;
+    int i;
+
+    do {
+        changed = false;
+        for (size_t b = block_num; b-- > 0;) {
+            auto &Block = BlockInfo->Blocks[b];
+
+            if (!Block.guest_instr || !Block.NumInstructions) {
+                /* Nothing is known about blocks without shadow instructions */
+                for (i = 0; i < X86_REG_NUM; i++)
+                    live[i] = true;
+            } else {
+                block_live_out(BlockInfo, b, live_in, live);
+                decide_reg_liveness(Block.guest_instr, live);
+            }
+
+            for (i = 0; i < X86_REG_NUM; i++) {
+                if (live_in[b * X86_REG_NUM + i] != live[i]) {
+                    live_in[b * X86_REG_NUM + i] = live[i];
+                    changed = true;
+                }
+            }
+        }
+    } while (changed);
+}
+
+/* Match every block of the function, rules never span two blocks */
+bool FEXCore::CPU::Arm64JITCore::MatchTranslationRule(const void *bi)
+{
+    auto BlockInfo = static_cast<const FEXCore::Frontend::Decoder::DecodedBlockInformation*>(bi);
+    bool ismatch = false;
+
+    if (!CTX->TranslationRules)
+        return false;
+
+    FEXCORE_PROFILE_SCOPED("MatchTranslationRule");
+    auto match_begin = std::chrono::steady_clock::now();
+
+    reset_buffer();
+
+    /* Rules that leave some condition codes wrong can only match where those are dead */
+    decide_function_liveness(BlockInfo);
+
+    for (auto &Block : BlockInfo->Blocks) {
+        if (match_block_rules(&Block))
+            ismatch = true;
+    }
+
+    rule_stats_add(rule_stats.blocks_attempted, BlockInfo->Blocks.size());
+    rule_stats_add(rule_stats.match_ns, std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - match_begin).count());
+
+    return ismatch;
+}
+
+static void rule_cache_append(fextl::vector<uint8_t> *data, const void *p, size_t size)
+{
+    const uint8_t *b = static_cast<const uint8_t *>(p);
+    data->insert(data->end(), b, b + size);
+}
+
+/* Serialize the rule records of the last match for the rule cache */
+uint32_t FEXCore::CPU::Arm64JITCore::SaveTranslationRules(uint64_t Entry, fextl::vector<uint8_t> *Data)
+{
+    int i, j = 0, k;
+
+    Data->clear();
+
+    for (i = 0; i < rule_record_buf_index; i++) {
+        RuleRecord *p = &rule_record_buf[i];
+        uint64_t next_pc = i + 1 < rule_record_buf_index ? rule_record_buf[i + 1].pc : UINT64_MAX;
+        int pc_start;
+        X86Instruction *last = p->last_guest;
+        RuleCacheRecord rec;
+
+        memset(&rec, 0, sizeof(rec));
+        rec.pc_off = p->pc - Entry;
+        rec.has_target_pc = p->target_pc != 0;
+        rec.target_pc_off = p->target_pc ? p->target_pc - Entry : 0;
+        rec.rule_id = p->rule - CTX->TranslationRules->rules;
+        rec.update_cc = p->update_cc;
+        rec.save_cc = p->save_cc;
+        rec.last_opc = last->opc;
+        rec.last_opd_num = last->opd_num;
+        rec.last_opd0_type = last->opd[0].type;
+        rec.last_rip_literal = last->opd[0].type == X86_OPD_TYPE_IMM && last->opd[0].content.imm.isRipLiteral;
+        for (k = X86_REG_OF; k <= X86_REG_ZF; k++) {
+            if (last->reg_liveness[k])
+                rec.last_cc_live |= 1 << (k - X86_REG_OF);
+        }
+
+        rec.imm_num = p->imm_num;
+        rec.reg_num = p->reg_num;
+        rec.label_num = p->label_num;
+
+        /* Matched pcs are in guest order, the ones up to the next rule belong to this one */
+        while (j < pc_matched_buf_index && pc_matched_buf[j] != p->pc)
+            j++;
+        pc_start = j;
+        while (j < pc_matched_buf_index && pc_matched_buf[j] < next_pc)
+            j++;
+        rec.pc_num = j - pc_start;
+
+        rule_cache_append(Data, &rec, sizeof(rec));
+
+        /* Bindings are kept in the order they were made, register allocation depends on it */
+        for (k = 0; k < (int)p->imm_num; k++) {
+            RuleCacheImm ci = {p->imm_map[k].sym, 0, p->imm_map[k].imm_val};
+            rule_cache_append(Data, &ci, sizeof(ci));
+        }
+        for (k = 0; k < (int)p->reg_num; k++) {
+            GuestRegisterMapping *gm = &p->g_reg_map[k];
+            RuleCacheReg cr = {(uint32_t)gm->sym, (uint32_t)gm->num, gm->regsize, gm->HighBits};
+            rule_cache_append(Data, &cr, sizeof(cr));
+        }
+        for (k = 0; k < (int)p->label_num; k++) {
+            LabelMapping *lm = &p->l_map[k];
+            RuleCacheLabel cl = {lm->sym, 0, lm->target /* RIP relative already */, lm->fallthrough - Entry};
+            rule_cache_append(Data, &cl, sizeof(cl));
+        }
+        for (j = pc_start; j < pc_start + rec.pc_num; j++) {
+            uint32_t pc_off = pc_matched_buf[j] - Entry;
+            rule_cache_append(Data, &pc_off, sizeof(pc_off));
+        }
+    }
+
+    return rule_record_buf_index;
+}
+
+/* Rebuild the state MatchTranslationRule leaves behind from a rule cache entry */
+bool FEXCore::CPU::Arm64JITCore::RestoreTranslationRules(uint64_t Entry, uint8_t const *Data, uint32_t DataSize, uint32_t RecordNum)
+{
+    const RuleSet *set = CTX->TranslationRules.get();
+    uint64_t off = 0;
+    uint32_t n;
+    int k;
+    int pa_opc[20] = {0};
+
+    if (!set || !RecordNum || RecordNum >= MAX_RULE_RECORD_BUF_LEN)
+        return false;
+
+    rule_stats_add(rule_stats.blocks_attempted, 1);
+
+    reset_buffer();
+    restored_last_guest.assign(RecordNum, X86Instruction{});
+
+    for (n = 0; n < RecordNum; n++) {
+        RuleCacheRecord rec;
+
+        if (off + sizeof(rec) > DataSize)
+            break;
+        memcpy(&rec, Data + off, sizeof(rec));
+        off += sizeof(rec);
+
+        uint64_t imm_off = off;
+        uint64_t reg_off = imm_off + rec.imm_num * sizeof(RuleCacheImm);
+        uint64_t label_off = reg_off + rec.reg_num * sizeof(RuleCacheReg);
+        uint64_t pc_off = label_off + rec.label_num * sizeof(RuleCacheLabel);
+        off = pc_off + rec.pc_num * sizeof(uint32_t);
+
+        if (off > DataSize || rec.rule_id >= (uint32_t)set->rule_num || rec.last_opc >= X86_OPC_END
+            || imm_map_buf_index + rec.imm_num >= MAX_MAP_BUF_LEN
+            || g_reg_map_buf_index + rec.reg_num >= MAX_MAP_BUF_LEN
+            || label_map_buf_index + rec.label_num >= MAX_MAP_BUF_LEN
+            || pc_matched_buf_index + rec.pc_num >= MAX_GUEST_INSTR_LEN)
+            break;
+
+        /* Rebind in the order of the match, add_rule_record copies them out again */
+        reset_bindings();
+        bool bound = true;
+        for (k = 0; k < (int)rec.imm_num; k++) {
+            RuleCacheImm ci;
+            memcpy(&ci, Data + imm_off + k * sizeof(ci), sizeof(ci));
+            bound &= ci.sym < RULE_SYM_MAX && match_imm(ci.val, ci.sym);
+        }
+        for (k = 0; k < (int)rec.reg_num; k++) {
+            RuleCacheReg cr;
+            memcpy(&cr, Data + reg_off + k * sizeof(cr), sizeof(cr));
+            bound &= X86_REG_REG0 <= cr.sym && cr.sym <= X86_REG_REG31 && cr.num < X86_REG_END;
+            if (!bound)
+                break;
+            bound &= match_register((X86Register)cr.num, (X86Register)cr.sym, cr.regsize, cr.high_bits);
+        }
+        for (k = 0; k < (int)rec.label_num; k++) {
+            RuleCacheLabel cl;
+            memcpy(&cl, Data + label_off + k * sizeof(cl), sizeof(cl));
+            bound &= cl.sym < RULE_SYM_MAX && match_label(cl.sym, cl.target, Entry + cl.fallthrough_off);
+        }
+        if (!bound)
+            break;
+
+        X86Instruction *last = &restored_last_guest[n];
+        last->opc = (X86Opcode)rec.last_opc;
+        last->opd_num = rec.last_opd_num;
+        last->opd[0].type = (X86OperandType)rec.last_opd0_type;
+        last->opd[0].content.imm.isRipLiteral = rec.last_rip_literal;
+        /* Only the condition codes are kept, registers stay live */
+        for (k = 0; k < X86_REG_NUM; k++)
+            last->reg_liveness[k] = true;
+        for (k = X86_REG_OF; k <= X86_REG_ZF; k++)
+            last->reg_liveness[k] = rec.last_cc_live & (1 << (k - X86_REG_OF));
+
+        /* The registers are all live now, the scratch registers may not fit anymore */
+        if (!rule_temp_regs_fit(&set->rules[rec.rule_id], last))
+            break;
+
+        add_rule_record(&set->rules[rec.rule_id], Entry + rec.pc_off,
+            rec.has_target_pc ? Entry + rec.target_pc_off : 0, last,
+            rec.update_cc, rec.save_cc, pa_opc);
+        for (k = 0; k < rec.pc_num; k++) {
+            uint32_t matched_off;
+            memcpy(&matched_off, Data + pc_off + k * sizeof(matched_off), sizeof(matched_off));
+            add_matched_pc(Entry + matched_off);
+        }
+    }
+
+    if (n != RecordNum) {
+        LogMan::Msg::IFmt("RuleCache: Corrupted entry at 0x{:x}", Entry);
+        reset_buffer();
+        return false;
+    }
+
+    return true;
+}
+
 void remove_guest_instruction(FEXCore::Frontend::Decoder::DecodedBlocks *tb, uint64_t pc)
 {
     X86Instruction *head = tb->guest_instr;
@@ -787,40 +1091,334 @@ void remove_guest_instruction(FEXCore::Frontend::Decoder::DecodedBlocks *tb, uin
     }
 }
 
-static ARMInstruction *arm_host;
-void FEXCore::CPU::Arm64JITCore::do_rule_translation(RuleRecord *rule_r, uint32_t *reg_liveness)
+/* Flags read by the guest after the rule */
+static uint8_t rule_cc_live_out(X86Instruction *last_guest)
+{
+    uint8_t live = last_guest->reg_liveness[X86_REG_CF] ? RULE_CF_LIVE : 0;
+
+    for (int i = X86_REG_OF; i <= X86_REG_ZF; i++) {
+        if (last_guest->reg_liveness[i])
+            live |= RULE_CC_LIVE;
+    }
+    return live;
+}
+
+/* Host register behind a rule register, ARM_REG_INVALID for scratch registers */
+static ARMRegister rule_host_reg(ARMRegister reg, RuleRecord *rule_r)
+{
+    if (ARM_REG_R0 <= reg && reg <= ARM_REG_ZR)
+        return reg;
+
+    if (ARM_REG_REG0 <= reg && reg <= ARM_REG_REG31) {
+        for (uint32_t i = 0; i < rule_r->reg_num; i++) {
+            if (rule_r->g_reg_map[i].sym - X86_REG_REG0 == reg - ARM_REG_REG0)
+                return guest_host_reg_map(rule_r->g_reg_map[i].num);
+        }
+    }
+    return ARM_REG_INVALID;
+}
+
+/* Registers free around every rule: the register allocator's r24, r25 and the
+   JIT temporaries TMP2-TMP4. r20-r23 and TMP1 are left out, the instruction
+   handlers use them as scratch themselves */
+static const ARMRegister rule_temp_pool[] = {
+    ARM_REG_R24, ARM_REG_R25, ARM_REG_R1, ARM_REG_R2, ARM_REG_R3,
+};
+
+/* Give every scratch register of the rule a host register, by linear scan over
+   the host instructions. Besides the pool, the static registers of guest
+   registers that are dead after the rule are handed out once the rule is done
+   with them. A scratch register copied from such a register takes it over, so
+   the copy goes away. Returns false if some scratch register finds no free
+   host register. */
+bool FEXCore::CPU::Arm64JITCore::assign_rule_temp_regs(RuleRecord *rule_r)
+{
+    int first[ARM_REG_TEMP_NUM], last[ARM_REG_TEMP_NUM];
+    ARMInstruction *def[ARM_REG_TEMP_NUM] = {nullptr};
+    int ref_last[ARM_REG_END];   /* last host instruction reading or writing the host register */
+    int busy[ARM_REG_END];       /* last host instruction of the scratch register holding it */
+    ARMRegister cand[sizeof(rule_temp_pool) / sizeof(rule_temp_pool[0]) + X86_REG_R15 - X86_REG_RAX + 1];
+    int cand_num = 0;
+    int i, k;
+
+    for (i = 0; i < ARM_REG_TEMP_NUM; i++) {
+        first[i] = last[i] = -1;
+        rule_temp_reg[i] = ARM_REG_INVALID;
+    }
+    for (i = 0; i < ARM_REG_END; i++)
+        ref_last[i] = busy[i] = -1;
+
+    auto note = [&](ARMRegister reg, ARMInstruction *instr, int k) {
+        if (reg == ARM_REG_INVALID)
+            return;
+        if (ARM_REG_TEMP0 <= reg && reg < ARM_REG_TEMP0 + ARM_REG_TEMP_NUM) {
+            int t = reg - ARM_REG_TEMP0;
+            if (first[t] < 0) {
+                first[t] = k;
+                def[t] = instr;
+            }
+            last[t] = k;
+            return;
+        }
+        ARMRegister host = rule_host_reg(reg, rule_r);
+        if (host != ARM_REG_INVALID)
+            ref_last[host] = k;
+    };
+
+    k = 0;
+    for (ARMInstruction *instr = rule_r->rule->arm_host; instr; instr = instr->next, k++) {
+        for (i = 0; i < instr->opd_num; i++) {
+            ARMOperand *opd = &instr->opd[i];
+
+            if (opd->type == ARM_OPD_TYPE_REG) {
+                note(opd->content.reg.num, instr, k);
+            } else if (opd->type == ARM_OPD_TYPE_MEM) {
+                note(opd->content.mem.base, instr, k);
+                note(opd->content.mem.index, instr, k);
+            }
+        }
+    }
+
+    bool has_temp = false;
+    for (i = 0; i < ARM_REG_TEMP_NUM; i++)
+        has_temp |= first[i] >= 0;
+    if (!has_temp)
+        return true;
+
+    for (auto reg : rule_temp_pool)
+        cand[cand_num++] = reg;
+    for (int r = X86_REG_RAX; r <= X86_REG_R15; r++) {
+        X86Register greg = static_cast<X86Register>(r);
+        if (!rule_r->last_guest->reg_liveness[r])
+            cand[cand_num++] = guest_host_reg_map(greg);
+    }
+
+    /* Scratch registers in the order they are first written */
+    for (;;) {
+        int t = -1;
+        for (i = 0; i < ARM_REG_TEMP_NUM; i++) {
+            if (first[i] >= 0 && rule_temp_reg[i] == ARM_REG_INVALID && (t < 0 || first[i] < first[t]))
+                t = i;
+        }
+        if (t < 0)
+            break;
+
+        ARMRegister host = ARM_REG_INVALID;
+
+        /* mov rtmp, reg with reg dead from here on */
+        if (def[t]->opc == ARM_OPC_MOV && def[t]->opd[0].type == ARM_OPD_TYPE_REG &&
+            def[t]->opd[0].content.reg.num == ARM_REG_TEMP0 + t && def[t]->opd[1].type == ARM_OPD_TYPE_REG) {
+            ARMRegister src = rule_host_reg(def[t]->opd[1].content.reg.num, rule_r);
+            for (i = 0; src != ARM_REG_INVALID && i < cand_num; i++) {
+                if (cand[i] == src && ref_last[src] == first[t] && busy[src] < first[t])
+                    host = src;
+            }
+        }
+
+        for (i = 0; host == ARM_REG_INVALID && i < cand_num; i++) {
+            if (ref_last[cand[i]] < first[t] && busy[cand[i]] < first[t])
+                host = cand[i];
+        }
+
+        if (host == ARM_REG_INVALID)
+            return false;
+
+        rule_temp_reg[t] = host;
+        busy[host] = last[t];
+    }
+    return true;
+}
+
+/* Whether the rule just matched, with the bindings of the match, finds a host
+   register for each of its scratch registers */
+bool FEXCore::CPU::Arm64JITCore::rule_temp_regs_fit(TranslationRule *rule, X86Instruction *last_guest)
+{
+    RuleBindings *b = &rule_bind;
+    GuestRegisterMapping regs[RULE_REG_SYM_NUM];
+    RuleRecord rule_r {};
+
+    rule_r.rule = rule;
+    rule_r.last_guest = last_guest;
+    rule_r.g_reg_map = regs;
+    rule_r.reg_num = b->reg_num;
+    for (uint32_t i = 0; i < b->reg_num; i++)
+        regs[i] = b->reg[b->reg_order[i]];
+
+    return assign_rule_temp_regs(&rule_r);
+}
+
+static bool rule_opt_gpr(ARMRegister reg)
+{
+    return (ARM_REG_R0 <= reg && reg <= ARM_REG_R31) || (ARM_REG_FP <= reg && reg <= ARM_REG_ZR);
+}
+
+/* Resolve the operands of a rule instruction in the context of its rule */
+void FEXCore::CPU::Arm64JITCore::resolve_rule_instr(ARMInstruction *instr, ARMOptInstr *c)
+{
+    c->instr = instr;
+    c->size = instr->OpSize;
+    c->opaque = !arm_opt_supported(instr);
+    for (int i = 0; i < ARM_MAX_OPERAND_NUM; i++) {
+        c->reg[i] = ARM_REG_INVALID;
+        c->index[i] = ARM_REG_INVALID;
+        c->imm[i] = 0;
+    }
+    if (c->opaque)
+        return;
+
+    auto resolve_reg = [&](ARMRegister &reg, bool size_opd) {
+        uint32_t regsize = 0;
+        bool HighBits = false;
+        ARMRegister host = GetGuestRegMap(reg, regsize, std::forward<bool>(HighBits));
+
+        /* Parts of guest registers are merged by the handlers */
+        if (HighBits || regsize == 1 || regsize == 2 || !rule_opt_gpr(host))
+            c->opaque = true;
+        if (size_opd && !c->size && regsize)
+            c->size = 1 << (regsize - 1);
+        return host;
+    };
+    auto resolve_imm = [&](ARMImm *imm) -> uint64_t {
+        /* Label and special symbols only appear in instructions the optimizer doesn't touch */
+        if (imm->type == ARM_IMM_TYPE_SYM && imm->content.sym[0] != 'i') {
+            c->opaque = true;
+            return 0;
+        }
+        return GetImmMapWrapper(imm);
+    };
+
+    /* mov takes its size from the source, everything else from the first operand */
+    size_t size_opd = instr->opc == ARM_OPC_MOV ? 1 : 0;
+
+    for (size_t i = 0; i < instr->opd_num && !c->opaque; i++) {
+        ARMOperand *opd = &instr->opd[i];
+
+        if (opd->type == ARM_OPD_TYPE_REG) {
+            c->reg[i] = resolve_reg(opd->content.reg.num, i == size_opd);
+        } else if (opd->type == ARM_OPD_TYPE_MEM) {
+            c->reg[i] = resolve_reg(opd->content.mem.base, false);
+            c->index[i] = opd->content.mem.index;
+            if (c->index[i] != ARM_REG_INVALID && !rule_opt_gpr(c->index[i]))
+                c->opaque = true;
+            c->imm[i] = resolve_imm(&opd->content.mem.offset);
+        } else if (opd->type == ARM_OPD_TYPE_IMM) {
+            c->imm[i] = resolve_imm(&opd->content.imm);
+        }
+    }
+}
+
+void FEXCore::CPU::Arm64JITCore::set_rule_context(RuleRecord *rule_r)
 {
-    TranslationRule *rule;
+    RuleBindings *b = &rule_bind;
+    uint32_t i;
+
+    reset_bindings();
+    for (i = 0; i < rule_r->imm_num; i++) {
+        uint16_t sym = rule_r->imm_map[i].sym;
+        b->imm_gen[sym] = b->gen;
+        b->imm[sym] = rule_r->imm_map[i];
+    }
+    for (i = 0; i < rule_r->label_num; i++) {
+        uint16_t sym = rule_r->l_map[i].sym;
+        b->label_gen[sym] = b->gen;
+        b->label[sym] = rule_r->l_map[i];
+    }
+    for (i = 0; i < rule_r->reg_num; i++) {
+        uint32_t idx = rule_r->g_reg_map[i].sym - X86_REG_REG0;
+        b->reg_gen[idx] = b->gen;
+        b->reg[idx] = rule_r->g_reg_map[i];
+    }
+    if (!assign_rule_temp_regs(rule_r))
+        LOGMAN_MSG_A_FMT("No free host register for the scratch registers of rule {}, the match should have been rejected", rule_r->rule->index);
+}
 
+void FEXCore::CPU::Arm64JITCore::do_rule_translation(RuleRecord *rule_r)
+{
     if (!rule_r)
         return;
 
-    rule = rule_r->rule;
-    l_map = rule_r->l_map;
-    imm_map = rule_r->imm_map;
-    g_reg_map = rule_r->g_reg_map;
+    do_rule_stream_translation(&rule_r, 1);
+}
 
-    #ifdef PROFILE_RULE_TRANSLATION
-        num_rules_replace++;
-        #ifdef DEBUG_RULE_LOG
-            writeToLogFile(std::to_string(ThreadState->ThreadManager.PID) + "fex-debug.log", "[INFO] ##### PC: 0x" + intToHex(rule_guest_pc) + ", Rule index " +
-                                   std::to_string(rule->index) + ", Total replace num:" +
-                                   std::to_string(num_rules_replace) + "#####\n\n");
-        #else
-            LogMan::Msg::IFmt( "##### PC: 0x{:x}, Rule index {}, Total replace num: {} #####\n",
-                rule_guest_pc, rule->index, num_rules_replace);
-        #endif
-    #endif
+/* Assemble rules that follow each other in the guest code. The host
+   instructions of all of them go through the rule stream optimizer first */
+void FEXCore::CPU::Arm64JITCore::do_rule_stream_translation(RuleRecord **rules, int num)
+{
+    auto &code = rule_opt_buf;
+    code.clear();
 
-    ARMInstruction *arm_code = rule->arm_host;
-    arm_host = arm_code;
+    for (int r = 0; r < num; r++) {
+        RuleRecord *rule_r = rules[r];
+
+        set_rule_context(rule_r);
+        for (ARMInstruction *instr = rule_r->rule->arm_host; instr; instr = instr->next) {
+            code.emplace_back();
+            resolve_rule_instr(instr, &code.back());
+        }
 
-    /* Assemble host instructions in the rule */
-    while(arm_code) {
-        assemble_arm_instr(arm_code, rule_r);
-        arm_code = arm_code->next;
+        if (rule_r->target_pc != 0 || r == num - 1) {
+            code.emplace_back();
+            code.back().live_out = rule_cc_live_out(rule_r->last_guest);
+        }
     }
 
+    arm_opt_rule_stream(code.data(), code.size());
+
+    size_t k = 0;
+    for (int r = 0; r < num; r++) {
+        RuleRecord *rule_r = rules[r];
+
+        set_rule_context(rule_r);
+
+        rule_stats_add(rule_stats.translated_rules, 1);
+        size_t host_begin = GetCursorOffset();
+
+        /* Assemble host instructions in the rule */
+        for (ARMInstruction *instr = rule_r->rule->arm_host; instr; instr = instr->next, k++) {
+            ARMOptInstr *c = &code[k];
+            ARMInstruction *arm_code = c->replaced ? &c->replacement : c->instr;
+            uint8_t live = c->cc_live;
+
+            if (c->removed)
+                continue;
+
+            if (!arm_instr_define_cc(arm_code) || (live & RULE_CC_LIVE)) {
+                /* Nobody reads the carry, leave it in the host form */
+                rule_cf_live = live & RULE_CF_LIVE;
+                assemble_arm_instr(arm_code, rule_r);
+                rule_cf_live = true;
+                continue;
+            }
+
+            /* The flags set here are dead, drop the flag setting form */
+            ARMOpcode opc = arm_flag_free_opc(arm_code->opc);
+            if (opc == ARM_OPC_INVALID)
+                continue;
+            if (arm_code->opd[0].type != ARM_OPD_TYPE_REG || arm_code->opd[0].content.reg.num == ARM_REG_ZR) {
+                assemble_arm_instr(arm_code, rule_r);
+                continue;
+            }
+
+            ARMInstruction flag_free = *arm_code;
+            flag_free.opc = opc;
+            assemble_arm_instr(&flag_free, rule_r);
+        }
+
+        /* Skip the end of rule entry */
+        if (k < code.size() && !code[k].instr)
+            k++;
+
+        rule_tail_translation(rule_r);
+
+        uint32_t host_bytes = GetCursorOffset() - host_begin;
+        rule_stats_add(rule_stats.rule_host_bytes, host_bytes);
+        CTX->RuleStats.CountRule(rule_r->rule, host_bytes);
+        rule_trace(RULE_TRACE_EMIT, rule_r->pc, rule_r->rule->index, host_bytes);
+    }
+}
+
+void FEXCore::CPU::Arm64JITCore::rule_tail_translation(RuleRecord *rule_r)
+{
     if (rule_r->target_pc != 0) {
         if (debug) {
             LogMan::Msg::IFmt("Current TB target_pc: 0x{:x}\n", rule_r->target_pc);
@@ -829,12 +1427,12 @@ void FEXCore::CPU::Arm64JITCore::do_rule_translation(RuleRecord *rule_r, uint32_
         X86Instruction* last_x86 = rule_r->last_guest;
 
         if (!x86_instr_test_branch(last_x86)) {
-            assemble_arm_exit(rule_r->target_pc);
+            assemble_rule_branch(rule_r->target_pc);
         } else if (last_x86->opc == X86_OPC_CALL) {
-            assemble_arm_exit(0);
+            assemble_arm_exit(0, IR::BranchHint::Call);
         } else if (last_x86->opc == X86_OPC_RET) {
             this->RipReg = ARM_REG_R20;
-            assemble_arm_exit(0);
+            assemble_arm_exit(0, IR::BranchHint::Return);
         } else if (last_x86->opc == X86_OPC_JMP) {
             if (last_x86->opd_num && last_x86->opd[0].type == X86_OPD_TYPE_IMM
                     && last_x86->opd[0].content.imm.isRipLiteral) {
@@ -845,43 +1443,11 @@ void FEXCore::CPU::Arm64JITCore::do_rule_translation(RuleRecord *rule_r, uint32_
             // False Block
             const auto IsTarget1 = JumpTargets2.try_emplace(this->FalseNewRip).first;
             Bind(&IsTarget1->second);
-            assemble_arm_exit(this->FalseNewRip);
+            assemble_rule_branch(this->FalseNewRip);
             // True Block
             const auto IsTarget2 = JumpTargets2.try_emplace(this->TrueNewRip).first;
             Bind(&IsTarget2->second);
-            assemble_arm_exit(this->TrueNewRip);
+            assemble_rule_branch(this->TrueNewRip);
         }
     }
 }
-
-bool is_last_access(ARMInstruction *insn, ARMRegister reg)
-{
-    ARMInstruction *head = arm_host;
-    int i;
-
-    while(head && head != insn)
-        head = head->next;
-    if (!head)
-        return true;
-
-    head = head->next;
-
-    while(head) {
-        for (i = 0; i < head->opd_num; i++) {
-            ARMOperand *opd = &head->opd[i];
-
-            if (opd->type == ARM_OPD_TYPE_REG) {
-                if (opd->content.reg.num == reg)
-                    return false;
-            } else if (opd->type == ARM_OPD_TYPE_MEM) {
-                if (opd->content.mem.base == reg)
-                    return false;
-                if (opd->content.mem.index == reg)
-                    return false;
-            }
-        }
-        head = head->next;
-    }
-
-    return true;
-}
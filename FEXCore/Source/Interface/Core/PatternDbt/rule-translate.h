@@ -9,29 +9,51 @@
 
 #include "parse.h"
 
-typedef struct ImmMapping {
-    char imm_str[20];
+#include "rule-sym.h"
+
+#define RULE_REG_SYM_NUM (X86_REG_REG31 - X86_REG_REG0 + 1)
+
+typedef struct {
+    uint16_t sym;       /* interned symbol in a rule */
     uint64_t imm_val;
-    struct ImmMapping *next;
 } ImmMapping;
 
-typedef struct GuestRegisterMapping {
+typedef struct {
     X86Register sym;    /* symbolic register in a rule */
     X86Register num;    /* real register in guest instruction */
     uint32_t regsize;
     bool HighBits;
-
-    struct GuestRegisterMapping *next;
 } GuestRegisterMapping;
 
-typedef struct LabelMapping {
-    char lab_str[20];
+typedef struct {
+    uint16_t sym;       /* interned symbol in a rule */
     uint64_t target;
     uint64_t fallthrough;
-
-    struct LabelMapping *next;
 } LabelMapping;
 
+/* Symbol bindings of the rule being matched or assembled, indexed by symbol.
+   An entry is bound only while its gen equals gen, so the bindings of a
+   candidate that failed are dropped at once by bumping gen. The order
+   arrays list the bound symbols for copying them into a RuleRecord. */
+typedef struct {
+    uint32_t gen;
+
+    uint32_t imm_gen[RULE_SYM_MAX];
+    ImmMapping imm[RULE_SYM_MAX];
+    uint16_t imm_order[RULE_SYM_MAX];
+    uint32_t imm_num;
+
+    uint32_t label_gen[RULE_SYM_MAX];
+    LabelMapping label[RULE_SYM_MAX];
+    uint16_t label_order[RULE_SYM_MAX];
+    uint32_t label_num;
+
+    uint32_t reg_gen[RULE_REG_SYM_NUM];
+    GuestRegisterMapping reg[RULE_REG_SYM_NUM];
+    uint8_t reg_order[RULE_REG_SYM_NUM];
+    uint32_t reg_num;
+} RuleBindings;
+
 typedef struct {
     uint64_t pc;            /* Simulated guest pc */
     uint64_t target_pc;     /* Branch target pc.
@@ -42,12 +64,15 @@ typedef struct {
                                Only valid at the first instruction */
     bool update_cc;         /* If guest instructions in this rule update condition codes */
     bool save_cc;           /* If the condition code needs to be saved */
+
+    /* Bindings of this rule instance, in the map buffers */
     ImmMapping *imm_map;
+    uint32_t imm_num;
     GuestRegisterMapping *g_reg_map;
+    uint32_t reg_num;
     LabelMapping *l_map;
+    uint32_t label_num;
     int para_opc[20];
 } RuleRecord;
 
-
-bool is_last_access(ARMInstruction *, ARMRegister);
 #endif
@@ -6,10 +6,13 @@
 #include <cstdlib>
 
 #include "x86-instr.h"
+#include "rule-sym.h"
 #include "rule-debug-log.h"
 
 #define MAX_INSTR_NUM 1000000
 
+static constexpr bool debug = false;
+
 static const char *x86_opc_str[] = {
     [X86_OPC_INVALID] = "**** unsupported (x86) ****",
     [X86_OPC_NOP] = "nop",
@@ -80,6 +83,24 @@ static const char *x86_opc_str[] = {
     [X86_OPC_MOVDQU] = "movdqu",
     [X86_OPC_PMOVMSKB] = "pmovmskb",
     [X86_OPC_PALIGNR] = "palignr",
+    [X86_OPC_PMOVSXBW] = "pmovsxbw",
+    [X86_OPC_PMOVSXBD] = "pmovsxbd",
+    [X86_OPC_PMOVSXWD] = "pmovsxwd",
+    [X86_OPC_PMOVSXDQ] = "pmovsxdq",
+    [X86_OPC_PMOVZXBW] = "pmovzxbw",
+    [X86_OPC_PMOVZXBD] = "pmovzxbd",
+    [X86_OPC_PMOVZXWD] = "pmovzxwd",
+    [X86_OPC_PMOVZXDQ] = "pmovzxdq",
+    [X86_OPC_MOVMSKPS] = "movmskps",
+    [X86_OPC_MOVMSKPD] = "movmskpd",
+    [X86_OPC_PEXTRB] = "pextrb",
+    [X86_OPC_PEXTRW] = "pextrw",
+    [X86_OPC_PEXTRD] = "pextrd",
+    [X86_OPC_PEXTRQ] = "pextrq",
+    [X86_OPC_PINSRB] = "pinsrb",
+    [X86_OPC_PINSRW] = "pinsrw",
+    [X86_OPC_PINSRD] = "pinsrd",
+    [X86_OPC_PINSRQ] = "pinsrq",
 
     // Logical
     [X86_OPC_ANDPS] = "andps",
@@ -92,6 +113,9 @@ static const char *x86_opc_str[] = {
     [X86_OPC_PANDN] = "pandn",
     [X86_OPC_POR] = "por",
     [X86_OPC_PXOR] = "pxor",
+    [X86_OPC_ANDNPS] = "andnps",
+    [X86_OPC_ANDNPD] = "andnpd",
+    [X86_OPC_PTEST] = "ptest",
 
     [X86_OPC_PACKUSWB] = "packuswb",
     [X86_OPC_PACKSSWB] = "packsswb",
@@ -104,11 +128,19 @@ static const char *x86_opc_str[] = {
     [X86_OPC_PUNPCKHDQ] = "punpckhdq",
     [X86_OPC_PUNPCKLQDQ] = "punpcklqdq",
     [X86_OPC_PUNPCKHQDQ] = "punpckhqdq",
+    [X86_OPC_PACKUSDW] = "packusdw",
+    [X86_OPC_UNPCKLPS] = "unpcklps",
+    [X86_OPC_UNPCKHPS] = "unpckhps",
+    [X86_OPC_UNPCKLPD] = "unpcklpd",
+    [X86_OPC_UNPCKHPD] = "unpckhpd",
     // Shuffle
     [X86_OPC_SHUFPD] = "shufpd",
     [X86_OPC_PSHUFD] = "pshufd",
     [X86_OPC_PSHUFLW] = "pshuflw",
     [X86_OPC_PSHUFHW] = "pshufhw",
+    [X86_OPC_SHUFPS] = "shufps",
+    [X86_OPC_PSHUFB] = "pshufb",
+    [X86_OPC_PBLENDW] = "pblendw",
 
     // Comparison
     [X86_OPC_PCMPGTB] = "pcmpgtb",
@@ -117,6 +149,26 @@ static const char *x86_opc_str[] = {
     [X86_OPC_PCMPEQB] = "pcmpeqb",
     [X86_OPC_PCMPEQW] = "pcmpeqw",
     [X86_OPC_PCMPEQD] = "pcmpeqd",
+    [X86_OPC_PCMPEQQ] = "pcmpeqq",
+    [X86_OPC_PCMPGTQ] = "pcmpgtq",
+    [X86_OPC_CMPPS] = "cmpps",
+    [X86_OPC_CMPPD] = "cmppd",
+    [X86_OPC_UCOMISS] = "ucomiss",
+    [X86_OPC_UCOMISD] = "ucomisd",
+    [X86_OPC_COMISS] = "comiss",
+    [X86_OPC_COMISD] = "comisd",
+
+    // Shift
+    [X86_OPC_PSRLW] = "psrlw",
+    [X86_OPC_PSRLD] = "psrld",
+    [X86_OPC_PSRLQ] = "psrlq",
+    [X86_OPC_PSRAW] = "psraw",
+    [X86_OPC_PSRAD] = "psrad",
+    [X86_OPC_PSLLW] = "psllw",
+    [X86_OPC_PSLLD] = "pslld",
+    [X86_OPC_PSLLQ] = "psllq",
+    [X86_OPC_PSRLDQ] = "psrldq",
+    [X86_OPC_PSLLDQ] = "pslldq",
 
     // Algorithm
     [X86_OPC_ADDPS] = "addps",
@@ -129,6 +181,74 @@ static const char *x86_opc_str[] = {
     [X86_OPC_SUBSD] = "subsd",
     [X86_OPC_PSUBB] = "psubb",
     [X86_OPC_PADDD] = "paddd",
+    [X86_OPC_PADDB] = "paddb",
+    [X86_OPC_PADDW] = "paddw",
+    [X86_OPC_PADDQ] = "paddq",
+    [X86_OPC_PSUBW] = "psubw",
+    [X86_OPC_PSUBD] = "psubd",
+    [X86_OPC_PSUBQ] = "psubq",
+    [X86_OPC_PADDSB] = "paddsb",
+    [X86_OPC_PADDSW] = "paddsw",
+    [X86_OPC_PADDUSB] = "paddusb",
+    [X86_OPC_PADDUSW] = "paddusw",
+    [X86_OPC_PSUBSB] = "psubsb",
+    [X86_OPC_PSUBSW] = "psubsw",
+    [X86_OPC_PSUBUSB] = "psubusb",
+    [X86_OPC_PSUBUSW] = "psubusw",
+    [X86_OPC_PMULLW] = "pmullw",
+    [X86_OPC_PMULHW] = "pmulhw",
+    [X86_OPC_PMULHUW] = "pmulhuw",
+    [X86_OPC_PMULLD] = "pmulld",
+    [X86_OPC_PMULUDQ] = "pmuludq",
+    [X86_OPC_PMULDQ] = "pmuldq",
+    [X86_OPC_PMADDWD] = "pmaddwd",
+    [X86_OPC_PMADDUBSW] = "pmaddubsw",
+    [X86_OPC_PMULHRSW] = "pmulhrsw",
+    [X86_OPC_PHADDW] = "phaddw",
+    [X86_OPC_PHADDD] = "phaddd",
+    [X86_OPC_PAVGB] = "pavgb",
+    [X86_OPC_PAVGW] = "pavgw",
+    [X86_OPC_PSADBW] = "psadbw",
+    [X86_OPC_PABSB] = "pabsb",
+    [X86_OPC_PABSW] = "pabsw",
+    [X86_OPC_PABSD] = "pabsd",
+    [X86_OPC_PMINUB] = "pminub",
+    [X86_OPC_PMINUW] = "pminuw",
+    [X86_OPC_PMINUD] = "pminud",
+    [X86_OPC_PMINSB] = "pminsb",
+    [X86_OPC_PMINSW] = "pminsw",
+    [X86_OPC_PMINSD] = "pminsd",
+    [X86_OPC_PMAXUB] = "pmaxub",
+    [X86_OPC_PMAXUW] = "pmaxuw",
+    [X86_OPC_PMAXUD] = "pmaxud",
+    [X86_OPC_PMAXSB] = "pmaxsb",
+    [X86_OPC_PMAXSW] = "pmaxsw",
+    [X86_OPC_PMAXSD] = "pmaxsd",
+    [X86_OPC_MULPS] = "mulps",
+    [X86_OPC_MULPD] = "mulpd",
+    [X86_OPC_MULSS] = "mulss",
+    [X86_OPC_MULSD] = "mulsd",
+    [X86_OPC_DIVPS] = "divps",
+    [X86_OPC_DIVPD] = "divpd",
+    [X86_OPC_DIVSS] = "divss",
+    [X86_OPC_DIVSD] = "divsd",
+    [X86_OPC_MINPS] = "minps",
+    [X86_OPC_MINPD] = "minpd",
+    [X86_OPC_MINSS] = "minss",
+    [X86_OPC_MINSD] = "minsd",
+    [X86_OPC_MAXPS] = "maxps",
+    [X86_OPC_MAXPD] = "maxpd",
+    [X86_OPC_MAXSS] = "maxss",
+    [X86_OPC_MAXSD] = "maxsd",
+    [X86_OPC_SQRTPS] = "sqrtps",
+    [X86_OPC_SQRTPD] = "sqrtpd",
+    [X86_OPC_SQRTSS] = "sqrtss",
+    [X86_OPC_SQRTSD] = "sqrtsd",
+
+    // Conversion
+    [X86_OPC_CVTDQ2PS] = "cvtdq2ps",
+    [X86_OPC_CVTPS2DQ] = "cvtps2dq",
+    [X86_OPC_CVTTPS2DQ] = "cvttps2dq",
 
     [X86_OPC_SET_LABEL] = "set label",
 };
@@ -353,6 +473,7 @@ void set_x86_opd_imm_sym_str(X86Operand *opd, char *imm_str, bool isRipLiteral)
 
     iopd->type = X86_IMM_TYPE_SYM;
     strcpy(iopd->content.sym, imm_str);
+    iopd->sym_id = rule_sym_intern(imm_str);
     iopd->isRipLiteral = isRipLiteral;
 }
 
@@ -429,6 +550,7 @@ void set_x86_opd_mem_scale_str(X86Operand *opd, char *scale_str)
     if (strstr(scale_str, "imm")) {
         opd->content.mem.scale.type = X86_IMM_TYPE_SYM;
         strcpy(opd->content.mem.scale.content.sym, scale_str);
+        opd->content.mem.scale.sym_id = rule_sym_intern(scale_str);
     } else {
         opd->content.mem.scale.type = X86_IMM_TYPE_VAL;
         opd->content.mem.scale.content.val = atoi(scale_str);
@@ -446,6 +568,7 @@ void set_x86_opd_mem_off_str(X86Operand *opd, char *off_str, bool neg)
     if (strstr(off_str, "imm")) { /* offset is a symbol */
         opd->content.mem.offset.type = X86_IMM_TYPE_SYM;
         strcpy(opd->content.mem.offset.content.sym, off_str);
+        opd->content.mem.offset.sym_id = rule_sym_intern(off_str);
     } else { /* offset is a constant integer */
         opd->content.mem.offset.type = X86_IMM_TYPE_VAL;
         if (neg) /* negative value */
@@ -474,38 +597,188 @@ bool x86_instr_test_branch(X86Instruction *instr)
     return false;
 }
 
-static inline bool insn_define_cc(X86Opcode opc)
+static inline bool is_x86_gpr(X86Register reg)
 {
-    if ((opc == X86_OPC_AND) || (opc == X86_OPC_OR) ||
-       (opc == X86_OPC_XOR) || (opc == X86_OPC_SAR) ||
-       (opc == X86_OPC_NEG) || (opc == X86_OPC_INC) ||
-       (opc == X86_OPC_DEC) || (opc == X86_OPC_ADD) ||
-       (opc == X86_OPC_ADC) || (opc == X86_OPC_SUB) ||
-       (opc == X86_OPC_SBB) || (opc == X86_OPC_IMUL) ||
-       (opc == X86_OPC_SHL) || (opc == X86_OPC_SHR) ||
-       (opc == X86_OPC_SHLD)|| (opc == X86_OPC_SHRD)||
-       (opc == X86_OPC_BT)  || (opc == X86_OPC_TEST)||
-       (opc == X86_OPC_CMP))
-      return true;
-    return false;
+    return reg >= X86_REG_RAX && reg <= X86_REG_R15;
 }
 
-void decide_reg_liveness(int succ_define_cc, X86Instruction *insn_seq)
+/* Shifts by a zero count leave the condition codes alone */
+static inline bool insn_shift_count_nonzero(X86Instruction *insn, int opd_idx)
+{
+    X86Operand *opd = &insn->opd[opd_idx];
+    return opd_idx < insn->opd_num && opd->type == X86_OPD_TYPE_IMM &&
+           opd->content.imm.type == X86_IMM_TYPE_VAL && (opd->content.imm.content.val & 0x1f);
+}
+
+/* Condition codes and registers this instruction reads (use) and overwrites (def).
+   Anything not modelled by the shadow instructions is assumed to read everything. */
+static void insn_use_def(X86Instruction *insn, bool *use, bool *def)
 {
-    bool cur_liveness[X86_REG_NUM];
-    X86Instruction *tail;
-    X86Instruction *insn;
-    bool cc_revised;
     int i;
 
-    for (i = 0; i < X86_REG_NUM; i++)
-        cur_liveness[i] = true;
+    if (insn->opc == X86_OPC_INVALID) {
+        for (i = X86_REG_RAX; i <= X86_REG_ZF; i++)
+            use[i] = true;
+        return;
+    }
 
-    if (succ_define_cc == 3) {
-        for (i = X86_REG_OF; i < X86_REG_NUM; i++)
-            cur_liveness[i] = false;
+    /* 1. Conditional execution */
+    switch (insn->opc) {
+        case X86_OPC_CMOVNE:
+        case X86_OPC_SETE:
+        case X86_OPC_JE:
+        case X86_OPC_JNE:
+            use[X86_REG_ZF] = true;
+            break;
+        case X86_OPC_CMOVB:
+        case X86_OPC_JAE:
+        case X86_OPC_JB:
+            use[X86_REG_CF] = true;
+            break;
+        case X86_OPC_JS:
+        case X86_OPC_JNS:
+            use[X86_REG_SF] = true;
+            break;
+        case X86_OPC_CMOVA:
+        case X86_OPC_JA:
+        case X86_OPC_JBE:
+            use[X86_REG_CF] = true;
+            use[X86_REG_ZF] = true;
+            break;
+        case X86_OPC_CMOVL:
+        case X86_OPC_JL:
+        case X86_OPC_JGE:
+            use[X86_REG_SF] = true;
+            use[X86_REG_OF] = true;
+            break;
+        case X86_OPC_JLE:
+        case X86_OPC_JG:
+            use[X86_REG_ZF] = true;
+            use[X86_REG_SF] = true;
+            use[X86_REG_OF] = true;
+            break;
+        default:
+            break;
     }
 
+    /* 2. Condition code as an operand, and the condition codes defined */
+    switch (insn->opc) {
+        case X86_OPC_ADC:
+        case X86_OPC_SBB:
+            use[X86_REG_CF] = true;
+            [[fallthrough]];
+        case X86_OPC_ADD:
+        case X86_OPC_SUB:
+        case X86_OPC_CMP:
+        case X86_OPC_NEG:
+        case X86_OPC_AND:
+        case X86_OPC_OR:
+        case X86_OPC_XOR:
+        case X86_OPC_TEST:
+        case X86_OPC_PTEST:
+        case X86_OPC_UCOMISS:
+        case X86_OPC_UCOMISD:
+        case X86_OPC_COMISS:
+        case X86_OPC_COMISD:
+            for (i = X86_REG_OF; i <= X86_REG_ZF; i++)
+                def[i] = true;
+            break;
+        case X86_OPC_INC:
+        case X86_OPC_DEC:
+            /* CF is preserved */
+            def[X86_REG_OF] = def[X86_REG_SF] = def[X86_REG_ZF] = true;
+            break;
+        case X86_OPC_MULL:
+        case X86_OPC_IMUL:
+            /* SF and ZF are undefined, keep whatever they had */
+            def[X86_REG_OF] = def[X86_REG_CF] = true;
+            break;
+        case X86_OPC_BT:
+            def[X86_REG_CF] = true;
+            break;
+        case X86_OPC_SHL:
+        case X86_OPC_SHR:
+        case X86_OPC_SAR:
+            /* OF is only defined for a count of 1 */
+            if (insn_shift_count_nonzero(insn, 1))
+                def[X86_REG_CF] = def[X86_REG_SF] = def[X86_REG_ZF] = true;
+            break;
+        case X86_OPC_SHLD:
+        case X86_OPC_SHRD:
+            if (insn_shift_count_nonzero(insn, 2))
+                def[X86_REG_CF] = def[X86_REG_SF] = def[X86_REG_ZF] = true;
+            break;
+        default:
+            break;
+    }
+
+    /* 3. Registers, only a full 32 or 64-bit write of a pure move kills the destination */
+    bool pure_def = (insn->opc == X86_OPC_MOV || insn->opc == X86_OPC_MOVZX ||
+                     insn->opc == X86_OPC_MOVSX || insn->opc == X86_OPC_MOVSXD ||
+                     insn->opc == X86_OPC_LEA) &&
+                    (insn->DestSize == FEXCore::X86Tables::DecodeFlags::SIZE_32BIT ||
+                     insn->DestSize == FEXCore::X86Tables::DecodeFlags::SIZE_64BIT);
+
+    for (i = 0; i < insn->opd_num; i++) {
+        X86Operand *opd = &insn->opd[i];
+
+        if (opd->type == X86_OPD_TYPE_REG && is_x86_gpr(opd->content.reg.num)) {
+            if (i == 0 && pure_def && !opd->content.reg.HighBits)
+                def[opd->content.reg.num] = true;
+            else
+                use[opd->content.reg.num] = true;
+        } else if (opd->type == X86_OPD_TYPE_MEM) {
+            if (is_x86_gpr(opd->content.mem.base))
+                use[opd->content.mem.base] = true;
+            if (is_x86_gpr(opd->content.mem.index))
+                use[opd->content.mem.index] = true;
+        }
+    }
+
+    /* 4. Implicit operands */
+    switch (insn->opc) {
+        case X86_OPC_PUSH:
+        case X86_OPC_POP:
+        case X86_OPC_CALL:
+        case X86_OPC_RET:
+            use[X86_REG_RSP] = true;
+            break;
+        case X86_OPC_IMUL:
+            /* Only the one operand form multiplies into RDX:RAX */
+            if (insn->opd_num != 1)
+                break;
+            [[fallthrough]];
+        case X86_OPC_MULL:
+            use[X86_REG_RAX] = true;
+            def[X86_REG_RAX] = true;
+            /* The 16-bit forms merge into DX */
+            if (insn->DestSize == FEXCore::X86Tables::DecodeFlags::SIZE_32BIT ||
+                insn->DestSize == FEXCore::X86Tables::DecodeFlags::SIZE_64BIT)
+                def[X86_REG_RDX] = true;
+            else
+                use[X86_REG_RDX] = true;
+            break;
+        case X86_OPC_CWT:
+            use[X86_REG_RAX] = true;
+            use[X86_REG_RDX] = true;
+            break;
+        default:
+            break;
+    }
+}
+
+/* Backward liveness of the general purpose registers and condition codes over
+   one block. live holds the liveness at the end of the block on entry, and at
+   its start on return. Vector registers are not tracked and always live. */
+void decide_reg_liveness(X86Instruction *insn_seq, bool *live)
+{
+    X86Instruction *tail;
+    X86Instruction *insn;
+    int i;
+
+    for (i = X86_REG_XMM0; i <= X86_REG_XMM15; i++)
+        live[i] = true;
+
     /* Find out the tail */
     tail = insn_seq;
     while (tail && tail->next)
@@ -514,62 +787,30 @@ void decide_reg_liveness(int succ_define_cc, X86Instruction *insn_seq)
     /* Decide register liveness */
     insn = tail;
     while(insn) {
+        bool use[X86_REG_NUM] = {false};
+        bool def[X86_REG_NUM] = {false};
+
         for (i = 0; i < X86_REG_NUM; i++)
-            insn->reg_liveness[i] = cur_liveness[i];
-
-        /* Check if this instruciton uses any condition code */
-        /* 1. Conditional execution */
-        switch (insn->opc) {
-            case X86_OPC_CMOVNE:
-            case X86_OPC_SETE:
-            case X86_OPC_JE:
-            case X86_OPC_JNE:
-                cur_liveness[X86_REG_ZF] = true;
-                break;
-            case X86_OPC_CMOVB:
-            case X86_OPC_JAE:
-            case X86_OPC_JB:
-                cur_liveness[X86_REG_CF] = true;
-                break;
-            case X86_OPC_JS:
-            case X86_OPC_JNS:
-                cur_liveness[X86_REG_SF] = true;
-                break;
-            case X86_OPC_CMOVA:
-            case X86_OPC_JA:
-            case X86_OPC_JBE:
-                cur_liveness[X86_REG_CF] = true;
-                cur_liveness[X86_REG_ZF] = true;
-                break;
-            case X86_OPC_CMOVL:
-            case X86_OPC_JL:
-            case X86_OPC_JGE:
-                cur_liveness[X86_REG_SF] = true;
-                cur_liveness[X86_REG_OF] = true;
-                break;
-            case X86_OPC_JLE:
-            case X86_OPC_JG:
-                cur_liveness[X86_REG_ZF] = true;
-                cur_liveness[X86_REG_SF] = true;
-                cur_liveness[X86_REG_OF] = true;
-                break;
-            default:
-                fprintf(stderr, "Error: unexpected condition code: %d\n", insn->opc);
+            insn->reg_liveness[i] = live[i];
+
+        insn_use_def(insn, use, def);
+
+        /* The condition codes defined here only need to be kept if someone reads them */
+        insn->save_cc = false;
+        for (i = X86_REG_OF; i <= X86_REG_ZF; i++) {
+            if (def[i] && live[i])
+                insn->save_cc = true;
         }
-        /* 2. Condition code as an operand */
-        if (insn->opc == X86_OPC_ADC || insn->opc == X86_OPC_SBB || insn->opc == X86_OPC_BT)
-            cur_liveness[X86_REG_CF] = true;
 
-        /* 3. Update the liveness if this instruciton defines condition code */
-        if (insn_define_cc(insn->opc)) {
-            for (i = X86_REG_OF; i < X86_REG_NUM; i++)
-                cur_liveness[i] = false;
+        for (i = 0; i < X86_REG_NUM; i++) {
+            if (def[i])
+                live[i] = false;
+            if (use[i])
+                live[i] = true;
         }
 
         insn = insn->prev;
     }
-
-    /* Decide if we need to save condition codes for instructions that define condtion codes */
 }
 
 void DecodeInstToX86Inst(FEXCore::X86Tables::DecodedInst *DecodeInst, X86Instruction *instr, uint64_t pid)
@@ -585,8 +826,9 @@ void DecodeInstToX86Inst(FEXCore::X86Tables::DecodedInst *DecodeInst, X86Instruc
                              ", InstSize: " + std::to_string(static_cast<int>(DecodeInst->InstSize)) + "\n";
       writeToLogFile(std::to_string(pid) + "fex-debug.log", logContent);
     #else
-      LogMan::Msg::IFmt("Inst at 0x{:x}: 0x{:04x} '{}' with DS: {}, SS: {}, InstSize: {}",
-              DecodeInst->PC, DecodeInst->OP, DecodeInst->TableInfo->Name ?: "UND", DestSize, SrcSize, DecodeInst->InstSize);
+      if (debug)
+        LogMan::Msg::IFmt("Inst at 0x{:x}: 0x{:04x} '{}' with DS: {}, SS: {}, InstSize: {}",
+                DecodeInst->PC, DecodeInst->OP, DecodeInst->TableInfo->Name ?: "UND", DestSize, SrcSize, DecodeInst->InstSize);
     #endif
 
     if (DecodeInst->Flags & (FEXCore::X86Tables::DecodeFlags::FLAG_SEGMENTS | FEXCore::X86Tables::DecodeFlags::FLAG_LOCK))
@@ -1109,6 +1351,373 @@ void DecodeInstToX86Inst(FEXCore::X86Tables::DecodedInst *DecodeInst, X86Instruc
         else if (!strcmp(DecodeInst->TableInfo->Name, "PADDD") && ((DecodeInst->OP == 0xFE))) {
             set_x86_instr_opc(instr, X86_OPC_PADDD);
         }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PADDB") && ((DecodeInst->OP == 0xFC))) {
+            set_x86_instr_opc(instr, X86_OPC_PADDB);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PADDW") && ((DecodeInst->OP == 0xFD))) {
+            set_x86_instr_opc(instr, X86_OPC_PADDW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PADDQ") && ((DecodeInst->OP == 0xD4))) {
+            set_x86_instr_opc(instr, X86_OPC_PADDQ);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSUBW") && ((DecodeInst->OP == 0xF9))) {
+            set_x86_instr_opc(instr, X86_OPC_PSUBW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSUBD") && ((DecodeInst->OP == 0xFA))) {
+            set_x86_instr_opc(instr, X86_OPC_PSUBD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSUBQ") && ((DecodeInst->OP == 0xFB))) {
+            set_x86_instr_opc(instr, X86_OPC_PSUBQ);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PADDSB") && ((DecodeInst->OP == 0xEC))) {
+            set_x86_instr_opc(instr, X86_OPC_PADDSB);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PADDSW") && ((DecodeInst->OP == 0xED))) {
+            set_x86_instr_opc(instr, X86_OPC_PADDSW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PADDUSB") && ((DecodeInst->OP == 0xDC))) {
+            set_x86_instr_opc(instr, X86_OPC_PADDUSB);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PADDUSW") && ((DecodeInst->OP == 0xDD))) {
+            set_x86_instr_opc(instr, X86_OPC_PADDUSW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSUBSB") && ((DecodeInst->OP == 0xE8))) {
+            set_x86_instr_opc(instr, X86_OPC_PSUBSB);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSUBSW") && ((DecodeInst->OP == 0xE9))) {
+            set_x86_instr_opc(instr, X86_OPC_PSUBSW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSUBUSB") && ((DecodeInst->OP == 0xD8))) {
+            set_x86_instr_opc(instr, X86_OPC_PSUBUSB);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSUBUSW") && ((DecodeInst->OP == 0xD9))) {
+            set_x86_instr_opc(instr, X86_OPC_PSUBUSW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMULLW") && ((DecodeInst->OP == 0xD5))) {
+            set_x86_instr_opc(instr, X86_OPC_PMULLW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMULHW") && ((DecodeInst->OP == 0xE5))) {
+            set_x86_instr_opc(instr, X86_OPC_PMULHW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMULHUW") && ((DecodeInst->OP == 0xE4))) {
+            set_x86_instr_opc(instr, X86_OPC_PMULHUW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMULUDQ") && ((DecodeInst->OP == 0xF4))) {
+            set_x86_instr_opc(instr, X86_OPC_PMULUDQ);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMADDWD") && ((DecodeInst->OP == 0xF5))) {
+            set_x86_instr_opc(instr, X86_OPC_PMADDWD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PAVGB") && ((DecodeInst->OP == 0xE0))) {
+            set_x86_instr_opc(instr, X86_OPC_PAVGB);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PAVGW") && ((DecodeInst->OP == 0xE3))) {
+            set_x86_instr_opc(instr, X86_OPC_PAVGW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSADBW") && ((DecodeInst->OP == 0xF6))) {
+            set_x86_instr_opc(instr, X86_OPC_PSADBW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMINUB") && ((DecodeInst->OP == 0xDA))) {
+            set_x86_instr_opc(instr, X86_OPC_PMINUB);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMAXUB") && ((DecodeInst->OP == 0xDE))) {
+            set_x86_instr_opc(instr, X86_OPC_PMAXUB);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMINSW") && ((DecodeInst->OP == 0xEA))) {
+            set_x86_instr_opc(instr, X86_OPC_PMINSW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMAXSW") && ((DecodeInst->OP == 0xEE))) {
+            set_x86_instr_opc(instr, X86_OPC_PMAXSW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSRLW") && ((DecodeInst->OP == 0xD1))) {
+            set_x86_instr_opc(instr, X86_OPC_PSRLW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSRLD") && ((DecodeInst->OP == 0xD2))) {
+            set_x86_instr_opc(instr, X86_OPC_PSRLD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSRLQ") && ((DecodeInst->OP == 0xD3))) {
+            set_x86_instr_opc(instr, X86_OPC_PSRLQ);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSRAW") && ((DecodeInst->OP == 0xE1))) {
+            set_x86_instr_opc(instr, X86_OPC_PSRAW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSRAD") && ((DecodeInst->OP == 0xE2))) {
+            set_x86_instr_opc(instr, X86_OPC_PSRAD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSLLW") && ((DecodeInst->OP == 0xF1))) {
+            set_x86_instr_opc(instr, X86_OPC_PSLLW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSLLD") && ((DecodeInst->OP == 0xF2))) {
+            set_x86_instr_opc(instr, X86_OPC_PSLLD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSLLQ") && ((DecodeInst->OP == 0xF3))) {
+            set_x86_instr_opc(instr, X86_OPC_PSLLQ);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "MULPS") && ((DecodeInst->OP == 0x59))) {
+            set_x86_instr_opc(instr, X86_OPC_MULPS);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "MULPD") && ((DecodeInst->OP == 0x59))) {
+            set_x86_instr_opc(instr, X86_OPC_MULPD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "MULSS") && ((DecodeInst->OP == 0x59))) {
+            set_x86_instr_opc(instr, X86_OPC_MULSS);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "MULSD") && ((DecodeInst->OP == 0x59))) {
+            set_x86_instr_opc(instr, X86_OPC_MULSD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "DIVPS") && ((DecodeInst->OP == 0x5E))) {
+            set_x86_instr_opc(instr, X86_OPC_DIVPS);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "DIVPD") && ((DecodeInst->OP == 0x5E))) {
+            set_x86_instr_opc(instr, X86_OPC_DIVPD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "DIVSS") && ((DecodeInst->OP == 0x5E))) {
+            set_x86_instr_opc(instr, X86_OPC_DIVSS);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "DIVSD") && ((DecodeInst->OP == 0x5E))) {
+            set_x86_instr_opc(instr, X86_OPC_DIVSD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "MINPS") && ((DecodeInst->OP == 0x5D))) {
+            set_x86_instr_opc(instr, X86_OPC_MINPS);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "MINPD") && ((DecodeInst->OP == 0x5D))) {
+            set_x86_instr_opc(instr, X86_OPC_MINPD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "MINSS") && ((DecodeInst->OP == 0x5D))) {
+            set_x86_instr_opc(instr, X86_OPC_MINSS);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "MINSD") && ((DecodeInst->OP == 0x5D))) {
+            set_x86_instr_opc(instr, X86_OPC_MINSD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "MAXPS") && ((DecodeInst->OP == 0x5F))) {
+            set_x86_instr_opc(instr, X86_OPC_MAXPS);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "MAXPD") && ((DecodeInst->OP == 0x5F))) {
+            set_x86_instr_opc(instr, X86_OPC_MAXPD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "MAXSS") && ((DecodeInst->OP == 0x5F))) {
+            set_x86_instr_opc(instr, X86_OPC_MAXSS);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "MAXSD") && ((DecodeInst->OP == 0x5F))) {
+            set_x86_instr_opc(instr, X86_OPC_MAXSD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "SQRTPS") && ((DecodeInst->OP == 0x51))) {
+            set_x86_instr_opc(instr, X86_OPC_SQRTPS);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "SQRTPD") && ((DecodeInst->OP == 0x51))) {
+            set_x86_instr_opc(instr, X86_OPC_SQRTPD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "SQRTSS") && ((DecodeInst->OP == 0x51))) {
+            set_x86_instr_opc(instr, X86_OPC_SQRTSS);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "SQRTSD") && ((DecodeInst->OP == 0x51))) {
+            set_x86_instr_opc(instr, X86_OPC_SQRTSD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "ANDNPS") && ((DecodeInst->OP == 0x55))) {
+            set_x86_instr_opc(instr, X86_OPC_ANDNPS);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "ANDNPD") && ((DecodeInst->OP == 0x55))) {
+            set_x86_instr_opc(instr, X86_OPC_ANDNPD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "UNPCKLPS") && ((DecodeInst->OP == 0x14))) {
+            set_x86_instr_opc(instr, X86_OPC_UNPCKLPS);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "UNPCKHPS") && ((DecodeInst->OP == 0x15))) {
+            set_x86_instr_opc(instr, X86_OPC_UNPCKHPS);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "UNPCKLPD") && ((DecodeInst->OP == 0x14))) {
+            set_x86_instr_opc(instr, X86_OPC_UNPCKLPD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "UNPCKHPD") && ((DecodeInst->OP == 0x15))) {
+            set_x86_instr_opc(instr, X86_OPC_UNPCKHPD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "UCOMISS") && ((DecodeInst->OP == 0x2E))) {
+            set_x86_instr_opc(instr, X86_OPC_UCOMISS);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "UCOMISD") && ((DecodeInst->OP == 0x2E))) {
+            set_x86_instr_opc(instr, X86_OPC_UCOMISD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "COMISS") && ((DecodeInst->OP == 0x2F))) {
+            set_x86_instr_opc(instr, X86_OPC_COMISS);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "COMISD") && ((DecodeInst->OP == 0x2F))) {
+            set_x86_instr_opc(instr, X86_OPC_COMISD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "MOVMSKPS") && ((DecodeInst->OP == 0x50))) {
+            set_x86_instr_opc(instr, X86_OPC_MOVMSKPS);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "MOVMSKPD") && ((DecodeInst->OP == 0x50))) {
+            set_x86_instr_opc(instr, X86_OPC_MOVMSKPD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "CVTDQ2PS") && ((DecodeInst->OP == 0x5B))) {
+            set_x86_instr_opc(instr, X86_OPC_CVTDQ2PS);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "CVTPS2DQ") && ((DecodeInst->OP == 0x5B))) {
+            set_x86_instr_opc(instr, X86_OPC_CVTPS2DQ);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "CVTTPS2DQ") && ((DecodeInst->OP == 0x5B))) {
+            set_x86_instr_opc(instr, X86_OPC_CVTTPS2DQ);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "SHUFPS") && ((DecodeInst->OP == 0xC6))) {
+            set_x86_instr_opc(instr, X86_OPC_SHUFPS);
+            ThreeSrc = true;
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "CMPPS") && ((DecodeInst->OP == 0xC2))) {
+            set_x86_instr_opc(instr, X86_OPC_CMPPS);
+            ThreeSrc = true;
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "CMPPD") && ((DecodeInst->OP == 0xC2))) {
+            set_x86_instr_opc(instr, X86_OPC_CMPPD);
+            ThreeSrc = true;
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PINSRW") && ((DecodeInst->OP == 0xC4))) {
+            set_x86_instr_opc(instr, X86_OPC_PINSRW);
+            ThreeSrc = true;
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PEXTRW") && ((DecodeInst->OP == 0xC5))) {
+            set_x86_instr_opc(instr, X86_OPC_PEXTRW);
+            ThreeSrc = true;
+        }
+
+        // Immediate shifts
+#define OPD(group, prefix, Reg) (((group - FEXCore::X86Tables::TYPE_GROUP_6) << 5) | (prefix) << 3 | (Reg))
+constexpr uint16_t PF_66 = 2;
+        if (!strcmp(DecodeInst->TableInfo->Name, "PSRLW")
+          && (DecodeInst->OP == OPD(FEXCore::X86Tables::TYPE_GROUP_12, PF_66, 2))) {
+            set_x86_instr_opc(instr, X86_OPC_PSRLW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSRAW")
+          && (DecodeInst->OP == OPD(FEXCore::X86Tables::TYPE_GROUP_12, PF_66, 4))) {
+            set_x86_instr_opc(instr, X86_OPC_PSRAW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSLLW")
+          && (DecodeInst->OP == OPD(FEXCore::X86Tables::TYPE_GROUP_12, PF_66, 6))) {
+            set_x86_instr_opc(instr, X86_OPC_PSLLW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSRLD")
+          && (DecodeInst->OP == OPD(FEXCore::X86Tables::TYPE_GROUP_13, PF_66, 2))) {
+            set_x86_instr_opc(instr, X86_OPC_PSRLD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSRAD")
+          && (DecodeInst->OP == OPD(FEXCore::X86Tables::TYPE_GROUP_13, PF_66, 4))) {
+            set_x86_instr_opc(instr, X86_OPC_PSRAD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSLLD")
+          && (DecodeInst->OP == OPD(FEXCore::X86Tables::TYPE_GROUP_13, PF_66, 6))) {
+            set_x86_instr_opc(instr, X86_OPC_PSLLD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSRLQ")
+          && (DecodeInst->OP == OPD(FEXCore::X86Tables::TYPE_GROUP_14, PF_66, 2))) {
+            set_x86_instr_opc(instr, X86_OPC_PSRLQ);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSRLDQ")
+          && (DecodeInst->OP == OPD(FEXCore::X86Tables::TYPE_GROUP_14, PF_66, 3))) {
+            set_x86_instr_opc(instr, X86_OPC_PSRLDQ);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSLLQ")
+          && (DecodeInst->OP == OPD(FEXCore::X86Tables::TYPE_GROUP_14, PF_66, 6))) {
+            set_x86_instr_opc(instr, X86_OPC_PSLLQ);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PSLLDQ")
+          && (DecodeInst->OP == OPD(FEXCore::X86Tables::TYPE_GROUP_14, PF_66, 7))) {
+            set_x86_instr_opc(instr, X86_OPC_PSLLDQ);
+        }
+#undef OPD
+
+        // SSSE3/SSE4
+#define OPD(prefix, opcode) (((prefix) << 8) | opcode)
+constexpr uint16_t PF_38_66 = (1U << 0);
+        if (!strcmp(DecodeInst->TableInfo->Name, "PSHUFB") && (DecodeInst->OP == OPD(PF_38_66, 0x00))) {
+            set_x86_instr_opc(instr, X86_OPC_PSHUFB);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PHADDW") && (DecodeInst->OP == OPD(PF_38_66, 0x01))) {
+            set_x86_instr_opc(instr, X86_OPC_PHADDW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PHADDD") && (DecodeInst->OP == OPD(PF_38_66, 0x02))) {
+            set_x86_instr_opc(instr, X86_OPC_PHADDD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMADDUBSW") && (DecodeInst->OP == OPD(PF_38_66, 0x04))) {
+            set_x86_instr_opc(instr, X86_OPC_PMADDUBSW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMULHRSW") && (DecodeInst->OP == OPD(PF_38_66, 0x0B))) {
+            set_x86_instr_opc(instr, X86_OPC_PMULHRSW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PTEST") && (DecodeInst->OP == OPD(PF_38_66, 0x17))) {
+            set_x86_instr_opc(instr, X86_OPC_PTEST);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PABSB") && (DecodeInst->OP == OPD(PF_38_66, 0x1C))) {
+            set_x86_instr_opc(instr, X86_OPC_PABSB);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PABSW") && (DecodeInst->OP == OPD(PF_38_66, 0x1D))) {
+            set_x86_instr_opc(instr, X86_OPC_PABSW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PABSD") && (DecodeInst->OP == OPD(PF_38_66, 0x1E))) {
+            set_x86_instr_opc(instr, X86_OPC_PABSD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMOVSXBW") && (DecodeInst->OP == OPD(PF_38_66, 0x20))) {
+            set_x86_instr_opc(instr, X86_OPC_PMOVSXBW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMOVSXBD") && (DecodeInst->OP == OPD(PF_38_66, 0x21))) {
+            set_x86_instr_opc(instr, X86_OPC_PMOVSXBD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMOVSXWD") && (DecodeInst->OP == OPD(PF_38_66, 0x23))) {
+            set_x86_instr_opc(instr, X86_OPC_PMOVSXWD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMOVSXDQ") && (DecodeInst->OP == OPD(PF_38_66, 0x25))) {
+            set_x86_instr_opc(instr, X86_OPC_PMOVSXDQ);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMULDQ") && (DecodeInst->OP == OPD(PF_38_66, 0x28))) {
+            set_x86_instr_opc(instr, X86_OPC_PMULDQ);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PCMPEQQ") && (DecodeInst->OP == OPD(PF_38_66, 0x29))) {
+            set_x86_instr_opc(instr, X86_OPC_PCMPEQQ);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PACKUSDW") && (DecodeInst->OP == OPD(PF_38_66, 0x2B))) {
+            set_x86_instr_opc(instr, X86_OPC_PACKUSDW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMOVZXBW") && (DecodeInst->OP == OPD(PF_38_66, 0x30))) {
+            set_x86_instr_opc(instr, X86_OPC_PMOVZXBW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMOVZXBD") && (DecodeInst->OP == OPD(PF_38_66, 0x31))) {
+            set_x86_instr_opc(instr, X86_OPC_PMOVZXBD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMOVZXWD") && (DecodeInst->OP == OPD(PF_38_66, 0x33))) {
+            set_x86_instr_opc(instr, X86_OPC_PMOVZXWD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMOVZXDQ") && (DecodeInst->OP == OPD(PF_38_66, 0x35))) {
+            set_x86_instr_opc(instr, X86_OPC_PMOVZXDQ);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PCMPGTQ") && (DecodeInst->OP == OPD(PF_38_66, 0x37))) {
+            set_x86_instr_opc(instr, X86_OPC_PCMPGTQ);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMINSB") && (DecodeInst->OP == OPD(PF_38_66, 0x38))) {
+            set_x86_instr_opc(instr, X86_OPC_PMINSB);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMINSD") && (DecodeInst->OP == OPD(PF_38_66, 0x39))) {
+            set_x86_instr_opc(instr, X86_OPC_PMINSD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMINUW") && (DecodeInst->OP == OPD(PF_38_66, 0x3A))) {
+            set_x86_instr_opc(instr, X86_OPC_PMINUW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMINUD") && (DecodeInst->OP == OPD(PF_38_66, 0x3B))) {
+            set_x86_instr_opc(instr, X86_OPC_PMINUD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMAXSB") && (DecodeInst->OP == OPD(PF_38_66, 0x3C))) {
+            set_x86_instr_opc(instr, X86_OPC_PMAXSB);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMAXSD") && (DecodeInst->OP == OPD(PF_38_66, 0x3D))) {
+            set_x86_instr_opc(instr, X86_OPC_PMAXSD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMAXUW") && (DecodeInst->OP == OPD(PF_38_66, 0x3E))) {
+            set_x86_instr_opc(instr, X86_OPC_PMAXUW);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMAXUD") && (DecodeInst->OP == OPD(PF_38_66, 0x3F))) {
+            set_x86_instr_opc(instr, X86_OPC_PMAXUD);
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PMULLD") && (DecodeInst->OP == OPD(PF_38_66, 0x40))) {
+            set_x86_instr_opc(instr, X86_OPC_PMULLD);
+        }
+#undef OPD
 
 #define OPD(REX, prefix, opcode) ((REX << 9) | (prefix << 8) | opcode)
 constexpr uint16_t PF_3A_NONE = 0;
@@ -1118,6 +1727,38 @@ constexpr uint16_t PF_3A_66   = 1;
             set_x86_instr_opc(instr, X86_OPC_PALIGNR);
             ThreeSrc = true;
         }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PBLENDW") && (DecodeInst->OP == OPD(0, PF_3A_66, 0x0E))) {
+            set_x86_instr_opc(instr, X86_OPC_PBLENDW);
+            ThreeSrc = true;
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PEXTRB") && (DecodeInst->OP == OPD(0, PF_3A_66, 0x14))) {
+            set_x86_instr_opc(instr, X86_OPC_PEXTRB);
+            ThreeSrc = true;
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PEXTRW") && (DecodeInst->OP == OPD(0, PF_3A_66, 0x15))) {
+            set_x86_instr_opc(instr, X86_OPC_PEXTRW);
+            ThreeSrc = true;
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PEXTRD") && (DecodeInst->OP == OPD(0, PF_3A_66, 0x16))) {
+            set_x86_instr_opc(instr, X86_OPC_PEXTRD);
+            ThreeSrc = true;
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PEXTRQ") && (DecodeInst->OP == OPD(1, PF_3A_66, 0x16))) {
+            set_x86_instr_opc(instr, X86_OPC_PEXTRQ);
+            ThreeSrc = true;
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PINSRB") && (DecodeInst->OP == OPD(0, PF_3A_66, 0x20))) {
+            set_x86_instr_opc(instr, X86_OPC_PINSRB);
+            ThreeSrc = true;
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PINSRD") && (DecodeInst->OP == OPD(0, PF_3A_66, 0x22))) {
+            set_x86_instr_opc(instr, X86_OPC_PINSRD);
+            ThreeSrc = true;
+        }
+        else if (!strcmp(DecodeInst->TableInfo->Name, "PINSRQ") && (DecodeInst->OP == OPD(1, PF_3A_66, 0x22))) {
+            set_x86_instr_opc(instr, X86_OPC_PINSRQ);
+            ThreeSrc = true;
+        }
 #undef OPD
 
         // VEX
@@ -1370,7 +2011,8 @@ constexpr uint16_t PF_3A_66   = 1;
           #ifdef DEBUG_RULE_LOG
             writeToLogFile(std::to_string(pid) + "fex-debug.log", "[INFO] ====Operand Num: " + std::to_string(num+1) + "\n");
           #else
-            LogMan::Msg::IFmt("====Operand Num: {:x}", num+1);
+            if (debug)
+              LogMan::Msg::IFmt("====Operand Num: {:x}", num+1);
           #endif
           if (Opd->IsGPR()){
               uint8_t GPR = Opd->Data.GPR.GPR;
@@ -1379,7 +2021,8 @@ constexpr uint16_t PF_3A_66   = 1;
               #ifdef DEBUG_RULE_LOG
                 writeToLogFile(std::to_string(pid) + "fex-debug.log", "[INFO]      GPR: " + std::to_string(GPR) + "\n");
               #else
-                LogMan::Msg::IFmt("     GPR: 0x{:x}", GPR);
+                if (debug)
+                  LogMan::Msg::IFmt("     GPR: 0x{:x}", GPR);
               #endif
 
               if(GPR <= FEXCore::X86State::REG_XMM_15)
@@ -1393,7 +2036,8 @@ constexpr uint16_t PF_3A_66   = 1;
               #ifdef DEBUG_RULE_LOG
                 writeToLogFile(std::to_string(pid) + "fex-debug.log", "[INFO]      RIPLiteral: 0x" + intToHex(Literal) + "\n");
               #else
-                LogMan::Msg::IFmt( "     RIPLiteral: 0x{:x}", Literal);
+                if (debug)
+                  LogMan::Msg::IFmt( "     RIPLiteral: 0x{:x}", Literal);
               #endif
 
               set_x86_instr_opd_imm(instr, num, Literal, true);
@@ -1404,7 +2048,8 @@ constexpr uint16_t PF_3A_66   = 1;
               #ifdef DEBUG_RULE_LOG
                 writeToLogFile(std::to_string(pid) + "fex-debug.log", "[INFO]      Literal: 0x" + intToHex(Literal) + "\n");
               #else
-                LogMan::Msg::IFmt( "     Literal: 0x{:x}", Literal);
+                if (debug)
+                  LogMan::Msg::IFmt( "     Literal: 0x{:x}", Literal);
               #endif
 
               set_x86_instr_opd_imm(instr, num, Literal);
@@ -1415,7 +2060,8 @@ constexpr uint16_t PF_3A_66   = 1;
               #ifdef DEBUG_RULE_LOG
                 writeToLogFile(std::to_string(pid) + "fex-debug.log", "[INFO]      GPRDirect: " + std::to_string(GPR) + "\n");
               #else
-                LogMan::Msg::IFmt( "     GPRDirect: 0x{:x}", GPR);
+                if (debug)
+                  LogMan::Msg::IFmt( "     GPRDirect: 0x{:x}", GPR);
               #endif
 
               set_x86_instr_opd_type(instr, num, X86_OPD_TYPE_MEM);
@@ -1432,7 +2078,8 @@ constexpr uint16_t PF_3A_66   = 1;
                 writeToLogFile(std::to_string(pid) + "fex-debug.log", "[INFO]      GPRIndirect - GPR: " + std::to_string(GPR)
                                              + ", Displacement: " + std::to_string(Displacement) + "\n");
               #else
-                LogMan::Msg::IFmt( "     GPRIndirect - GPR: 0x{:x}, Displacement: 0x{:x}", GPR, Displacement);
+                if (debug)
+                  LogMan::Msg::IFmt( "     GPRIndirect - GPR: 0x{:x}, Displacement: 0x{:x}", GPR, Displacement);
               #endif
 
               set_x86_instr_opd_type(instr, num, X86_OPD_TYPE_MEM);
@@ -1454,8 +2101,9 @@ constexpr uint16_t PF_3A_66   = 1;
                                               + ", Index: " + std::to_string(Index)
                                               + ", Scale: " + std::to_string(Scale) + "\n");
               #else
-                LogMan::Msg::IFmt( "     SIB - Base: 0x{:x}, Offset: 0x{:x}, Index: 0x{:x}, Scale: 0x{:x}",
-                                Base, Offset, Index, Scale);
+                if (debug)
+                  LogMan::Msg::IFmt( "     SIB - Base: 0x{:x}, Offset: 0x{:x}, Index: 0x{:x}, Scale: 0x{:x}",
+                                  Base, Offset, Index, Scale);
               #endif
 
               set_x86_instr_opd_type(instr, num, X86_OPD_TYPE_MEM);
@@ -123,6 +123,24 @@ typedef enum {
     X86_OPC_MOVDQU,
     X86_OPC_PMOVMSKB,
     X86_OPC_PALIGNR,
+    X86_OPC_PMOVSXBW,
+    X86_OPC_PMOVSXBD,
+    X86_OPC_PMOVSXWD,
+    X86_OPC_PMOVSXDQ,
+    X86_OPC_PMOVZXBW,
+    X86_OPC_PMOVZXBD,
+    X86_OPC_PMOVZXWD,
+    X86_OPC_PMOVZXDQ,
+    X86_OPC_MOVMSKPS,
+    X86_OPC_MOVMSKPD,
+    X86_OPC_PEXTRB,
+    X86_OPC_PEXTRW,
+    X86_OPC_PEXTRD,
+    X86_OPC_PEXTRQ,
+    X86_OPC_PINSRB,
+    X86_OPC_PINSRW,
+    X86_OPC_PINSRD,
+    X86_OPC_PINSRQ,
 
     // Logical
     X86_OPC_ANDPS,
@@ -135,6 +153,9 @@ typedef enum {
     X86_OPC_PANDN,
     X86_OPC_POR,
     X86_OPC_PXOR,
+    X86_OPC_ANDNPS,
+    X86_OPC_ANDNPD,
+    X86_OPC_PTEST,
 
     // Pack&Unpack
     X86_OPC_PACKUSWB,
@@ -148,11 +169,19 @@ typedef enum {
     X86_OPC_PUNPCKHDQ,
     X86_OPC_PUNPCKLQDQ,
     X86_OPC_PUNPCKHQDQ,
+    X86_OPC_PACKUSDW,
+    X86_OPC_UNPCKLPS,
+    X86_OPC_UNPCKHPS,
+    X86_OPC_UNPCKLPD,
+    X86_OPC_UNPCKHPD,
     // Shuffle
     X86_OPC_SHUFPD,
     X86_OPC_PSHUFD,
     X86_OPC_PSHUFLW,
     X86_OPC_PSHUFHW,
+    X86_OPC_SHUFPS,
+    X86_OPC_PSHUFB,
+    X86_OPC_PBLENDW,
 
     // Comparison
     X86_OPC_PCMPGTB,
@@ -161,6 +190,26 @@ typedef enum {
     X86_OPC_PCMPEQB,
     X86_OPC_PCMPEQW,
     X86_OPC_PCMPEQD,
+    X86_OPC_PCMPEQQ,
+    X86_OPC_PCMPGTQ,
+    X86_OPC_CMPPS,
+    X86_OPC_CMPPD,
+    X86_OPC_UCOMISS,
+    X86_OPC_UCOMISD,
+    X86_OPC_COMISS,
+    X86_OPC_COMISD,
+
+    // Shift
+    X86_OPC_PSRLW,
+    X86_OPC_PSRLD,
+    X86_OPC_PSRLQ,
+    X86_OPC_PSRAW,
+    X86_OPC_PSRAD,
+    X86_OPC_PSLLW,
+    X86_OPC_PSLLD,
+    X86_OPC_PSLLQ,
+    X86_OPC_PSRLDQ,
+    X86_OPC_PSLLDQ,
 
     // Algorithm
     X86_OPC_ADDPS,
@@ -173,6 +222,74 @@ typedef enum {
     X86_OPC_SUBSD,
     X86_OPC_PSUBB,
     X86_OPC_PADDD,
+    X86_OPC_PADDB,
+    X86_OPC_PADDW,
+    X86_OPC_PADDQ,
+    X86_OPC_PSUBW,
+    X86_OPC_PSUBD,
+    X86_OPC_PSUBQ,
+    X86_OPC_PADDSB,
+    X86_OPC_PADDSW,
+    X86_OPC_PADDUSB,
+    X86_OPC_PADDUSW,
+    X86_OPC_PSUBSB,
+    X86_OPC_PSUBSW,
+    X86_OPC_PSUBUSB,
+    X86_OPC_PSUBUSW,
+    X86_OPC_PMULLW,
+    X86_OPC_PMULHW,
+    X86_OPC_PMULHUW,
+    X86_OPC_PMULLD,
+    X86_OPC_PMULUDQ,
+    X86_OPC_PMULDQ,
+    X86_OPC_PMADDWD,
+    X86_OPC_PMADDUBSW,
+    X86_OPC_PMULHRSW,
+    X86_OPC_PHADDW,
+    X86_OPC_PHADDD,
+    X86_OPC_PAVGB,
+    X86_OPC_PAVGW,
+    X86_OPC_PSADBW,
+    X86_OPC_PABSB,
+    X86_OPC_PABSW,
+    X86_OPC_PABSD,
+    X86_OPC_PMINUB,
+    X86_OPC_PMINUW,
+    X86_OPC_PMINUD,
+    X86_OPC_PMINSB,
+    X86_OPC_PMINSW,
+    X86_OPC_PMINSD,
+    X86_OPC_PMAXUB,
+    X86_OPC_PMAXUW,
+    X86_OPC_PMAXUD,
+    X86_OPC_PMAXSB,
+    X86_OPC_PMAXSW,
+    X86_OPC_PMAXSD,
+    X86_OPC_MULPS,
+    X86_OPC_MULPD,
+    X86_OPC_MULSS,
+    X86_OPC_MULSD,
+    X86_OPC_DIVPS,
+    X86_OPC_DIVPD,
+    X86_OPC_DIVSS,
+    X86_OPC_DIVSD,
+    X86_OPC_MINPS,
+    X86_OPC_MINPD,
+    X86_OPC_MINSS,
+    X86_OPC_MINSD,
+    X86_OPC_MAXPS,
+    X86_OPC_MAXPD,
+    X86_OPC_MAXSS,
+    X86_OPC_MAXSD,
+    X86_OPC_SQRTPS,
+    X86_OPC_SQRTPD,
+    X86_OPC_SQRTSS,
+    X86_OPC_SQRTSD,
+
+    // Conversion
+    X86_OPC_CVTDQ2PS,
+    X86_OPC_CVTPS2DQ,
+    X86_OPC_CVTTPS2DQ,
 
     X86_OPC_SET_LABEL, // fake instruction to generate label
 
@@ -189,6 +306,7 @@ typedef enum{
 typedef struct {
     X86ImmType type;
     bool isRipLiteral;
+    uint16_t sym_id;  /* interned content.sym, see rule-sym.h */
     union {
         uint64_t val;
         char sym[20]; /* this symbol might contain expression */
@@ -245,17 +363,11 @@ typedef struct X86Instruction {
     bool reg_liveness[X86_REG_NUM]; /* liveness of each register after this instruction.
                                        True: this register will be used
                                        False: this regsiter will not be used
-                                    Currently, we only maitain this for the four condition codes */
+                                    Maintained for the general purpose registers and the four condition codes */
     bool save_cc;   /* If this instruction defines conditon code, save_cc indicates if it is necessary to
                         save the condition code when do rule translation. */
 } X86Instruction;
 
-extern X86Instruction *instr_buffer;
-extern int instr_buffer_index;
-extern int instr_block_start;
-
-void x86_instr_buffer_init(void);
-
 const char *get_x86_opc_str(X86Opcode opc);
 X86Instruction *create_x86_instr(uint64_t pc);
 void print_x86_instr(X86Instruction *instr);
@@ -288,6 +400,7 @@ void set_x86_opd_mem_off_str(X86Operand *opd, char *off_str, bool neg);
 
 const char *get_x86_reg_str(X86Register );
 bool x86_instr_test_branch(X86Instruction *instr);
+void decide_reg_liveness(X86Instruction *insn_seq, bool *live);
 
 void DecodeInstToX86Inst(FEXCore::X86Tables::DecodedInst *DecodeInst, X86Instruction *instr, uint64_t pid);
 #endif
@@ -22,12 +22,23 @@ void rule_x86_instr_buf_init(void)
     rule_x86_instr_buf_index = 0;
 }
 
+X86Instruction *get_rule_x86_instr_buf(int *num)
+{
+    *num = rule_x86_instr_buf_index;
+    return rule_x86_instr_buf;
+}
+
 static X86Instruction *rule_x86_instr_alloc(uint64_t pc)
 {
+    /* Not allocated when the rules come from a precompiled database */
+    if (!rule_x86_instr_buf)
+        rule_x86_instr_buf_init();
+
     X86Instruction *instr = &rule_x86_instr_buf[rule_x86_instr_buf_index++];
     if (rule_x86_instr_buf_index >= RULE_X86_INSTR_BUF_LEN)
         LogMan::Msg::IFmt( "Error: rule_x86_instr_buf is not enough!\n");
 
+    memset(instr, 0, sizeof(X86Instruction));
     instr->pc = pc;
     instr->next = NULL;
     return instr;
@@ -264,6 +275,7 @@ void parse_rule_x86_code(FILE *fp, TranslationRule *rule)
             code_head = code_tail = cur;
         } else {
             code_tail->next = cur;
+            cur->prev = code_tail;
             code_tail = cur;
         }
         pc += 4;    // fake value
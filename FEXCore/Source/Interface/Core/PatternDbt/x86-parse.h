@@ -5,5 +5,6 @@
 
 void rule_x86_instr_buf_init(void);
 void parse_rule_x86_code(FILE *fp, TranslationRule *rule);
+X86Instruction *get_rule_x86_instr_buf(int *num);
 
 #endif
@@ -272,6 +272,15 @@ static void PrintArg(fextl::stringstream *out, [[maybe_unused]] IRListView const
   }
 }
 
+static void PrintArg(fextl::stringstream *out, [[maybe_unused]] IRListView const* IR, FEXCore::IR::BranchHint Arg) {
+  switch (Arg) {
+    case BranchHint::None:   *out << "None"; break;
+    case BranchHint::Call:   *out << "Call"; break;
+    case BranchHint::Return: *out << "Return"; break;
+    default: *out << "<Unknown Branch Hint>"; break;
+  }
+}
+
 void Dump(fextl::stringstream *out, IRListView const* IR, IR::RegisterAllocationData *RAData) {
   auto HeaderOp = IR->GetHeader();
 
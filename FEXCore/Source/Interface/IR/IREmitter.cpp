@@ -22,6 +22,7 @@ namespace FEXCore::IR {
 bool IsFragmentExit(FEXCore::IR::IROps Op) {
   switch (Op) {
     case OP_EXITFUNCTION:
+    case OP_RULEEXIT:
     case OP_BREAK:
       return true;
     default:
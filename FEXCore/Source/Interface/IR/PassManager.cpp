@@ -70,22 +70,26 @@ void PassManager::AddDefaultPasses(FEXCore::Context::ContextImpl *ctx, bool Inli
   FEX_CONFIG_OPT(DisablePasses, O0);
 
   if (!DisablePasses()) {
-    InsertPass(CreateContextLoadStoreElimination(ctx->HostFeatures.SupportsAVX));
+    auto InsertOptimizationPass = [this](fextl::unique_ptr<Pass> Pass) {
+      OptimizationPasses.insert(InsertPass(std::move(Pass)));
+    };
+
+    InsertOptimizationPass(CreateContextLoadStoreElimination(ctx->HostFeatures.SupportsAVX));
 
     if (Is64BitMode()) {
       // This needs to run after RCLSE
       // This only matters for 64-bit code since these instructions don't exist in 32-bit
-      InsertPass(CreateLongDivideEliminationPass());
+      InsertOptimizationPass(CreateLongDivideEliminationPass());
     }
 
-    InsertPass(CreateDeadStoreElimination(ctx->HostFeatures.SupportsAVX));
-    InsertPass(CreatePassDeadCodeElimination());
-    InsertPass(CreateConstProp(InlineConstants, ctx->HostFeatures.SupportsTSOImm9));
+    InsertOptimizationPass(CreateDeadStoreElimination(ctx->HostFeatures.SupportsAVX));
+    InsertOptimizationPass(CreatePassDeadCodeElimination());
+    InsertOptimizationPass(CreateConstProp(InlineConstants, ctx->HostFeatures.SupportsTSOImm9));
 
     ////// InsertPass(CreateDeadFlagCalculationEliminination());
 
-    InsertPass(CreateInlineCallOptimization(&ctx->CPUID));
-    InsertPass(CreatePassDeadCodeElimination());
+    InsertOptimizationPass(CreateInlineCallOptimization(&ctx->CPUID));
+    InsertOptimizationPass(CreatePassDeadCodeElimination());
   }
 
   // If the IR is compacted post-RA then the node indexing gets messed up and the backend isn't able to find the register assigned to a node
@@ -105,11 +109,14 @@ void PassManager::InsertRegisterAllocationPass(bool SupportsAVX) {
   InsertPass(IR::CreateRegisterAllocationPass(GetPass("Compaction"), SupportsAVX), "RA");
 }
 
-bool PassManager::Run(IREmitter *IREmit) {
+bool PassManager::Run(IREmitter *IREmit, bool Baseline) {
   FEXCORE_PROFILE_SCOPED("PassManager::Run");
 
   bool Changed = false;
   for (auto const &Pass : Passes) {
+    if (Baseline && OptimizationPasses.contains(Pass.get())) {
+      continue;
+    }
     Changed |= Pass->Run(IREmit);
   }
 
@@ -12,6 +12,7 @@ $end_info$
 #include <FEXCore/fextl/memory.h>
 #include <FEXCore/fextl/string.h>
 #include <FEXCore/fextl/unordered_map.h>
+#include <FEXCore/fextl/unordered_set.h>
 #include <FEXCore/fextl/vector.h>
 
 #include <functional>
@@ -58,7 +59,12 @@ public:
 
   void InsertRegisterAllocationPass(bool SupportsAVX);
 
-  bool Run(IREmitter *IREmit);
+  /**
+   * @brief Runs the passes over the IR
+   *
+   * @param Baseline Skips the optimization passes, for blocks that may only run a few times
+   */
+  bool Run(IREmitter *IREmit, bool Baseline = false);
 
   bool HasPass(fextl::string Name) const {
     return NameToPassMaping.contains(Name);
@@ -90,6 +96,8 @@ private:
   }
   PassArrayType Passes;
   fextl::unordered_map<fextl::string, Pass*> NameToPassMaping;
+  // Passes that only make the code faster, a baseline compile leaves them out
+  fextl::unordered_set<Pass*> OptimizationPasses;
 
 #if defined(ASSERTIONS_ENABLED) && ASSERTIONS_ENABLED
   fextl::vector<fextl::unique_ptr<Pass>> ValidationPasses;
@@ -221,6 +221,11 @@ bool DeadStoreElimination::Run(IREmitter *IREmit) {
 
           auto& BlockInfo = InfoMap[BlockNode];
           ClassifyRegisterLoad(BlockInfo, Op->Offset, IROp->Size);
+        } else if (IROp->Op == OP_RULETRANSLATION || IROp->Op == OP_RULEEXIT) {
+          // Rule translated code can read any register
+          auto& BlockInfo = InfoMap[BlockNode];
+          BlockInfo.gpr.reads = ~0U;
+          BlockInfo.fpr.reads = ~0ULL;
         }
       }
     }
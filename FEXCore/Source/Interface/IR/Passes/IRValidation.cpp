@@ -146,10 +146,27 @@ bool IRValidation::Run(IREmitter *IREmit) {
       NodeIsLive.Set(ID.Value);
 
       switch (IROp->Op) {
-        case IR::OP_EXITFUNCTION: {
+        case IR::OP_EXITFUNCTION:
+        case IR::OP_RULEEXIT: {
           CurrentBlock->HasExit = true;
         break;
         }
+        case IR::OP_RULELOCALTARGET: {
+          auto Op = IROp->C<IR::IROp_RuleLocalTarget>();
+          OrderedNode *TargetNode = CurrentIR.GetNode(Op->TargetBlock);
+          CurrentBlock->Successors.emplace_back(TargetNode);
+
+          FEXCore::IR::IROp_Header const *TargetOp = CurrentIR.GetOp<IROp_Header>(TargetNode);
+          if (TargetOp->Op != OP_CODEBLOCK) {
+            HadError |= true;
+            Errors << "RuleLocalTarget %" << ID << ": Target isn't the begining of a block" << std::endl;
+          }
+          else {
+            auto Block = OffsetToBlockMap.try_emplace(Op->TargetBlock.ID()).first;
+            Block->second.Predecessors.emplace_back(BlockNode);
+          }
+          break;
+        }
         case IR::OP_CONDJUMP: {
           auto Op = IROp->C<IR::IROp_CondJump>();
 
@@ -714,6 +714,16 @@ namespace {
           }
         }
 
+        // OP is an OP_RULETRANSLATION
+        // - The rule writes the SRA regs directly, any span still live across it has been written
+        if (IROp->Op == OP_RULETRANSLATION) {
+          for (size_t i = 0; i < MapsSize; ++i) {
+            if (StaticMaps[i]) {
+              StaticMaps[i]->Written = true;
+            }
+          }
+        }
+
         // OP is an OP_STOREREGISTER
         // - If there was a matching pre-write, clear the pre-write flag as the register is no longer pre-written
         // - Mark the SRA span as written, so that any further reads demote it from read-aliases if they happen
@@ -1433,6 +1443,14 @@ namespace {
         auto Op = IROp->C<IROp_CondJump>();
         Graph->BlockPredecessors[Op->TrueBlock.ID()].insert(IR->GetID(BlockNode));
         Graph->BlockPredecessors[Op->FalseBlock.ID()].insert(IR->GetID(BlockNode));
+      } else if (IROp->Op == OP_RULEEXIT) {
+        // The rule may branch to any block named by the RuleLocalTargets in front of it
+        for (auto [CodeNode, CodeOp] : IR->GetCode(BlockNode)) {
+          if (CodeOp->Op == OP_RULELOCALTARGET) {
+            auto Op = CodeOp->C<IROp_RuleLocalTarget>();
+            Graph->BlockPredecessors[Op->TargetBlock.ID()].insert(IR->GetID(BlockNode));
+          }
+        }
       }
     }
   }
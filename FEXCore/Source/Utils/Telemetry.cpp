@@ -33,6 +33,13 @@ namespace FEXCore::Telemetry {
     "Uses 32-bit Segment SS",
     "Uses 32-bit Segment CS",
     "Uses 32-bit Segment DS",
+    "Rule blocks attempted",
+    "Rule blocks translated",
+    "Rule guest instructions",
+    "Rule match time (ns)",
+    "Rule host bytes",
+    "IR only guest instructions",
+    "IR only host bytes",
   };
 
   static bool Enabled {true};
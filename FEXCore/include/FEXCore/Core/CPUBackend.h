@@ -45,6 +45,8 @@ namespace CPU {
     struct CodeBuffer {
       uint8_t *Ptr;
       size_t Size;
+      // Bytes emitted so far, every thread emits into the same buffer
+      size_t Offset;
     };
 
     /**
@@ -129,16 +131,59 @@ namespace CPU {
      *
      * @param IR -  IR that maps to the IR for this RIP
      * @param DebugData - Debug data that is available for this IR indirectly
+     * @param TierUpCount - Executions after which the block asks to be compiled again, 0 if it never does
      *
      * @return Information about the compiled code block.
      */
     [[nodiscard]] virtual CompiledCode CompileCode(uint64_t Entry,
                                             FEXCore::IR::IRListView const *IR,
                                             FEXCore::Core::DebugData *DebugData,
-                                            FEXCore::IR::RegisterAllocationData *RAData) = 0;
+                                            FEXCore::IR::RegisterAllocationData *RAData,
+                                            uint32_t TierUpCount = 0) = 0;
 
+    /**
+     * @brief Matches the translation rules against every block of a decoded function
+     *
+     * @param BlockInfo - The Frontend::Decoder::DecodedBlockInformation of the function
+     *
+     * @return true if any rule matched
+     */
     [[nodiscard]] virtual bool MatchTranslationRule(const void *BlockInfo) = 0;
 
+    // How a guest instruction is covered by the rules of the last match
+    enum class RuleCoverage {
+      // Not covered, the instruction goes through the IR.
+      NONE,
+      // Covered by a rule that starts at an earlier instruction.
+      BODY,
+      // First instruction of a rule that falls through to the next instruction.
+      HEAD,
+      // First instruction of a rule that covers the rest of the block and leaves it.
+      EXIT,
+    };
+
+    /**
+     * @brief Tells how the instruction at PC is covered by the rules of the last MatchTranslationRule call
+     */
+    [[nodiscard]] virtual RuleCoverage GetRuleCoverage(uint64_t PC) { return RuleCoverage::NONE; }
+
+    /**
+     * @brief Serializes the rules matched by the last MatchTranslationRule call for the rule match cache
+     *
+     * @param Entry - RIP of the block, addresses are stored relative to it
+     * @param Data - Receives the serialized rule records
+     *
+     * @return The number of rule records in Data
+     */
+    virtual uint32_t SaveTranslationRules(uint64_t Entry, fextl::vector<uint8_t> *Data) { return 0; }
+
+    /**
+     * @brief Restores rule matches serialized by SaveTranslationRules instead of matching the block again
+     *
+     * @return true if the block is translated with rules
+     */
+    [[nodiscard]] virtual bool RestoreTranslationRules(uint64_t Entry, uint8_t const *Data, uint32_t DataSize, uint32_t RecordNum) { return false; }
+
     /**
      * @brief Relocates a block of code from the JIT code object cache
      *
@@ -176,6 +221,13 @@ namespace CPU {
 
     bool IsAddressInCodeBuffer(uintptr_t Address) const;
 
+    /**
+     * @brief Stops holding on to the code buffer last emitted into if another thread replaced it
+     *
+     * Only safe while nothing of this thread is running code from it, the next compile picks up the current one.
+     */
+    void ReleaseStaleCodeBuffer();
+
   protected:
     // Max spill slot size in bytes. We need at most 32 bytes
     // to be able to handle a 256-bit vector store to a slot.
@@ -184,22 +236,25 @@ namespace CPU {
     FEXCore::Core::InternalThreadState *ThreadState;
 
     size_t InitialCodeSize, MaxCodeSize;
+
+    /**
+     * @brief Returns the code buffer shared by all threads to emit into
+     *
+     * If this thread's buffer is still the current one then it is full, all blocks are dropped and every thread moves on to a new one.
+     */
     [[nodiscard]] CodeBuffer *GetEmptyCodeBuffer();
 
+    /**
+     * @brief Another thread replaced the shared code buffer since this thread last emitted into it
+     */
+    [[nodiscard]] bool IsCodeBufferStale();
+
     // This is the current code buffer that we are tracking
-    CodeBuffer *CurrentCodeBuffer{};
+    std::shared_ptr<CodeBuffer> CurrentCodeBuffer{};
 
   private:
-    CodeBuffer AllocateNewCodeBuffer(size_t Size);
-    void FreeCodeBuffer(CodeBuffer Buffer);
-
-    void EmplaceNewCodeBuffer(CodeBuffer Buffer) {
-      CurrentCodeBuffer = &CodeBuffers.emplace_back(Buffer);
-    }
-
-    // This is the array of code buffers. Unless signals force us to keep more than
-    // buffer, there will be only one entry here
-    fextl::vector<CodeBuffer> CodeBuffers{};
+    std::shared_ptr<CodeBuffer> AllocateNewCodeBuffer(size_t Size);
+    static void FreeCodeBuffer(CodeBuffer *Buffer);
   };
 
 }
@@ -285,7 +285,26 @@ namespace FEXCore::Context {
 
       FEX_DEFAULT_VISIBILITY virtual void FinalizeAOTIRCache() = 0;
       FEX_DEFAULT_VISIBILITY virtual void WriteFilesWithCode(AOTIRCodeFileWriterFn Writer) = 0;
+      /**
+       * @brief Loads the translation rules of the user, before the first guest instruction runs
+       */
+      FEX_DEFAULT_VISIBILITY virtual void LoadTranslationRules(uint64_t PID) = 0;
+      FEX_DEFAULT_VISIBILITY virtual void FinalizeRuleCache() = 0;
+      /**
+       * @brief Has the RuleStats file written soon, safe to call from a signal handler
+       */
+      FEX_DEFAULT_VISIBILITY virtual void RequestRuleStatsDump() = 0;
       FEX_DEFAULT_VISIBILITY virtual void InvalidateGuestCodeRange(FEXCore::Core::InternalThreadState *Thread, uint64_t Start, uint64_t Length) = 0;
+      /**
+       * @brief Tells the code object cache about an executable file mapping
+       *
+       * @param Base - Guest address the file is mapped at
+       * @param Size - Size of the mapping
+       * @param Offset - Offset in to the file of Base
+       * @param Filename - Path of the mapped file
+       */
+      FEX_DEFAULT_VISIBILITY virtual void AddNamedRegion(FEXCore::Core::InternalThreadState *Thread, uintptr_t Base, uintptr_t Size, uintptr_t Offset, const fextl::string &Filename) = 0;
+      FEX_DEFAULT_VISIBILITY virtual void RemoveNamedRegion(FEXCore::Core::InternalThreadState *Thread, uintptr_t Base, uintptr_t Size) = 0;
       FEX_DEFAULT_VISIBILITY virtual void InvalidateGuestCodeRange(FEXCore::Core::InternalThreadState *Thread, uint64_t Start, uint64_t Length, CodeRangeInvalidationFn callback) = 0;
       FEX_DEFAULT_VISIBILITY virtual void MarkMemoryShared(FEXCore::Core::InternalThreadState *Thread) = 0;
 
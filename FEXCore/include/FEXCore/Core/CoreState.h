@@ -271,12 +271,14 @@ namespace FEXCore::Core {
       uint64_t PrintValue{};
       uint64_t PrintVectorValue{};
       uint64_t ThreadRemoveCodeEntryFromJIT{};
+      uint64_t ThreadTierUpBlockFromJIT{};
       uint64_t CPUIDObj{};
       uint64_t CPUIDFunction{};
       uint64_t XCRFunction{};
       uint64_t SyscallHandlerObj{};
       uint64_t SyscallHandlerFunc{};
       uint64_t ExitFunctionLink{};
+      uint64_t IndirectBranchLink{};
 
       uint64_t FallbackHandlerPointers[FallbackHandlerIndex::OPINDEX_MAX];
       uint64_t NamedVectorConstantPointers[FEXCore::IR::NamedVectorConstant::NAMED_VECTOR_CONST_POOL_MAX];
@@ -290,6 +292,7 @@ namespace FEXCore::Core {
       uint64_t DispatcherLoopTop{};
       uint64_t DispatcherLoopTopFillSRA{};
       uint64_t ExitFunctionLinker{};
+      uint64_t IndirectBranchLinker{};
       uint64_t ThreadStopHandlerSpillSRA{};
       uint64_t ThreadPauseHandlerSpillSRA{};
       uint64_t UnimplementedInstructionHandler{};
@@ -300,6 +303,9 @@ namespace FEXCore::Core {
       uint64_t SignalReturnHandlerRT{};
       uint64_t L1Pointer{};
       uint64_t L2Pointer{};
+      // Generation of the shared block cache, and the one this thread's L1 and L2 hold blocks of
+      uint64_t SharedGenerationPointer{};
+      uint64_t GenerationPointer{};
       /**  @} */
 
       // Copy of process-wide named vector constants data.
@@ -367,11 +373,37 @@ namespace FEXCore::Core {
 
     // Pointers that the JIT needs to load to remove relocations
     JITPointers Pointers;
+
+    /**
+     * @brief Guest CALLs that haven't returned yet, with the host code that continues after them
+     *
+     * A ring indexed by the free running ReturnStackIndex. A guest RET pops the top entry and only
+     * returns to its host code if the guest return address matches, anything else takes the regular exit.
+     */
+    struct ReturnStackEntry {
+      uint64_t GuestRIP{~0ULL};
+      uint64_t HostCode{};
+    };
+    static constexpr size_t RETURN_STACK_ENTRIES = 32;
+    ReturnStackEntry ReturnStack[RETURN_STACK_ENTRIES]{};
+    uint64_t ReturnStackIndex{};
+
+    /**
+     * @brief Drops every entry, for when the code they continue to goes away
+     */
+    void ClearReturnStack() {
+      for (auto &Entry : ReturnStack) {
+        Entry = {};
+      }
+    }
   };
   static_assert(offsetof(CpuStateFrame, State) == 0, "CPUState must be first member in CpuStateFrame");
   static_assert(offsetof(CpuStateFrame, State.rip) == 0, "rip must be zero offset in CpuStateFrame");
   static_assert(offsetof(CpuStateFrame, Pointers) % 8 == 0, "JITPointers need to be aligned to 8 bytes");
   static_assert(offsetof(CpuStateFrame, Pointers) + sizeof(CpuStateFrame::Pointers) <= 32760, "JITPointers maximum pointer needs to be less than architecture maximum 32768");
+  static_assert((CpuStateFrame::RETURN_STACK_ENTRIES & (CpuStateFrame::RETURN_STACK_ENTRIES - 1)) == 0, "Return stack is indexed with a mask");
+  static_assert(sizeof(CpuStateFrame::ReturnStackEntry) == 16, "Return stack entries are indexed with a shift");
+  static_assert(offsetof(CpuStateFrame, ReturnStack) < 4096, "Return stack needs to be in add immediate range");
 
   static_assert(std::is_standard_layout<CpuStateFrame>::value, "This needs to be standard layout");
   static_assert(sizeof(CpuStateFrame::SynchronousFaultData) == 8, "This needs to be 8 bytes");
@@ -58,6 +58,8 @@ namespace FEXCore::Core {
    */
   struct DebugData : public FEXCore::Allocator::FEXAllocOperators {
     uint64_t HostCodeSize; ///< The size of the code generated in the host JIT
+    uint32_t HostEntryOffset; ///< Offset of the block's entrypoint from the start of its host code
+    bool Relocatable; ///< The host code can be stored in the code object cache
     fextl::vector<DebugDataSubblock> Subblocks;
     fextl::vector<DebugDataGuestOpcode> GuestOpcodes;
     fextl::vector<FEXCore::CPU::Relocation> *Relocations;
@@ -580,6 +580,13 @@ enum class ShiftType : uint8_t {
   ROR,
 };
 
+// What the guest branch of an ExitFunction was, so that the backend can predict returns.
+enum class BranchHint : uint8_t {
+  None = 0,
+  Call,
+  Return,
+};
+
 // Converts a size stored as an integer in to an OpSize enum.
 // This is a nop operation and will be eliminated by the compiler.
 static inline OpSize SizeToOpSize(uint8_t Size) {
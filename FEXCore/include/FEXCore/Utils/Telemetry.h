@@ -30,6 +30,14 @@ namespace FEXCore::Telemetry {
     TYPE_USES_32BIT_SEGMENT_SS,
     TYPE_USES_32BIT_SEGMENT_CS,
     TYPE_USES_32BIT_SEGMENT_DS,
+    // Translation rules, set once at exit from the rule statistics.
+    TYPE_RULE_BLOCKS_ATTEMPTED,
+    TYPE_RULE_BLOCKS_TRANSLATED,
+    TYPE_RULE_GUEST_INSTRS,
+    TYPE_RULE_MATCH_NS,
+    TYPE_RULE_HOST_BYTES,
+    TYPE_RULE_IR_GUEST_INSTRS,
+    TYPE_RULE_IR_HOST_BYTES,
     TYPE_LAST,
   };
 
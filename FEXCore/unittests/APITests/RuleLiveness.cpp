@@ -0,0 +1,119 @@
+#include "Interface/Core/PatternDbt/x86-instr.h"
+
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <array>
+
+namespace {
+// A block of shadow x86 instructions, linked in order
+template<size_t Num>
+struct Block {
+  std::array<X86Instruction, Num> Instrs{};
+
+  Block() {
+    for (size_t i = 0; i < Num; ++i) {
+      Instrs[i].prev = i ? &Instrs[i - 1] : nullptr;
+      Instrs[i].next = i + 1 < Num ? &Instrs[i + 1] : nullptr;
+    }
+  }
+
+  X86Instruction &operator[](size_t i) {
+    return Instrs[i];
+  }
+};
+
+void SetOp(X86Instruction &Instr, X86Opcode Opc, uint32_t Size) {
+  Instr.opc = Opc;
+  Instr.SrcSize = Size;
+  Instr.DestSize = Size;
+}
+
+void SetReg(X86Instruction &Instr, int Idx, X86Register Reg) {
+  Instr.opd[Idx].type = X86_OPD_TYPE_REG;
+  Instr.opd[Idx].content.reg.num = Reg;
+  Instr.opd_num = std::max<uint8_t>(Instr.opd_num, Idx + 1);
+}
+
+// Liveness at the start of the block when nothing is live after it
+template<size_t Num>
+std::array<bool, X86_REG_NUM> LiveIn(Block<Num> &Insts) {
+  std::array<bool, X86_REG_NUM> Live{};
+  decide_reg_liveness(&Insts[0], Live.data());
+  return Live;
+}
+}
+
+TEST_CASE("RuleLiveness: One operand imul") {
+  const auto Size = GENERATE(FEXCore::X86Tables::DecodeFlags::SIZE_32BIT, FEXCore::X86Tables::DecodeFlags::SIZE_64BIT);
+
+  // imul rbx
+  Block<1> Insts;
+  SetOp(Insts[0], X86_OPC_IMUL, Size);
+  SetReg(Insts[0], 0, X86_REG_RBX);
+
+  const auto Live = LiveIn(Insts);
+  CHECK(Live[X86_REG_RAX]);
+  CHECK(Live[X86_REG_RBX]);
+  CHECK_FALSE(Live[X86_REG_RDX]);
+}
+
+TEST_CASE("RuleLiveness: One operand imul defines RDX") {
+  // mov rdx, rcx; imul rbx
+  Block<2> Insts;
+  SetOp(Insts[0], X86_OPC_MOV, FEXCore::X86Tables::DecodeFlags::SIZE_64BIT);
+  SetReg(Insts[0], 0, X86_REG_RDX);
+  SetReg(Insts[0], 1, X86_REG_RCX);
+  SetOp(Insts[1], X86_OPC_IMUL, FEXCore::X86Tables::DecodeFlags::SIZE_64BIT);
+  SetReg(Insts[1], 0, X86_REG_RBX);
+
+  std::array<bool, X86_REG_NUM> Live{};
+  Live[X86_REG_RDX] = true;
+  decide_reg_liveness(&Insts[0], Live.data());
+
+  // The mov is dead, imul overwrites RDX before anyone reads it
+  CHECK_FALSE(Insts[0].reg_liveness[X86_REG_RDX]);
+  CHECK(Insts[0].reg_liveness[X86_REG_RAX]);
+  CHECK(Insts[1].reg_liveness[X86_REG_RDX]);
+}
+
+TEST_CASE("RuleLiveness: Two operand imul") {
+  // imul rcx, rbx
+  Block<1> Insts;
+  SetOp(Insts[0], X86_OPC_IMUL, FEXCore::X86Tables::DecodeFlags::SIZE_64BIT);
+  SetReg(Insts[0], 0, X86_REG_RCX);
+  SetReg(Insts[0], 1, X86_REG_RBX);
+
+  const auto Live = LiveIn(Insts);
+  CHECK_FALSE(Live[X86_REG_RAX]);
+  CHECK_FALSE(Live[X86_REG_RDX]);
+  CHECK(Live[X86_REG_RBX]);
+}
+
+TEST_CASE("RuleLiveness: 16-bit mul merges into DX") {
+  // mul bx
+  Block<1> Insts;
+  SetOp(Insts[0], X86_OPC_MULL, FEXCore::X86Tables::DecodeFlags::SIZE_16BIT);
+  SetReg(Insts[0], 0, X86_REG_RBX);
+
+  const auto Live = LiveIn(Insts);
+  CHECK(Live[X86_REG_RAX]);
+  CHECK(Live[X86_REG_RDX]);
+}
+
+TEST_CASE("RuleLiveness: Implicit operands stay live after a rule") {
+  // add rcx, rdx; imul rbx
+  // A rule covering the add may only borrow the host registers of guest registers dead after it,
+  // RAX is read by the imul even though no operand names it.
+  Block<2> Insts;
+  SetOp(Insts[0], X86_OPC_ADD, FEXCore::X86Tables::DecodeFlags::SIZE_64BIT);
+  SetReg(Insts[0], 0, X86_REG_RCX);
+  SetReg(Insts[0], 1, X86_REG_RDX);
+  SetOp(Insts[1], X86_OPC_IMUL, FEXCore::X86Tables::DecodeFlags::SIZE_64BIT);
+  SetReg(Insts[1], 0, X86_REG_RBX);
+
+  LiveIn(Insts);
+  CHECK(Insts[0].reg_liveness[X86_REG_RAX]);
+  CHECK(Insts[0].reg_liveness[X86_REG_RBX]);
+  CHECK_FALSE(Insts[0].reg_liveness[X86_REG_RCX]);
+  CHECK_FALSE(Insts[0].reg_liveness[X86_REG_RDX]);
+}
@@ -0,0 +1,465 @@
+#include "DummyHandlers.h"
+#include "Interface/Core/JIT/Arm64/JITClass.h"
+#include "Interface/Core/PatternDbt/arm-opt.h"
+#include "Interface/Core/PatternDbt/parse.h"
+#include "Interface/Core/PatternDbt/rule-translate.h"
+
+#include <FEXCore/Config/Config.h>
+#include <FEXCore/Core/Context.h>
+#include <FEXCore/Debug/InternalThreadState.h>
+#include <FEXCore/fextl/fmt.h>
+#include <FEXCore/fextl/vector.h>
+
+#include <aarch64/disasm-aarch64.h>
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <deque>
+
+namespace {
+// One JIT for every test, like a single guest thread compiling block after block
+struct RuleJIT {
+  RuleJIT() {
+    FEXCore::Config::Initialize();
+    FEXCore::Config::Load();
+    FEXCore::Config::EraseSet(FEXCore::Config::CONFIG_CORE, fextl::fmt::format("{}", static_cast<uint64_t>(FEXCore::Config::CONFIG_IRJIT)));
+    FEXCore::Context::InitializeStaticTables(FEXCore::Context::MODE_64BIT);
+
+    CTX = FEXCore::Context::Context::CreateNewContext();
+    SignalDelegation = FEX::DummyHandlers::CreateSignalDelegator();
+    SyscallHandler = FEX::DummyHandlers::CreateSyscallHandler();
+    CTX->SetSignalDelegator(SignalDelegation.get());
+    CTX->SetSyscallHandler(SyscallHandler.get());
+    CTX->InitCore();
+    Thread = CTX->CreateThread(0, 0, FEXCore::Context::Context::ManagedBy::FRONTEND);
+  }
+
+  ~RuleJIT() {
+    CTX->DestroyThread(Thread);
+  }
+
+  static FEXCore::CPU::Arm64JITCore *Get() {
+    static RuleJIT JIT;
+    return static_cast<FEXCore::CPU::Arm64JITCore*>(JIT.Thread->CPUBackend.get());
+  }
+
+  fextl::unique_ptr<FEXCore::Context::Context> CTX;
+  fextl::unique_ptr<FEX::DummyHandlers::DummySignalDelegator> SignalDelegation;
+  fextl::unique_ptr<FEXCore::HLE::SyscallHandler> SyscallHandler;
+  FEXCore::Core::InternalThreadState *Thread;
+};
+}
+
+// Host code of consecutive rule instances with host registers in place of the
+// rule registers, assembled the way the JIT assembles matched rules.
+class RuleStreamTest {
+public:
+  RuleStreamTest() {
+    fp = tmpfile();
+    Disassembler = std::make_unique<vixl::aarch64::PrintDisassembler>(fp);
+    Rule();
+  }
+
+  ~RuleStreamTest() {
+    fclose(fp);
+  }
+
+  void Mov(size_t Size, ARMRegister Dst, ARMRegister Src) {
+    auto &instr = Add(ARM_OPC_MOV, Size, 2);
+    SetReg(instr, 0, Dst);
+    SetReg(instr, 1, Src);
+  }
+
+  void MovImm(size_t Size, ARMRegister Dst, int32_t Imm) {
+    auto &instr = Add(ARM_OPC_MOV, Size, 2);
+    SetReg(instr, 0, Dst);
+    SetImm(instr, 1, Imm);
+  }
+
+  void Alu(ARMOpcode Opc, size_t Size, ARMRegister Dst, ARMRegister Src1, ARMRegister Src2) {
+    auto &instr = Add(Opc, Size, 3);
+    SetReg(instr, 0, Dst);
+    SetReg(instr, 1, Src1);
+    SetReg(instr, 2, Src2);
+  }
+
+  void Cmp(size_t Size, ARMRegister Src1, ARMRegister Src2) {
+    auto &instr = Add(ARM_OPC_CMP, Size, 2);
+    SetReg(instr, 0, Src1);
+    SetReg(instr, 1, Src2);
+  }
+
+  void Cset(size_t Size, ARMRegister Dst, ARMConditionCode Cond) {
+    auto &instr = Add(ARM_OPC_CSET, Size, 1);
+    SetReg(instr, 0, Dst);
+    instr.cc = Cond;
+  }
+
+  void Ldr(size_t Size, ARMRegister Dst, ARMRegister Base, int32_t Offset) {
+    auto &instr = Add(ARM_OPC_LDR, Size, 2);
+    SetReg(instr, 0, Dst);
+    SetMem(instr, 1, Base, Offset);
+  }
+
+  void Str(size_t Size, ARMRegister Src, ARMRegister Base, int32_t Offset) {
+    auto &instr = Add(ARM_OPC_STR, Size, 2);
+    SetReg(instr, 0, Src);
+    SetMem(instr, 1, Base, Offset);
+  }
+
+  // A vector move, the optimizer only knows the general purpose registers
+  void Opaque() {
+    auto &instr = Add(ARM_OPC_MOV, 16, 2);
+    SetReg(instr, 0, ARM_REG_V2);
+    SetReg(instr, 1, ARM_REG_V3);
+  }
+
+  // Start the next rule, the current one falls through to it
+  void Rule() {
+    auto &NewRule = Rules.emplace_back();
+    NewRule.guest_instr_num = 1;
+
+    auto &Guest = Guests.emplace_back();
+    Guest.opc = X86_OPC_MOV;
+
+    auto &Record = Records.emplace_back();
+    Record.pc = Records.size();
+    Record.rule = &NewRule;
+    Record.last_guest = &Guest;
+    Last = nullptr;
+  }
+
+  // End the current rule with a branch within the function, the flags in LiveOut are read at the target
+  void Exit(uint8_t LiveOut) {
+    auto &Record = Records.back();
+    Record.target_pc = 0x1000 + Records.size();
+    SetLiveOut(Record.last_guest, LiveOut);
+
+    auto JIT = RuleJIT::Get();
+    JIT->RuleLocalTargets.emplace(Record.target_pc, FEXCore::IR::NodeID(JIT->RuleLocalTargets.size()));
+
+    Rule();
+  }
+
+  // Assembles the stream, the flags in LiveOut are read after the last rule
+  fextl::string Assemble(uint8_t LiveOut) {
+    auto JIT = RuleJIT::Get();
+    SetLiveOut(Records.back().last_guest, LiveOut);
+
+    fextl::vector<RuleRecord *> Stream;
+    for (auto &Record : Records) {
+      Stream.push_back(&Record);
+    }
+
+    const auto Begin = JIT->GetCursorAddress<const vixl::aarch64::Instruction*>();
+    JIT->do_rule_stream_translation(Stream.data(), Stream.size());
+    const auto End = JIT->GetCursorAddress<const vixl::aarch64::Instruction*>();
+
+    JIT->JumpTargets.clear();
+    JIT->RuleLocalTargets.clear();
+    Records.clear();
+    Guests.clear();
+    Rules.clear();
+    Instrs.clear();
+    Rule();
+
+    fseek(fp, 0, SEEK_SET);
+    Disassembler->DisassembleBuffer(Begin, End);
+    fflush(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    fextl::string Decoded{};
+    char Tmp[512];
+    uint64_t Addr;
+    uint32_t Encoding;
+    // The file keeps the text of earlier streams past this one
+    const auto Num = (reinterpret_cast<uintptr_t>(End) - reinterpret_cast<uintptr_t>(Begin)) / 4;
+    for (size_t i = 0; i < Num && fscanf(fp, "0x%lx %x %[^\n]\n", &Addr, &Encoding, Tmp) == 3; ++i) {
+      Decoded += std::string_view(Tmp);
+      Decoded += "\n";
+    }
+    return Decoded;
+  }
+
+  static size_t Count(fextl::string const &Disasm) {
+    return std::count(Disasm.begin(), Disasm.end(), '\n');
+  }
+
+  // Number of instructions starting with Mnemonic
+  static size_t Count(fextl::string const &Disasm, std::string_view Mnemonic) {
+    size_t Num = 0;
+    for (size_t Pos = 0; Pos < Disasm.size(); Pos = Disasm.find('\n', Pos) + 1) {
+      Num += std::string_view(Disasm).substr(Pos).starts_with(Mnemonic);
+    }
+    return Num;
+  }
+
+private:
+  ARMInstruction &Add(ARMOpcode Opc, size_t Size, size_t OpdNum) {
+    auto &instr = Instrs.emplace_back();
+    instr.opc = Opc;
+    instr.OpSize = Size;
+    instr.opd_num = OpdNum;
+
+    if (Last) {
+      Last->next = &instr;
+      instr.prev = Last;
+    } else {
+      Rules.back().arm_host = &instr;
+    }
+    Last = &instr;
+    return instr;
+  }
+
+  static void SetReg(ARMInstruction &instr, size_t Idx, ARMRegister Reg) {
+    instr.opd[Idx].type = ARM_OPD_TYPE_REG;
+    instr.opd[Idx].content.reg.num = Reg;
+  }
+
+  static void SetImm(ARMInstruction &instr, size_t Idx, int32_t Imm) {
+    instr.opd[Idx].type = ARM_OPD_TYPE_IMM;
+    instr.opd[Idx].content.imm.type = ARM_IMM_TYPE_VAL;
+    instr.opd[Idx].content.imm.content.val = Imm;
+  }
+
+  static void SetMem(ARMInstruction &instr, size_t Idx, ARMRegister Base, int32_t Offset) {
+    instr.opd[Idx].type = ARM_OPD_TYPE_MEM;
+    instr.opd[Idx].content.mem.base = Base;
+    instr.opd[Idx].content.mem.index = ARM_REG_INVALID;
+    instr.opd[Idx].content.mem.offset.type = ARM_IMM_TYPE_VAL;
+    instr.opd[Idx].content.mem.offset.content.val = Offset;
+  }
+
+  static void SetLiveOut(X86Instruction *Guest, uint8_t LiveOut) {
+    std::fill(std::begin(Guest->reg_liveness), std::end(Guest->reg_liveness), false);
+    Guest->reg_liveness[X86_REG_ZF] = LiveOut & RULE_CC_LIVE;
+    Guest->reg_liveness[X86_REG_CF] = LiveOut & RULE_CF_LIVE;
+  }
+
+  std::deque<ARMInstruction> Instrs;
+  std::deque<TranslationRule> Rules;
+  std::deque<X86Instruction> Guests;
+  std::deque<RuleRecord> Records;
+  ARMInstruction *Last{};
+
+  FILE *fp;
+  std::unique_ptr<vixl::aarch64::PrintDisassembler> Disassembler;
+};
+
+// A cmp the carry of is read also turns the carry around, like x86 sets it for subtraction
+static constexpr size_t CMP_FLIP_CF = 4;
+
+TEST_CASE_METHOD(RuleStreamTest, "Emitter: RuleOpt: Store to load forwarding") {
+  {
+    Str(8, ARM_REG_R4, ARM_REG_R8, 16);
+    Rule();
+    Ldr(8, ARM_REG_R5, ARM_REG_R8, 16);
+    const auto Disasm = Assemble(0);
+    CHECK(Count(Disasm) == 2);
+    CHECK(Disasm == "str x4, [x8, #16]\nmov x5, x4\n");
+  }
+
+  {
+    // Reloading the register that was stored
+    Str(8, ARM_REG_R4, ARM_REG_R8, 16);
+    Rule();
+    Ldr(8, ARM_REG_R4, ARM_REG_R8, 16);
+    CHECK(Assemble(0) == "str x4, [x8, #16]\n");
+  }
+
+  {
+    // A 32 bit reload zero extends, the stored register may not be
+    Str(4, ARM_REG_R4, ARM_REG_R8, 16);
+    Ldr(4, ARM_REG_R4, ARM_REG_R8, 16);
+    CHECK(Assemble(0) == "str w4, [x8, #16]\nmov w4, w4\n");
+  }
+
+  {
+    // Another store may alias
+    Str(8, ARM_REG_R4, ARM_REG_R8, 16);
+    Str(8, ARM_REG_R6, ARM_REG_R9, 0);
+    Ldr(8, ARM_REG_R5, ARM_REG_R8, 16);
+    CHECK(Count(Assemble(0), "ldr ") == 1);
+  }
+
+  {
+    // The stored register changed in between
+    Str(8, ARM_REG_R4, ARM_REG_R8, 16);
+    Alu(ARM_OPC_ADD, 8, ARM_REG_R4, ARM_REG_R4, ARM_REG_R5);
+    Ldr(8, ARM_REG_R5, ARM_REG_R8, 16);
+    const auto Disasm = Assemble(0);
+    CHECK(Count(Disasm) == 3);
+    CHECK(Disasm == "str x4, [x8, #16]\nadd x4, x4, x5\nldr x5, [x8, #16]\n");
+  }
+
+  {
+    // Different size
+    Str(8, ARM_REG_R4, ARM_REG_R8, 16);
+    Ldr(4, ARM_REG_R5, ARM_REG_R8, 16);
+    CHECK(Assemble(0) == "str x4, [x8, #16]\nldr w5, [x8, #16]\n");
+  }
+}
+
+TEST_CASE_METHOD(RuleStreamTest, "Emitter: RuleOpt: Repeated compare and cset") {
+  {
+    Cmp(8, ARM_REG_R4, ARM_REG_R5);
+    Cset(8, ARM_REG_R6, ARM_CC_EQ);
+    Rule();
+    Cmp(8, ARM_REG_R4, ARM_REG_R5);
+    Cset(8, ARM_REG_R6, ARM_CC_EQ);
+    const auto Disasm = Assemble(0);
+    CHECK(Count(Disasm) == CMP_FLIP_CF + 1);
+    CHECK(Count(Disasm, "cmp x4, x5") == 1);
+    CHECK(Count(Disasm, "cset x6, eq") == 1);
+  }
+
+  {
+    // Operand written in between
+    Cmp(8, ARM_REG_R4, ARM_REG_R5);
+    Cset(8, ARM_REG_R6, ARM_CC_EQ);
+    MovImm(8, ARM_REG_R4, 1);
+    Cmp(8, ARM_REG_R4, ARM_REG_R5);
+    Cset(8, ARM_REG_R6, ARM_CC_EQ);
+    const auto Disasm = Assemble(0);
+    CHECK(Count(Disasm) == 2 * (CMP_FLIP_CF + 1) + 1);
+    CHECK(Count(Disasm, "cmp x4, x5") == 2);
+  }
+
+  {
+    // Flags nobody reads
+    Cmp(8, ARM_REG_R4, ARM_REG_R5);
+    Rule();
+    Cmp(8, ARM_REG_R6, ARM_REG_R7);
+    Cset(8, ARM_REG_R8, ARM_CC_EQ);
+    const auto Disasm = Assemble(0);
+    CHECK(Count(Disasm) == CMP_FLIP_CF + 1);
+    CHECK(Count(Disasm, "cmp x4, x5") == 0);
+    CHECK(Count(Disasm, "cmp x6, x7") == 1);
+  }
+
+  {
+    // Flags written in between
+    Cmp(8, ARM_REG_R4, ARM_REG_R5);
+    Cset(8, ARM_REG_R6, ARM_CC_EQ);
+    Cmp(8, ARM_REG_R7, ARM_REG_R5);
+    Cset(8, ARM_REG_R6, ARM_CC_EQ);
+    CHECK(Count(Assemble(0), "cset x6, eq") == 2);
+  }
+
+  {
+    // Handler scratch registers never carry facts
+    Cmp(8, ARM_REG_R20, ARM_REG_R5);
+    Cset(8, ARM_REG_R6, ARM_CC_EQ);
+    Cmp(8, ARM_REG_R20, ARM_REG_R5);
+    Cset(8, ARM_REG_R6, ARM_CC_EQ);
+    CHECK(Count(Assemble(0), "cmp x20, x5") == 2);
+  }
+}
+
+TEST_CASE_METHOD(RuleStreamTest, "Emitter: RuleOpt: Copies") {
+  {
+    Mov(8, ARM_REG_R6, ARM_REG_R4);
+    Rule();
+    Mov(8, ARM_REG_R4, ARM_REG_R6);
+    Mov(8, ARM_REG_R6, ARM_REG_R4);
+    CHECK(Assemble(0) == "mov x6, x4\n");
+  }
+
+  {
+    Mov(8, ARM_REG_R6, ARM_REG_R4);
+    Alu(ARM_OPC_ADD, 8, ARM_REG_R4, ARM_REG_R4, ARM_REG_R5);
+    Mov(8, ARM_REG_R6, ARM_REG_R4);
+    CHECK(Assemble(0) == "mov x6, x4\nadd x4, x4, x5\nmov x6, x4\n");
+  }
+
+  {
+    // Forwarded values are copies too
+    Str(8, ARM_REG_R4, ARM_REG_R8, 0);
+    Rule();
+    Ldr(8, ARM_REG_R5, ARM_REG_R8, 0);
+    Rule();
+    Mov(8, ARM_REG_R4, ARM_REG_R5);
+    CHECK(Assemble(0) == "str x4, [x8]\nmov x5, x4\n");
+  }
+}
+
+TEST_CASE_METHOD(RuleStreamTest, "Emitter: RuleOpt: Zero extensions") {
+  {
+    Alu(ARM_OPC_ADD, 4, ARM_REG_R6, ARM_REG_R4, ARM_REG_R5);
+    Rule();
+    Mov(4, ARM_REG_R6, ARM_REG_R6);
+    Rule();
+    Mov(4, ARM_REG_R6, ARM_REG_R6);
+    CHECK(Assemble(0) == "add w6, w4, w5\n");
+  }
+
+  {
+    Ldr(8, ARM_REG_R6, ARM_REG_R8, 0);
+    Rule();
+    Mov(4, ARM_REG_R6, ARM_REG_R6);
+    Rule();
+    Mov(4, ARM_REG_R6, ARM_REG_R6);
+    CHECK(Assemble(0) == "ldr x6, [x8]\nmov w6, w6\n");
+  }
+
+  {
+    MovImm(8, ARM_REG_R6, 0x1234);
+    Mov(4, ARM_REG_R6, ARM_REG_R6);
+    CHECK(Count(Assemble(0), "mov w6, w6") == 0);
+  }
+}
+
+TEST_CASE_METHOD(RuleStreamTest, "Emitter: RuleOpt: Dead flags across rules") {
+  {
+    Alu(ARM_OPC_ADDS, 8, ARM_REG_R4, ARM_REG_R4, ARM_REG_R5);
+    Rule();
+    Alu(ARM_OPC_ADDS, 8, ARM_REG_R6, ARM_REG_R6, ARM_REG_R7);
+    CHECK(Assemble(RULE_CC_LIVE) == "add x4, x4, x5\nadds x6, x6, x7\n");
+  }
+
+  {
+    Alu(ARM_OPC_ADDS, 8, ARM_REG_R4, ARM_REG_R4, ARM_REG_R5);
+    Cset(8, ARM_REG_R6, ARM_CC_CS);
+    Rule();
+    Alu(ARM_OPC_ADDS, 8, ARM_REG_R6, ARM_REG_R6, ARM_REG_R7);
+    CHECK(Assemble(0) == "adds x4, x4, x5\ncset x6, hs\nadd x6, x6, x7\n");
+  }
+
+  {
+    // Flags are live into the exit of a rule in the middle of the stream, only the carry is dead there
+    Cmp(8, ARM_REG_R4, ARM_REG_R5);
+    Exit(RULE_CC_LIVE);
+    Cmp(8, ARM_REG_R6, ARM_REG_R7);
+    const auto Disasm = Assemble(0);
+    CHECK(Count(Disasm) == 2);
+    CHECK(Count(Disasm, "cmp x4, x5") == 1);
+    CHECK(Count(Disasm, "b ") == 1);
+  }
+
+  {
+    // Flags read after the block keep the flag setting form
+    Alu(ARM_OPC_ADDS, 8, ARM_REG_R4, ARM_REG_R4, ARM_REG_R5);
+    CHECK(Assemble(RULE_CC_LIVE) == "adds x4, x4, x5\n");
+  }
+}
+
+TEST_CASE_METHOD(RuleStreamTest, "Emitter: RuleOpt: Barriers") {
+  {
+    Cmp(8, ARM_REG_R4, ARM_REG_R5);
+    Cset(8, ARM_REG_R6, ARM_CC_EQ);
+    Opaque();
+    Cmp(8, ARM_REG_R4, ARM_REG_R5);
+    Cset(8, ARM_REG_R6, ARM_CC_EQ);
+    const auto Disasm = Assemble(0);
+    CHECK(Count(Disasm) == 2 * (CMP_FLIP_CF + 1) + 1);
+    CHECK(Count(Disasm, "mov v2.16b, v3.16b") == 1);
+  }
+
+  {
+    Str(8, ARM_REG_R4, ARM_REG_R8, 16);
+    Exit(0);
+    Ldr(8, ARM_REG_R5, ARM_REG_R8, 16);
+    const auto Disasm = Assemble(0);
+    CHECK(Count(Disasm) == 3);
+    CHECK(Count(Disasm, "ldr x5, [x8, #16]") == 1);
+  }
+}
@@ -0,0 +1,77 @@
+#!/usr/bin/python3
+# Prints the binary trace of the translation rules, written by FEX with
+# FEX_RULETRACE=<file> as <file>.<pid>.
+#
+# Usage: rule_trace.py [--summary] <trace file>
+
+import argparse
+import struct
+import sys
+from collections import defaultdict
+
+MAGIC = b"FEXRTRC\0"
+VERSION = 1
+
+# RuleTraceHeader and RuleTraceRecord of rule-trace.h
+HEADER = struct.Struct("<8sII")
+RECORD = struct.Struct("<QIIIHH")
+
+EVENTS = ["block", "miss", "match", "emit", "unsupported"]
+
+def ReadTrace(Path):
+  with open(Path, "rb") as TraceFile:
+    Data = TraceFile.read()
+
+  Magic, Version, RecordSize = HEADER.unpack_from(Data, 0)
+  if Magic != MAGIC or Version != VERSION or RecordSize != RECORD.size:
+    raise ValueError("{} is not a version {} rule trace".format(Path, VERSION))
+
+  for Offset in range(HEADER.size, len(Data) - RECORD.size + 1, RECORD.size):
+    PC, Rule, HostBytes, TID, Event, _ = RECORD.unpack_from(Data, Offset)
+    yield {"pc": PC, "rule": Rule, "host_bytes": HostBytes, "tid": TID,
+           "event": EVENTS[Event] if Event < len(EVENTS) else str(Event)}
+
+def PrintSummary(Records):
+  Rules = defaultdict(lambda: defaultdict(int))
+  Blocks = 0
+  for Record in Records:
+    if Record["event"] == "block":
+      Blocks += 1
+      continue
+    Counts = Rules[Record["rule"]]
+    Counts[Record["event"]] += 1
+    if Record["event"] == "emit":
+      Counts["host_bytes"] += Record["host_bytes"]
+
+  print("Blocks matched: {}".format(Blocks))
+  print("{:>8} {:>10} {:>10} {:>10} {:>12} {:>12}".format("rule", "tried", "matched", "emitted", "host bytes", "unsupported"))
+  for Rule, Counts in sorted(Rules.items(), key=lambda Item: -Item[1]["emit"]):
+    print("{:>8} {:>10} {:>10} {:>10} {:>12} {:>12}".format(
+      Rule, Counts["miss"] + Counts["match"], Counts["match"], Counts["emit"], Counts["host_bytes"], Counts["unsupported"]))
+
+def main():
+  Parser = argparse.ArgumentParser(description="Print a translation rule trace")
+  Parser.add_argument("--summary", action="store_true", help="counts per rule instead of the records")
+  Parser.add_argument("trace", help="trace file")
+  Args = Parser.parse_args()
+
+  try:
+    Records = ReadTrace(Args.trace)
+    if Args.summary:
+      PrintSummary(Records)
+      return 0
+
+    for Record in Records:
+      Line = "{:5} {:11} 0x{:x}".format(Record["tid"], Record["event"], Record["pc"])
+      if Record["event"] != "block":
+        Line += " rule {}".format(Record["rule"])
+      if Record["event"] == "emit":
+        Line += " {} bytes".format(Record["host_bytes"])
+      print(Line)
+  except (OSError, ValueError) as Err:
+    print(Err, file=sys.stderr)
+    return 1
+  return 0
+
+if __name__ == "__main__":
+  sys.exit(main())
@@ -0,0 +1,446 @@
+#!/usr/bin/python3
+# Differential verifier for translation rules.
+#
+# Every rule's guest sequence is instantiated as an ASM test: random registers
+# are bound to the rule's symbolic registers, random immediates to its
+# symbols, and the guest registers, flags, XMM registers and memory start out
+# random. Each test runs through TestHarnessRunner once with the rules and
+# once with FEX_TRANSLATIONRULES=0, which sends the same code through the
+# OpcodeDispatcher and the IR JIT. The final states must match.
+#
+# Works with any TestHarnessRunner build, including the VIXL simulator one.
+#
+# Usage: rule_verifier.py [options] <TestHarnessRunner> <rule file>
+
+import argparse
+import glob
+import os
+import random
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+from multiprocessing.pool import ThreadPool
+
+from rule_trace import ReadTrace
+
+ScriptDir = os.path.dirname(os.path.abspath(__file__))
+
+# Memory the tests use, a single MemoryRegion
+DATA_BASE   = 0x1000_0000     # addressed absolute, below 2GB
+DATA_SIZE   = 0x2000
+FLAGS_ADDR  = DATA_BASE            # flags after the sequence, stored by the test
+XMM_INIT    = DATA_BASE + 0x100    # initial XMM values
+WINDOW_LO   = DATA_BASE + 0x800    # random data the sequence may access
+WINDOW_HI   = DATA_BASE + 0x1a00
+BASE_VALUE  = DATA_BASE + 0xc00    # value of registers used as memory base
+STACK_TOP   = DATA_BASE + 0x1800
+OFFSET_MAX  = 0x200
+
+# Flags the rules don't model, ignored unless --strict-flags
+FLAGS_PF_AF = (1 << 2) | (1 << 4)
+FLAGS_RANDOM = 0x8d5   # CF, PF, AF, ZF, SF, OF
+
+GPRS = [
+  # 64, 32, 16, 8
+  ("rax", "eax",  "ax",   "al"),
+  ("rbx", "ebx",  "bx",   "bl"),
+  ("rcx", "ecx",  "cx",   "cl"),
+  ("rdx", "edx",  "dx",   "dl"),
+  ("rsi", "esi",  "si",   "sil"),
+  ("rdi", "edi",  "di",   "dil"),
+  ("rbp", "ebp",  "bp",   "bpl"),
+  ("rsp", "esp",  "sp",   "spl"),
+  ("r8",  "r8d",  "r8w",  "r8b"),
+  ("r9",  "r9d",  "r9w",  "r9b"),
+  ("r10", "r10d", "r10w", "r10b"),
+  ("r11", "r11d", "r11w", "r11b"),
+  ("r12", "r12d", "r12w", "r12b"),
+  ("r13", "r13d", "r13w", "r13b"),
+  ("r14", "r14d", "r14w", "r14b"),
+  ("r15", "r15d", "r15w", "r15b"),
+]
+
+GPR_FAMILY = {}
+for Family in GPRS:
+  for Name in Family:
+    GPR_FAMILY[Name] = Family[0]
+for High, Family in (("ah", "rax"), ("bh", "rbx"), ("ch", "rcx"), ("dh", "rdx")):
+  GPR_FAMILY[High] = Family
+
+SUFFIX_INDEX = {"q": 0, "d": 1, "w": 2, "b": 3}
+SIZE_BITS = {"q": 64, "d": 32, "w": 16, "b": 8}
+MEM_BITS = {"byte": 8, "word": 16, "dword": 32, "qword": 64, "xmmword": 128}
+
+SHIFT_OPS = {"shl", "shr", "sar", "shld", "shrd", "bt"}
+UNSUPPORTED_OPS = {"call", "ret"}
+
+SymReg = re.compile(r"\breg(\d+)([qdwb]?)\b")
+TempReg = re.compile(r"\btemp\d+")
+ImmSym = re.compile(r"\$\(?(imm_\w+)")
+
+def IsSSE(Mnemonic):
+  return Mnemonic.startswith(("p", "mov", "and", "or", "xor", "add", "sub", "shuf", "punpck", "pack")) and \
+         Mnemonic not in ("mov", "movzx", "movsx", "movsxd", "and", "or", "xor", "add", "sub", "pop", "push")
+
+def LoadRules(Path):
+  Rules = []
+  Current = None
+  InGuest = False
+  with open(Path) as RuleFile:
+    for Line in RuleFile:
+      Match = re.match(r"^(\d+)\.(Guest|Host):$", Line.strip())
+      if Match:
+        InGuest = Match.group(2) == "Guest"
+        if InGuest:
+          Current = {"index": int(Match.group(1)), "guest": []}
+          Rules.append(Current)
+        continue
+      if InGuest and Line.strip() and not Line.startswith("#"):
+        Current["guest"].append(Line.strip())
+  return Rules
+
+def SplitInstr(Line):
+  Parts = Line.split(" ", 1)
+  Operands = [Opd.strip() for Opd in Parts[1].split(",")] if len(Parts) > 1 else []
+  return Parts[0], Operands
+
+def OperandBits(Operand):
+  Match = SymReg.fullmatch(Operand)
+  if Match and Match.group(2):
+    return SIZE_BITS[Match.group(2)]
+  for Keyword, Bits in MEM_BITS.items():
+    if Operand.startswith(Keyword + " "):
+      return Bits
+  for Family in GPRS:
+    if Operand in Family:
+      return [64, 32, 16, 8][Family.index(Operand)]
+  return 8 if Operand in GPR_FAMILY else 64
+
+# What each immediate symbol is used for decides the values it gets
+def ClassifyRule(Rule):
+  Info = {"imms": {}, "gprs": {}, "xmms": set(), "physical": set(), "labels": set(), "unsupported": None}
+
+  def SetImm(Sym, Kind):
+    Priority = ["label", "scale", "shift", "offset", "imm8", "imm16", "imm32"]
+    Old = Info["imms"].get(Sym)
+    if Old is None or Priority.index(Kind[0]) < Priority.index(Old[0]):
+      Info["imms"][Sym] = Kind
+
+  for Line in Rule["guest"]:
+    if TempReg.search(Line):
+      Info["unsupported"] = "temporary registers"
+    if Line.endswith(":"):
+      Info["labels"].add(Line[:-1])
+      continue
+
+    Mnemonic, Operands = SplitInstr(Line)
+    if Mnemonic in UNSUPPORTED_OPS:
+      Info["unsupported"] = Mnemonic
+    if "rip" in Line:
+      Info["unsupported"] = "rip relative operands"
+
+    Bits = OperandBits(Operands[0]) if Operands else 64
+    for Pos, Operand in enumerate(Operands):
+      for Name in re.findall(r"\b[a-z][a-z0-9]*\b", Operand):
+        if Name in GPR_FAMILY:
+          Info["physical"].add(GPR_FAMILY[Name])
+
+      if "[" in Operand:
+        Inner = Operand[Operand.index("[") + 1:Operand.rindex("]")]
+        Terms = [T.strip() for T in re.split(r"\+|-", Inner)]
+        for TermPos, Term in enumerate(Terms):
+          Match = SymReg.fullmatch(Term.split("*")[0].strip())
+          if Match:
+            Role = "base" if TermPos == 0 else "index"
+            Info["gprs"].setdefault(Match.group(1), set()).add(Role)
+          if "*" in Term:
+            Scale = Term.split("*")[1].strip()
+            if Scale.startswith("imm"):
+              SetImm(Scale, ("scale",))
+          elif Term.startswith("imm"):
+            SetImm(Term, ("offset",))
+        continue
+
+      Match = SymReg.fullmatch(Operand)
+      if Match:
+        if not Match.group(2) and IsSSE(Mnemonic):
+          Info["xmms"].add(Match.group(1))
+        else:
+          Info["gprs"].setdefault(Match.group(1), set()).add("data")
+        continue
+
+      Sym = ImmSym.match(Operand)
+      if Operand.startswith("$L"):
+        SetImm(Operand[1:], ("label",))
+      elif Sym:
+        if Mnemonic in SHIFT_OPS and Pos == len(Operands) - 1:
+          SetImm(Sym.group(1), ("shift", Bits))
+        else:
+          SetImm(Sym.group(1), ("imm8" if Bits == 8 else "imm16" if Bits == 16 else "imm32",))
+
+  return Info
+
+def RandomValue(Rng, Bits):
+  Edges = [0, 1, (1 << Bits) - 1, 1 << (Bits - 1), (1 << (Bits - 1)) - 1]
+  if Rng.random() < 0.25:
+    return Rng.choice(Edges)
+  return Rng.getrandbits(Bits)
+
+def RandomImm(Rng, Kind):
+  if Kind[0] == "scale":
+    return Rng.choice([1, 2, 4, 8])
+  if Kind[0] == "shift":
+    return Rng.randrange(Kind[1])
+  if Kind[0] == "offset":
+    return Rng.randrange(-OFFSET_MAX, OFFSET_MAX)
+  Bits = {"imm8": 8, "imm16": 16, "imm32": 32}[Kind[0]]
+  Value = RandomValue(Rng, Bits)
+  # Signed, so the assembler keeps the operand size of the rule
+  return Value - (1 << Bits) if Value >= 1 << (Bits - 1) else Value
+
+def HexBytes(Data):
+  return " ".join("{:02x}".format(Byte) for Byte in Data)
+
+# Instantiates the rule, returns the test source or None with a reason
+def GenerateTest(Rule, Info, Rng, Alias, FlagsLive):
+  if Info["unsupported"]:
+    return None, Info["unsupported"]
+
+  Pool = [F[0] for F in GPRS if F[0] != "rsp" and F[0] not in Info["physical"]]
+  Syms = sorted(Info["gprs"].keys(), key=int)
+  if not Alias and len(Syms) > len(Pool):
+    return None, "too many registers"
+
+  Binding = {}
+  Choices = Rng.sample(Pool, len(Syms)) if not Alias else [Rng.choice(Pool) for _ in Syms]
+  for Sym, Reg in zip(Syms, Choices):
+    Binding[Sym] = Reg
+
+  XMMBinding = {}
+  for Sym, Num in zip(sorted(Info["xmms"], key=int), Rng.sample(range(16), len(Info["xmms"]))):
+    XMMBinding[Sym] = "xmm{}".format(Num)
+
+  # A register used as a memory base or index must point into the window
+  Roles = {}
+  for Sym, Reg in Binding.items():
+    Roles.setdefault(Reg, set()).update(Info["gprs"][Sym])
+
+  Source = []
+  Source.append("%ifdef CONFIG")
+  Source.append("{")
+  Source.append('  "MemoryRegions": {')
+  Source.append('    "0x{:x}": "0x{:x}"'.format(DATA_BASE, DATA_SIZE))
+  Source.append("  },")
+  Source.append('  "MemoryData": {')
+  XMMData = Rng.randbytes(16 * 16)
+  WindowData = Rng.randbytes(WINDOW_HI - WINDOW_LO)
+  Source.append('    "0x{:x}": "{}",'.format(XMM_INIT, HexBytes(XMMData)))
+  Source.append('    "0x{:x}": "{}"'.format(WINDOW_LO, HexBytes(WindowData)))
+  Source.append("  }")
+  Source.append("}")
+  Source.append("%endif")
+  Source.append("")
+
+  for Sym, Reg in Binding.items():
+    Family = next(F for F in GPRS if F[0] == Reg)
+    Source.append("%define reg{} {}".format(Sym, Family[0]))
+    for Suffix, Index in SUFFIX_INDEX.items():
+      Source.append("%define reg{}{} {}".format(Sym, Suffix, Family[Index]))
+  for Sym, Reg in XMMBinding.items():
+    Source.append("%define reg{} {}".format(Sym, Reg))
+  for Sym, Kind in Info["imms"].items():
+    if Kind[0] != "label":
+      Source.append("%define {} {}".format(Sym, RandomImm(Rng, Kind)))
+  Source.append("")
+
+  Source.append("mov rsp, 0x{:x}".format(STACK_TOP))
+  for Family in GPRS:
+    Reg = Family[0]
+    if Reg == "rsp":
+      continue
+    Role = Roles.get(Reg, set())
+    if "base" in Role:
+      Value = BASE_VALUE
+    elif "index" in Role:
+      Value = Rng.randrange(16)
+    else:
+      Value = RandomValue(Rng, 64)
+    Source.append("mov {}, 0x{:x}".format(Reg, Value))
+  for Num in range(16):
+    Source.append("movdqu xmm{}, [0x{:x}]".format(Num, XMM_INIT + Num * 16))
+  Source.append("push qword 0x{:x}".format(0x202 | (Rng.getrandbits(12) & FLAGS_RANDOM)))
+  Source.append("popfq")
+
+  # Start a block of its own, so the sequence is matched from its first instruction
+  Source.append("jmp sequence")
+  Source.append("sequence:")
+  for Line in Rule["guest"]:
+    Mnemonic, Operands = SplitInstr(Line)
+    # Keep the 64-bit form, the assembler would shrink it to a 32-bit mov
+    if Mnemonic == "mov" and len(Operands) == 2 and OperandBits(Operands[0]) == 64 and \
+       ImmSym.match(Operands[1]) and Info["imms"][ImmSym.match(Operands[1]).group(1)][0] == "imm32":
+      Line = "mov {}, strict dword {}".format(Operands[0], Operands[1])
+    Line = re.sub(r"\$\(", "(", Line)
+    Line = re.sub(r"\$(-?)([0-9a-fA-F]+)\b", r"\g<1>0x\2", Line)
+    Line = Line.replace("$", "")
+    # Constant memory offsets are hex in the rule text
+    Line = re.sub(r"([+-]) ([0-9a-fA-F]+)\]", r"\1 0x\2]", Line)
+    Source.append(Line)
+
+  # Both sides of a branch end the test, with different RIPs
+  def Epilogue():
+    if FlagsLive:
+      Source.append("pushfq")
+      Source.append("pop qword [0x{:x}]".format(FLAGS_ADDR))
+    else:
+      # Kills the flags, the rule doesn't need to produce them
+      Source.append("cmp rsp, rsp")
+    Source.append("hlt")
+
+  Epilogue()
+  for Label in sorted(Info["imms"]):
+    if Info["imms"][Label][0] == "label" and Label not in Info["labels"]:
+      Source.append(Label + ":")
+      Epilogue()
+
+  return "\n".join(Source) + "\n", None
+
+def ParseDump(Path, StrictFlags):
+  State = {}
+  try:
+    with open(Path) as DumpFile:
+      for Line in DumpFile:
+        Key, Value = Line.split(" ", 1)
+        if Key == "MEM":
+          Addr, Data = Value.split(" ", 1)
+          Addr = int(Addr, 16)
+          Bytes = bytearray(int(Byte, 16) for Byte in Data.split())
+          if Addr == FLAGS_ADDR and not StrictFlags:
+            Bytes[0] &= ~FLAGS_PF_AF & 0xff
+          State["MEM 0x{:x}".format(Addr)] = HexBytes(Bytes)
+        else:
+          State[Key] = Value.strip()
+  except OSError:
+    return None
+  return State
+
+def RunTest(Args, Home, AsmPath, Index):
+  Base = AsmPath[:-4]
+  Nasm = subprocess.run(["nasm", "-i", os.path.join(os.path.dirname(ScriptDir), "unittests/ASM/Includes/"),
+                         AsmPath, "-o", Base + ".bin"], capture_output=True, text=True)
+  if Nasm.returncode:
+    return "unsupported", Nasm.stderr.strip().splitlines()[0] if Nasm.stderr else "nasm failed"
+
+  Config = subprocess.run(["python3", os.path.join(ScriptDir, "json_asm_config_parse.py"), AsmPath, Base + ".config.bin"])
+  if Config.returncode:
+    return "error", "config"
+
+  Results = {}
+  for Mode, Enabled in (("ir", "0"), ("rule", "1")):
+    Env = dict(os.environ)
+    Env["HOME"] = Home
+    Env["FEX_TRANSLATIONRULES"] = Enabled
+    Env["FEX_DUMPGUESTSTATE"] = "{}.{}.state".format(Base, Mode)
+    Env["FEX_RULETRACE"] = Base + ".rule.trace"
+    Run = subprocess.run([Args.runner, Base + ".config.bin", Base + ".bin"], env=Env,
+                         capture_output=True, text=True, timeout=Args.timeout)
+    Results[Mode] = (Run, ParseDump(Env["FEX_DUMPGUESTSTATE"], Args.strict_flags))
+
+  IRRun, IRState = Results["ir"]
+  RuleRun, RuleState = Results["rule"]
+  if IRState is None or RuleState is None:
+    return "error", "no state from the {} run".format("IR" if IRState is None else "rule")
+
+  # The trace file of the run has its pid appended
+  Applied = [str(Record["rule"]) for Trace in glob.glob(Base + ".rule.trace.*")
+             for Record in ReadTrace(Trace) if Record["event"] == "emit"]
+  if str(Index) not in Applied:
+    return "not applied", "applied " + (", ".join(sorted(set(Applied))) or "no rule")
+
+  Diff = ["{}: {} != {}".format(Key, RuleState.get(Key), IRState.get(Key))
+          for Key in sorted(set(IRState) | set(RuleState)) if IRState.get(Key) != RuleState.get(Key)]
+  if "Faulted? Yes" in RuleRun.stdout and "Faulted? Yes" not in IRRun.stdout:
+    Diff.insert(0, "rule translation faulted")
+  if Diff:
+    return "fail", "; ".join(Diff[:4])
+  return "pass", ""
+
+def main():
+  Parser = argparse.ArgumentParser(description="Differential verifier for translation rules")
+  Parser.add_argument("runner", help="TestHarnessRunner executable")
+  Parser.add_argument("rules", help="rule file, as in $HOME/rules4all")
+  Parser.add_argument("-n", "--trials", type=int, default=8, help="random instances per rule")
+  Parser.add_argument("-s", "--seed", type=int, default=0)
+  Parser.add_argument("-r", "--rule", type=int, action="append", help="only verify these rule indexes")
+  Parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count())
+  Parser.add_argument("-t", "--timeout", type=int, default=60, help="seconds per run")
+  Parser.add_argument("-k", "--keep", help="keep the generated tests in this directory")
+  Parser.add_argument("--strict-flags", action="store_true", help="also compare PF and AF")
+  Args = Parser.parse_args()
+
+  Rules = LoadRules(Args.rules)
+  if Args.rule:
+    Rules = [Rule for Rule in Rules if Rule["index"] in Args.rule]
+
+  WorkDir = Args.keep or tempfile.mkdtemp(prefix="rule_verifier.")
+  os.makedirs(WorkDir, exist_ok=True)
+
+  # The rules are loaded from $HOME, a home of our own only holds the rule text
+  Home = os.path.join(WorkDir, "home")
+  os.makedirs(Home, exist_ok=True)
+  shutil.copyfile(Args.rules, os.path.join(Home, "rules4all"))
+
+  Tests = []
+  Results = {}
+  for Rule in Rules:
+    Info = ClassifyRule(Rule)
+    Rng = random.Random("{}:{}".format(Args.seed, Rule["index"]))
+    Results[Rule["index"]] = []
+    for Trial in range(Args.trials):
+      # Odd trials may bind several symbolic registers to one guest register,
+      # the matcher allows it. Every other pair of trials needs the flags.
+      Source, Reason = GenerateTest(Rule, Info, Rng, Trial % 2 == 1, Trial % 4 < 2)
+      if Source is None:
+        Results[Rule["index"]].append(("unsupported", Reason))
+        break
+      AsmPath = os.path.join(WorkDir, "rule{}_{}.asm".format(Rule["index"], Trial))
+      with open(AsmPath, "w") as AsmFile:
+        AsmFile.write(Source)
+      Tests.append((Rule["index"], AsmPath))
+
+  def Run(Test):
+    Index, AsmPath = Test
+    try:
+      return Index, AsmPath, RunTest(Args, Home, AsmPath, Index)
+    except subprocess.TimeoutExpired:
+      return Index, AsmPath, ("error", "timeout")
+
+  with ThreadPool(Args.jobs) as Pool:
+    for Index, AsmPath, Result in Pool.imap_unordered(Run, Tests):
+      Results[Index].append(Result)
+      if Result[0] == "fail":
+        print("FAIL rule {}: {}: {}".format(Index, os.path.basename(AsmPath), Result[1]))
+
+  Columns = ["pass", "fail", "not applied", "unsupported", "error"]
+  print("{:>8}  {}  {}".format("rule", "  ".join("{:>11}".format(C) for C in Columns), "note"))
+  Totals = dict.fromkeys(Columns, 0)
+  for Index in sorted(Results):
+    Counts = dict.fromkeys(Columns, 0)
+    Notes = []
+    for Status, Note in Results[Index]:
+      Counts[Status] += 1
+      Totals[Status] += 1
+      if Note and Status != "pass" and Note not in Notes:
+        Notes.append(Note)
+    print("{:>8}  {}  {}".format(Index, "  ".join("{:>11}".format(Counts[C]) for C in Columns), " | ".join(Notes[:2])))
+  print("{:>8}  {}".format("total", "  ".join("{:>11}".format(Totals[C]) for C in Columns)))
+
+  if not Args.keep:
+    shutil.rmtree(WorkDir)
+
+  return 1 if Totals["fail"] or Totals["error"] else 0
+
+if __name__ == "__main__":
+  sys.exit(main())
@@ -3,6 +3,7 @@
 
 #include "Common/Config.h"
 
+#include <algorithm>
 #include <array>
 #include <bitset>
 #include <cassert>
@@ -14,6 +15,7 @@
 #include <FEXCore/Core/X86Enums.h>
 #include <FEXCore/Utils/Allocator.h>
 #include <FEXCore/Utils/CompilerDefs.h>
+#include <FEXCore/Utils/File.h>
 #include <FEXCore/Utils/FileLoading.h>
 #include <FEXCore/Utils/LogManager.h>
 #include <FEXCore/Utils/MathUtils.h>
@@ -275,6 +277,35 @@ namespace FEX::HarnessHelper {
       return Matches;
     }
 
+    // Writes the final state as text, so two runs of the same test can be diffed.
+    // Flags only show up through memory, the test has to store them itself.
+    bool DumpState(fextl::string const &Filename, FEXCore::Core::CPUState const* State, bool SupportsAVX) {
+      FEXCore::File::File File(Filename.c_str(), FEXCore::File::FileModes::WRITE | FEXCore::File::FileModes::CREATE | FEXCore::File::FileModes::TRUNCATE);
+      if (!File.IsValid()) {
+        LogMan::Msg::EFmt("Couldn't open {} to dump the guest state", Filename);
+        return false;
+      }
+
+      fextl::fmt::print(File, "RIP 0x{:016x}\n", State->rip);
+      for (unsigned i = 0; i < FEXCore::Core::CPUState::NUM_GPRS; ++i) {
+        fextl::fmt::print(File, "GPR{} 0x{:016x}\n", i, State->gregs[i]);
+      }
+
+      for (size_t i = 0; i < FEXCore::Core::CPUState::NUM_XMMS; ++i) {
+        uint64_t const *XMM = SupportsAVX ? State->xmm.avx.data[i] : State->xmm.sse.data[i];
+        fextl::fmt::print(File, "XMM{} 0x{:016x} 0x{:016x}\n", i, XMM[0], XMM[1]);
+      }
+
+      for (auto& [region, size] : GetMemoryRegions()) {
+        auto Data = reinterpret_cast<uint8_t const*>(region);
+        for (size_t Offset = 0; Offset < size; Offset += 16) {
+          fextl::fmt::print(File, "MEM 0x{:x} {:02x}\n", region + Offset, fmt::join(Data + Offset, Data + std::min<size_t>(Offset + 16, size), " "));
+        }
+      }
+
+      return true;
+    }
+
     fextl::map<uintptr_t, size_t> GetMemoryRegions() {
       fextl::map<uintptr_t, size_t> regions;
 
@@ -460,6 +491,10 @@ namespace FEX::HarnessHelper {
       return Config.CompareStates(State1, State2, SupportsAVX);
     }
 
+    bool DumpState(fextl::string const &Filename, FEXCore::Core::CPUState const* State, bool SupportsAVX) {
+      return Config.DumpState(Filename, State, SupportsAVX);
+    }
+
     bool Is64BitMode() const { return Config.Is64BitMode(); }
     bool Requires3DNow()  const { return Config.Requires3DNow(); }
     bool RequiresSSE4A()  const { return Config.RequiresSSE4A(); }
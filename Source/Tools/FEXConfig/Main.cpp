@@ -480,6 +480,13 @@ namespace {
         ConfigChanged = true;
       }
 
+      Value = LoadedConfig->Get(FEXCore::Config::ConfigOption::CONFIG_RULECACHE);
+      bool RuleCache = Value.has_value() && **Value == "1";
+      if (ImGui::Checkbox("Cache rule matches", &RuleCache)) {
+        LoadedConfig->EraseSet(FEXCore::Config::ConfigOption::CONFIG_RULECACHE, RuleCache ? "1" : "0");
+        ConfigChanged = true;
+      }
+
       Value = LoadedConfig->Get(FEXCore::Config::ConfigOption::CONFIG_CACHEOBJECTCODECOMPILATION);
 
       ImGui::Text("Cache JIT object code:");
@@ -20,7 +20,6 @@ $end_info$
 #include "LinuxSyscalls/x64/Syscalls.h"
 #include "LinuxSyscalls/SignalDelegator.h"
 #include "Linux/Utils/ELFContainer.h"
-#include "../../../FEXCore/Source/Interface/Core/PatternDbt/parse.h"
 
 #include <FEXCore/Config/Config.h>
 #include <FEXCore/Core/Context.h>
@@ -479,6 +478,15 @@ int main(int argc, char **argv, char **const envp) {
     DebugServer = fextl::make_unique<FEX::GdbServer>(CTX.get(), SignalDelegation.get(), SyscallHandler.get());
   }
 
+  FEX_CONFIG_OPT(RuleStatsSignal, RULESTATSSIGNAL);
+  if (RuleStatsSignal) {
+    // Only flags the request, the rule statistics are written outside of the signal handler
+    SignalDelegation->RegisterHostSignalHandler(RuleStatsSignal, [CTX = CTX.get()] (FEXCore::Core::InternalThreadState *Thread, int Signal, void *info, void *ucontext) {
+      CTX->RequestRuleStatsDump();
+      return true;
+    }, true);
+  }
+
   if (!CTX->InitCore()) {
     return 1;
   }
@@ -533,7 +541,7 @@ int main(int argc, char **argv, char **const envp) {
     });
   }
 
-  ParseTranslationRules(ParentThread->ThreadManager.PID);
+  CTX->LoadTranslationRules(ParentThread->ThreadManager.PID);
 
   if (AOTIRGenerate()) {
     for(auto &Section: Loader.Sections) {
@@ -543,6 +551,10 @@ int main(int argc, char **argv, char **const envp) {
     CTX->RunUntilExit(ParentThread);
   }
 
+  // Keeps the rule matches and rule order of this run for the next one and writes the rule mining reports,
+  // does nothing unless RuleCache, RuleProfile or RuleMining is enabled
+  CTX->FinalizeRuleCache();
+
   if (AOTEnabled) {
     if (FHU::Filesystem::CreateDirectories(fextl::fmt::format("{}/aotir", FEXCore::Config::GetDataDirectory()))) {
       CTX->WriteFilesWithCode([](const fextl::string& fileid, const fextl::string& filename) {
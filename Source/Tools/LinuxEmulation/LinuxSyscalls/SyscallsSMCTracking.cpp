@@ -190,6 +190,9 @@ void SyscallHandler::TrackMmap(FEXCore::Core::InternalThreadState *Thread, uintp
     CTX->MarkMemoryShared(Thread);
   }
 
+  // Executable file mappings get their code objects cached
+  fextl::string NamedRegionFilename;
+
   {
     // NOTE: Frontend calls this with a nullptr Thread during initialization, but
     //       providing this code with a valid Thread object earlier would allow
@@ -217,6 +220,10 @@ void SyscallHandler::TrackMmap(FEXCore::Core::InternalThreadState *Thread, uintp
           Resource->AOTIRCacheEntry = CTX->LoadAOTIRCacheEntry(fextl::string(Tmp, PathLength));
           Resource->Iterator = Iter;
         }
+
+        if (Prot & PROT_EXEC) {
+          NamedRegionFilename = fextl::string(Tmp, PathLength);
+        }
       }
     } else if (Flags & MAP_SHARED) {
       MRID mrid{SpecialDev::Anon, AnonSharedId++};
@@ -232,6 +239,10 @@ void SyscallHandler::TrackMmap(FEXCore::Core::InternalThreadState *Thread, uintp
     VMATracking.SetUnsafe(CTX, Resource, Base, Offset, Size, VMAFlags::fromFlags(Flags), VMAProt::fromProt(Prot));
   }
 
+  if (!NamedRegionFilename.empty()) {
+    CTX->AddNamedRegion(Thread, Base, Size, Offset, NamedRegionFilename);
+  }
+
   if (SMCChecks != FEXCore::Config::CONFIG_SMC_NONE) {
     // VMATracking.Mutex can't be held while executing this, otherwise it hangs if the JIT is in the process of looking up code in the AOT JIT.
     CTX->InvalidateGuestCodeRange(Thread, (uintptr_t)Base, Size);
@@ -250,6 +261,8 @@ void SyscallHandler::TrackMunmap(FEXCore::Core::InternalThreadState *Thread, uin
     VMATracking.ClearUnsafe(CTX, Base, Size);
   }
 
+  CTX->RemoveNamedRegion(Thread, Base, Size);
+
   if (SMCChecks != FEXCore::Config::CONFIG_SMC_NONE) {
     CTX->InvalidateGuestCodeRange(Thread, (uintptr_t)Base, Size);
   }
@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: MIT
+/*
+$info$
+tags: Bin|RuleDBCompiler
+desc: Compiles the translation rule text into the binary rule database mapped by FEXLoader
+$end_info$
+*/
+
+#include "Interface/Core/PatternDbt/parse.h"
+#include "Interface/Core/PatternDbt/rule-db.h"
+
+#include <FEXCore/Utils/LogManager.h>
+#include <FEXCore/fextl/fmt.h>
+#include <FEXCore/fextl/string.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+void MsgHandler(LogMan::DebugLevels Level, char const *Message) {
+  // Rule parsing is chatty at the info level, only forward problems.
+  if (Level > LogMan::ERROR) {
+    return;
+  }
+  fextl::fmt::print("[{}] {}\n", LogMan::DebugLevelStr(Level), Message);
+}
+
+void AssertHandler(char const *Message) {
+  fextl::fmt::print("[ASSERT] {}\n", Message);
+  fflush(nullptr);
+}
+
+void PrintUsage(char const *Name) {
+  fextl::fmt::print("Usage: {} [-b <base address>] [rule text] [output]\n", Name);
+  fextl::fmt::print("  Defaults to $HOME/rules4all and $HOME/rules4all.db, which FEXLoader maps at startup.\n");
+}
+}
+
+int main(int argc, char **argv) {
+  LogMan::Throw::InstallHandler(AssertHandler);
+  LogMan::Msg::InstallHandler(MsgHandler);
+
+  uint64_t Base = RULE_DB_DEFAULT_BASE;
+  fextl::string Home = getenv("HOME") ?: ".";
+  fextl::string Input = Home + "/rules4all";
+  fextl::string Output = Home + "/rules4all.db";
+
+  int Arg = 1;
+  if (Arg < argc && (!strcmp(argv[Arg], "-h") || !strcmp(argv[Arg], "--help"))) {
+    PrintUsage(argv[0]);
+    return 0;
+  }
+
+  if (Arg + 1 < argc && !strcmp(argv[Arg], "-b")) {
+    Base = strtoull(argv[Arg + 1], nullptr, 0);
+    Arg += 2;
+  }
+
+  if (Arg < argc) {
+    Input = argv[Arg++];
+  }
+
+  if (Arg < argc) {
+    Output = argv[Arg++];
+  }
+
+  if (Arg != argc) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  auto Rules = fextl::make_unique<RuleSet>();
+  if (!ParseTranslationRuleFile(Input.c_str(), Rules.get())) {
+    LogMan::Msg::EFmt("Couldn't load translation rules from {}", Input);
+    return 1;
+  }
+
+  if (!rule_db_write(Rules.get(), Output.c_str(), Input.c_str(), Base)) {
+    LogMan::Msg::EFmt("Couldn't write rule database {}", Output);
+    return 1;
+  }
+
+  fextl::fmt::print("{} rules compiled to {}, linked at {:#x}\n", Rules->rule_num, Output, Base);
+  return 0;
+}
@@ -0,0 +1,199 @@
+// SPDX-License-Identifier: MIT
+/*
+$info$
+tags: Bin|RuleMatchBench
+desc: Compares the hash chain and trie rule lookups on a recorded corpus of guest blocks
+$end_info$
+*/
+
+#include "Interface/Core/PatternDbt/parse.h"
+#include "Interface/Core/PatternDbt/rule-index.h"
+#include "Interface/Core/PatternDbt/x86-parse.h"
+
+#include <FEXCore/Utils/LogManager.h>
+#include <FEXCore/fextl/fmt.h>
+#include <FEXCore/fextl/string.h>
+#include <FEXCore/fextl/vector.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace {
+void MsgHandler(LogMan::DebugLevels Level, char const *Message) {
+  // Rule loading is chatty at the info level, only forward problems.
+  if (Level > LogMan::ERROR) {
+    return;
+  }
+  fextl::fmt::print("[{}] {}\n", LogMan::DebugLevelStr(Level), Message);
+}
+
+void AssertHandler(char const *Message) {
+  fextl::fmt::print("[ASSERT] {}\n", Message);
+  fflush(nullptr);
+}
+
+struct CorpusBlock {
+  X86Instruction *Instrs;
+  uint32_t NumInstrs;
+};
+
+// The corpus uses the guest half of the rule syntax, one "N.Guest:" header per block.
+// This is the format DEBUG_RULE_LOG writes to fex-asm.log.
+bool LoadCorpus(char const *Path, fextl::vector<CorpusBlock> *Blocks) {
+  std::ifstream File(Path);
+  if (!File.is_open()) {
+    return false;
+  }
+
+  fextl::vector<fextl::string> Chunks;
+  std::string Line;
+  while (std::getline(File, Line)) {
+    if (Line.empty()) {
+      continue;
+    }
+    if (Line.find(".Guest:") != std::string::npos) {
+      Chunks.emplace_back();
+      continue;
+    }
+    if (Chunks.empty() || Line[0] == '#') {
+      continue;
+    }
+    Chunks.back() += Line;
+    Chunks.back() += '\n';
+  }
+
+  for (auto &Chunk : Chunks) {
+    if (Chunk.empty()) {
+      continue;
+    }
+
+    FILE *fp = fmemopen(Chunk.data(), Chunk.size(), "r");
+    if (!fp) {
+      return false;
+    }
+
+    TranslationRule Block{};
+    parse_rule_x86_code(fp, &Block);
+    fclose(fp);
+
+    if (Block.x86_guest) {
+      Blocks->push_back({Block.x86_guest, Block.guest_instr_num});
+    }
+  }
+
+  return true;
+}
+
+// Opcode and operand shape comparison, the first thing match_rule_internal checks on every candidate.
+bool ShapeMatches(X86Instruction *Guest, TranslationRule *Rule) {
+  for (X86Instruction *RuleInstr = Rule->x86_guest; RuleInstr; RuleInstr = RuleInstr->next, Guest = Guest->next) {
+    if (!Guest || Guest->opc == X86_OPC_INVALID) {
+      return false;
+    }
+    const uint32_t RuleKey = rule_shape_key(RuleInstr);
+    if (RuleKey != rule_shape_key(Guest) && RuleKey != RULE_SHAPE_ANY(Guest->opc)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+struct BenchResult {
+  uint64_t Nanoseconds{};
+  uint64_t CandidatesVisited{};
+  uint64_t BlocksWithCandidate{};
+};
+
+BenchResult RunHashChains(RuleSet const *Rules, fextl::vector<CorpusBlock> const &Blocks, uint32_t Iterations) {
+  BenchResult Result{};
+  RuleCandidate Cands[MAX_RULE_CANDIDATES];
+
+  auto Begin = std::chrono::high_resolution_clock::now();
+  for (uint32_t Iter = 0; Iter < Iterations; ++Iter) {
+    for (auto &Block : Blocks) {
+      bool Found = false;
+      for (int Len = Block.NumInstrs; Len > 0 && !Found; --Len) {
+        int Num = rule_hash_lookup(Rules, Block.Instrs, Len, Cands, MAX_RULE_CANDIDATES);
+        for (int i = 0; i < Num; ++i) {
+          ++Result.CandidatesVisited;
+          if (ShapeMatches(Block.Instrs, Cands[i].rule)) {
+            Found = true;
+            break;
+          }
+        }
+      }
+      Result.BlocksWithCandidate += Found;
+    }
+  }
+  auto End = std::chrono::high_resolution_clock::now();
+
+  Result.Nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(End - Begin).count();
+  return Result;
+}
+
+BenchResult RunTrie(RuleSet const *Rules, fextl::vector<CorpusBlock> const &Blocks, uint32_t Iterations) {
+  BenchResult Result{};
+  RuleCandidate Cands[MAX_RULE_CANDIDATES];
+
+  auto Begin = std::chrono::high_resolution_clock::now();
+  for (uint32_t Iter = 0; Iter < Iterations; ++Iter) {
+    for (auto &Block : Blocks) {
+      // Same check per candidate as the hash chains, the trie only hands out fewer of them
+      bool Found = false;
+      int Num = rule_index_lookup(Rules, Block.Instrs, Cands, MAX_RULE_CANDIDATES);
+      for (int i = 0; i < Num; ++i) {
+        ++Result.CandidatesVisited;
+        if (ShapeMatches(Block.Instrs, Cands[i].rule)) {
+          Found = true;
+          break;
+        }
+      }
+      Result.BlocksWithCandidate += Found;
+    }
+  }
+  auto End = std::chrono::high_resolution_clock::now();
+
+  Result.Nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(End - Begin).count();
+  return Result;
+}
+
+void PrintResult(char const *Name, BenchResult const &Result, size_t NumBlocks, uint32_t Iterations) {
+  const uint64_t Lookups = NumBlocks * Iterations;
+  fextl::fmt::print("{:>12}: {:>10.1f} ns/block, {:>8.2f} candidates/block, {} blocks with a candidate\n",
+    Name,
+    Lookups ? static_cast<double>(Result.Nanoseconds) / Lookups : 0.0,
+    Lookups ? static_cast<double>(Result.CandidatesVisited) / Lookups : 0.0,
+    Iterations ? Result.BlocksWithCandidate / Iterations : 0);
+}
+}
+
+int main(int argc, char **argv) {
+  LogMan::Throw::InstallHandler(AssertHandler);
+  LogMan::Msg::InstallHandler(MsgHandler);
+
+  if (argc < 2) {
+    LogMan::Msg::EFmt("Usage: {} <block corpus> [iterations]", argv[0]);
+    return 1;
+  }
+
+  const uint32_t Iterations = argc > 2 ? std::max(1, atoi(argv[2])) : 100;
+
+  // Loads $HOME/rules4all, same as FEXLoader.
+  auto Rules = ParseTranslationRules(0);
+
+  fextl::vector<CorpusBlock> Blocks;
+  if (!LoadCorpus(argv[1], &Blocks)) {
+    LogMan::Msg::EFmt("Couldn't load block corpus from {}", argv[1]);
+    return 1;
+  }
+
+  fextl::fmt::print("{} blocks, {} iterations, {} trie nodes\n", Blocks.size(), Iterations, rule_index_node_num(Rules.get()));
+
+  PrintResult("hash chains", RunHashChains(Rules.get(), Blocks, Iterations), Blocks.size(), Iterations);
+  PrintResult("trie", RunTrie(Rules.get(), Blocks, Iterations), Blocks.size(), Iterations);
+
+  return 0;
+}
@@ -20,7 +20,6 @@ $end_info$
 #include "Common/ArgumentLoader.h"
 #include "TestHarnessRunner/HostRunner.h"
 #include "HarnessHelpers.h"
-#include "../../../FEXCore/Source/Interface/Core/PatternDbt/parse.h"
 
 #include <FEXCore/Config/Config.h>
 #include <FEXCore/Core/Context.h>
@@ -218,6 +217,7 @@ int main(int argc, char **argv, char **const envp) {
 #endif
 
   FEX_CONFIG_OPT(Core, CORE);
+  FEX_CONFIG_OPT(DumpGuestState, DUMPGUESTSTATE);
 
 #ifndef _WIN32
   fextl::unique_ptr<FEX::HLE::MemAllocator> Allocator;
@@ -302,7 +302,7 @@ int main(int argc, char **argv, char **const envp) {
       return 1;
     }
 
-    ParseTranslationRules(ParentThread->ThreadManager.PID);
+    CTX->LoadTranslationRules(ParentThread->ThreadManager.PID);
 
     int LongJumpVal = setjmp(LongJumpHandler::LongJump);
     if (!LongJumpVal) {
@@ -333,6 +333,10 @@ int main(int argc, char **argv, char **const envp) {
 
   bool Passed = !LongJumpHandler::DidFault && Loader.CompareStates(&State, nullptr, SupportsAVX);
 
+  if (!DumpGuestState().empty()) {
+    Loader.DumpState(DumpGuestState(), &State, SupportsAVX);
+  }
+
   LogMan::Msg::IFmt("Faulted? {}", LongJumpHandler::DidFault ? "Yes" : "No");
   LogMan::Msg::IFmt("Passed? {}", Passed ? "Yes" : "No");
 